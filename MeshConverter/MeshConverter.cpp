@@ -0,0 +1,368 @@
+// Offline converter from Wavefront OBJ to the binary mesh format VulkanTest loads with --mesh
+//
+//   MeshConverter [--float] <output.vmesh> <lod0.obj> [<lod1.obj> ...]
+//
+// Each input becomes one level of detail, most detailed first. The renderer draws in 2D, so only
+// x and y are kept: the mesh is centred on LOD 0's bounds and scaled to fit [-0.5, 0.5], with y
+// flipped to Vulkan's downward clip space. Vertex colours (the "v x y z r g b" extension) are
+// kept, meshes without them get a gradient across their bounds.
+//
+// Triangles are reordered for the vertex cache and vertices for fetch locality. Vertices are
+// quantized to PackedVertex unless a LOD has edges too short for it (see
+// MeshData::preferredEncoding) or --float is passed.
+#include <algorithm>                        // std::min, std::max
+#include <cstdint>
+#include <cstdlib>                          // EXIT_SUCCESS/FAILURE macros, strtof, strtol
+#include <fstream>                          // Reading OBJ, writing the mesh file
+#include <iostream>                         // Error reporting and progress
+#include <stdexcept>                        // Error reporting
+#include <string>
+#include <vector>
+
+#include "MeshFile.h"                       // The output format
+#include "Mesh.h"                           // MeshData, quantization
+#include "VertexCacheOptimizer.h"           // Triangle and vertex reordering
+
+namespace
+{
+    // Cache size the reported ACMR figures are measured with, typical of current hardware
+    const uint32_t REPORTED_CACHE_SIZE = 16;
+
+    struct ObjMesh
+    {
+        std::vector<float>          positions;                      // x, y per vertex
+        std::vector<float>          colors;                         // r, g, b per vertex, empty if any vertex had none
+        std::vector<uint32_t>       indices;
+    };
+
+    // Reads "12", "12/4", "12//7" or "12/4/7", returning the position index as zero based
+    uint32_t parseFaceVertex(const char*& cursor, size_t vertexCount, const std::string& path, uint64_t lineNumber)
+    {
+        char* end = nullptr;
+        long index = strtol(cursor, &end, 10);
+
+        if (end == cursor)
+        {
+            throw std::runtime_error(path + ":" + std::to_string(lineNumber) + ": malformed face");
+        }
+
+        // Texture coordinates and normals are not needed
+        while (*end != '\0' && *end != ' ' && *end != '\t' && *end != '\r') end++;
+        cursor = end;
+
+        // Negative indices count back from the most recent vertex
+        long resolved = index < 0 ? static_cast<long>(vertexCount) + index : index - 1;
+
+        if (index == 0 || resolved < 0 || static_cast<size_t>(resolved) >= vertexCount)
+        {
+            throw std::runtime_error(path + ":" + std::to_string(lineNumber) + ": face refers to missing vertex " + std::to_string(index));
+        }
+
+        return static_cast<uint32_t>(resolved);
+    }
+
+    ObjMesh readObj(const std::string& path)
+    {
+        std::ifstream file(path);
+
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Failed to open " + path);
+        }
+
+        ObjMesh mesh;
+        bool allColored = true;
+        std::vector<uint32_t> polygon;
+        std::string line;
+        uint64_t lineNumber = 0;
+
+        while (std::getline(file, line))
+        {
+            lineNumber++;
+            const char* cursor = line.c_str();
+
+            if (cursor[0] == 'v' && (cursor[1] == ' ' || cursor[1] == '\t'))
+            {
+                float values[6];
+                int valueCount = 0;
+                cursor += 2;
+
+                for (; valueCount < 6; valueCount++)
+                {
+                    char* end = nullptr;
+                    values[valueCount] = strtof(cursor, &end);
+                    if (end == cursor) break;
+                    cursor = end;
+                }
+
+                if (valueCount < 3)
+                {
+                    throw std::runtime_error(path + ":" + std::to_string(lineNumber) + ": vertex needs at least x, y and z");
+                }
+
+                mesh.positions.push_back(values[0]);
+                mesh.positions.push_back(values[1]);
+
+                allColored = allColored && valueCount == 6;
+
+                if (allColored)
+                {
+                    mesh.colors.insert(mesh.colors.end(), values + 3, values + 6);
+                }
+            }
+            else if (cursor[0] == 'f' && (cursor[1] == ' ' || cursor[1] == '\t'))
+            {
+                size_t vertexCount = mesh.positions.size() / 2;
+                polygon.clear();
+                cursor += 2;
+
+                while (true)
+                {
+                    while (*cursor == ' ' || *cursor == '\t' || *cursor == '\r') cursor++;
+                    if (*cursor == '\0') break;
+
+                    polygon.push_back(parseFaceVertex(cursor, vertexCount, path, lineNumber));
+                }
+
+                if (polygon.size() < 3)
+                {
+                    throw std::runtime_error(path + ":" + std::to_string(lineNumber) + ": face needs at least three vertices");
+                }
+
+                // Polygons are assumed convex, as exporters write them
+                for (size_t i = 1; i + 1 < polygon.size(); i++)
+                {
+                    mesh.indices.push_back(polygon[0]);
+                    mesh.indices.push_back(polygon[i]);
+                    mesh.indices.push_back(polygon[i + 1]);
+                }
+            }
+            // Everything else (normals, texture coordinates, groups, materials) is ignored
+        }
+
+        if (mesh.indices.empty())
+        {
+            throw std::runtime_error(path + " contains no faces");
+        }
+
+        if (!allColored)
+        {
+            mesh.colors.clear();
+        }
+
+        return mesh;
+    }
+
+    void writePadding(std::ofstream& file, uint64_t& offset)
+    {
+        static const char zeros[MESH_FILE_ALIGNMENT] = {};
+
+        uint64_t aligned = alignMeshFileOffset(offset);
+        file.write(zeros, static_cast<std::streamsize>(aligned - offset));
+        offset = aligned;
+    }
+
+    // Placed like LOD 0 (see the top of the file), with gradient colours if the OBJ has none
+    MeshData buildLod(const ObjMesh& obj, float centerX, float centerY, float scale)
+    {
+        MeshData mesh;
+        size_t vertexCount = obj.positions.size() / 2;
+        mesh.vertices.resize(vertexCount);
+
+        for (size_t i = 0; i < vertexCount; i++)
+        {
+            Vertex& vertex = mesh.vertices[i];
+            vertex.position[0] = (obj.positions[2 * i] - centerX) * scale;
+            vertex.position[1] = (centerY - obj.positions[2 * i + 1]) * scale;
+
+            if (!obj.colors.empty())
+            {
+                vertex.color[0] = obj.colors[3 * i];
+                vertex.color[1] = obj.colors[3 * i + 1];
+                vertex.color[2] = obj.colors[3 * i + 2];
+            }
+            else
+            {
+                float u = std::min(std::max(vertex.position[0] + 0.5f, 0.0f), 1.0f);
+                float v = std::min(std::max(vertex.position[1] + 0.5f, 0.0f), 1.0f);
+
+                vertex.color[0] = u;
+                vertex.color[1] = v;
+                vertex.color[2] = 1.0f - u;
+            }
+        }
+
+        mesh.indices = obj.indices;
+
+        return mesh;
+    }
+
+    void convert(const std::string& outputPath, const std::vector<std::string>& inputPaths, bool allowQuantization)
+    {
+        // Every LOD's vertices end up in one blob, their indices stay relative to their own range
+        MeshData combined;
+        std::vector<MeshFileLod> lods;
+        VertexEncoding encoding = allowQuantization ? VertexEncoding::Quantized : VertexEncoding::Float;
+
+        float centerX = 0.0f;
+        float centerY = 0.0f;
+        float scale = 1.0f;
+
+        for (const std::string& path : inputPaths)
+        {
+            ObjMesh obj = readObj(path);
+            size_t vertexCount = obj.positions.size() / 2;
+
+            // LOD 0 decides the placement of every level, so they line up with each other
+            if (lods.empty())
+            {
+                float minX = obj.positions[0], maxX = minX;
+                float minY = obj.positions[1], maxY = minY;
+
+                for (size_t i = 0; i < vertexCount; i++)
+                {
+                    minX = std::min(minX, obj.positions[2 * i]);
+                    maxX = std::max(maxX, obj.positions[2 * i]);
+                    minY = std::min(minY, obj.positions[2 * i + 1]);
+                    maxY = std::max(maxY, obj.positions[2 * i + 1]);
+                }
+
+                float extent = std::max(maxX - minX, maxY - minY);
+
+                centerX = 0.5f * (minX + maxX);
+                centerY = 0.5f * (minY + maxY);
+                scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+            }
+
+            MeshData lodMesh = buildLod(obj, centerX, centerY, scale);
+
+            float missRatioBefore = averageCacheMissRatio(lodMesh.indices, lodMesh.vertices.size(), REPORTED_CACHE_SIZE);
+            optimizeVertexCache(lodMesh);
+            float missRatioAfter = averageCacheMissRatio(lodMesh.indices, lodMesh.vertices.size(), REPORTED_CACHE_SIZE);
+
+            // Quantization is all or nothing, one LOD too fine for it keeps the whole file float
+            if (encoding == VertexEncoding::Quantized && lodMesh.preferredEncoding() == VertexEncoding::Float)
+            {
+                std::cout << path << ": edges too short for 16 bit positions, keeping 32 bit floats" << std::endl;
+                encoding = VertexEncoding::Float;
+            }
+
+            if (combined.vertices.size() + lodMesh.vertices.size() > INT32_MAX || combined.indices.size() + lodMesh.indices.size() > UINT32_MAX)
+            {
+                throw std::runtime_error("Too much geometry for one mesh file");
+            }
+
+            MeshFileLod lod{};
+            lod.firstIndex = static_cast<uint32_t>(combined.indices.size());
+            lod.indexCount = static_cast<uint32_t>(lodMesh.indices.size());
+            lod.vertexOffset = static_cast<int32_t>(combined.vertices.size());
+            lods.push_back(lod);
+
+            combined.vertices.insert(combined.vertices.end(), lodMesh.vertices.begin(), lodMesh.vertices.end());
+            combined.indices.insert(combined.indices.end(), lodMesh.indices.begin(), lodMesh.indices.end());
+
+            std::cout << path << ": LOD " << (lods.size() - 1) << ", " << lodMesh.vertices.size() << " vertices, "
+                      << (lodMesh.indices.size() / 3) << " triangles, ACMR " << missRatioBefore << " -> " << missRatioAfter 
+                      << " (" << REPORTED_CACHE_SIZE << " entry FIFO)" << std::endl;
+        }
+
+        const std::vector<Vertex>& vertices = combined.vertices;
+        const std::vector<uint32_t>& indices = combined.indices;
+        bool quantized = encoding == VertexEncoding::Quantized;
+
+        MeshFileHeader header{};
+        header.magic = MESH_FILE_MAGIC;
+        header.version = MESH_FILE_VERSION;
+        header.vertexEncoding = static_cast<uint32_t>(encoding);
+        header.vertexStride = quantized ? sizeof(PackedVertex) : sizeof(Vertex);
+        header.vertexCount = vertices.size();
+        header.indexCount = indices.size();
+        header.lodCount = static_cast<uint32_t>(lods.size());
+        header.boundingRadius = combined.boundingRadius();
+        header.positionScale = quantized ? combined.positionQuantizationScale() : 1.0f;
+        header.boundsMin[0] = header.boundsMax[0] = vertices[0].position[0];
+        header.boundsMin[1] = header.boundsMax[1] = vertices[0].position[1];
+
+        for (const Vertex& vertex : vertices)
+        {
+            for (int axis = 0; axis < 2; axis++)
+            {
+                header.boundsMin[axis] = std::min(header.boundsMin[axis], vertex.position[axis]);
+                header.boundsMax[axis] = std::max(header.boundsMax[axis], vertex.position[axis]);
+            }
+        }
+
+        std::vector<PackedVertex> packed;
+        if (quantized) packed = combined.quantizedVertices(header.positionScale);
+
+        const char* vertexData = quantized ? reinterpret_cast<const char*>(packed.data()) : reinterpret_cast<const char*>(vertices.data());
+        uint64_t vertexBytes = header.vertexStride * header.vertexCount;
+
+        // Header, LOD table, vertices, indices, each aligned
+        header.lodOffset = alignMeshFileOffset(sizeof(MeshFileHeader));
+        header.vertexOffset = alignMeshFileOffset(header.lodOffset + sizeof(MeshFileLod) * lods.size());
+        header.indexOffset = alignMeshFileOffset(header.vertexOffset + vertexBytes);
+
+        std::ofstream file(outputPath, std::ios::binary | std::ios::trunc);
+
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Failed to create " + outputPath);
+        }
+
+        uint64_t offset = 0;
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        offset += sizeof(header);
+        writePadding(file, offset);
+
+        file.write(reinterpret_cast<const char*>(lods.data()), sizeof(MeshFileLod) * lods.size());
+        offset += sizeof(MeshFileLod) * lods.size();
+        writePadding(file, offset);
+
+        file.write(vertexData, static_cast<std::streamsize>(vertexBytes));
+        offset += vertexBytes;
+        writePadding(file, offset);
+
+        file.write(reinterpret_cast<const char*>(indices.data()), sizeof(uint32_t) * indices.size());
+
+        if (!file.good())
+        {
+            throw std::runtime_error("Failed to write " + outputPath);
+        }
+
+        std::cout << "Wrote " << outputPath << ": " << lods.size() << " LODs, " << vertices.size() << " vertices at " 
+                  << header.vertexStride << " bytes each (" << (quantized ? "snorm16 position, unorm8 colour" : "float32") << "), "
+                  << (indices.size() / 3) << " triangles" << std::endl;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> arguments(argv + 1, argv + argc);
+    bool allowQuantization = true;
+
+    if (!arguments.empty() && arguments[0] == "--float")
+    {
+        allowQuantization = false;
+        arguments.erase(arguments.begin());
+    }
+
+    if (arguments.size() < 2)
+    {
+        std::cerr << "Usage: MeshConverter [--float] <output.vmesh> <lod0.obj> [<lod1.obj> ...]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        convert(arguments[0], std::vector<std::string>(arguments.begin() + 1, arguments.end()), allowQuantization);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,185 @@
+#include "VertexCacheOptimizer.h"
+
+#include <algorithm>                        // std::find
+#include <cmath>                            // std::pow
+#include <cstdint>                          // SIZE_MAX
+#include <limits>                           // std::numeric_limits
+
+namespace
+{
+    // Modelled cache, larger than most hardware's so the order suits all of them
+    const uint32_t CACHE_SIZE = 32;
+
+    // Forsyth's scoring: vertices of the last triangle score a fixed amount (so the next one is
+    // not forced to reuse all three), older cache entries decay with their position, and vertices
+    // with few triangles left get a boost so they are finished off rather than left stranded
+    const float LAST_TRIANGLE_SCORE = 0.75f;
+    const float CACHE_DECAY_POWER = 1.5f;
+    const float VALENCE_BOOST_SCALE = 2.0f;
+    const float VALENCE_BOOST_POWER = 0.5f;
+
+    const uint32_t NOT_CACHED = UINT32_MAX;
+
+    float vertexScore(uint32_t cachePosition, uint32_t remainingTriangles)
+    {
+        // No triangles left to draw, nothing to gain from this vertex
+        if (remainingTriangles == 0) return -1.0f;
+
+        float score = 0.0f;
+
+        if (cachePosition != NOT_CACHED)
+        {
+            if (cachePosition < 3)
+            {
+                score = LAST_TRIANGLE_SCORE;
+            }
+            else
+            {
+                float scaler = 1.0f / (CACHE_SIZE - 3);
+                score = std::pow(1.0f - (cachePosition - 3) * scaler, CACHE_DECAY_POWER);
+            }
+        }
+
+        return score + VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remainingTriangles), -VALENCE_BOOST_POWER);
+    }
+
+    void reorderTriangles(std::vector<uint32_t>& indices, size_t vertexCount)
+    {
+        size_t triangleCount = indices.size() / 3;
+
+        // Triangles of every vertex, as one array sliced by adjacencyStart
+        std::vector<uint32_t> remaining(vertexCount, 0);
+        for (uint32_t index : indices) remaining[index]++;
+
+        std::vector<size_t> adjacencyStart(vertexCount + 1, 0);
+        for (size_t v = 0; v < vertexCount; v++) adjacencyStart[v + 1] = adjacencyStart[v] + remaining[v];
+
+        std::vector<uint32_t> adjacency(indices.size());
+        std::vector<size_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+
+        for (size_t i = 0; i < indices.size(); i++)
+        {
+            adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        std::vector<uint32_t> cachePosition(vertexCount, NOT_CACHED);
+        std::vector<float> score(vertexCount);
+        std::vector<float> triangleScore(triangleCount, 0.0f);
+        std::vector<bool> emitted(triangleCount, false);
+
+        for (size_t v = 0; v < vertexCount; v++) score[v] = vertexScore(NOT_CACHED, remaining[v]);
+        for (size_t i = 0; i < indices.size(); i++) triangleScore[i / 3] += score[indices[i]];
+
+        std::vector<uint32_t> cache;
+        std::vector<uint32_t> nextCache;
+        std::vector<uint32_t> output;
+        output.reserve(indices.size());
+
+        size_t bestTriangle = 0;
+        size_t scanCursor = 0;
+
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            // Nothing in the cache leads anywhere: restart at the next triangle not yet drawn
+            if (bestTriangle == SIZE_MAX)
+            {
+                while (emitted[scanCursor]) scanCursor++;
+                bestTriangle = scanCursor;
+            }
+
+            const uint32_t* triangle = &indices[bestTriangle * 3];
+            emitted[bestTriangle] = true;
+            output.insert(output.end(), triangle, triangle + 3);
+
+            // The triangle's vertices move to the front, everything else shifts back
+            nextCache.assign(triangle, triangle + 3);
+
+            for (uint32_t vertex : cache)
+            {
+                if (std::find(triangle, triangle + 3, vertex) == triangle + 3) nextCache.push_back(vertex);
+            }
+
+            for (int corner = 0; corner < 3; corner++) remaining[triangle[corner]]--;
+
+            for (size_t i = 0; i < nextCache.size(); i++)
+            {
+                uint32_t vertex = nextCache[i];
+                cachePosition[vertex] = i < CACHE_SIZE ? static_cast<uint32_t>(i) : NOT_CACHED;
+
+                float newScore = vertexScore(cachePosition[vertex], remaining[vertex]);
+                float delta = newScore - score[vertex];
+                score[vertex] = newScore;
+
+                for (size_t a = adjacencyStart[vertex]; a < adjacencyStart[vertex + 1]; a++)
+                {
+                    triangleScore[adjacency[a]] += delta;
+                }
+            }
+
+            if (nextCache.size() > CACHE_SIZE) nextCache.resize(CACHE_SIZE);
+            std::swap(cache, nextCache);
+
+            // Only triangles touching the cache are candidates, which keeps this linear
+            float bestScore = -std::numeric_limits<float>::max();
+            bestTriangle = SIZE_MAX;
+
+            for (uint32_t vertex : cache)
+            {
+                for (size_t a = adjacencyStart[vertex]; a < adjacencyStart[vertex + 1]; a++)
+                {
+                    uint32_t candidate = adjacency[a];
+
+                    if (!emitted[candidate] && triangleScore[candidate] > bestScore)
+                    {
+                        bestScore = triangleScore[candidate];
+                        bestTriangle = candidate;
+                    }
+                }
+            }
+        }
+
+        indices.swap(output);
+    }
+}
+
+void optimizeVertexCache(MeshData& mesh)
+{
+    reorderTriangles(mesh.indices, mesh.vertices.size());
+
+    // Renumber in order of first use
+    std::vector<uint32_t> remap(mesh.vertices.size(), UINT32_MAX);
+    std::vector<Vertex> vertices;
+    vertices.reserve(mesh.vertices.size());
+
+    for (uint32_t& index : mesh.indices)
+    {
+        if (remap[index] == UINT32_MAX)
+        {
+            remap[index] = static_cast<uint32_t>(vertices.size());
+            vertices.push_back(mesh.vertices[index]);
+        }
+
+        index = remap[index];
+    }
+
+    mesh.vertices.swap(vertices);
+}
+
+float averageCacheMissRatio(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize)
+{
+    // Miss count at which each vertex entered the FIFO (0 for never), it stays cached until
+    // cacheSize more misses have pushed it out
+    std::vector<uint64_t> insertedAt(vertexCount, 0);
+    uint64_t misses = 0;
+
+    for (uint32_t index : indices)
+    {
+        if (insertedAt[index] == 0 || misses - insertedAt[index] >= cacheSize)
+        {
+            misses++;
+            insertedAt[index] = misses;
+        }
+    }
+
+    return indices.empty() ? 0.0f : static_cast<float>(misses) / (indices.size() / 3);
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Mesh.h"                           // MeshData
+
+// Reorders the triangles of a mesh so consecutive triangles share vertices still in the GPU's
+// post-transform cache, using Tom Forsyth's linear-speed greedy algorithm. Then renumbers the
+// vertices in order of first use, so vertex fetch walks the buffer front to back. Vertices no
+// triangle uses are dropped.
+void optimizeVertexCache(MeshData&);
+
+// Vertices transformed per triangle (ACMR) by a FIFO cache of cacheSize entries. 3 is the worst
+// case, a regular grid approaches 0.5
+float averageCacheMissRatio(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize);
@@ -0,0 +1,326 @@
+#include "ApplicationSettings.h"
+
+#include <stdexcept>                        // Error reporting
+#include <iostream>                         // Usage output
+#include <cstring>                          // strcmp
+
+// Reads the value following argv[i], advancing i past it
+static const char* nextArgument(int argc, char** argv, int& i)
+{
+    if (i + 1 >= argc)
+    {
+        throw std::runtime_error(std::string("Missing value for ") + argv[i]);
+    }
+
+    return argv[++i];
+}
+
+static uint64_t parseUnsigned(const char* option, const char* value)
+{
+    try
+    {
+        size_t consumed = 0;
+        unsigned long long parsed = std::stoull(value, &consumed);
+
+        if (consumed == strlen(value) && value[0] != '-')
+        {
+            return parsed;
+        }
+    }
+    catch (const std::exception&)
+    {
+        // Fall through to the error below
+    }
+
+    throw std::runtime_error(std::string("Invalid value for ") + option + ": " + value);
+}
+
+ApplicationSettings ApplicationSettings::fromCommandLine(int argc, char** argv)
+{
+    ApplicationSettings settings;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char* argument = argv[i];
+
+        if (strcmp(argument, "--help") == 0 || strcmp(argument, "-h") == 0)
+        {
+            settings.showHelp = true;
+        }
+        else if (strcmp(argument, "--headless") == 0)
+        {
+            settings.headless = true;
+        }
+        else if (strcmp(argument, "--frames") == 0)
+        {
+            settings.frameCount = parseUnsigned(argument, nextArgument(argc, argv, i));
+        }
+        else if (strcmp(argument, "--width") == 0)
+        {
+            settings.width = static_cast<uint32_t>(parseUnsigned(argument, nextArgument(argc, argv, i)));
+        }
+        else if (strcmp(argument, "--height") == 0)
+        {
+            settings.height = static_cast<uint32_t>(parseUnsigned(argument, nextArgument(argc, argv, i)));
+        }
+        else if (strcmp(argument, "--frames-in-flight") == 0)
+        {
+            settings.framesInFlight = static_cast<uint32_t>(parseUnsigned(argument, nextArgument(argc, argv, i)));
+        }
+        else if (strcmp(argument, "--worker-threads") == 0)
+        {
+            settings.workerThreads = static_cast<uint32_t>(parseUnsigned(argument, nextArgument(argc, argv, i)));
+        }
+        else if (strcmp(argument, "--resize-storm") == 0)
+        {
+            settings.resizeStorm = static_cast<uint32_t>(parseUnsigned(argument, nextArgument(argc, argv, i)));
+        }
+        else if (strcmp(argument, "--draws") == 0)
+        {
+            settings.drawCount = static_cast<uint32_t>(parseUnsigned(argument, nextArgument(argc, argv, i)));
+        }
+        else if (strcmp(argument, "--record-threads") == 0)
+        {
+            settings.recordThreads = static_cast<uint32_t>(parseUnsigned(argument, nextArgument(argc, argv, i)));
+        }
+        else if (strcmp(argument, "--instances") == 0)
+        {
+            settings.instanceCount = static_cast<uint32_t>(parseUnsigned(argument, nextArgument(argc, argv, i)));
+        }
+        else if (strcmp(argument, "--gpu-driven") == 0)
+        {
+            settings.gpuDriven = true;
+        }
+        else if (strcmp(argument, "--cull-benchmark") == 0)
+        {
+            settings.cullBenchmark = true;
+            settings.headless = true;
+        }
+        else if (strcmp(argument, "--vertex-benchmark") == 0)
+        {
+            settings.vertexBenchmark = true;
+            settings.headless = true;
+        }
+        else if (strcmp(argument, "--mip-benchmark") == 0)
+        {
+            settings.mipBenchmark = true;
+            settings.headless = true;
+        }
+        else if (strcmp(argument, "--particles") == 0)
+        {
+            settings.particleCount = static_cast<uint32_t>(parseUnsigned(argument, nextArgument(argc, argv, i)));
+        }
+        else if (strcmp(argument, "--particles-on-graphics-queue") == 0)
+        {
+            settings.particlesOnGraphicsQueue = true;
+        }
+        else if (strcmp(argument, "--particle-benchmark") == 0)
+        {
+            settings.particleBenchmark = true;
+            settings.headless = true;
+        }
+        else if (strcmp(argument, "--legacy-render-pass") == 0)
+        {
+            settings.legacyRenderPass = true;
+        }
+        else if (strcmp(argument, "--rendering-benchmark") == 0)
+        {
+            settings.renderingBenchmark = true;
+            settings.headless = true;
+        }
+        else if (strcmp(argument, "--render-graph-benchmark") == 0)
+        {
+            settings.renderGraphBenchmark = true;
+            settings.headless = true;
+        }
+        else if (strcmp(argument, "--msaa") == 0)
+        {
+            settings.msaaSamples = static_cast<uint32_t>(parseUnsigned(argument, nextArgument(argc, argv, i)));
+        }
+        else if (strcmp(argument, "--msaa-benchmark") == 0)
+        {
+            settings.msaaBenchmark = true;
+            settings.headless = true;
+        }
+        else if (strcmp(argument, "--depth-prepass") == 0)
+        {
+            settings.depthPrepass = true;
+        }
+        else if (strcmp(argument, "--overdraw-benchmark") == 0)
+        {
+            settings.overdrawBenchmark = true;
+            settings.headless = true;
+        }
+        else if (strcmp(argument, "--mesh") == 0)
+        {
+            settings.meshPath = nextArgument(argc, argv, i);
+        }
+        else if (strcmp(argument, "--texture") == 0)
+        {
+            settings.texturePaths.push_back(nextArgument(argc, argv, i));
+        }
+        else if (strcmp(argument, "--texture-budget") == 0)
+        {
+            settings.textureBudget = parseUnsigned(argument, nextArgument(argc, argv, i)) * 1024 * 1024;
+        }
+        else if (strcmp(argument, "--record-benchmark") == 0)
+        {
+            // Only CPU recording is measured, there is no need for a window
+            settings.recordBenchmark = true;
+            settings.headless = true;
+        }
+        else if (strcmp(argument, "--pipeline-cache") == 0)
+        {
+            const char* value = nextArgument(argc, argv, i);
+            settings.pipelineCachePath = strcmp(value, "none") == 0 ? "" : value;
+        }
+        else if (strcmp(argument, "--profile-report") == 0)
+        {
+            const char* value = nextArgument(argc, argv, i);
+
+            if (strcmp(value, "none") == 0)         settings.profileReport = ProfileReportFormat::None;
+            else if (strcmp(value, "text") == 0)    settings.profileReport = ProfileReportFormat::Text;
+            else if (strcmp(value, "json") == 0)    settings.profileReport = ProfileReportFormat::Json;
+            else throw std::runtime_error(std::string("Invalid value for --profile-report: ") + value);
+        }
+        else if (strcmp(argument, "--profile-output") == 0)
+        {
+            settings.profileOutput = nextArgument(argc, argv, i);
+        }
+        else
+        {
+            throw std::runtime_error(std::string("Unknown argument: ") + argument + " (see --help)");
+        }
+    }
+
+    if (settings.width == 0 || settings.height == 0)
+    {
+        throw std::runtime_error("--width and --height must be greater than zero");
+    }
+
+    if (settings.framesInFlight == 0 || settings.framesInFlight > g_MAX_FRAMES_IN_FLIGHT)
+    {
+        throw std::runtime_error("--frames-in-flight must be between 1 and " + std::to_string(g_MAX_FRAMES_IN_FLIGHT));
+    }
+
+    if (settings.recordThreads == 0 || settings.recordThreads > g_MAX_RECORD_THREADS)
+    {
+        throw std::runtime_error("--record-threads must be between 1 and " + std::to_string(g_MAX_RECORD_THREADS));
+    }
+
+    if (settings.instanceCount > g_MAX_INSTANCES)
+    {
+        throw std::runtime_error("--instances must be at most " + std::to_string(g_MAX_INSTANCES));
+    }
+
+    if (settings.recordBenchmark && settings.instanceCount > 0)
+    {
+        throw std::runtime_error("--instances records a single draw and cannot be combined with --record-benchmark");
+    }
+
+    if ((settings.gpuDriven || settings.cullBenchmark) && settings.instanceCount > 0)
+    {
+        throw std::runtime_error("--gpu-driven and --cull-benchmark draw the draw list and cannot be combined with --instances");
+    }
+
+    if (settings.recordBenchmark && (settings.gpuDriven || settings.cullBenchmark))
+    {
+        throw std::runtime_error("--record-benchmark times CPU recording and cannot be combined with --gpu-driven or --cull-benchmark");
+    }
+
+    if (settings.vertexBenchmark && (settings.recordBenchmark || settings.cullBenchmark || settings.gpuDriven || settings.instanceCount > 0))
+    {
+        throw std::runtime_error("--vertex-benchmark draws its own meshes and cannot be combined with other benchmarks, --gpu-driven or --instances");
+    }
+
+    if (settings.mipBenchmark && (settings.recordBenchmark || settings.cullBenchmark || settings.vertexBenchmark))
+    {
+        throw std::runtime_error("--mip-benchmark cannot be combined with other benchmarks");
+    }
+
+    if (settings.particleCount > g_MAX_PARTICLES)
+    {
+        throw std::runtime_error("--particles must be at most " + std::to_string(g_MAX_PARTICLES));
+    }
+
+    if ((settings.particleCount > 0 || settings.particleBenchmark) && settings.recordThreads > 1)
+    {
+        throw std::runtime_error("--particles and --particle-benchmark draw into the primary command buffer and cannot be combined with --record-threads");
+    }
+
+    if (settings.particleBenchmark && (settings.recordBenchmark || settings.cullBenchmark || settings.vertexBenchmark || settings.mipBenchmark))
+    {
+        throw std::runtime_error("--particle-benchmark cannot be combined with other benchmarks");
+    }
+
+    if (settings.overdrawBenchmark && (settings.recordBenchmark || settings.cullBenchmark || settings.vertexBenchmark || settings.mipBenchmark || settings.particleBenchmark))
+    {
+        throw std::runtime_error("--overdraw-benchmark cannot be combined with other benchmarks");
+    }
+
+    if (settings.msaaSamples == 0 || settings.msaaSamples > 64 || (settings.msaaSamples & (settings.msaaSamples - 1)) != 0)
+    {
+        throw std::runtime_error("--msaa must be 1, 2, 4, 8, 16, 32 or 64");
+    }
+
+    if (settings.msaaBenchmark && (settings.recordBenchmark || settings.cullBenchmark || settings.vertexBenchmark || settings.mipBenchmark || settings.particleBenchmark || settings.overdrawBenchmark))
+    {
+        throw std::runtime_error("--msaa-benchmark cannot be combined with other benchmarks");
+    }
+
+    if (settings.renderingBenchmark && (settings.recordBenchmark || settings.cullBenchmark || settings.vertexBenchmark || settings.mipBenchmark || settings.particleBenchmark || settings.overdrawBenchmark || settings.msaaBenchmark))
+    {
+        throw std::runtime_error("--rendering-benchmark cannot be combined with other benchmarks");
+    }
+
+    if (settings.renderGraphBenchmark && (settings.recordBenchmark || settings.cullBenchmark || settings.vertexBenchmark || settings.mipBenchmark || settings.particleBenchmark || settings.overdrawBenchmark || settings.msaaBenchmark || settings.renderingBenchmark))
+    {
+        throw std::runtime_error("--render-graph-benchmark cannot be combined with other benchmarks");
+    }
+
+    if (settings.headless && settings.resizeStorm > 0)
+    {
+        throw std::runtime_error("--resize-storm needs a window and cannot be combined with --headless");
+    }
+
+    return settings;
+}
+
+void ApplicationSettings::printUsage()
+{
+    std::cout
+        << "Usage: VulkanTest [options]\n"
+        << "  --headless            Render into offscreen images without a window and report frames/sec\n"
+        << "  --frames <n>          Number of frames to render in headless mode (default " << g_HEADLESS_DEFAULT_FRAMES << ")\n"
+        << "  --width <px>          Window / render target width (default " << g_WINDOW_WIDTH << ")\n"
+        << "  --height <px>         Window / render target height (default " << g_WINDOW_HEIGHT << ")\n"
+        << "  --frames-in-flight <n> Frames the CPU may run ahead of the GPU, 1-" << g_MAX_FRAMES_IN_FLIGHT << " (default " << g_DEFAULT_FRAMES_IN_FLIGHT << ")\n"
+        << "  --worker-threads <n>  Background threads for pipeline compilation, 0 = one per spare core (default 0)\n"
+        << "  --resize-storm <n>    Resize the window n times, " << g_RESIZE_STORM_INTERVAL_MS << " ms apart, then report the worst frame and exit\n"
+        << "  --draws <n>           Triangles drawn per frame, one draw call each (default 1)\n"
+        << "  --record-threads <n>  Threads recording the draws into secondary command buffers, 1-" << g_MAX_RECORD_THREADS << " (default 1)\n"
+        << "  --instances <n>       Instanced stress mode: n copies of the mesh in one draw, moved on the CPU every frame (up to " << g_MAX_INSTANCES << ")\n"
+        << "  --gpu-driven          Cull the draws in a compute pass and draw the survivors with indirect draws\n"
+        << "  --cull-benchmark      Compare CPU recorded and GPU-driven drawing of 10k-100k draws, then exit\n"
+        << "  --vertex-benchmark    Compare float32 and quantized vertices on 64^2-1024^2 cell grids, then exit\n"
+        << "  --mip-benchmark       Compare single pass compute and blit chain mip generation at 1K-8K, then exit\n"
+        << "  --particles <n>       Simulate n particles on the compute queue and draw them as points (up to " << g_MAX_PARTICLES << ")\n"
+        << "  --particles-on-graphics-queue Simulate the particles on the graphics queue, ahead of the render pass\n"
+        << "  --particle-benchmark  Compare async compute and graphics queue particle simulation of 1M-8M particles, then exit\n"
+        << "  --legacy-render-pass  Render through render pass and framebuffer objects even where dynamic rendering is supported\n"
+        << "  --rendering-benchmark Compare dynamic rendering and render pass objects at 1k and 10k draws, then exit\n"
+        << "  --render-graph-benchmark Compile and run a post processing render graph, report its barriers and aliased memory, then exit\n"
+        << "  --msaa <n>            Samples per pixel, resolved within the render pass: 1-64, lowered to what the device supports (default 1)\n"
+        << "  --msaa-benchmark      Compare frame time and attachment memory traffic of every supported sample count, then exit\n"
+        << "  --depth-prepass       Draw the draw list depth only first, then shade it with an EQUAL depth test\n"
+        << "  --overdraw-benchmark  Compare 4-64 full screen layers with and without the depth prepass, then exit\n"
+        << "  --mesh <p>            Draw a mesh written by MeshConverter instead of the built-in triangle\n"
+        << "  --texture <p>         Stream in a KTX2 texture for the mesh draws, repeat to spread several over them\n"
+        << "  --texture-budget <MiB> Full mip chains kept resident before evicting (default " << g_TEXTURE_STREAMING_BUDGET / (1024 * 1024) << ")\n"
+        << "  --record-benchmark    Time command recording of 10k-100k draws against thread count, then exit\n"
+        << "  --pipeline-cache <p>  Pipeline cache file, or none for a cold start every run (default " << g_PIPELINE_CACHE_DEFAULT_PATH << ")\n"
+        << "  --profile-report <f>  Frame timing report on exit: none, text or json (default text)\n"
+        << "  --profile-output <p>  Write the frame timing report to a file instead of stdout\n"
+        << "  --help                Show this message\n"
+        << "Press P in the window to print a frame timing report on demand.\n";
+}
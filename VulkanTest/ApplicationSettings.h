@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "GlobalApplicationConstants.h"     // const uint32_t WINDOW_HEIGHT etc
+#include "FrameProfiler.h"                  // ProfileReportFormat
+
+// Runtime configuration, filled in from the command line by main()
+struct ApplicationSettings
+{
+    // MEMBERS
+    bool                    showHelp = false;                       // --help was passed, print usage and exit
+    bool                    headless = false;                       // Render offscreen, no window/surface/swapchain
+    uint32_t                width = g_WINDOW_WIDTH;
+    uint32_t                height = g_WINDOW_HEIGHT;
+    uint64_t                frameCount = g_HEADLESS_DEFAULT_FRAMES; // Frames rendered before a headless run exits
+    uint32_t                framesInFlight = g_DEFAULT_FRAMES_IN_FLIGHT;
+    uint32_t                workerThreads = 0;                      // Background worker threads, 0 = one per spare core
+    uint32_t                resizeStorm = 0;                        // Resizes forced by the resize benchmark, 0 = off
+    uint32_t                drawCount = 1;                          // Triangles in the draw list, one draw each
+    uint32_t                recordThreads = 1;                      // Threads recording the draw list each frame
+    bool                    recordBenchmark = false;                // Time command recording instead of rendering
+    uint32_t                instanceCount = 0;                      // Instanced stress mode replacing the draw list, 0 = off
+    bool                    gpuDriven = false;                      // Cull and draw the draw list from the GPU
+    bool                    cullBenchmark = false;                  // Compare CPU recorded and GPU-driven drawing, then exit
+    bool                    vertexBenchmark = false;                // Compare float and quantized vertices, then exit
+    bool                    mipBenchmark = false;                   // Compare compute and blit mip generation, then exit
+    uint32_t                particleCount = 0;                      // Particles simulated and drawn every frame, 0 = off
+    bool                    particlesOnGraphicsQueue = false;       // Simulate them on the graphics queue, not the compute queue
+    bool                    particleBenchmark = false;              // Compare async compute and graphics queue particles, then exit
+    bool                    legacyRenderPass = false;               // Render through VkRenderPass even where dynamic rendering is supported
+    bool                    renderingBenchmark = false;             // Compare dynamic rendering and render pass objects, then exit
+    bool                    renderGraphBenchmark = false;           // Compile and run a post processing render graph, then exit
+    uint32_t                msaaSamples = 1;                        // Samples per pixel, lowered to what the device supports
+    bool                    msaaBenchmark = false;                  // Compare the cost of every supported sample count, then exit
+    bool                    depthPrepass = false;                   // Lay down depth before shading the draw list
+    bool                    overdrawBenchmark = false;              // Compare overdraw with and without the prepass, then exit
+    std::string             meshPath;                               // .vmesh file drawn instead of the triangle, when set
+    std::vector<std::string> texturePaths;                          // KTX2 files streamed in and spread over the mesh draws
+    uint64_t                textureBudget = g_TEXTURE_STREAMING_BUDGET; // Bytes of full mip chains resident at once
+    ProfileReportFormat     profileReport = ProfileReportFormat::Text;
+    std::string             profileOutput;                          // Report file, stdout when empty
+    std::string             pipelineCachePath = g_PIPELINE_CACHE_DEFAULT_PATH; // Empty keeps the cache in memory only
+
+    // FUNCTIONS
+    static ApplicationSettings fromCommandLine(int argc, char** argv);
+    static void printUsage();
+};
@@ -0,0 +1,204 @@
+#include "BindlessTable.h"
+
+#include <stdexcept>                        // Error reporting
+#include <string>
+
+namespace
+{
+    const uint32_t TEXTURE_BINDING = 0;
+    const uint32_t BUFFER_BINDING = 1;
+}
+
+BindlessTable::BindlessTable()
+{
+    m_device = VK_NULL_HANDLE;
+    m_allocationCallbacks = nullptr;
+    m_descriptorSetLayout = VK_NULL_HANDLE;
+    m_descriptorPool = VK_NULL_HANDLE;
+    m_descriptorSet = VK_NULL_HANDLE;
+    m_textureSlots.nextUnused = 0;
+    m_textureSlots.capacity = 0;
+    m_bufferSlots.nextUnused = 0;
+    m_bufferSlots.capacity = 0;
+}
+
+void BindlessTable::create(VkDevice device, const VkAllocationCallbacks* allocationCallbacks, uint32_t textureCapacity, uint32_t bufferCapacity)
+{
+    m_device = device;
+    m_allocationCallbacks = allocationCallbacks;
+    m_textureSlots.capacity = textureCapacity;
+    m_bufferSlots.capacity = bufferCapacity;
+
+    VkDescriptorSetLayoutBinding bindings[2]{};
+    bindings[TEXTURE_BINDING].binding = TEXTURE_BINDING;
+    bindings[TEXTURE_BINDING].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[TEXTURE_BINDING].descriptorCount = textureCapacity;
+    bindings[TEXTURE_BINDING].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+
+    bindings[BUFFER_BINDING].binding = BUFFER_BINDING;
+    bindings[BUFFER_BINDING].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[BUFFER_BINDING].descriptorCount = bufferCapacity;
+    bindings[BUFFER_BINDING].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkDescriptorBindingFlags bindingFlags[2] = {
+        VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT,
+        VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT
+    };
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+    bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    bindingFlagsInfo.bindingCount = 2;
+    bindingFlagsInfo.pBindingFlags = bindingFlags;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext = &bindingFlagsInfo;
+    layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    layoutInfo.bindingCount = 2;
+    layoutInfo.pBindings = bindings;
+
+    if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, m_allocationCallbacks, &m_descriptorSetLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create bindless descriptor set layout");
+    }
+
+    VkDescriptorPoolSize poolSizes[2]{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[0].descriptorCount = textureCapacity;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[1].descriptorCount = bufferCapacity;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 2;
+    poolInfo.pPoolSizes = poolSizes;
+
+    if (vkCreateDescriptorPool(m_device, &poolInfo, m_allocationCallbacks, &m_descriptorPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create bindless descriptor pool");
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_descriptorSetLayout;
+
+    if (vkAllocateDescriptorSets(m_device, &allocInfo, &m_descriptorSet) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to allocate bindless descriptor set");
+    }
+}
+
+void BindlessTable::destruct()
+{
+    if (m_descriptorPool != VK_NULL_HANDLE) vkDestroyDescriptorPool(m_device, m_descriptorPool, m_allocationCallbacks);
+    if (m_descriptorSetLayout != VK_NULL_HANDLE) vkDestroyDescriptorSetLayout(m_device, m_descriptorSetLayout, m_allocationCallbacks);
+
+    m_descriptorPool = VK_NULL_HANDLE;
+    m_descriptorSetLayout = VK_NULL_HANDLE;
+    m_descriptorSet = VK_NULL_HANDLE;
+}
+
+BindlessHandle BindlessTable::addTexture(VkImageView imageView, VkSampler sampler)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    uint32_t slot = allocateSlot(m_textureSlots, "texture");
+
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.sampler = sampler;
+    imageInfo.imageView = imageView;
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = m_descriptorSet;
+    write.dstBinding = TEXTURE_BINDING;
+    write.dstArrayElement = slot;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.pImageInfo = &imageInfo;
+
+    vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+
+    return slot;
+}
+
+BindlessHandle BindlessTable::addBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    uint32_t slot = allocateSlot(m_bufferSlots, "buffer");
+
+    VkDescriptorBufferInfo bufferInfo{};
+    bufferInfo.buffer = buffer;
+    bufferInfo.offset = offset;
+    bufferInfo.range = range;
+
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = m_descriptorSet;
+    write.dstBinding = BUFFER_BINDING;
+    write.dstArrayElement = slot;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.pBufferInfo = &bufferInfo;
+
+    vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+
+    return slot;
+}
+
+void BindlessTable::removeTexture(BindlessHandle handle)
+{
+    if (handle == INVALID_BINDLESS_HANDLE) return;
+
+    // The stale descriptor stays behind, partially bound arrays only care about what is read
+    std::lock_guard<std::mutex> lock(m_mutex);
+    freeSlot(m_textureSlots, handle);
+}
+
+void BindlessTable::removeBuffer(BindlessHandle handle)
+{
+    if (handle == INVALID_BINDLESS_HANDLE) return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    freeSlot(m_bufferSlots, handle);
+}
+
+VkDescriptorSetLayout BindlessTable::descriptorSetLayout() const
+{
+    return m_descriptorSetLayout;
+}
+
+VkDescriptorSet BindlessTable::descriptorSet() const
+{
+    return m_descriptorSet;
+}
+
+uint32_t BindlessTable::allocateSlot(SlotAllocator& slots, const char* kind)
+{
+    // Recently freed slots first, which keeps the used range of the array compact
+    if (!slots.freeSlots.empty())
+    {
+        uint32_t slot = slots.freeSlots.back();
+        slots.freeSlots.pop_back();
+
+        return slot;
+    }
+
+    if (slots.nextUnused == slots.capacity)
+    {
+        throw std::runtime_error(std::string("Bindless table is out of ") + kind + " slots (" + std::to_string(slots.capacity) + ")");
+    }
+
+    return slots.nextUnused++;
+}
+
+void BindlessTable::freeSlot(SlotAllocator& slots, uint32_t slot)
+{
+    slots.freeSlots.push_back(slot);
+}
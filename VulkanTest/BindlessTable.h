@@ -0,0 +1,77 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Index of a resource in its BindlessTable array, as passed to shaders
+typedef uint32_t BindlessHandle;
+const BindlessHandle INVALID_BINDLESS_HANDLE = UINT32_MAX;
+
+// One descriptor set holding every texture and storage buffer shaders may read, as runtime sized
+// arrays indexed by a BindlessHandle from push constants or instance data. The set is bound once
+// per command buffer, so draws never rebind descriptors whatever they read.
+//
+//   binding 0  combined image samplers, SHADER_READ_ONLY_OPTIMAL
+//   binding 1  storage buffers
+//
+// Both bindings are update-after-bind and partially bound: slots can be written while the set is
+// bound in pending command buffers as long as nothing pending uses them, and unwritten slots are
+// fine as long as nothing reads them. Slots are recycled through a free list. Removing a resource
+// frees its slot right away, so callers must not remove anything a frame in flight may still
+// index (retire it through the DeletionQueue instead).
+//
+// Requires the descriptor indexing features enabled in createLogicalDevice(). Thread safe.
+class BindlessTable
+{
+public:
+    // CONSTRUCTOR
+    //------------------------------------------------------------------------//
+    BindlessTable();
+    //------------------------------------------------------------------------//
+
+    // PUBLIC FUNCTIONS
+    //------------------------------------------------------------------------//
+    void create(VkDevice, const VkAllocationCallbacks*, uint32_t textureCapacity, uint32_t bufferCapacity);
+    void destruct();
+
+    // Throw std::runtime_error when the array is full
+    BindlessHandle addTexture(VkImageView, VkSampler);
+    BindlessHandle addBuffer(VkBuffer, VkDeviceSize offset, VkDeviceSize range);
+
+    // Invalid handles are ignored
+    void removeTexture(BindlessHandle);
+    void removeBuffer(BindlessHandle);
+
+    VkDescriptorSetLayout descriptorSetLayout() const;
+    VkDescriptorSet descriptorSet() const;
+    //------------------------------------------------------------------------//
+
+private:
+    // Free list over the slots of one binding
+    struct SlotAllocator
+    {
+        std::vector<uint32_t>               freeSlots;
+        uint32_t                            nextUnused;             // Slots from here on were never handed out
+        uint32_t                            capacity;
+    };
+
+    // PRIVATE MEMBERS
+    //------------------------------------------------------------------------//
+    VkDevice                                m_device;
+    const VkAllocationCallbacks*            m_allocationCallbacks;
+    VkDescriptorSetLayout                   m_descriptorSetLayout;
+    VkDescriptorPool                        m_descriptorPool;
+    VkDescriptorSet                         m_descriptorSet;
+    SlotAllocator                           m_textureSlots;
+    SlotAllocator                           m_bufferSlots;
+    std::mutex                              m_mutex;
+    //------------------------------------------------------------------------//
+
+    // PRIVATE FUNCTIONS
+    //------------------------------------------------------------------------//
+    static uint32_t allocateSlot(SlotAllocator&, const char* kind);
+    static void freeSlot(SlotAllocator&, uint32_t slot);
+    //------------------------------------------------------------------------//
+};
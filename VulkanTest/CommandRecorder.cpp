@@ -0,0 +1,226 @@
+#include "CommandRecorder.h"
+
+#include <stdexcept>                        // Error reporting
+
+CommandRecorder::CommandRecorder()
+{
+    m_device = VK_NULL_HANDLE;
+    m_allocationCallbacks = nullptr;
+    m_generation = 0;
+    m_remainingWorkers = 0;
+    m_stopping = false;
+    m_slot = 0;
+    m_inheritance = nullptr;
+    m_itemCount = 0;
+    m_sliceRecorder = nullptr;
+}
+
+CommandRecorder::~CommandRecorder()
+{
+    destruct();
+}
+
+void CommandRecorder::create(VkDevice device, const VkAllocationCallbacks* allocationCallbacks, uint32_t queueFamilyIndex, uint32_t threadCount, uint32_t framesInFlight)
+{
+    if (threadCount == 0)
+    {
+        throw std::runtime_error("Command recording needs at least one thread");
+    }
+
+    m_device = device;
+    m_allocationCallbacks = allocationCallbacks;
+    m_contexts.resize(threadCount);
+    m_sliceBuffers.assign(threadCount, VK_NULL_HANDLE);
+    m_stopping = false;
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = queueFamilyIndex;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;  // Reset as a whole every frame
+
+    for (auto& context : m_contexts)
+    {
+        context.pools.resize(framesInFlight, VK_NULL_HANDLE);
+        context.buffers.resize(framesInFlight, VK_NULL_HANDLE);
+
+        for (uint32_t slot = 0; slot < framesInFlight; slot++)
+        {
+            if (vkCreateCommandPool(m_device, &poolInfo, m_allocationCallbacks, &context.pools[slot]) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Failed to create recording thread command pool");
+            }
+
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool = context.pools[slot];
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            allocInfo.commandBufferCount = 1;
+
+            if (vkAllocateCommandBuffers(m_device, &allocInfo, &context.buffers[slot]) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Failed to allocate secondary command buffer");
+            }
+        }
+    }
+
+    // Pools are created before the workers start, from then on each is only used by its owner
+    for (uint32_t i = 1; i < threadCount; i++)
+    {
+        m_workers.emplace_back(&CommandRecorder::workerLoop, this, i);
+    }
+}
+
+void CommandRecorder::destruct()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+
+    m_workAvailable.notify_all();
+
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+
+    m_workers.clear();
+
+    // Destroying a pool frees its command buffers with it
+    for (auto& context : m_contexts)
+    {
+        for (VkCommandPool pool : context.pools) vkDestroyCommandPool(m_device, pool, m_allocationCallbacks);
+    }
+
+    m_contexts.clear();
+    m_sliceBuffers.clear();
+    m_recorded.clear();
+}
+
+const std::vector<VkCommandBuffer>& CommandRecorder::record(
+    uint32_t slot,
+    const VkCommandBufferInheritanceInfo& inheritance,
+    uint32_t itemCount,
+    const SliceRecorder& sliceRecorder)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_slot = slot;
+        m_inheritance = &inheritance;
+        m_itemCount = itemCount;
+        m_sliceRecorder = &sliceRecorder;
+        m_remainingWorkers = static_cast<uint32_t>(m_workers.size());
+        m_error = nullptr;
+        m_generation++;
+    }
+
+    m_workAvailable.notify_all();
+
+    // Do a share of the work instead of sleeping through it
+    std::exception_ptr callerError;
+
+    try
+    {
+        recordSlice(0);
+    }
+    catch (...)
+    {
+        callerError = std::current_exception();
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_workDone.wait(lock, [this]() { return m_remainingWorkers == 0; });
+    }
+
+    if (callerError) std::rethrow_exception(callerError);
+    if (m_error) std::rethrow_exception(m_error);
+
+    m_recorded.clear();
+
+    for (VkCommandBuffer buffer : m_sliceBuffers)
+    {
+        if (buffer != VK_NULL_HANDLE) m_recorded.push_back(buffer);
+    }
+
+    return m_recorded;
+}
+
+uint32_t CommandRecorder::threadCount() const
+{
+    return static_cast<uint32_t>(m_contexts.size());
+}
+
+void CommandRecorder::workerLoop(uint32_t threadIndex)
+{
+    uint64_t seenGeneration = 0;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_workAvailable.wait(lock, [&]() { return m_stopping || m_generation != seenGeneration; });
+
+            if (m_stopping) return;
+
+            seenGeneration = m_generation;
+        }
+
+        try
+        {
+            recordSlice(threadIndex);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_error) m_error = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_remainingWorkers--;
+        }
+
+        m_workDone.notify_one();
+    }
+}
+
+void CommandRecorder::recordSlice(uint32_t threadIndex)
+{
+    uint32_t threads = threadCount();
+    uint32_t begin = static_cast<uint32_t>(static_cast<uint64_t>(m_itemCount) * threadIndex / threads);
+    uint32_t end = static_cast<uint32_t>(static_cast<uint64_t>(m_itemCount) * (threadIndex + 1) / threads);
+
+    m_sliceBuffers[threadIndex] = VK_NULL_HANDLE;
+
+    // Fewer items than threads, this thread has nothing to add
+    if (begin == end) return;
+
+    ThreadContext& context = m_contexts[threadIndex];
+    VkCommandBuffer commandBuffer = context.buffers[m_slot];
+
+    // The slot's previous frame has completed, so everything recorded from this pool is unused
+    if (vkResetCommandPool(m_device, context.pools[m_slot], 0) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to reset recording thread command pool");
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.pInheritanceInfo = m_inheritance;
+
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to begin recording secondary command buffer");
+    }
+
+    (*m_sliceRecorder)(commandBuffer, begin, end);
+
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to record secondary command buffer");
+    }
+
+    m_sliceBuffers[threadIndex] = commandBuffer;
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <condition_variable>               // Workers sleep on it between frames
+#include <cstdint>
+#include <exception>                        // Worker errors, rethrown on the calling thread
+#include <functional>                       // SliceRecorder
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Records the commands for items [begin, end) of a draw list into a secondary command buffer
+typedef std::function<void(VkCommandBuffer, uint32_t begin, uint32_t end)> SliceRecorder;
+
+// Splits the recording of a draw list across threads. Every thread owns one transient command
+// pool per frame slot and only ever touches its own pools, so recording needs no locking. Pools
+// are reset wholesale (vkResetCommandPool) by their owning thread once the slot comes around
+// again, which is much cheaper than resetting buffers one by one.
+//
+// The calling thread records the first slice itself, the other slices go to threadCount - 1
+// dedicated workers. record() returns once all of them are done.
+class CommandRecorder
+{
+public:
+    // CONSTRUCTOR/DESTRUCTOR
+    //------------------------------------------------------------------------//
+    CommandRecorder();
+    ~CommandRecorder();
+    //------------------------------------------------------------------------//
+
+    // PUBLIC FUNCTIONS
+    //------------------------------------------------------------------------//
+    void create(VkDevice, const VkAllocationCallbacks*, uint32_t queueFamilyIndex, uint32_t threadCount, uint32_t framesInFlight);
+    void destruct();
+
+    // The slot's previous frame must have completed. Secondaries are begun with the given
+    // inheritance info and RENDER_PASS_CONTINUE, so the recorder has to bind its own pipeline and
+    // set any dynamic state. Returns the non-empty slices in draw list order
+    const std::vector<VkCommandBuffer>& record(
+        uint32_t slot,
+        const VkCommandBufferInheritanceInfo&,
+        uint32_t itemCount,
+        const SliceRecorder&
+    );
+
+    uint32_t threadCount() const;
+    //------------------------------------------------------------------------//
+
+private:
+    // PRIVATE MEMBERS
+    //------------------------------------------------------------------------//
+    struct ThreadContext
+    {
+        std::vector<VkCommandPool>          pools;                  // One per frame slot
+        std::vector<VkCommandBuffer>        buffers;                // One secondary per frame slot
+    };
+
+    VkDevice                                m_device;
+    const VkAllocationCallbacks*            m_allocationCallbacks;
+    std::vector<ThreadContext>              m_contexts;             // Index 0 is the calling thread
+    std::vector<std::thread>                m_workers;              // Worker i records slice i + 1
+    std::mutex                              m_mutex;
+    std::condition_variable                 m_workAvailable;
+    std::condition_variable                 m_workDone;
+    uint64_t                                m_generation;           // Bumped by every record() call
+    uint32_t                                m_remainingWorkers;
+    bool                                    m_stopping;
+    std::exception_ptr                      m_error;                // First worker failure of this record()
+
+    // The job of the current record() call, only read by workers while it is waiting on them
+    uint32_t                                m_slot;
+    const VkCommandBufferInheritanceInfo*   m_inheritance;
+    uint32_t                                m_itemCount;
+    const SliceRecorder*                    m_sliceRecorder;
+    std::vector<VkCommandBuffer>            m_sliceBuffers;         // Per thread, null for empty slices
+    std::vector<VkCommandBuffer>            m_recorded;
+    //------------------------------------------------------------------------//
+
+    // PRIVATE FUNCTIONS
+    //------------------------------------------------------------------------//
+    void workerLoop(uint32_t threadIndex);
+    void recordSlice(uint32_t threadIndex);
+    //------------------------------------------------------------------------//
+};
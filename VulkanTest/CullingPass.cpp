@@ -0,0 +1,291 @@
+#include "CullingPass.h"
+
+#include <stdexcept>                        // Error reporting
+
+namespace
+{
+    // Matches local_size_x in cull.comp
+    const uint32_t CULL_GROUP_SIZE = 64;
+}
+
+CullingPass::CullingPass()
+{
+    m_device = VK_NULL_HANDLE;
+    m_allocationCallbacks = nullptr;
+    m_allocator = nullptr;
+    m_stagingUploader = nullptr;
+    m_pipelineRegistry = nullptr;
+    m_bindlessTable = nullptr;
+    m_drawIndirectCount = false;
+    m_multiDrawIndirect = false;
+    m_descriptorSetLayout = VK_NULL_HANDLE;
+    m_descriptorPool = VK_NULL_HANDLE;
+    m_descriptorSet = VK_NULL_HANDLE;
+    m_pipelineLayout = VK_NULL_HANDLE;
+    m_pipeline = INVALID_PIPELINE_HANDLE;
+    m_objectBuffer = VK_NULL_HANDLE;
+    m_objectBufferHandle = INVALID_BINDLESS_HANDLE;
+    m_commandBuffer = VK_NULL_HANDLE;
+    m_countBuffer = VK_NULL_HANDLE;
+    m_objectCount = 0;
+    m_indexCount = 0;
+    m_boundingRadius = 0.0f;
+    m_upload = 0;
+}
+
+void CullingPass::create(
+    VkDevice device,
+    const VkAllocationCallbacks* allocationCallbacks,
+    DeviceAllocator& allocator,
+    StagingUploader& stagingUploader,
+    PipelineRegistry& pipelineRegistry,
+    BindlessTable& bindlessTable,
+    bool drawIndirectCount,
+    bool multiDrawIndirect)
+{
+    m_device = device;
+    m_allocationCallbacks = allocationCallbacks;
+    m_allocator = &allocator;
+    m_stagingUploader = &stagingUploader;
+    m_pipelineRegistry = &pipelineRegistry;
+    m_bindlessTable = &bindlessTable;
+    m_drawIndirectCount = drawIndirectCount;
+    m_multiDrawIndirect = multiDrawIndirect;
+
+    // Objects, commands and count, in cull.comp's binding order
+    VkDescriptorSetLayoutBinding bindings[3]{};
+
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 3;
+    layoutInfo.pBindings = bindings;
+
+    if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, m_allocationCallbacks, &m_descriptorSetLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create culling descriptor set layout");
+    }
+
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSize.descriptorCount = 3;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+
+    if (vkCreateDescriptorPool(m_device, &poolInfo, m_allocationCallbacks, &m_descriptorPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create culling descriptor pool");
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_descriptorSetLayout;
+
+    if (vkAllocateDescriptorSets(m_device, &allocInfo, &m_descriptorSet) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to allocate culling descriptor set");
+    }
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(CullConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &m_descriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, m_allocationCallbacks, &m_pipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create culling pipeline layout");
+    }
+
+    PipelineDescription description;
+    description.computeShader = "shaders/cull.spv";
+    description.layout = m_pipelineLayout;
+
+    m_pipeline = pipelineRegistry.request(description);
+}
+
+void CullingPass::destruct()
+{
+    destroyBuffers();
+
+    // The registry owns the pipeline itself and outlives this
+    if (m_pipelineLayout != VK_NULL_HANDLE) vkDestroyPipelineLayout(m_device, m_pipelineLayout, m_allocationCallbacks);
+    if (m_descriptorPool != VK_NULL_HANDLE) vkDestroyDescriptorPool(m_device, m_descriptorPool, m_allocationCallbacks);
+    if (m_descriptorSetLayout != VK_NULL_HANDLE) vkDestroyDescriptorSetLayout(m_device, m_descriptorSetLayout, m_allocationCallbacks);
+
+    m_pipelineLayout = VK_NULL_HANDLE;
+    m_descriptorPool = VK_NULL_HANDLE;
+    m_descriptorSetLayout = VK_NULL_HANDLE;
+}
+
+void CullingPass::setObjects(const std::vector<DrawCommand>& objects, uint32_t meshIndexCount, float meshBoundingRadius)
+{
+    destroyBuffers();
+
+    m_objectCount = static_cast<uint32_t>(objects.size());
+    m_indexCount = meshIndexCount;
+    m_boundingRadius = meshBoundingRadius;
+
+    if (m_objectCount == 0) return;
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = sizeof(DrawCommand) * objects.size();
+    bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    m_allocator->createBuffer(bufferInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_objectBuffer, m_objectAllocation);
+
+    bufferInfo.size = sizeof(VkDrawIndexedIndirectCommand) * objects.size();
+    bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+
+    m_allocator->createBuffer(bufferInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_commandBuffer, m_commandAllocation);
+
+    // Bound even when unused, the shader declares it either way
+    bufferInfo.size = sizeof(uint32_t);
+    bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+    m_allocator->createBuffer(bufferInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_countBuffer, m_countAllocation);
+
+    // Read by the culling shader and, through the bindless table, by the vertex shader
+    m_upload = m_stagingUploader->uploadBuffer(
+        m_objectBuffer,
+        0,
+        objects.data(),
+        sizeof(DrawCommand) * objects.size(),
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+        VK_ACCESS_SHADER_READ_BIT
+    );
+
+    m_objectBufferHandle = m_bindlessTable->addBuffer(m_objectBuffer, 0, VK_WHOLE_SIZE);
+
+    VkDescriptorBufferInfo bufferInfos[3]{};
+    bufferInfos[0] = { m_objectBuffer, 0, VK_WHOLE_SIZE };
+    bufferInfos[1] = { m_commandBuffer, 0, VK_WHOLE_SIZE };
+    bufferInfos[2] = { m_countBuffer, 0, VK_WHOLE_SIZE };
+
+    VkWriteDescriptorSet writes[3]{};
+
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = m_descriptorSet;
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[i].pBufferInfo = &bufferInfos[i];
+    }
+
+    vkUpdateDescriptorSets(m_device, 3, writes, 0, nullptr);
+}
+
+bool CullingPass::isReady() const
+{
+    return m_objectCount > 0 &&
+           m_stagingUploader->isReady(m_upload) &&
+           m_pipelineRegistry->get(m_pipeline) != VK_NULL_HANDLE;
+}
+
+void CullingPass::recordReset(VkCommandBuffer commandBuffer)
+{
+    if (m_drawIndirectCount)
+    {
+        vkCmdFillBuffer(commandBuffer, m_countBuffer, 0, sizeof(uint32_t), 0);
+    }
+}
+
+void CullingPass::record(VkCommandBuffer commandBuffer, const DrawCommand& view)
+{
+    CullConstants constants{};
+    constants.viewOffsetX = view.offsetX;
+    constants.viewOffsetY = view.offsetY;
+    constants.viewScale = view.scale;
+    constants.boundingRadius = m_boundingRadius;
+    constants.objectCount = m_objectCount;
+    constants.indexCount = m_indexCount;
+    constants.compact = m_drawIndirectCount ? 1 : 0;
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineRegistry->get(m_pipeline));
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_descriptorSet, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullConstants), &constants);
+    vkCmdDispatch(commandBuffer, (m_objectCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+}
+
+void CullingPass::draw(VkCommandBuffer commandBuffer)
+{
+    const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+
+    if (m_drawIndirectCount)
+    {
+        vkCmdDrawIndexedIndirectCount(commandBuffer, m_commandBuffer, 0, m_countBuffer, 0, m_objectCount, stride);
+    }
+    else if (m_multiDrawIndirect)
+    {
+        vkCmdDrawIndexedIndirect(commandBuffer, m_commandBuffer, 0, m_objectCount, stride);
+    }
+    else
+    {
+        // One call per object, but nothing for the CPU to decide, culled commands draw nothing
+        for (uint32_t i = 0; i < m_objectCount; i++)
+        {
+            vkCmdDrawIndexedIndirect(commandBuffer, m_commandBuffer, static_cast<VkDeviceSize>(i) * stride, 1, stride);
+        }
+    }
+}
+
+BindlessHandle CullingPass::objectBuffer() const
+{
+    return m_objectBufferHandle;
+}
+
+VkBuffer CullingPass::indirectBuffer() const
+{
+    return m_commandBuffer;
+}
+
+VkBuffer CullingPass::countBuffer() const
+{
+    return m_countBuffer;
+}
+
+bool CullingPass::usesDrawCount() const
+{
+    return m_drawIndirectCount;
+}
+
+void CullingPass::destroyBuffers()
+{
+    if (m_allocator == nullptr) return;
+
+    // Like the buffers, the slot is reused right away
+    m_bindlessTable->removeBuffer(m_objectBufferHandle);
+    m_objectBufferHandle = INVALID_BINDLESS_HANDLE;
+
+    m_allocator->destroyBuffer(m_objectBuffer, m_objectAllocation);
+    m_allocator->destroyBuffer(m_commandBuffer, m_commandAllocation);
+    m_allocator->destroyBuffer(m_countBuffer, m_countAllocation);
+
+    m_objectBuffer = VK_NULL_HANDLE;
+    m_commandBuffer = VK_NULL_HANDLE;
+    m_countBuffer = VK_NULL_HANDLE;
+    m_objectCount = 0;
+}
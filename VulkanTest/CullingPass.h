@@ -0,0 +1,121 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "DeviceAllocator.h"                // Object and indirect command buffers
+#include "StagingUploader.h"                // Object uploads
+#include "PipelineRegistry.h"               // The culling compute pipeline
+#include "BindlessTable.h"                  // Objects as read by the vertex shader
+#include "DrawList.h"                       // DrawCommand, the per object data
+
+// GPU-driven drawing of the draw list. A compute pass tests every object's bounds against the
+// view and writes an indexed indirect draw for each survivor, and the graphics pass consumes them
+// with one vkCmdDrawIndexedIndirectCount. Recording costs the same whatever the object count.
+//
+// Without drawIndirectCount every object keeps a command of its own, culled ones with no
+// instances, drawn by a single multi-draw indirect (or one indirect draw per object without
+// multiDrawIndirect). Each command selects its object through firstInstance, which the vertex
+// shader uses as gl_InstanceIndex to index the object buffer through its bindless handle, so
+// drawIndirectFirstInstance is required.
+//
+// Render thread only.
+class CullingPass
+{
+public:
+    // CONSTRUCTOR
+    //------------------------------------------------------------------------//
+    CullingPass();
+    //------------------------------------------------------------------------//
+
+    // PUBLIC FUNCTIONS
+    //------------------------------------------------------------------------//
+    void create(
+        VkDevice,
+        const VkAllocationCallbacks*,
+        DeviceAllocator&,
+        StagingUploader&,
+        PipelineRegistry&,
+        BindlessTable&,
+        bool drawIndirectCount,
+        bool multiDrawIndirect
+    );
+    void destruct();
+
+    // Uploads a new set of objects. The previous buffers are destroyed right away, so the GPU must
+    // be done with them
+    void setObjects(const std::vector<DrawCommand>&, uint32_t meshIndexCount, float meshBoundingRadius);
+
+    // The compute pipeline is compiled and the objects have been acquired by the graphics queue
+    bool isReady() const;
+
+    // Outside a render pass, with drawIndirectCount: zeroes countBuffer() ahead of record()
+    void recordReset(VkCommandBuffer);
+
+    // Outside a render pass: culls against the view, given as a DrawCommand applied after each
+    // object's own. Fills the indirect buffer consumed by draw(). Records no barriers, the caller
+    // orders it after recordReset() and earlier draws, and before draw(). The frame's render
+    // graph does, from the buffers' accesses
+    void record(VkCommandBuffer, const DrawCommand& view);
+
+    // Inside the render pass, with the pipeline bound, the mesh at vertex binding 0 and
+    // objectBuffer() in the push constants
+    void draw(VkCommandBuffer);
+
+    // The DrawCommands in the bindless table, INVALID_BINDLESS_HANDLE without objects
+    BindlessHandle objectBuffer() const;
+
+    // Written by record() and read by draw(). The count buffer is only used with drawIndirectCount
+    VkBuffer indirectBuffer() const;
+    VkBuffer countBuffer() const;
+
+    bool usesDrawCount() const;
+    //------------------------------------------------------------------------//
+
+private:
+    // Matches CullConstants in cull.comp
+    struct CullConstants
+    {
+        float                               viewOffsetX;
+        float                               viewOffsetY;
+        float                               viewScale;
+        float                               boundingRadius;
+        uint32_t                            objectCount;
+        uint32_t                            indexCount;
+        uint32_t                            compact;
+    };
+
+    // PRIVATE MEMBERS
+    //------------------------------------------------------------------------//
+    VkDevice                                m_device;
+    const VkAllocationCallbacks*            m_allocationCallbacks;
+    DeviceAllocator*                        m_allocator;
+    StagingUploader*                        m_stagingUploader;
+    PipelineRegistry*                       m_pipelineRegistry;
+    BindlessTable*                          m_bindlessTable;
+    bool                                    m_drawIndirectCount;
+    bool                                    m_multiDrawIndirect;
+    VkDescriptorSetLayout                   m_descriptorSetLayout;
+    VkDescriptorPool                        m_descriptorPool;
+    VkDescriptorSet                         m_descriptorSet;
+    VkPipelineLayout                        m_pipelineLayout;
+    PipelineHandle                          m_pipeline;
+    VkBuffer                                m_objectBuffer;         // DrawCommands, read by both passes
+    MemoryAllocation                        m_objectAllocation;
+    BindlessHandle                          m_objectBufferHandle;
+    VkBuffer                                m_commandBuffer;        // VkDrawIndexedIndirectCommands
+    MemoryAllocation                        m_commandAllocation;
+    VkBuffer                                m_countBuffer;          // Surviving draws, drawIndirectCount only
+    MemoryAllocation                        m_countAllocation;
+    uint32_t                                m_objectCount;
+    uint32_t                                m_indexCount;
+    float                                   m_boundingRadius;
+    UploadTicket                            m_upload;
+    //------------------------------------------------------------------------//
+
+    // PRIVATE FUNCTIONS
+    //------------------------------------------------------------------------//
+    void destroyBuffers();
+    //------------------------------------------------------------------------//
+};
@@ -0,0 +1,27 @@
+#include "DeletionQueue.h"
+
+#include <utility>                          // std::move
+
+void DeletionQueue::push(uint64_t retireValue, std::function<void()> destroy)
+{
+    m_entries.push_back(Entry{ retireValue, std::move(destroy) });
+}
+
+void DeletionQueue::flush(uint64_t completedValue)
+{
+    while (!m_entries.empty() && m_entries.front().retireValue <= completedValue)
+    {
+        m_entries.front().destroy();
+        m_entries.pop_front();
+    }
+}
+
+void DeletionQueue::flushAll()
+{
+    flush(UINT64_MAX);
+}
+
+size_t DeletionQueue::size() const
+{
+    return m_entries.size();
+}
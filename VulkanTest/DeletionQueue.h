@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+#include <deque>                            // FIFO of retired resources
+#include <functional>                       // Destruction callbacks
+
+// Defers destroying GPU resources until the frame timeline says nothing can still be using them,
+// so retiring a resource never needs vkDeviceWaitIdle. Values must be pushed in non-decreasing
+// order, which holds as long as they come from the FrameScheduler.
+class DeletionQueue
+{
+public:
+    // PUBLIC FUNCTIONS
+    //------------------------------------------------------------------------//
+    void push(uint64_t retireValue, std::function<void()> destroy);
+    void flush(uint64_t completedValue);
+    void flushAll();
+    size_t size() const;
+    //------------------------------------------------------------------------//
+
+private:
+    struct Entry
+    {
+        uint64_t                retireValue;    // Timeline value after which it is safe to destroy
+        std::function<void()>   destroy;
+    };
+
+    // PRIVATE MEMBERS
+    //------------------------------------------------------------------------//
+    std::deque<Entry>                       m_entries;
+    //------------------------------------------------------------------------//
+};
@@ -0,0 +1,347 @@
+#include "DeviceAllocator.h"
+
+#include <algorithm>                        // std::max, std::min
+#include <stdexcept>                        // Error reporting
+#include <string>                           // std::to_string
+
+namespace
+{
+    VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+DeviceAllocator::DeviceAllocator()
+{
+    m_device = VK_NULL_HANDLE;
+    m_allocationCallbacks = nullptr;
+    m_memoryProperties = {};
+    m_bufferImageGranularity = 1;
+    m_maxAllocationCount = 0;
+    m_blockCount = 0;
+    m_dedicatedAllocations = 0;
+    m_frameProfiler = nullptr;
+
+    for (uint32_t i = 0; i < GaugeCount; i++) m_gauges[i] = 0;
+}
+
+void DeviceAllocator::create(VkPhysicalDevice physicalDevice, VkDevice device, const VkAllocationCallbacks* allocationCallbacks, FrameProfiler& frameProfiler)
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &m_memoryProperties);
+
+    m_device = device;
+    m_allocationCallbacks = allocationCallbacks;
+    m_bufferImageGranularity = std::max<VkDeviceSize>(1, properties.limits.bufferImageGranularity);
+    m_maxAllocationCount = properties.limits.maxMemoryAllocationCount;
+    m_frameProfiler = &frameProfiler;
+
+    m_gauges[UsedBytesGauge] = frameProfiler.registerGauge("memory.used_bytes");
+    m_gauges[ReservedBytesGauge] = frameProfiler.registerGauge("memory.reserved_bytes");
+    m_gauges[BlockCountGauge] = frameProfiler.registerGauge("memory.blocks");
+    m_gauges[AllocationCountGauge] = frameProfiler.registerGauge("memory.allocations");
+    m_gauges[FragmentationGauge] = frameProfiler.registerGauge("memory.fragmentation");
+
+    publishStatistics();
+}
+
+void DeviceAllocator::destruct()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Anything still allocated here is a leak on the caller's side, but the memory goes either way
+    for (uint32_t i = 0; i < m_blocks.size(); i++)
+    {
+        if (m_blocks[i]) destroyBlock(i);
+    }
+
+    m_blocks.clear();
+    m_dedicatedAllocations = 0;
+}
+
+MemoryAllocation DeviceAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, MemoryResourceKind kind)
+{
+    VkDeviceSize size = requirements.size;
+    VkDeviceSize alignment = std::max<VkDeviceSize>(1, requirements.alignment);
+
+    // Linear and optimal resources must not share a bufferImageGranularity page. Padding optimal
+    // resources out to whole pages on both ends guarantees that, whatever ends up next to them,
+    // and costs nothing on the (common) devices reporting a granularity of 1
+    if (kind == MemoryResourceKind::Optimal && m_bufferImageGranularity > 1)
+    {
+        alignment = std::max(alignment, m_bufferImageGranularity);
+        size = alignUp(size, m_bufferImageGranularity);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    MemoryAllocation allocation;
+
+    // Memory types are ordered by preference, so the first suitable one with room wins
+    for (uint32_t memoryType = 0; memoryType < m_memoryProperties.memoryTypeCount; memoryType++)
+    {
+        if ((requirements.memoryTypeBits & (1u << memoryType)) == 0) continue;
+        if ((m_memoryProperties.memoryTypes[memoryType].propertyFlags & properties) != properties) continue;
+
+        VkDeviceSize blockSize = preferredBlockSize(memoryType);
+        uint32_t block = UINT32_MAX;
+        uint32_t node = TlsfHeap::INVALID_NODE;
+        VkDeviceSize offset = 0;
+
+        // Lazily allocated memory is only committed as a tile based GPU actually spills a transient
+        // attachment to it, which sharing a block with other resources would defeat
+        if (size > blockSize / 2 || (m_memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT))
+        {
+            // Would waste most of a shared block, give it one of its own
+            block = createBlock(memoryType, size, true);
+        }
+        else
+        {
+            for (uint32_t i = 0; i < m_blocks.size() && node == TlsfHeap::INVALID_NODE; i++)
+            {
+                if (!m_blocks[i] || m_blocks[i]->dedicated || m_blocks[i]->memoryType != memoryType) continue;
+
+                node = m_blocks[i]->heap.allocate(size, alignment, offset);
+                block = i;
+            }
+
+            if (node == TlsfHeap::INVALID_NODE)
+            {
+                block = createBlock(memoryType, blockSize, false);
+                if (block != UINT32_MAX) node = m_blocks[block]->heap.allocate(size, alignment, offset);
+            }
+        }
+
+        // Out of memory in this type's heap, a less preferred type may still have room
+        if (block == UINT32_MAX) continue;
+
+        Block& owner = *m_blocks[block];
+
+        allocation.memory = owner.memory;
+        allocation.offset = offset;
+        allocation.size = size;
+        allocation.mapped = owner.mapped != nullptr ? static_cast<char*>(owner.mapped) + offset : nullptr;
+        allocation.block = block;
+        allocation.node = node;
+
+        if (owner.dedicated) m_dedicatedAllocations++;
+
+        publishStatistics();
+        return allocation;
+    }
+
+    throw std::runtime_error("Failed to allocate " + std::to_string(size) + " bytes of device memory");
+}
+
+void DeviceAllocator::free(MemoryAllocation& allocation)
+{
+    if (allocation.memory == VK_NULL_HANDLE) return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Block& owner = *m_blocks[allocation.block];
+
+    if (owner.dedicated)
+    {
+        m_dedicatedAllocations--;
+        destroyBlock(allocation.block);
+    }
+    else
+    {
+        owner.heap.free(allocation.node);
+
+        // Keep one empty block per memory type around, so a resource that is freed and recreated
+        // (e.g. on resize) does not go back to the driver each time
+        if (owner.heap.isEmpty())
+        {
+            for (uint32_t i = 0; i < m_blocks.size(); i++)
+            {
+                const auto& other = m_blocks[i];
+
+                if (i != allocation.block && other && !other->dedicated && other->memoryType == owner.memoryType && other->heap.isEmpty())
+                {
+                    destroyBlock(allocation.block);
+                    break;
+                }
+            }
+        }
+    }
+
+    allocation = MemoryAllocation();
+    publishStatistics();
+}
+
+void DeviceAllocator::createBuffer(const VkBufferCreateInfo& createInfo, VkMemoryPropertyFlags properties, VkBuffer& buffer, MemoryAllocation& allocation)
+{
+    if (vkCreateBuffer(m_device, &createInfo, m_allocationCallbacks, &buffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create buffer");
+    }
+
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(m_device, buffer, &memoryRequirements);
+
+    allocation = allocate(memoryRequirements, properties, MemoryResourceKind::Linear);
+    vkBindBufferMemory(m_device, buffer, allocation.memory, allocation.offset);
+}
+
+void DeviceAllocator::createImage(const VkImageCreateInfo& createInfo, VkMemoryPropertyFlags properties, VkImage& image, MemoryAllocation& allocation)
+{
+    if (vkCreateImage(m_device, &createInfo, m_allocationCallbacks, &image) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create image");
+    }
+
+    VkMemoryRequirements memoryRequirements;
+    vkGetImageMemoryRequirements(m_device, image, &memoryRequirements);
+
+    MemoryResourceKind kind = createInfo.tiling == VK_IMAGE_TILING_LINEAR ? MemoryResourceKind::Linear : MemoryResourceKind::Optimal;
+
+    allocation = allocate(memoryRequirements, properties, kind);
+    vkBindImageMemory(m_device, image, allocation.memory, allocation.offset);
+}
+
+void DeviceAllocator::destroyBuffer(VkBuffer buffer, MemoryAllocation& allocation)
+{
+    vkDestroyBuffer(m_device, buffer, m_allocationCallbacks);
+    free(allocation);
+}
+
+void DeviceAllocator::destroyImage(VkImage image, MemoryAllocation& allocation)
+{
+    vkDestroyImage(m_device, image, m_allocationCallbacks);
+    free(allocation);
+}
+
+bool DeviceAllocator::hasMemoryType(VkMemoryPropertyFlags properties) const
+{
+    for (uint32_t memoryType = 0; memoryType < m_memoryProperties.memoryTypeCount; memoryType++)
+    {
+        if ((m_memoryProperties.memoryTypes[memoryType].propertyFlags & properties) == properties) return true;
+    }
+
+    return false;
+}
+
+DeviceMemoryStatistics DeviceAllocator::statistics()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return computeStatistics();
+}
+
+VkDeviceSize DeviceAllocator::preferredBlockSize(uint32_t memoryType) const
+{
+    // Small heaps (e.g. the 256 MiB device local + host visible window) would be eaten up by a few
+    // default sized blocks
+    VkDeviceSize heapSize = m_memoryProperties.memoryHeaps[m_memoryProperties.memoryTypes[memoryType].heapIndex].size;
+    return std::min<VkDeviceSize>(g_DEVICE_MEMORY_BLOCK_SIZE, alignUp(heapSize / 8, 1 << 20));
+}
+
+uint32_t DeviceAllocator::createBlock(uint32_t memoryType, VkDeviceSize size, bool dedicated)
+{
+    if (m_blockCount >= m_maxAllocationCount)
+    {
+        throw std::runtime_error("Out of device memory allocations (maxMemoryAllocationCount " + std::to_string(m_maxAllocationCount) + ")");
+    }
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryType;
+
+    VkDeviceMemory memory;
+    VkResult result = vkAllocateMemory(m_device, &allocInfo, m_allocationCallbacks, &memory);
+
+    if (result == VK_ERROR_OUT_OF_DEVICE_MEMORY || result == VK_ERROR_OUT_OF_HOST_MEMORY) return UINT32_MAX;
+
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to allocate device memory block");
+    }
+
+    auto block = std::make_unique<Block>();
+    block->memory = memory;
+    block->memoryType = memoryType;
+    block->size = size;
+    block->mapped = nullptr;
+    block->dedicated = dedicated;
+
+    if (!dedicated) block->heap.create(size);
+
+    // Mapped once for the lifetime of the block, vkMapMemory per upload is needlessly slow
+    if (m_memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+    {
+        if (vkMapMemory(m_device, memory, 0, VK_WHOLE_SIZE, 0, &block->mapped) != VK_SUCCESS)
+        {
+            vkFreeMemory(m_device, memory, m_allocationCallbacks);
+            throw std::runtime_error("Failed to map device memory block");
+        }
+    }
+
+    m_blockCount++;
+
+    for (uint32_t i = 0; i < m_blocks.size(); i++)
+    {
+        if (!m_blocks[i])
+        {
+            m_blocks[i] = std::move(block);
+            return i;
+        }
+    }
+
+    m_blocks.push_back(std::move(block));
+    return static_cast<uint32_t>(m_blocks.size() - 1);
+}
+
+void DeviceAllocator::destroyBlock(uint32_t block)
+{
+    // Freeing memory implicitly unmaps it
+    vkFreeMemory(m_device, m_blocks[block]->memory, m_allocationCallbacks);
+    m_blocks[block].reset();
+    m_blockCount--;
+}
+
+DeviceMemoryStatistics DeviceAllocator::computeStatistics() const
+{
+    DeviceMemoryStatistics statistics{};
+    uint64_t freeBytes = 0;
+    uint64_t largestFree = 0;
+
+    for (const auto& block : m_blocks)
+    {
+        if (!block) continue;
+
+        statistics.reservedBytes += block->size;
+        statistics.blockCount++;
+
+        if (block->dedicated)
+        {
+            statistics.usedBytes += block->size;
+            continue;
+        }
+
+        statistics.usedBytes += block->heap.usedBytes();
+        statistics.allocationCount += block->heap.allocationCount();
+
+        freeBytes += block->size - block->heap.usedBytes();
+        largestFree = std::max(largestFree, block->heap.largestFreeRange());
+    }
+
+    statistics.allocationCount += m_dedicatedAllocations;
+    statistics.fragmentation = freeBytes > 0 ? 1.0 - static_cast<double>(largestFree) / freeBytes : 0.0;
+
+    return statistics;
+}
+
+void DeviceAllocator::publishStatistics()
+{
+    DeviceMemoryStatistics statistics = computeStatistics();
+
+    m_frameProfiler->setGauge(m_gauges[UsedBytesGauge], static_cast<double>(statistics.usedBytes));
+    m_frameProfiler->setGauge(m_gauges[ReservedBytesGauge], static_cast<double>(statistics.reservedBytes));
+    m_frameProfiler->setGauge(m_gauges[BlockCountGauge], statistics.blockCount);
+    m_frameProfiler->setGauge(m_gauges[AllocationCountGauge], statistics.allocationCount);
+    m_frameProfiler->setGauge(m_gauges[FragmentationGauge], statistics.fragmentation);
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <memory>                           // Block storage
+#include <mutex>
+#include <vector>
+
+#include "GlobalApplicationConstants.h"     // g_DEVICE_MEMORY_BLOCK_SIZE
+#include "FrameProfiler.h"                  // Memory gauges
+#include "TlsfHeap.h"                       // Sub-allocation within a block
+
+// Whether a resource is laid out linearly (buffers, linear images) or opaquely (optimal tiling
+// images). The two may not share a bufferImageGranularity page
+enum class MemoryResourceKind
+{
+    Linear,
+    Optimal
+};
+
+// A range of device memory handed out by DeviceAllocator. Bind resources at memory + offset
+struct MemoryAllocation
+{
+    VkDeviceMemory      memory = VK_NULL_HANDLE;
+    VkDeviceSize        offset = 0;
+    VkDeviceSize        size = 0;
+    void*               mapped = nullptr;                           // Host visible memory only, persistently mapped
+    uint32_t            block = UINT32_MAX;                         // Owning block, internal to the allocator
+    uint32_t            node = TlsfHeap::INVALID_NODE;              // Range within that block, internal to the allocator
+};
+
+struct DeviceMemoryStatistics
+{
+    uint64_t            usedBytes;              // Handed out to resources
+    uint64_t            reservedBytes;          // Allocated from the driver
+    uint32_t            blockCount;             // Live VkDeviceMemory objects
+    uint32_t            allocationCount;
+    double              fragmentation;          // 1 - largest free range / free bytes, 0 when nothing is free
+};
+
+// Sub-allocates buffers and images from a few large VkDeviceMemory blocks per memory type instead
+// of one vkAllocateMemory per resource, which stays far below maxMemoryAllocationCount and keeps
+// the driver's allocation cost off the hot path. Ranges within a block are managed by a TLSF heap.
+// Resources too large to share a block, and anything in lazily allocated memory, get a dedicated one.
+//
+// Thread safe. Live statistics are published as memory.* gauges on the FrameProfiler.
+class DeviceAllocator
+{
+public:
+    // CONSTRUCTOR
+    //------------------------------------------------------------------------//
+    DeviceAllocator();
+    //------------------------------------------------------------------------//
+
+    // PUBLIC FUNCTIONS
+    //------------------------------------------------------------------------//
+    void create(VkPhysicalDevice, VkDevice, const VkAllocationCallbacks*, FrameProfiler&);
+    void destruct();
+
+    MemoryAllocation allocate(const VkMemoryRequirements&, VkMemoryPropertyFlags, MemoryResourceKind);
+    void free(MemoryAllocation&);
+
+    // Create the resource, allocate its memory and bind the two
+    void createBuffer(const VkBufferCreateInfo&, VkMemoryPropertyFlags, VkBuffer&, MemoryAllocation&);
+    void createImage(const VkImageCreateInfo&, VkMemoryPropertyFlags, VkImage&, MemoryAllocation&);
+    void destroyBuffer(VkBuffer, MemoryAllocation&);
+    void destroyImage(VkImage, MemoryAllocation&);
+
+    // Some memory type has all of the properties, e.g. LAZILY_ALLOCATED on tile based GPUs
+    bool hasMemoryType(VkMemoryPropertyFlags) const;
+
+    DeviceMemoryStatistics statistics();
+    //------------------------------------------------------------------------//
+
+private:
+    struct Block
+    {
+        VkDeviceMemory                      memory;
+        uint32_t                            memoryType;
+        VkDeviceSize                        size;
+        void*                               mapped;
+        bool                                dedicated;              // One resource, no heap
+        TlsfHeap                            heap;
+    };
+
+    enum GaugeIndex
+    {
+        UsedBytesGauge,
+        ReservedBytesGauge,
+        BlockCountGauge,
+        AllocationCountGauge,
+        FragmentationGauge,
+        GaugeCount
+    };
+
+    // PRIVATE MEMBERS
+    //------------------------------------------------------------------------//
+    VkDevice                                m_device;
+    const VkAllocationCallbacks*            m_allocationCallbacks;
+    VkPhysicalDeviceMemoryProperties        m_memoryProperties;
+    VkDeviceSize                            m_bufferImageGranularity;
+    uint32_t                                m_maxAllocationCount;   // maxMemoryAllocationCount
+    std::vector<std::unique_ptr<Block>>     m_blocks;               // Null entries are free slots
+    uint32_t                                m_blockCount;
+    uint32_t                                m_dedicatedAllocations;
+    FrameProfiler*                          m_frameProfiler;
+    uint32_t                                m_gauges[GaugeCount];
+    std::mutex                              m_mutex;
+    //------------------------------------------------------------------------//
+
+    // PRIVATE FUNCTIONS
+    //------------------------------------------------------------------------//
+    VkDeviceSize preferredBlockSize(uint32_t memoryType) const;
+    uint32_t createBlock(uint32_t memoryType, VkDeviceSize size, bool dedicated);
+    void destroyBlock(uint32_t block);
+    DeviceMemoryStatistics computeStatistics() const;
+    void publishStatistics();
+    //------------------------------------------------------------------------//
+};
@@ -0,0 +1,43 @@
+#include "DrawList.h"
+
+#include <cmath>                            // std::ceil, std::sqrt
+
+std::vector<DrawCommand> buildGridDrawList(uint32_t count)
+{
+    std::vector<DrawCommand> draws(count);
+
+    uint32_t columns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(count))));
+    if (columns == 0) return draws;
+
+    // Clip space spans [-1, 1], each draw gets one square cell of it
+    float cell = 2.0f / columns;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        draws[i].offsetX = -1.0f + cell * ((i % columns) + 0.5f);
+        draws[i].offsetY = -1.0f + cell * ((i / columns) + 0.5f);
+        draws[i].scale = cell;
+        draws[i].depth = 0.0f;
+    }
+
+    return draws;
+}
+
+std::vector<DrawCommand> buildOverdrawDrawList(uint32_t layers, bool frontToBack)
+{
+    std::vector<DrawCommand> draws(layers);
+
+    for (uint32_t i = 0; i < layers; i++)
+    {
+        float step = static_cast<float>(i + 1) / (layers + 1);
+
+        // A triangle of scale 6 around the centre covers all of clip space. The small offsets keep
+        // the layers from being exactly coincident
+        draws[i].offsetX = 0.01f * static_cast<float>(i % 7) - 0.03f;
+        draws[i].offsetY = 0.01f * static_cast<float>(i % 5) - 0.02f;
+        draws[i].scale = 6.0f;
+        draws[i].depth = frontToBack ? step : 1.0f - step;
+    }
+
+    return draws;
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Push constants of one draw, laid out to match draw_list.vert
+struct DrawCommand
+{
+    float       offsetX;
+    float       offsetY;
+    float       scale;
+    float       depth;                      // [0, 1], 0 nearest. Drawn in list order at equal depth
+};
+
+// Per frame uniforms, read by every vertex shader from the frame allocator (std140 layout)
+struct FrameConstants
+{
+    float       viewOffset[2];
+    float       viewScale;
+    float       time;                       // Seconds since startup
+};
+
+// count copies of the triangle tiled over the screen, row by row
+std::vector<DrawCommand> buildGridDrawList(uint32_t count);
+
+// layers triangles each covering the whole screen, at evenly spaced depths. Submitted back to front
+// every layer overwrites the one before, front to back the depth test rejects all but the first
+std::vector<DrawCommand> buildOverdrawDrawList(uint32_t layers, bool frontToBack);
@@ -0,0 +1,168 @@
+#include "FrameAllocator.h"
+
+#include <algorithm>                        // std::max
+#include <stdexcept>                        // Error reporting
+#include <string>
+
+FrameAllocator::FrameAllocator()
+{
+    m_device = VK_NULL_HANDLE;
+    m_allocationCallbacks = nullptr;
+    m_allocator = nullptr;
+    m_frameProfiler = nullptr;
+    m_peakGauge = 0;
+    m_buffer = VK_NULL_HANDLE;
+    m_descriptorSetLayout = VK_NULL_HANDLE;
+    m_descriptorPool = VK_NULL_HANDLE;
+    m_descriptorSet = VK_NULL_HANDLE;
+    m_alignment = 1;
+    m_bytesPerSlot = 0;
+    m_uniformRange = 0;
+    m_regionStart = 0;
+    m_head = 0;
+    m_peakBytes = 0;
+}
+
+void FrameAllocator::create(
+    VkDevice device,
+    const VkAllocationCallbacks* allocationCallbacks,
+    DeviceAllocator& allocator,
+    FrameProfiler& frameProfiler,
+    VkDeviceSize minUniformBufferOffsetAlignment,
+    uint32_t slotCount,
+    VkDeviceSize bytesPerSlot,
+    VkDeviceSize uniformRange)
+{
+    m_device = device;
+    m_allocationCallbacks = allocationCallbacks;
+    m_allocator = &allocator;
+    m_frameProfiler = &frameProfiler;
+    m_peakGauge = frameProfiler.registerGauge("memory.frame_allocator_peak_bytes");
+    m_alignment = std::max<VkDeviceSize>(1, minUniformBufferOffsetAlignment);
+    m_bytesPerSlot = (bytesPerSlot + m_alignment - 1) / m_alignment * m_alignment;
+    m_uniformRange = uniformRange;
+
+    // A descriptor always reads uniformRange bytes from its offset, so the last allocation of the
+    // last region needs that much room behind it even when it is smaller
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = m_bytesPerSlot * slotCount + m_uniformRange;
+    bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    allocator.createBuffer(bufferInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_buffer, m_allocation);
+
+    VkDescriptorSetLayoutBinding binding{};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 1;
+    layoutInfo.pBindings = &binding;
+
+    if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, m_allocationCallbacks, &m_descriptorSetLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create frame allocator descriptor set layout");
+    }
+
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    poolSize.descriptorCount = 1;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+
+    if (vkCreateDescriptorPool(m_device, &poolInfo, m_allocationCallbacks, &m_descriptorPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create frame allocator descriptor pool");
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_descriptorSetLayout;
+
+    if (vkAllocateDescriptorSets(m_device, &allocInfo, &m_descriptorSet) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to allocate frame allocator descriptor set");
+    }
+
+    // Written once, the dynamic offset does the rest
+    VkDescriptorBufferInfo descriptorBufferInfo{};
+    descriptorBufferInfo.buffer = m_buffer;
+    descriptorBufferInfo.offset = 0;
+    descriptorBufferInfo.range = m_uniformRange;
+
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = m_descriptorSet;
+    write.dstBinding = 0;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    write.pBufferInfo = &descriptorBufferInfo;
+
+    vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+
+    beginFrame(0);
+}
+
+void FrameAllocator::destruct()
+{
+    if (m_descriptorPool != VK_NULL_HANDLE) vkDestroyDescriptorPool(m_device, m_descriptorPool, m_allocationCallbacks);
+    if (m_descriptorSetLayout != VK_NULL_HANDLE) vkDestroyDescriptorSetLayout(m_device, m_descriptorSetLayout, m_allocationCallbacks);
+    if (m_buffer != VK_NULL_HANDLE) m_allocator->destroyBuffer(m_buffer, m_allocation);
+
+    m_descriptorPool = VK_NULL_HANDLE;
+    m_descriptorSetLayout = VK_NULL_HANDLE;
+    m_descriptorSet = VK_NULL_HANDLE;
+    m_buffer = VK_NULL_HANDLE;
+}
+
+void FrameAllocator::beginFrame(uint32_t slot)
+{
+    VkDeviceSize used = m_head - m_regionStart;
+
+    if (used > m_peakBytes)
+    {
+        m_peakBytes = used;
+        m_frameProfiler->setGauge(m_peakGauge, static_cast<double>(m_peakBytes));
+    }
+
+    m_regionStart = m_bytesPerSlot * slot;
+    m_head = m_regionStart;
+}
+
+FrameAllocation FrameAllocator::allocate(VkDeviceSize size)
+{
+    VkDeviceSize offset = (m_head + m_alignment - 1) / m_alignment * m_alignment;
+
+    if (offset + size > m_regionStart + m_bytesPerSlot)
+    {
+        throw std::runtime_error("Frame allocator exhausted, " + std::to_string(m_bytesPerSlot) + " bytes per frame");
+    }
+
+    m_head = offset + size;
+
+    FrameAllocation allocation;
+    allocation.data = static_cast<char*>(m_allocation.mapped) + offset;
+    allocation.offset = static_cast<uint32_t>(offset);
+
+    return allocation;
+}
+
+VkDescriptorSetLayout FrameAllocator::descriptorSetLayout() const
+{
+    return m_descriptorSetLayout;
+}
+
+VkDescriptorSet FrameAllocator::descriptorSet() const
+{
+    return m_descriptorSet;
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <cstring>                          // memcpy in push()
+
+#include "DeviceAllocator.h"                // The backing buffer
+#include "FrameProfiler.h"                  // Peak usage gauge
+
+// Memory handed out by FrameAllocator::allocate. Write through data, bind with offset
+struct FrameAllocation
+{
+    void*                                   data;
+    uint32_t                                offset;                 // Dynamic offset into the buffer
+};
+
+// Linear allocator for data that lives for one frame (camera, time, transforms). One persistently
+// mapped, host coherent buffer is split into a region per frame slot, and allocations are bumped
+// out of the current slot's region. The GPU reads them through a single dynamic uniform buffer
+// descriptor, with each allocation's offset supplied when the set is bound, so a frame never
+// allocates, maps or writes descriptors.
+//
+// beginFrame() rewinds the slot's region in O(1). Call it once the frame scheduler has seen that
+// slot's previous frame complete.
+//
+// Render thread only.
+class FrameAllocator
+{
+public:
+    // CONSTRUCTOR
+    //------------------------------------------------------------------------//
+    FrameAllocator();
+    //------------------------------------------------------------------------//
+
+    // PUBLIC FUNCTIONS
+    //------------------------------------------------------------------------//
+    // uniformRange is what the shaders read from each offset, and the largest allocation that
+    // can be bound as a uniform buffer
+    void create(
+        VkDevice,
+        const VkAllocationCallbacks*,
+        DeviceAllocator&,
+        FrameProfiler&,
+        VkDeviceSize minUniformBufferOffsetAlignment,
+        uint32_t slotCount,
+        VkDeviceSize bytesPerSlot,
+        VkDeviceSize uniformRange
+    );
+    void destruct();
+
+    void beginFrame(uint32_t slot);
+
+    // Aligned for use as a dynamic offset. Throws std::runtime_error when the slot's region is
+    // exhausted
+    FrameAllocation allocate(VkDeviceSize size);
+
+    // Copies value into a fresh allocation and returns its dynamic offset
+    template<typename T>
+    uint32_t push(const T& value)
+    {
+        FrameAllocation allocation = allocate(sizeof(T));
+        memcpy(allocation.data, &value, sizeof(T));
+
+        return allocation.offset;
+    }
+
+    // One VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC at binding 0, visible to the vertex and
+    // fragment stages
+    VkDescriptorSetLayout descriptorSetLayout() const;
+    VkDescriptorSet descriptorSet() const;
+    //------------------------------------------------------------------------//
+
+private:
+    // PRIVATE MEMBERS
+    //------------------------------------------------------------------------//
+    VkDevice                                m_device;
+    const VkAllocationCallbacks*            m_allocationCallbacks;
+    DeviceAllocator*                        m_allocator;
+    FrameProfiler*                          m_frameProfiler;
+    uint32_t                                m_peakGauge;
+    VkBuffer                                m_buffer;
+    MemoryAllocation                        m_allocation;
+    VkDescriptorSetLayout                   m_descriptorSetLayout;
+    VkDescriptorPool                        m_descriptorPool;
+    VkDescriptorSet                         m_descriptorSet;
+    VkDeviceSize                            m_alignment;
+    VkDeviceSize                            m_bytesPerSlot;
+    VkDeviceSize                            m_uniformRange;
+    VkDeviceSize                            m_regionStart;          // Current slot's region
+    VkDeviceSize                            m_head;                 // Next free byte, from the buffer start
+    VkDeviceSize                            m_peakBytes;            // Most any frame has used
+    //------------------------------------------------------------------------//
+};
@@ -0,0 +1,271 @@
+#include "FrameProfiler.h"
+
+#include <algorithm>                        // std::sort for percentiles
+#include <iomanip>                          // Report formatting
+#include <stdexcept>                        // Error reporting
+
+FrameProfiler::Scope::Scope(FrameProfiler& profiler, uint32_t channel)
+    : m_profiler(profiler), m_channel(channel), m_start(std::chrono::steady_clock::now())
+{
+}
+
+FrameProfiler::Scope::Scope(FrameProfiler& profiler, FramePhase phase)
+    : Scope(profiler, static_cast<uint32_t>(phase))
+{
+}
+
+FrameProfiler::Scope::~Scope()
+{
+    auto elapsed = std::chrono::steady_clock::now() - m_start;
+    m_profiler.record(m_channel, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
+FrameProfiler::FrameProfiler() : m_channelCount(0), m_gaugeCount(0)
+{
+    // Must match the order of FramePhase
+    registerChannel("cpu.frame_slot_wait");
+    registerChannel("cpu.acquire");
+    registerChannel("cpu.image_in_flight_wait");
+    registerChannel("cpu.record");
+    registerChannel("cpu.submit");
+    registerChannel("cpu.present");
+    registerChannel("cpu.swapchain_recreate");
+    registerChannel("cpu.frame");
+}
+
+uint32_t FrameProfiler::registerChannel(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(m_registrationMutex);
+
+    uint32_t count = m_channelCount.load(std::memory_order_relaxed);
+
+    // Registering the same name twice hands back the existing channel
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (m_channels[i]->name == name) return i;
+    }
+
+    if (count == g_PROFILER_MAX_CHANNELS)
+    {
+        throw std::runtime_error("Frame profiler is out of channels");
+    }
+
+    m_channels[count] = std::make_unique<Channel>();
+    m_channels[count]->name = name;
+    m_channels[count]->written.store(0, std::memory_order_relaxed);
+    m_channels[count]->maximum.store(0, std::memory_order_relaxed);
+
+    // Publish the fully constructed channel to lock-free readers
+    m_channelCount.store(count + 1, std::memory_order_release);
+
+    return count;
+}
+
+void FrameProfiler::record(uint32_t channel, uint64_t nanoseconds)
+{
+    Channel& target = *m_channels[channel];
+
+    // Single writer per channel: claim the slot, fill it, then publish the new count
+    uint64_t index = target.written.load(std::memory_order_relaxed);
+    target.samples[index % g_PROFILER_RING_CAPACITY].store(nanoseconds, std::memory_order_relaxed);
+    target.written.store(index + 1, std::memory_order_release);
+
+    if (nanoseconds > target.maximum.load(std::memory_order_relaxed))
+    {
+        target.maximum.store(nanoseconds, std::memory_order_relaxed);
+    }
+}
+
+void FrameProfiler::record(FramePhase phase, uint64_t nanoseconds)
+{
+    record(static_cast<uint32_t>(phase), nanoseconds);
+}
+
+std::vector<ProfileChannelStatistics> FrameProfiler::statistics(uint64_t recentSamples) const
+{
+    std::vector<ProfileChannelStatistics> result;
+    std::vector<uint64_t> samples;
+    samples.reserve(g_PROFILER_RING_CAPACITY);
+
+    uint32_t count = m_channelCount.load(std::memory_order_acquire);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const Channel& channel = *m_channels[i];
+
+        uint64_t written = channel.written.load(std::memory_order_acquire);
+        uint64_t held = std::min<uint64_t>(written, std::min<uint64_t>(recentSamples, g_PROFILER_RING_CAPACITY));
+
+        // Unused channels (e.g. present when headless) are left out of reports
+        if (held == 0) continue;
+
+        // The writer may lap us while copying; that only swaps an old sample for a newer one
+        samples.clear();
+        for (uint64_t j = written - held; j < written; j++)
+        {
+            samples.push_back(channel.samples[j % g_PROFILER_RING_CAPACITY].load(std::memory_order_relaxed));
+        }
+
+        std::sort(samples.begin(), samples.end());
+
+        double total = 0.0;
+        for (uint64_t sample : samples) total += static_cast<double>(sample);
+
+        // Nearest-rank percentile
+        auto percentile = [&samples](double p) {
+            size_t rank = static_cast<size_t>(p * (samples.size() - 1) + 0.5);
+            return samples[rank] / 1.0e6;
+        };
+
+        ProfileChannelStatistics statistics;
+        statistics.name = channel.name;
+        statistics.samples = written;
+        statistics.meanMs = total / samples.size() / 1.0e6;
+        statistics.p50Ms = percentile(0.50);
+        statistics.p95Ms = percentile(0.95);
+        statistics.p99Ms = percentile(0.99);
+        statistics.maxMs = std::max(samples.back(), channel.maximum.load(std::memory_order_relaxed)) / 1.0e6;
+
+        result.push_back(statistics);
+    }
+
+    return result;
+}
+
+uint32_t FrameProfiler::registerGauge(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(m_registrationMutex);
+
+    uint32_t count = m_gaugeCount.load(std::memory_order_relaxed);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (m_gauges[i]->name == name) return i;
+    }
+
+    if (count == g_PROFILER_MAX_GAUGES)
+    {
+        throw std::runtime_error("Frame profiler is out of gauges");
+    }
+
+    m_gauges[count] = std::make_unique<Gauge>();
+    m_gauges[count]->name = name;
+    m_gauges[count]->value.store(0.0, std::memory_order_relaxed);
+
+    m_gaugeCount.store(count + 1, std::memory_order_release);
+
+    return count;
+}
+
+void FrameProfiler::setGauge(uint32_t gauge, double value)
+{
+    m_gauges[gauge]->value.store(value, std::memory_order_relaxed);
+}
+
+std::vector<ProfileGaugeValue> FrameProfiler::gauges() const
+{
+    uint32_t count = m_gaugeCount.load(std::memory_order_acquire);
+    std::vector<ProfileGaugeValue> result(count);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        result[i].name = m_gauges[i]->name;
+        result[i].value = m_gauges[i]->value.load(std::memory_order_relaxed);
+    }
+
+    return result;
+}
+
+void FrameProfiler::writeReport(std::ostream& out, ProfileReportFormat format) const
+{
+    switch (format)
+    {
+    case ProfileReportFormat::Text:
+        writeTextReport(out, statistics(), gauges());
+        break;
+    case ProfileReportFormat::Json:
+        writeJsonReport(out, statistics(), gauges());
+        break;
+    case ProfileReportFormat::None:
+        break;
+    }
+}
+
+void FrameProfiler::writeTextReport(std::ostream& out, const std::vector<ProfileChannelStatistics>& channels, const std::vector<ProfileGaugeValue>& gauges) const
+{
+    // Left as the caller had it, precision included
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+
+    out << std::left << std::setw(32) << "channel" << std::right
+        << std::setw(9) << "samples"
+        << std::setw(11) << "mean ms"
+        << std::setw(11) << "p50 ms"
+        << std::setw(11) << "p95 ms"
+        << std::setw(11) << "p99 ms"
+        << std::setw(11) << "max ms" << "\n";
+
+    out << std::fixed << std::setprecision(3);
+
+    for (const auto& channel : channels)
+    {
+        out << std::left << std::setw(32) << channel.name << std::right
+            << std::setw(9) << channel.samples
+            << std::setw(11) << channel.meanMs
+            << std::setw(11) << channel.p50Ms
+            << std::setw(11) << channel.p95Ms
+            << std::setw(11) << channel.p99Ms
+            << std::setw(11) << channel.maxMs << "\n";
+    }
+
+    if (!gauges.empty())
+    {
+        out << "\n" << std::left << std::setw(32) << "gauge" << std::right << std::setw(20) << "value" << "\n";
+
+        for (const auto& gauge : gauges)
+        {
+            out << std::left << std::setw(32) << gauge.name << std::right << std::setw(20) << gauge.value << "\n";
+        }
+    }
+
+    out.flush();
+    out.flags(flags);
+    out.precision(precision);
+}
+
+void FrameProfiler::writeJsonReport(std::ostream& out, const std::vector<ProfileChannelStatistics>& channels, const std::vector<ProfileGaugeValue>& gauges) const
+{
+    // Left as the caller had it, precision included
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+
+    out << std::fixed << std::setprecision(6) << "{\"channels\":[";
+
+    for (size_t i = 0; i < channels.size(); i++)
+    {
+        const auto& channel = channels[i];
+
+        // Channel names are plain identifiers registered by the application, no escaping needed
+        out << (i == 0 ? "" : ",")
+            << "{\"name\":\"" << channel.name << "\""
+            << ",\"samples\":" << channel.samples
+            << ",\"mean_ms\":" << channel.meanMs
+            << ",\"p50_ms\":" << channel.p50Ms
+            << ",\"p95_ms\":" << channel.p95Ms
+            << ",\"p99_ms\":" << channel.p99Ms
+            << ",\"max_ms\":" << channel.maxMs << "}";
+    }
+
+    out << "],\"gauges\":[";
+
+    for (size_t i = 0; i < gauges.size(); i++)
+    {
+        out << (i == 0 ? "" : ",")
+            << "{\"name\":\"" << gauges[i].name << "\""
+            << ",\"value\":" << gauges[i].value << "}";
+    }
+
+    out << "]}" << std::endl;
+    out.flags(flags);
+    out.precision(precision);
+}
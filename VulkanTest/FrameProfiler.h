@@ -0,0 +1,126 @@
+#pragma once
+#include <array>                            // Fixed size sample rings
+#include <atomic>                           // Lock-free ring indices
+#include <chrono>                           // steady_clock timestamps
+#include <cstdint>
+#include <memory>                           // Channel storage
+#include <mutex>                            // Channel registration only
+#include <ostream>                          // Report output
+#include <string>
+#include <vector>
+
+#include "GlobalApplicationConstants.h"     // Ring capacity / channel limits
+
+// Channels every FrameProfiler registers up front, in this order, so drawFrame() can record
+// without any lookup
+enum class FramePhase : uint32_t
+{
+    FrameSlotWait,              // Timeline wait for the frame that last used this frame slot
+    Acquire,                    // vkAcquireNextImageKHR
+    ImageInFlightWait,          // Timeline wait for the frame still using the acquired image
+    Record,                     // Recording the frame's command buffer
+    Submit,                     // vkQueueSubmit
+    Present,                    // vkQueuePresentKHR
+    SwapchainRecreate,          // recreateSwapChain(), only sampled on resize
+    Frame,                      // The whole of drawFrame()
+    Count
+};
+
+enum class ProfileReportFormat
+{
+    None,
+    Text,
+    Json
+};
+
+struct ProfileChannelStatistics
+{
+    std::string     name;
+    uint64_t        samples;    // Samples recorded over the whole run
+    double          meanMs;     // Mean and percentiles cover the most recent g_PROFILER_RING_CAPACITY samples
+    double          p50Ms;
+    double          p95Ms;
+    double          p99Ms;
+    double          maxMs;      // Worst sample over the whole run
+};
+
+struct ProfileGaugeValue
+{
+    std::string     name;
+    double          value;
+};
+
+// Always-on timing surface. Each channel is a fixed size ring of nanosecond samples written by
+// a single thread (the render loop) with no locks or allocations, and readable from any thread
+// at any time for on demand reports.
+//
+// Gauges sit alongside the channels for state that is a current value rather than a stream of
+// timings (memory in use, block counts). Any thread may set one, the latest value wins.
+class FrameProfiler
+{
+public:
+    // RAII helper that records the time between its construction and destruction
+    class Scope
+    {
+    public:
+        Scope(FrameProfiler&, uint32_t channel);
+        Scope(FrameProfiler&, FramePhase);
+        ~Scope();
+
+    private:
+        FrameProfiler&                          m_profiler;
+        uint32_t                                m_channel;
+        std::chrono::steady_clock::time_point   m_start;
+    };
+
+    // CONSTRUCTOR
+    //------------------------------------------------------------------------//
+    FrameProfiler();
+    //------------------------------------------------------------------------//
+
+    // PUBLIC FUNCTIONS
+    //------------------------------------------------------------------------//
+    uint32_t registerChannel(const std::string&);
+    void record(uint32_t channel, uint64_t nanoseconds);
+    void record(FramePhase, uint64_t nanoseconds);
+    // Mean and percentiles over at most the recentSamples latest samples of each channel, e.g. to
+    // measure just the last few hundred frames of a benchmark
+    std::vector<ProfileChannelStatistics> statistics(uint64_t recentSamples = g_PROFILER_RING_CAPACITY) const;
+
+    uint32_t registerGauge(const std::string&);
+    void setGauge(uint32_t gauge, double value);
+    std::vector<ProfileGaugeValue> gauges() const;
+
+    void writeReport(std::ostream&, ProfileReportFormat) const;
+    //------------------------------------------------------------------------//
+
+private:
+    struct Channel
+    {
+        std::string                                                 name;
+        std::array<std::atomic<uint64_t>, g_PROFILER_RING_CAPACITY> samples;
+        std::atomic<uint64_t>                                       written;
+        std::atomic<uint64_t>                                       maximum;
+    };
+
+    struct Gauge
+    {
+        std::string                                                 name;
+        std::atomic<double>                                         value;
+    };
+
+    // PRIVATE MEMBERS
+    //------------------------------------------------------------------------//
+    std::array<std::unique_ptr<Channel>, g_PROFILER_MAX_CHANNELS>   m_channels;
+    std::atomic<uint32_t>                                           m_channelCount;
+    std::array<std::unique_ptr<Gauge>, g_PROFILER_MAX_GAUGES>       m_gauges;
+    std::atomic<uint32_t>                                           m_gaugeCount;
+    std::mutex                                                      m_registrationMutex;
+    //------------------------------------------------------------------------//
+
+    // PRIVATE FUNCTIONS
+    //------------------------------------------------------------------------//
+    void writeTextReport(std::ostream&, const std::vector<ProfileChannelStatistics>&, const std::vector<ProfileGaugeValue>&) const;
+    void writeJsonReport(std::ostream&, const std::vector<ProfileChannelStatistics>&, const std::vector<ProfileGaugeValue>&) const;
+    //------------------------------------------------------------------------//
+};
@@ -0,0 +1,220 @@
+#include "FrameScheduler.h"
+
+#include <stdexcept>                        // Error reporting
+#include <string>                           // std::to_string
+
+FrameScheduler::FrameScheduler()
+{
+    m_device = VK_NULL_HANDLE;
+    m_allocationCallbacks = nullptr;
+    m_timeline = VK_NULL_HANDLE;
+    m_framesInFlight = g_DEFAULT_FRAMES_IN_FLIGHT;
+    m_submittedValue = 0;
+    m_completedValue = 0;
+}
+
+void FrameScheduler::create(VkDevice device, const VkAllocationCallbacks* allocationCallbacks, uint32_t framesInFlight, bool createPresentSemaphores)
+{
+    if (framesInFlight == 0 || framesInFlight > g_MAX_FRAMES_IN_FLIGHT)
+    {
+        throw std::runtime_error("Frames in flight must be between 1 and " + std::to_string(g_MAX_FRAMES_IN_FLIGHT));
+    }
+
+    m_device = device;
+    m_allocationCallbacks = allocationCallbacks;
+    m_framesInFlight = framesInFlight;
+    m_submittedValue = 0;
+    m_completedValue = 0;
+
+    VkSemaphoreTypeCreateInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    timelineInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    timelineInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &timelineInfo;
+
+    if (vkCreateSemaphore(m_device, &semaphoreInfo, m_allocationCallbacks, &m_timeline) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create frame timeline semaphore");
+    }
+
+    // Headless rendering has no acquire/present, so there is nothing to signal between them
+    if (!createPresentSemaphores) return;
+
+    semaphoreInfo.pNext = nullptr;
+    m_imageAvailableSemaphores.resize(m_framesInFlight, VK_NULL_HANDLE);
+    m_renderFinishedSemaphores.resize(m_framesInFlight, VK_NULL_HANDLE);
+
+    for (uint32_t i = 0; i < m_framesInFlight; i++)
+    {
+        if (vkCreateSemaphore(m_device, &semaphoreInfo, m_allocationCallbacks, &m_imageAvailableSemaphores[i]) != VK_SUCCESS ||
+            vkCreateSemaphore(m_device, &semaphoreInfo, m_allocationCallbacks, &m_renderFinishedSemaphores[i]) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create frame semaphores");
+        }
+    }
+}
+
+void FrameScheduler::destruct()
+{
+    for (VkSemaphore semaphore : m_imageAvailableSemaphores) vkDestroySemaphore(m_device, semaphore, m_allocationCallbacks);
+    for (VkSemaphore semaphore : m_renderFinishedSemaphores) vkDestroySemaphore(m_device, semaphore, m_allocationCallbacks);
+
+    m_imageAvailableSemaphores.clear();
+    m_renderFinishedSemaphores.clear();
+    m_imageValues.clear();
+
+    if (m_timeline != VK_NULL_HANDLE)
+    {
+        vkDestroySemaphore(m_device, m_timeline, m_allocationCallbacks);
+        m_timeline = VK_NULL_HANDLE;
+    }
+}
+
+void FrameScheduler::setImageCount(uint32_t imageCount)
+{
+    // Value 0 is signalled from the start, so new images are never waited on
+    m_imageValues.assign(imageCount, 0);
+}
+
+uint32_t FrameScheduler::beginFrame()
+{
+    // The frame about to be recorded reuses the slot of the frame framesInFlight submissions
+    // back, so that frame has to have finished. The value is only claimed on submit, so a frame
+    // abandoned after this (out of date swapchain) leaves nothing unsignalled behind
+    uint64_t frameValue = currentFrameValue();
+    if (frameValue > m_framesInFlight)
+    {
+        waitForValue(frameValue - m_framesInFlight);
+    }
+
+    return currentSlot();
+}
+
+void FrameScheduler::waitForImage(uint32_t imageIndex)
+{
+    // The swapchain may hand back an image whose last frame is not the one this slot waited on
+    waitForValue(m_imageValues[imageIndex]);
+}
+
+void FrameScheduler::submit(VkQueue queue, VkCommandBuffer commandBuffer, uint32_t imageIndex)
+{
+    uint64_t frameValue = currentFrameValue();
+
+    VkSemaphore signalSemaphores[] = { m_timeline, VK_NULL_HANDLE };
+    uint64_t signalValues[] = { frameValue, 0 };        // Binary semaphores ignore their value
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = signalSemaphores;
+
+    if (!m_imageAvailableSemaphores.empty())
+    {
+        addWait(imageAvailableSemaphore(), 0, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+
+        signalSemaphores[1] = renderFinishedSemaphore();
+        submitInfo.signalSemaphoreCount = 2;
+    }
+
+    submitInfo.waitSemaphoreCount = static_cast<uint32_t>(m_waitSemaphores.size());
+    submitInfo.pWaitSemaphores = m_waitSemaphores.data();
+    submitInfo.pWaitDstStageMask = m_waitStages.data();
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount = submitInfo.waitSemaphoreCount;
+    timelineInfo.pWaitSemaphoreValues = m_waitValues.data();
+    timelineInfo.signalSemaphoreValueCount = submitInfo.signalSemaphoreCount;
+    timelineInfo.pSignalSemaphoreValues = signalValues;
+    submitInfo.pNext = &timelineInfo;
+
+    if (vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to submit draw command buffer");
+    }
+
+    m_waitSemaphores.clear();
+    m_waitValues.clear();
+    m_waitStages.clear();
+
+    m_submittedValue = frameValue;
+    m_imageValues[imageIndex] = frameValue;
+}
+
+void FrameScheduler::addWait(VkSemaphore timeline, uint64_t value, VkPipelineStageFlags stage)
+{
+    // Binary semaphores (the acquire one) go through here too, their value is ignored
+    m_waitSemaphores.push_back(timeline);
+    m_waitValues.push_back(value);
+    m_waitStages.push_back(stage);
+}
+
+void FrameScheduler::waitIdle()
+{
+    waitForValue(m_submittedValue);
+}
+
+uint32_t FrameScheduler::framesInFlight() const
+{
+    return m_framesInFlight;
+}
+
+uint32_t FrameScheduler::currentSlot() const
+{
+    return static_cast<uint32_t>(currentFrameValue() % m_framesInFlight);
+}
+
+uint64_t FrameScheduler::currentFrameValue() const
+{
+    return m_submittedValue + 1;
+}
+
+uint64_t FrameScheduler::submittedValue() const
+{
+    return m_submittedValue;
+}
+
+uint64_t FrameScheduler::completedValue()
+{
+    vkGetSemaphoreCounterValue(m_device, m_timeline, &m_completedValue);
+    return m_completedValue;
+}
+
+VkSemaphore FrameScheduler::timelineSemaphore() const
+{
+    return m_timeline;
+}
+
+VkSemaphore FrameScheduler::imageAvailableSemaphore() const
+{
+    return m_imageAvailableSemaphores[currentSlot()];
+}
+
+VkSemaphore FrameScheduler::renderFinishedSemaphore() const
+{
+    return m_renderFinishedSemaphores[currentSlot()];
+}
+
+void FrameScheduler::waitForValue(uint64_t value)
+{
+    // Most waits are for frames the GPU finished long ago; skip the call entirely for those
+    if (value <= m_completedValue) return;
+
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &m_timeline;
+    waitInfo.pValues = &value;
+
+    if (vkWaitSemaphores(m_device, &waitInfo, UINT64_MAX) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to wait on the frame timeline semaphore");
+    }
+
+    m_completedValue = value;
+}
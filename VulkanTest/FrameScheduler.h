@@ -0,0 +1,67 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "GlobalApplicationConstants.h"     // g_MAX_FRAMES_IN_FLIGHT
+
+// Paces the CPU against the GPU with a single timeline semaphore. Frame N signals value N when
+// its commands complete, so "is the slot free" and "is this image free" are both just a wait on
+// a value, with no fences to reset. The depth (frames in flight) is chosen at runtime.
+//
+// The binary acquire/present semaphores the swapchain still requires are owned here as well,
+// one pair per frame slot.
+class FrameScheduler
+{
+public:
+    // CONSTRUCTOR
+    //------------------------------------------------------------------------//
+    FrameScheduler();
+    //------------------------------------------------------------------------//
+
+    // PUBLIC FUNCTIONS
+    //------------------------------------------------------------------------//
+    void create(VkDevice, const VkAllocationCallbacks*, uint32_t framesInFlight, bool createPresentSemaphores);
+    void destruct();
+    void setImageCount(uint32_t);
+
+    uint32_t beginFrame();
+    void waitForImage(uint32_t imageIndex);
+    void submit(VkQueue, VkCommandBuffer, uint32_t imageIndex);
+    // Makes the next submit wait for a value of another timeline (e.g. an upload's)
+    void addWait(VkSemaphore timeline, uint64_t value, VkPipelineStageFlags);
+    void waitIdle();
+
+    uint32_t framesInFlight() const;
+    uint32_t currentSlot() const;
+    uint64_t currentFrameValue() const;
+    uint64_t submittedValue() const;
+    uint64_t completedValue();
+    VkSemaphore timelineSemaphore() const;
+    VkSemaphore imageAvailableSemaphore() const;
+    VkSemaphore renderFinishedSemaphore() const;
+    //------------------------------------------------------------------------//
+
+private:
+    // PRIVATE MEMBERS
+    //------------------------------------------------------------------------//
+    VkDevice                                m_device;
+    const VkAllocationCallbacks*            m_allocationCallbacks;
+    VkSemaphore                             m_timeline;
+    uint32_t                                m_framesInFlight;
+    uint64_t                                m_submittedValue;       // Value of the last submitted frame
+    uint64_t                                m_completedValue;       // Last value known to be reached
+    std::vector<uint64_t>                   m_imageValues;          // Frame value last rendering to each image
+    std::vector<VkSemaphore>                m_imageAvailableSemaphores;
+    std::vector<VkSemaphore>                m_renderFinishedSemaphores;
+    std::vector<VkSemaphore>                m_waitSemaphores;       // Waits of the next submit
+    std::vector<uint64_t>                   m_waitValues;
+    std::vector<VkPipelineStageFlags>       m_waitStages;
+    //------------------------------------------------------------------------//
+
+    // PRIVATE FUNCTIONS
+    //------------------------------------------------------------------------//
+    void waitForValue(uint64_t);
+    //------------------------------------------------------------------------//
+};
@@ -1,5 +1,121 @@
 #pragma once
+#include <cstdint>
 
 const uint32_t g_WINDOW_WIDTH = 400;
 const uint32_t g_WINDOW_HEIGHT = 300;
-const int g_MAX_FRAMES_IN_FLIGHT = 2;
\ No newline at end of file
+// Frames the CPU may run ahead of the GPU, selectable at runtime with --frames-in-flight
+const uint32_t g_DEFAULT_FRAMES_IN_FLIGHT = 2;
+const uint32_t g_MAX_FRAMES_IN_FLIGHT = 8;
+
+// Window events (resizes, quit) the event thread can queue up for the render thread
+const uint32_t g_WINDOW_EVENT_QUEUE_CAPACITY = 256;
+
+// Time between the forced resizes of --resize-storm
+const uint32_t g_RESIZE_STORM_INTERVAL_MS = 50;
+
+// Persistent pipeline cache: default file (relative to the working directory) and how often the
+// event thread writes it out while running, in addition to the save at shutdown
+const char* const g_PIPELINE_CACHE_DEFAULT_PATH = "pipeline_cache.bin";
+const uint32_t g_PIPELINE_CACHE_SAVE_INTERVAL_MS = 30000;
+
+// Distinct pipelines the PipelineRegistry can hold
+const uint32_t g_PIPELINE_REGISTRY_CAPACITY = 256;
+
+// Threads recording the draw list into secondary command buffers, selectable with --record-threads
+const uint32_t g_MAX_RECORD_THREADS = 16;
+// Recordings timed per configuration by --record-benchmark
+const uint32_t g_RECORD_BENCHMARK_ITERATIONS = 200;
+
+// Upper limit of --instances. Each instance takes 16 bytes of host visible memory per frame slot
+const uint32_t g_MAX_INSTANCES = 16u * 1024 * 1024;
+
+// Frames timed per configuration by --cull-benchmark, and untimed frames rendered before them
+const uint32_t g_CULL_BENCHMARK_FRAMES = 300;
+const uint32_t g_CULL_BENCHMARK_WARMUP_FRAMES = 30;
+
+// Frames timed per mesh and vertex encoding by --vertex-benchmark, untimed frames rendered before
+// them, and the draws of the benchmark mesh per frame
+const uint32_t g_VERTEX_BENCHMARK_FRAMES = 200;
+const uint32_t g_VERTEX_BENCHMARK_WARMUP_FRAMES = 20;
+const uint32_t g_VERTEX_BENCHMARK_DRAWS = 16;
+
+// Frames timed per image size and method by --mip-benchmark, and untimed frames rendered before them
+const uint32_t g_MIP_BENCHMARK_FRAMES = 100;
+const uint32_t g_MIP_BENCHMARK_WARMUP_FRAMES = 10;
+
+// Frames timed per particle count and queue by --particle-benchmark, and untimed frames rendered
+// before them
+const uint32_t g_PARTICLE_BENCHMARK_FRAMES = 200;
+const uint32_t g_PARTICLE_BENCHMARK_WARMUP_FRAMES = 20;
+
+// Frames timed per layer count, submission order and prepass setting by --overdraw-benchmark, and
+// untimed frames rendered before them
+const uint32_t g_OVERDRAW_BENCHMARK_FRAMES = 200;
+const uint32_t g_OVERDRAW_BENCHMARK_WARMUP_FRAMES = 20;
+
+// Frames timed per sample count by --msaa-benchmark, untimed frames rendered before them, and the
+// triangles drawn per frame, small enough that most of their pixels are edge pixels
+const uint32_t g_MSAA_BENCHMARK_FRAMES = 200;
+const uint32_t g_MSAA_BENCHMARK_WARMUP_FRAMES = 20;
+const uint32_t g_MSAA_BENCHMARK_DRAWS = 10000;
+
+// Frames timed per draw count and rendering path by --rendering-benchmark, untimed frames rendered
+// before them, and the times what a swapchain recreation rebuilds is rebuilt to time that
+const uint32_t g_RENDERING_BENCHMARK_FRAMES = 200;
+const uint32_t g_RENDERING_BENCHMARK_WARMUP_FRAMES = 20;
+const uint32_t g_RENDERING_BENCHMARK_REBUILDS = 100;
+
+// Times --render-graph-benchmark rebuilds and compiles its graph to time that, and times it
+// executes the compiled graph
+const uint32_t g_RENDER_GRAPH_BENCHMARK_COMPILES = 1000;
+const uint32_t g_RENDER_GRAPH_BENCHMARK_RUNS = 50;
+
+// Meshes are only quantized when their shortest edge spans at least this many snorm16 steps
+const float g_MIN_QUANTIZED_EDGE_STEPS = 8.0f;
+
+// Device memory is allocated from the driver in blocks of this size (or an eighth of the heap,
+// if smaller) and sub-allocated from there
+const uint64_t g_DEVICE_MEMORY_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+// Persistently mapped staging ring that uploads to device local buffers go through
+const uint64_t g_STAGING_RING_SIZE = 16ull * 1024 * 1024;
+
+// Per thread arena that the driver's command scope host allocations are bump allocated from
+const uint64_t g_HOST_ARENA_SIZE = 256ull * 1024;
+
+// Slots of the bindless descriptor arrays, far below what descriptor indexing guarantees
+const uint32_t g_BINDLESS_TEXTURE_CAPACITY = 4096;
+const uint32_t g_BINDLESS_BUFFER_CAPACITY = 1024;
+
+// Texture streaming: levels up to this size form the always resident mip tail, full chains are
+// streamed in under the budget (overridable with --texture-budget), at most this many at a time and
+// with at most this many bytes of levels uploaded per frame
+const uint32_t g_TEXTURE_TAIL_SIZE = 128;
+const uint64_t g_TEXTURE_STREAMING_BUDGET = 256ull * 1024 * 1024;
+const uint32_t g_TEXTURE_MAX_STREAMS = 4;
+const uint64_t g_TEXTURE_UPLOAD_BYTES_PER_FRAME = 4ull * 1024 * 1024;
+
+// Compute mip generation handles chains of up to this many levels (8192 texels wide), and up to
+// this many registered chains at once
+const uint32_t g_MIPGEN_MAX_LEVELS = 14;
+const uint32_t g_MIPGEN_MAX_CHAINS = 16;
+
+// Particle simulation: at most this many particles (two 128 MiB buffers, which is as large as
+// maxStorageBufferRange goes on some devices), stepped this many seconds per frame
+const uint32_t g_MAX_PARTICLES = 8u * 1024 * 1024;
+const float g_PARTICLE_TIME_STEP = 1.0f / 60.0f;
+
+// Per frame uniform data the frame allocator can hand out for each frame in flight
+const uint64_t g_FRAME_ALLOCATOR_BYTES_PER_FRAME = 64ull * 1024;
+
+// Headless mode renders into this many offscreen images instead of a swapchain
+const uint32_t g_HEADLESS_IMAGE_COUNT = 3;
+const uint64_t g_HEADLESS_DEFAULT_FRAMES = 2000;
+
+// Frame profiler: samples kept per channel, and the maximum number of channels and gauges
+const uint32_t g_PROFILER_RING_CAPACITY = 4096;
+const uint32_t g_PROFILER_MAX_CHANNELS = 64;
+const uint32_t g_PROFILER_MAX_GAUGES = 32;
+
+// GPU timestamp scopes per command buffer slot (two queries each)
+const uint32_t g_GPU_PROFILER_MAX_SCOPES = 16;
@@ -0,0 +1,180 @@
+#include "GpuProfiler.h"
+
+#include <stdexcept>                        // Error reporting
+
+GpuProfiler::GpuProfiler()
+{
+    m_device = VK_NULL_HANDLE;
+    m_allocationCallbacks = nullptr;
+    m_queryPool = VK_NULL_HANDLE;
+    m_frameProfiler = nullptr;
+    m_timestampPeriod = 1.0;
+    m_timestampMask = 0;
+    m_supported = false;
+}
+
+void GpuProfiler::create(
+    VkDevice                            device,
+    const VkAllocationCallbacks*        allocationCallbacks,
+    const VkPhysicalDeviceProperties&   properties,
+    uint32_t                            timestampValidBits,
+    FrameProfiler&                      frameProfiler
+)
+{
+    m_device = device;
+    m_allocationCallbacks = allocationCallbacks;
+    m_frameProfiler = &frameProfiler;
+
+    // timestampPeriod converts ticks to nanoseconds. A queue family without valid timestamp bits
+    // cannot be profiled at all, in which case every call below becomes a no-op
+    m_timestampPeriod = properties.limits.timestampPeriod;
+    m_supported = timestampValidBits > 0 && m_timestampPeriod > 0.0;
+    m_timestampMask = timestampValidBits >= 64 ? UINT64_MAX : ((uint64_t(1) << timestampValidBits) - 1);
+}
+
+void GpuProfiler::destruct()
+{
+    if (m_queryPool != VK_NULL_HANDLE)
+    {
+        vkDestroyQueryPool(m_device, m_queryPool, m_allocationCallbacks);
+        m_queryPool = VK_NULL_HANDLE;
+    }
+
+    m_slots.clear();
+}
+
+void GpuProfiler::setSlotCount(uint32_t slotCount)
+{
+    if (!m_supported || slotCount == m_slots.size()) return;
+
+    // Only called while the device is idle (startup)
+    destruct();
+
+    VkQueryPoolCreateInfo queryPoolInfo{};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount = slotCount * g_GPU_PROFILER_MAX_SCOPES * 2;
+
+    if (vkCreateQueryPool(m_device, &queryPoolInfo, m_allocationCallbacks, &m_queryPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create timestamp query pool");
+    }
+
+    m_slots.assign(slotCount, Slot{ {}, false });
+    m_results.resize(g_GPU_PROFILER_MAX_SCOPES * 2 * 2);
+}
+
+bool GpuProfiler::isSupported() const
+{
+    return m_supported;
+}
+
+double GpuProfiler::timestampPeriod() const
+{
+    return m_timestampPeriod;
+}
+
+uint32_t GpuProfiler::firstQueryOfSlot(uint32_t slot) const
+{
+    return slot * g_GPU_PROFILER_MAX_SCOPES * 2;
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t slot)
+{
+    if (!m_supported) return;
+
+    m_slots[slot].scopes.clear();
+
+    // Reset as part of the command buffer so re-submitting a recorded buffer reuses its queries
+    vkCmdResetQueryPool(commandBuffer, m_queryPool, firstQueryOfSlot(slot), g_GPU_PROFILER_MAX_SCOPES * 2);
+}
+
+uint32_t GpuProfiler::scopeChannel(const char* name)
+{
+    // A handful of names, a scan is cheaper than hashing them
+    for (const ScopeChannel& known : m_scopeChannels)
+    {
+        if (known.name == name) return known.channel;
+    }
+
+    ScopeChannel added;
+    added.name = name;
+    added.channel = m_frameProfiler->registerChannel("gpu." + added.name);
+    m_scopeChannels.push_back(added);
+
+    return added.channel;
+}
+
+uint32_t GpuProfiler::beginScope(VkCommandBuffer commandBuffer, uint32_t slot, const char* name)
+{
+    if (!m_supported) return 0;
+
+    Slot& target = m_slots[slot];
+
+    if (target.scopes.size() == g_GPU_PROFILER_MAX_SCOPES)
+    {
+        throw std::runtime_error("Too many GPU profiler scopes in one command buffer");
+    }
+
+    Scope scope;
+    scope.channel = scopeChannel(name);
+    scope.firstQuery = firstQueryOfSlot(slot) + static_cast<uint32_t>(target.scopes.size()) * 2;
+    target.scopes.push_back(scope);
+
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_queryPool, scope.firstQuery);
+
+    return static_cast<uint32_t>(target.scopes.size() - 1);
+}
+
+void GpuProfiler::endScope(VkCommandBuffer commandBuffer, uint32_t slot, uint32_t scope)
+{
+    if (!m_supported) return;
+
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_queryPool, m_slots[slot].scopes[scope].firstQuery + 1);
+}
+
+void GpuProfiler::markSubmitted(uint32_t slot)
+{
+    if (!m_supported) return;
+
+    m_slots[slot].pending = true;
+}
+
+void GpuProfiler::collect(uint32_t slot)
+{
+    if (!m_supported || !m_slots[slot].pending) return;
+
+    Slot& target = m_slots[slot];
+    target.pending = false;
+
+    if (target.scopes.empty()) return;
+
+    uint32_t queryCount = static_cast<uint32_t>(target.scopes.size()) * 2;
+
+    // No WAIT_BIT: the caller has already waited on this slot's submission, and if a result is
+    // somehow still unavailable it is skipped rather than stalling the frame
+    VkResult result = vkGetQueryPoolResults(
+        m_device,
+        m_queryPool,
+        firstQueryOfSlot(slot),
+        queryCount,
+        queryCount * 2 * sizeof(uint64_t),
+        m_results.data(),
+        2 * sizeof(uint64_t),
+        VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT
+    );
+
+    if (result != VK_SUCCESS && result != VK_NOT_READY) return;
+
+    for (size_t i = 0; i < target.scopes.size(); i++)
+    {
+        const uint64_t* begin = &m_results[i * 4];
+        const uint64_t* end = &m_results[i * 4 + 2];
+
+        // [0] is the timestamp, [1] its availability
+        if (begin[1] == 0 || end[1] == 0) continue;
+
+        uint64_t ticks = (end[0] - begin[0]) & m_timestampMask;
+        m_frameProfiler->record(target.scopes[i].channel, static_cast<uint64_t>(ticks * m_timestampPeriod));
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "GlobalApplicationConstants.h"     // g_GPU_PROFILER_MAX_SCOPES
+#include "FrameProfiler.h"                  // GPU timings land next to the CPU ones
+
+// Timestamp query based GPU timing. Queries are grouped into slots, one per command buffer that
+// is in flight independently; a slot's results are only read back after the submission that
+// wrote them is known to have completed, and without VK_QUERY_RESULT_WAIT_BIT, so collecting
+// never stalls. Each named scope becomes a "gpu.<name>" channel in the FrameProfiler.
+class GpuProfiler
+{
+public:
+    // CONSTRUCTOR
+    //------------------------------------------------------------------------//
+    GpuProfiler();
+    //------------------------------------------------------------------------//
+
+    // PUBLIC FUNCTIONS
+    //------------------------------------------------------------------------//
+    void create(VkDevice, const VkAllocationCallbacks*, const VkPhysicalDeviceProperties&, uint32_t timestampValidBits, FrameProfiler&);
+    void destruct();
+    void setSlotCount(uint32_t);
+    bool isSupported() const;
+    double timestampPeriod() const;
+
+    // Recording (outside of a render pass for beginFrame)
+    void beginFrame(VkCommandBuffer, uint32_t slot);
+    // The first scope of each name registers its channel, later ones find it without locking
+    uint32_t beginScope(VkCommandBuffer, uint32_t slot, const char* name);
+    void endScope(VkCommandBuffer, uint32_t slot, uint32_t scope);
+
+    // Submission bookkeeping
+    void markSubmitted(uint32_t slot);
+    void collect(uint32_t slot);
+    //------------------------------------------------------------------------//
+
+private:
+    struct Scope
+    {
+        uint32_t    channel;        // FrameProfiler channel
+        uint32_t    firstQuery;     // Begin timestamp, end is firstQuery + 1
+    };
+
+    // A scope name already registered with the FrameProfiler
+    struct ScopeChannel
+    {
+        std::string name;
+        uint32_t    channel;
+    };
+
+    struct Slot
+    {
+        std::vector<Scope>  scopes;
+        bool                pending;    // Submitted and not yet collected
+    };
+
+    // PRIVATE MEMBERS
+    //------------------------------------------------------------------------//
+    VkDevice                                m_device;
+    const VkAllocationCallbacks*            m_allocationCallbacks;
+    VkQueryPool                             m_queryPool;
+    FrameProfiler*                          m_frameProfiler;
+    double                                  m_timestampPeriod;      // Nanoseconds per tick
+    uint64_t                                m_timestampMask;
+    bool                                    m_supported;
+    std::vector<Slot>                       m_slots;
+    std::vector<uint64_t>                   m_results;              // Value/availability pairs
+    std::vector<ScopeChannel>               m_scopeChannels;        // Render thread only, like recording
+    //------------------------------------------------------------------------//
+
+    // PRIVATE FUNCTIONS
+    //------------------------------------------------------------------------//
+    uint32_t firstQueryOfSlot(uint32_t slot) const;
+    uint32_t scopeChannel(const char* name);
+    //------------------------------------------------------------------------//
+};
@@ -1,15 +1,55 @@
 // Jesse Rankins 2021
 #include "HelloTriangleApplication.h"
 
-HelloTriangleApplication::HelloTriangleApplication()
+HelloTriangleApplication::HelloTriangleApplication(const ApplicationSettings& settings) : m_settings(settings)
 {
+    m_window = nullptr;
+    m_surface = VK_NULL_HANDLE;
+
     m_glfwExtensionCount = 0;
     m_requiredGLFWExtensionsEstablished = false;
 
     m_physicalDevice = VK_NULL_HANDLE;
-
-    m_currentFrame = 0;
-    m_framebufferResized = false;
+    m_dynamicRenderingSupported = false;
+    m_bindlessSupported = false;
+    m_dynamicRendering = false;
+    m_cmdBeginRendering = nullptr;
+    m_cmdEndRendering = nullptr;
+    m_cmdPipelineBarrier2 = nullptr;
+    m_renderPass = VK_NULL_HANDLE;
+
+    m_framebufferExtent = { m_settings.width, m_settings.height };
+    m_renderThreadRunning = false;
+    m_pipelineLayout = VK_NULL_HANDLE;
+    m_trianglePipeline = INVALID_PIPELINE_HANDLE;
+    m_instancedPipeline = INVALID_PIPELINE_HANDLE;
+    m_gpuDrivenPipeline = INVALID_PIPELINE_HANDLE;
+    m_particlePipeline = INVALID_PIPELINE_HANDLE;
+    m_cullingPassCreated = false;
+    m_gpuDriven = false;
+    m_depthPrepass = m_settings.depthPrepass;
+    m_overdrawScene = false;
+    m_sampleCount = VK_SAMPLE_COUNT_1_BIT;
+    m_depthFormat = VK_FORMAT_UNDEFINED;
+    m_depthImage = VK_NULL_HANDLE;
+    m_depthImageView = VK_NULL_HANDLE;
+    m_colorImage = VK_NULL_HANDLE;
+    m_colorImageView = VK_NULL_HANDLE;
+    m_mipBenchmarkChain = nullptr;
+    m_mipBenchmarkMethod = MipGenerationMethod::Compute;
+    m_mipBenchmarkLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    m_asyncParticles = !m_settings.particlesOnGraphicsQueue;
+    m_view = { 0.0f, 0.0f, 1.0f, 0.0f };
+    m_startTime = std::chrono::steady_clock::now();
+    m_frameConstantsOffset = 0;
+    m_drawList = buildGridDrawList(m_settings.drawCount);
+    m_nextOffscreenImage = 0;
+
+    // Headless rendering never presents, so the swapchain extension is only required with a window
+    if (!m_settings.headless)
+    {
+        m_deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    }
 
     initWindow();
     initVulkan();
@@ -19,37 +59,76 @@ HelloTriangleApplication::~HelloTriangleApplication()
 {
     if (validationLayersEnabled) 
     {
-        DestroyDebugUtilsMessengerEXT(m_instance, m_debugMessenger, nullptr);
+        DestroyDebugUtilsMessengerEXT(m_instance, m_debugMessenger, m_hostAllocator.callbacks());
     }
 
+    // The render loop has already waited for the device, nothing retired can still be in use
+    m_deletionQueue.flushAll();
+
+    for (auto& destroy : m_retiredSwapChains) destroy();
+
+    // Before the thread pool its reads run on, and the table and allocator its images live in
+    if (m_bindlessSupported) m_textureStreamer.destruct();
+
+    // Finishes any compiles still in flight before destroying the pipelines
+    m_pipelineRegistry.destruct();
+    m_threadPool.destruct();
+
     destructSwapChain();
 
-    vkDestroyCommandPool(m_logicalDevice, m_commandPool, nullptr);
+    m_commandRecorder.destruct();
+    vkDestroyCommandPool(m_logicalDevice, m_commandPool, m_hostAllocator.callbacks());
 
-    for (size_t i = 0; i < g_MAX_FRAMES_IN_FLIGHT; i++)
+    m_gpuProfiler.destruct();
+
+    m_frameScheduler.destruct();
+
+    // Saves the final cache contents before destroying it
+    m_pipelineCache.destruct();
+
+    m_instanceField.destruct();
+    m_cullingPass.destruct();
+    m_mipGenerator.destruct();
+    m_particleSystem.destruct();
+    m_renderGraph.destruct();
+    m_stagingUploader.destruct();
+    m_frameAllocator.destruct();
+    m_bindlessTable.destruct();
+    m_deviceAllocator.destroyBuffer(m_mesh.vertexBuffer, m_mesh.vertexAllocation);
+    m_deviceAllocator.destroyBuffer(m_mesh.indexBuffer, m_mesh.indexAllocation);
+
+    // Every buffer and image is gone by now, this releases the blocks they came from
+    m_deviceAllocator.destruct();
+
+    vkDestroyDevice(m_logicalDevice, m_hostAllocator.callbacks());
+
+    if (!m_settings.headless)
     {
-        vkDestroySemaphore(m_logicalDevice, m_renderFinishedSemaphores[i], nullptr);
-        vkDestroySemaphore(m_logicalDevice, m_imageAvailableSemaphores[i], nullptr);
-        vkDestroyFence(m_logicalDevice, m_inFlightFences[i], nullptr);
+        vkDestroySurfaceKHR(m_instance, m_surface, m_hostAllocator.callbacks());
     }
 
-    vkDestroyDevice(m_logicalDevice, nullptr);
-    vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
-    vkDestroyInstance(m_instance, nullptr);
-    glfwDestroyWindow(m_window);
-    glfwTerminate();
+    vkDestroyInstance(m_instance, m_hostAllocator.callbacks());
+
+    if (!m_settings.headless)
+    {
+        glfwDestroyWindow(m_window);
+        glfwTerminate();
+    }
 }
 
 void HelloTriangleApplication::initWindow()
 {
+    // Headless runs must work on machines without a display server
+    if (m_settings.headless) return;
+
     glfwInit();
 
     // Stop glfw from initialing with opengl
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
 
     m_window = glfwCreateWindow(
-        g_WINDOW_WIDTH, 
-        g_WINDOW_HEIGHT, 
+        m_settings.width, 
+        m_settings.height, 
         "Vulkan Renderer", 
         nullptr, 
         nullptr
@@ -57,261 +136,1421 @@ void HelloTriangleApplication::initWindow()
 
     glfwSetWindowUserPointer(m_window, this);
     glfwSetFramebufferSizeCallback(m_window, framebufferResizeCallback);
+    glfwSetKeyCallback(m_window, keyCallback);
+
+    // From here on the render thread learns about size changes through Resize events only
+    int width, height;
+    glfwGetFramebufferSize(m_window, &width, &height);
+    m_framebufferExtent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
 }
 
 void HelloTriangleApplication::framebufferResizeCallback(GLFWwindow* window, int width, int height)
 {
     auto app = reinterpret_cast<HelloTriangleApplication*>(glfwGetWindowUserPointer(window));
-    app->m_framebufferResized = true;
+    app->pushWindowEvent({ WindowEventType::Resize, static_cast<uint32_t>(width), static_cast<uint32_t>(height) });
+}
+
+void HelloTriangleApplication::keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+    auto app = reinterpret_cast<HelloTriangleApplication*>(glfwGetWindowUserPointer(window));
+
+    // On demand frame timing report
+    if (key == GLFW_KEY_P && action == GLFW_PRESS)
+    {
+        app->reportFrameTimings(std::cout, ProfileReportFormat::Text);
+    }
 }
 
 void HelloTriangleApplication::initVulkan()
 {
+    // Before anything the driver could allocate for
+    m_hostAllocator.create(m_frameProfiler);
+
     createVkInstance();
     setupDebugMessenger();
     createSurface();
     selectPhysicalDevice();
     createLogicalDevice();
     getDeviceQueue(); 
-    createSwapChain();
+    createDeviceAllocator();
+    createStagingUploader();
+    createFrameAllocator();
+    createBindlessTable();
+    createMeshBuffers();                    // Before the pipelines, which depend on its encoding
+    createGpuProfiler();
+    createPipelineCache();
+    createPipelineRegistry();
+
+    if (m_settings.headless)
+    {
+        createOffscreenImages();
+    }
+    else
+    {
+        createSwapChain(VK_NULL_HANDLE);
+    }
+
     createImageViews();
+    createAttachmentImages();
     createRenderPass();
     createGraphicsPipeline();
     createFrameBuffers();
     createCommandPool();
     createCommandBuffers();
     createSynchronizationObjects();
+    createInstanceField();
+    createCullingPass();
+    createMipGenerator();
+    createTextureStreamer();
+    createParticleSystem();
+    createRenderGraph();
 }
 
 void HelloTriangleApplication::recreateSwapChain()
 {
-    int width = 0, height = 0;
-    glfwGetFramebufferSize(m_window, &width, &height);
+    // Minimized, renderLoop() holds off drawing until a Resize event restores the size
+    if (m_framebufferExtent.width == 0 || m_framebufferExtent.height == 0) return;
+
+    FrameProfiler::Scope scope(m_frameProfiler, FramePhase::SwapchainRecreate);
+
+    // Frames still in flight may reference everything replaced below, so rather than idling the
+    // device it is all retired until the last submitted frame has completed
+    uint64_t                        retireValue = m_frameScheduler.submittedValue();
+    VkDevice                        device = m_logicalDevice;
+    const VkAllocationCallbacks*    allocationCallbacks = m_hostAllocator.callbacks();
+    VkSwapchainKHR                  oldSwapChain = m_swapChain;
+    VkFormat                        oldFormat = m_swapChainImageFormat;
+    std::vector<VkImageView>        oldImageViews = std::move(m_swapChainImageViews);
+    std::vector<VkFramebuffer>      oldFramebuffers = std::move(m_swapChainFramebuffers);
+    DeviceAllocator*                deviceAllocator = &m_deviceAllocator;
+    VkImage                         oldAttachmentImages[2] = { m_depthImage, m_colorImage };
+    MemoryAllocation                oldAttachmentAllocations[2] = { m_depthAllocation, m_colorAllocation };
+    VkImageView                     oldAttachmentViews[2] = { m_depthImageView, m_colorImageView };
+
+    // Handing over the old swapchain lets the driver recycle its resources and keep presenting
+    // what it has queued while the new one is created
+    createSwapChain(oldSwapChain);
+    m_frameScheduler.setImageCount(static_cast<uint32_t>(m_swapChainImages.size()));
+    createImageViews();
+    createAttachmentImages();
 
-    while (width == 0 || height == 0) 
+    // Viewport and scissor are dynamic, so the render pass and pipeline only depend on the format
+    if (m_swapChainImageFormat != oldFormat)
     {
-        glfwGetFramebufferSize(m_window, &width, &height);
-        glfwWaitEvents();
-    }
+        VkRenderPass oldRenderPass = m_renderPass;
 
-    vkDeviceWaitIdle(m_logicalDevice);
+        // A compile still in progress may be using the old render pass. Format changes are rare
+        // enough that simply letting them finish is fine. Pipelines built against the old pass
+        // stay in the registry, harmlessly, until shutdown
+        m_pipelineRegistry.waitForPending();
 
-    destructSwapChain();
+        m_deletionQueue.push(retireValue, [device, allocationCallbacks, oldRenderPass]() {
+            vkDestroyRenderPass(device, oldRenderPass, allocationCallbacks);
+        });
+
+        createRenderPass();
+        createGraphicsPipeline();
+    }
 
-    createSwapChain();
-    createImageViews();
-    createRenderPass();
-    createGraphicsPipeline();
     createFrameBuffers();
-    createCommandBuffers();
+
+    // The frame timeline only says when rendering to the old images has finished, not when the
+    // presentation engine is done with them: presents queued on the old swapchain may still be
+    // pending once retireValue is reached. An image acquired from the new swapchain means those
+    // presents have been taken over, so drawFrame() only queues this for deletion after that
+    m_retiredSwapChains.push_back([device, allocationCallbacks, oldSwapChain, oldImageViews, oldFramebuffers]() {
+        for (auto framebuffer : oldFramebuffers) vkDestroyFramebuffer(device, framebuffer, allocationCallbacks);
+        for (auto imageView : oldImageViews) vkDestroyImageView(device, imageView, allocationCallbacks);
+        vkDestroySwapchainKHR(device, oldSwapChain, allocationCallbacks);
+    });
+
+    m_deletionQueue.push(retireValue, [device, allocationCallbacks, deviceAllocator, oldAttachmentImages, oldAttachmentAllocations, oldAttachmentViews]() mutable {
+        for (uint32_t i = 0; i < 2; i++)
+        {
+            vkDestroyImageView(device, oldAttachmentViews[i], allocationCallbacks);
+            deviceAllocator->destroyImage(oldAttachmentImages[i], oldAttachmentAllocations[i]);
+        }
+    });
 }
 
 void HelloTriangleApplication::destructSwapChain()
 {
     for (auto framebuffer : m_swapChainFramebuffers)
     {
-        vkDestroyFramebuffer(m_logicalDevice, framebuffer, nullptr);
+        vkDestroyFramebuffer(m_logicalDevice, framebuffer, m_hostAllocator.callbacks());
     }
 
-    vkFreeCommandBuffers(m_logicalDevice, m_commandPool, static_cast<uint32_t>(m_commandBuffers.size()), m_commandBuffers.data());
-    vkDestroyPipeline(m_logicalDevice, m_graphicsPipeline, nullptr);
-    vkDestroyPipelineLayout(m_logicalDevice, m_pipelineLayout, nullptr);
-    vkDestroyRenderPass(m_logicalDevice, m_renderPass, nullptr);
+    vkDestroyPipelineLayout(m_logicalDevice, m_pipelineLayout, m_hostAllocator.callbacks());
+    vkDestroyRenderPass(m_logicalDevice, m_renderPass, m_hostAllocator.callbacks());
 
     for (auto imageView : m_swapChainImageViews)
     {
-        vkDestroyImageView(m_logicalDevice, imageView, nullptr);
+        vkDestroyImageView(m_logicalDevice, imageView, m_hostAllocator.callbacks());
     }
 
-    vkDestroySwapchainKHR(m_logicalDevice, m_swapChain, nullptr);
+    destroyAttachmentImages();
+
+    if (m_settings.headless)
+    {
+        for (size_t i = 0; i < m_swapChainImages.size(); i++)
+        {
+            m_deviceAllocator.destroyImage(m_swapChainImages[i], m_offscreenImageAllocations[i]);
+        }
+    }
+    else
+    {
+        vkDestroySwapchainKHR(m_logicalDevice, m_swapChain, m_hostAllocator.callbacks());
+    }
 }
 
 void HelloTriangleApplication::run()
 {
-    mainLoop();
+    if (m_settings.recordBenchmark)
+    {
+        runRecordBenchmark();
+    }
+    else if (m_settings.cullBenchmark)
+    {
+        runCullBenchmark();
+    }
+    else if (m_settings.vertexBenchmark)
+    {
+        runVertexBenchmark();
+    }
+    else if (m_settings.mipBenchmark)
+    {
+        runMipBenchmark();
+    }
+    else if (m_settings.particleBenchmark)
+    {
+        runParticleBenchmark();
+    }
+    else if (m_settings.overdrawBenchmark)
+    {
+        runOverdrawBenchmark();
+    }
+    else if (m_settings.msaaBenchmark)
+    {
+        runMsaaBenchmark();
+    }
+    else if (m_settings.renderingBenchmark)
+    {
+        runRenderingBenchmark();
+    }
+    else if (m_settings.renderGraphBenchmark)
+    {
+        runRenderGraphBenchmark();
+    }
+    else if (m_settings.headless)
+    {
+        runHeadless();
+    }
+    else
+    {
+        mainLoop();
+    }
+
+    writeExitReport();
+}
+
+void HelloTriangleApplication::reportFrameTimings(std::ostream& out, ProfileReportFormat format) const
+{
+    m_frameProfiler.writeReport(out, format);
 }
 
-void HelloTriangleApplication::mainLoop()
+void HelloTriangleApplication::writeExitReport()
 {
-    while (!glfwWindowShouldClose(m_window))
+    if (m_settings.profileReport == ProfileReportFormat::None) return;
+
+    if (m_settings.profileOutput.empty())
     {
-        glfwPollEvents();
-        drawFrame();
+        reportFrameTimings(std::cout, m_settings.profileReport);
+        return;
     }
 
-    vkDeviceWaitIdle(m_logicalDevice);
+    std::ofstream file(m_settings.profileOutput);
+
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Failed to open profile output file " + m_settings.profileOutput);
+    }
+
+    reportFrameTimings(file, m_settings.profileReport);
 }
 
-void HelloTriangleApplication::createVkInstance()
+void HelloTriangleApplication::mainLoop()
 {
-    // Initialize application information struct
-    VkApplicationInfo appInfo{};
-    appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
-    appInfo.pNext = nullptr;
-    appInfo.pApplicationName = "Hello Triangle";
-    appInfo.applicationVersion = VK_MAKE_API_VERSION(0, 1, 0, 0);
-    appInfo.pEngineName = "No Engine";
-    appInfo.engineVersion = VK_MAKE_API_VERSION(0, 1, 0, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    // GLFW event processing must stay on the main thread, so rendering moves off it instead
+    m_renderThreadRunning.store(true, std::memory_order_release);
+    m_renderThread = std::thread(&HelloTriangleApplication::renderLoop, this);
 
-    // Initialize the instance creation struct, providing appInfo
-    VkInstanceCreateInfo createInfo{};
-    createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
-    createInfo.pApplicationInfo = &appInfo;
+    if (m_settings.resizeStorm > 0)
+    {
+        runResizeStorm();
+    }
 
-    // Get a vector of all the required GLFW extensions for this instance
-    std::vector<const char*> requiredExtensions = getRequiredGLFWExtensions();
+    auto nextCacheSave = std::chrono::steady_clock::now() + std::chrono::milliseconds(g_PIPELINE_CACHE_SAVE_INTERVAL_MS);
 
-    // Assert that the required glfw extensions and validation layers are all
-    // available for use in this VkInstance
-    assertRequiredGLFWExtensionsAreAvailable();
-    assertRequiredValidationLayersAreAvailable();
+    // Nothing else happens on this thread, so block for events rather than polling, waking up
+    // now and then to persist the pipeline cache without the render thread paying for the IO
+    while (m_renderThreadRunning.load(std::memory_order_acquire) && !glfwWindowShouldClose(m_window))
+    {
+        glfwWaitEventsTimeout(g_PIPELINE_CACHE_SAVE_INTERVAL_MS / 1000.0);
 
-    // Finish initializing the instance creation struct
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(requiredExtensions.size());
-    createInfo.ppEnabledExtensionNames = requiredExtensions.data();
+        if (std::chrono::steady_clock::now() >= nextCacheSave)
+        {
+            m_pipelineCache.saveIfChanged();
+            nextCacheSave = std::chrono::steady_clock::now() + std::chrono::milliseconds(g_PIPELINE_CACHE_SAVE_INTERVAL_MS);
+        }
+    }
 
-    VkDebugUtilsMessengerCreateInfoEXT debugCreateInfo{};
+    pushWindowEvent({ WindowEventType::Quit, 0, 0 });
+    m_renderThread.join();
 
-    // If in debug mode, include the validation layers in our initialization 
-    if (validationLayersEnabled)
+    if (m_renderThreadError)
     {
-        createInfo.enabledLayerCount = static_cast<uint32_t>(m_validationLayers.size());
-        createInfo.ppEnabledLayerNames = m_validationLayers.data();
+        std::rethrow_exception(m_renderThreadError);
+    }
 
-        populateDebugMessengerCreateInfo(debugCreateInfo);
-        createInfo.pNext = (VkDebugUtilsMessengerCreateInfoEXT*)&debugCreateInfo;
+    if (m_settings.resizeStorm > 0)
+    {
+        writeResizeStormSummary();
     }
-    else
+}
+
+void HelloTriangleApplication::runResizeStorm()
+{
+    // Runs on the event thread while the render thread keeps drawing. Alternating between two
+    // sizes makes every step a real extent change
+    for (uint32_t i = 0; i < m_settings.resizeStorm; i++)
     {
-        createInfo.enabledLayerCount = 0;
+        if (!m_renderThreadRunning.load(std::memory_order_acquire) || glfwWindowShouldClose(m_window)) return;
 
-        createInfo.pNext = nullptr;
+        uint32_t scale = (i % 2 == 0) ? 3 : 2;
+        glfwSetWindowSize(m_window, static_cast<int>(m_settings.width * scale / 2), static_cast<int>(m_settings.height * scale / 2));
+
+        // Keep servicing events (including the resulting resize) until the next step is due
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(g_RESIZE_STORM_INTERVAL_MS);
+        for (auto now = std::chrono::steady_clock::now(); now < deadline; now = std::chrono::steady_clock::now())
+        {
+            glfwWaitEventsTimeout(std::chrono::duration<double>(deadline - now).count());
+        }
     }
 
-    // Create and validate the instance
-    if (vkCreateInstance(&createInfo, nullptr, &m_instance) != VK_SUCCESS)
+    glfwSetWindowShouldClose(m_window, GLFW_TRUE);
+}
+
+void HelloTriangleApplication::writeResizeStormSummary()
+{
+    ProfileChannelStatistics frame{};
+    ProfileChannelStatistics recreate{};
+
+    for (const auto& channel : m_frameProfiler.statistics())
     {
-        throw std::runtime_error("failed to create VkInstance");
+        if (channel.name == "cpu.frame") frame = channel;
+        if (channel.name == "cpu.swapchain_recreate") recreate = channel;
     }
+
+    std::cout << "Resize storm: " << m_settings.resizeStorm << " resizes, " 
+              << recreate.samples << " swapchain recreations (mean " << recreate.meanMs << " ms, max " << recreate.maxMs << " ms), " 
+              << "worst frame " << frame.maxMs << " ms, p99 frame " << frame.p99Ms << " ms" << std::endl;
 }
 
-std::vector<const char*> HelloTriangleApplication::getRequiredGLFWExtensions()
+void HelloTriangleApplication::renderLoop()
 {
-    // This ensures that the order for calling assertRequiredGLFWExtensionsAreAvailable() is preserved
-    m_requiredGLFWExtensionsEstablished = true;
+    try
+    {
+        bool resizePending = false;
+        bool quit = false;
 
-    // Get all required glfw extensions and their count
-    m_glfwExtensions = glfwGetRequiredInstanceExtensions(&m_glfwExtensionCount);
+        while (!quit)
+        {
+            WindowEvent event;
 
-    std::vector<const char*> extensions(m_glfwExtensions, m_glfwExtensions + m_glfwExtensionCount);
+            while (m_windowEvents.tryPop(event))
+            {
+                switch (event.type)
+                {
+                case WindowEventType::Resize:
+                    m_framebufferExtent = { event.width, event.height };
+                    resizePending = true;
+                    break;
+                case WindowEventType::Quit:
+                    quit = true;
+                    break;
+                }
+            }
 
-    if (validationLayersEnabled)
+            if (quit) break;
+
+            // Minimized, there is nothing to render into until the next Resize event
+            if (m_framebufferExtent.width == 0 || m_framebufferExtent.height == 0)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+
+            // Several resize events in one frame only cost one recreation
+            if (resizePending)
+            {
+                resizePending = false;
+                recreateSwapChain();
+            }
+
+            drawFrame();
+        }
+
+        vkDeviceWaitIdle(m_logicalDevice);
+    }
+    catch (...)
     {
-        extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+        // Handed to the main thread, which rethrows it once the render thread is joined
+        m_renderThreadError = std::current_exception();
     }
 
-    return extensions;
+    m_renderThreadRunning.store(false, std::memory_order_release);
+    glfwPostEmptyEvent();
 }
 
-void HelloTriangleApplication::assertRequiredGLFWExtensionsAreAvailable()
+void HelloTriangleApplication::pushWindowEvent(const WindowEvent& event)
 {
-    // getRequiredGLFWExtensions() must be called before this function to prevent errors
-    if (!m_requiredGLFWExtensionsEstablished)
+    // The render thread drains the queue every frame, so it is only ever full if rendering has
+    // stalled; retry rather than drop the event, unless there is no render thread left to drain it
+    while (!m_windowEvents.tryPush(event))
     {
-        throw std::runtime_error("assertRequiredGLFWExtensionsAreAvailable() called before getRequiredGLFWExtensions()");
+        if (!m_renderThreadRunning.load(std::memory_order_acquire)) return;
+        std::this_thread::yield();
     }
+}
 
-    // Get a count of all the available extensions
-    uint32_t numberOfAvailableExtensions = 0;
-    vkEnumerateInstanceExtensionProperties(nullptr, &numberOfAvailableExtensions, nullptr);
+void HelloTriangleApplication::runHeadless()
+{
+    std::cout << "Headless rendering on " << m_physicalDeviceProperties.deviceName 
+              << " (" << m_swapChainExtent.width << "x" << m_swapChainExtent.height 
+              << ", " << m_settings.frameCount << " frames, " << m_settings.framesInFlight << " in flight)" << std::endl;
 
-    // Init a vector of VkExtensionProperties to the size of the number of available extensions established above
-    std::vector<VkExtensionProperties> allAvailableExtensions(numberOfAvailableExtensions);
+    if (m_gpuProfiler.isSupported())
+    {
+        std::cout << "GPU timestamps enabled, " << m_gpuProfiler.timestampPeriod() << " ns per tick" << std::endl;
+    }
 
-    // Find all available extensions and place them in the vector
-    vkEnumerateInstanceExtensionProperties(nullptr, &numberOfAvailableExtensions, allAvailableExtensions.data());
+    // Measure rendering, not how long the first frames spend skipping draws during compilation
+    // or waiting for geometry
+    m_pipelineRegistry.waitForPending();
+    m_stagingUploader.waitIdle();
 
-    // Assertion loop. The ith required tested against the jth available. If not found, exception thrown
-    for (unsigned int i = 0; i < m_glfwExtensionCount; i++)
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint64_t frame = 0; frame < m_settings.frameCount; frame++)
     {
-        bool extensionNotFound = true;
-        
-        for (int j = 0; j < allAvailableExtensions.size(); j++)
-        {
-            if (strcmp(m_glfwExtensions[i], allAvailableExtensions[j].extensionName) == 0)
-            {
-                extensionNotFound = false;
-                break;
-            }
-        }
+        drawOffscreenFrame();
+    }
 
-        if (extensionNotFound)
+    // Count the GPU work of the final frames too, not just their submission
+    vkDeviceWaitIdle(m_logicalDevice);
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Rendered " << m_settings.frameCount << " frames in " << seconds << " s: " 
+              << (m_settings.frameCount / seconds) << " frames/sec, " 
+              << (seconds * 1000.0 / m_settings.frameCount) << " ms/frame" << std::endl;
+
+    if (m_instanceField.instanceCount() > 0)
+    {
+        ProfileChannelStatistics update{};
+
+        for (const auto& channel : m_frameProfiler.statistics())
         {
-            throw std::runtime_error("Required GLFW extension missing");
+            if (channel.name == "cpu.instance_update") update = channel;
         }
+
+        double instancesPerSecond = static_cast<double>(m_instanceField.instanceCount()) * m_settings.frameCount / seconds;
+
+        std::cout << "  " << m_instanceField.instanceCount() << " instances: " << (instancesPerSecond / 1e6) << " million instances/sec, " 
+                  << (instancesPerSecond * m_mesh.indexCount / 3 / 1e6) << " million triangles/sec, CPU update mean " 
+                  << update.meanMs << " ms (p95 " << update.p95Ms << " ms)" << std::endl;
     }
 }
 
-void HelloTriangleApplication::assertRequiredValidationLayersAreAvailable()
+void HelloTriangleApplication::runRecordBenchmark()
 {
-    // Get a count of all of the available validation layers
-    uint32_t validationLayerCount = 0;
-    vkEnumerateInstanceLayerProperties(&validationLayerCount, nullptr);
-
-    // Init a vector of VkLayerProperties to the size of the available validation layers found above
-    std::vector<VkLayerProperties> availableLayers(validationLayerCount);
-
-    // Fill the vector with all of the available validation layers
-    vkEnumerateInstanceLayerProperties(&validationLayerCount, availableLayers.data());
+    uint32_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    uint32_t maxThreads = std::min(g_MAX_RECORD_THREADS, hardwareThreads);
+
+    std::cout << "Command recording benchmark on " << m_physicalDeviceProperties.deviceName 
+              << " (" << hardwareThreads << " hardware threads, " << g_RECORD_BENCHMARK_ITERATIONS << " recordings each)" << std::endl;
+
+    // Only recording is timed, nothing is ever submitted. The draws must not be skipped for a
+    // pipeline that is still compiling or geometry still uploading, though, and one real frame
+    // takes ownership of the uploads so the timed recordings have nothing left to acquire
+    m_pipelineRegistry.waitForPending();
+    m_stagingUploader.waitIdle();
+    drawOffscreenFrame();
+    vkDeviceWaitIdle(m_logicalDevice);
 
-    // Assertion loop. The ith required tested against the jth available. If not found, exception thrown
-    for (const char* validationLayerName : m_validationLayers)    // ith
+    for (uint32_t drawCount : { 10000u, 50000u, 100000u })
     {
-        bool layerNotFound = true;
+        m_drawList = buildGridDrawList(drawCount);
 
-        for (const auto& availableLayer : availableLayers)      // jth
+        for (uint32_t threads = 1; threads <= maxThreads; threads *= 2)
         {
-            if (strcmp(validationLayerName, availableLayer.layerName) == 0)
+            m_commandRecorder.destruct();
+            m_commandRecorder.create(m_logicalDevice, m_hostAllocator.callbacks(), m_queueFamilyIndices.graphicsFamily.value(), threads, m_settings.framesInFlight);
+
+            // The first recording grows the pools, keep it out of the numbers. Nothing is
+            // submitted, so slot 0's frame data can be rewound before every recording
+            m_frameAllocator.beginFrame(0);
+            recordCommandBuffer(m_commandBuffers[0], 0, 0);
+
+            std::vector<double> samples(g_RECORD_BENCHMARK_ITERATIONS);
+
+            for (auto& sample : samples)
             {
-                layerNotFound = false;
-                break;
+                m_frameAllocator.beginFrame(0);
+
+                auto start = std::chrono::steady_clock::now();
+                recordCommandBuffer(m_commandBuffers[0], 0, 0);
+                sample = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
             }
-        }
-        
-        if (layerNotFound)
-        {
-            throw std::runtime_error("Required validation layer not found in available layers");
+
+            std::sort(samples.begin(), samples.end());
+
+            double mean = 0.0;
+            for (double sample : samples) mean += sample;
+            mean /= samples.size();
+
+            std::cout << "  " << drawCount << " draws, " << threads << (threads == 1 ? " thread" : " threads") 
+                      << ": mean " << mean << " ms, p50 " << samples[samples.size() / 2] 
+                      << " ms, p95 " << samples[samples.size() * 95 / 100] << " ms" << std::endl;
         }
     }
+
+    // Leave things as configured on the command line
+    m_commandRecorder.destruct();
+    m_commandRecorder.create(m_logicalDevice, m_hostAllocator.callbacks(), m_queueFamilyIndices.graphicsFamily.value(), m_settings.recordThreads, m_settings.framesInFlight);
+    m_drawList = buildGridDrawList(m_settings.drawCount);
 }
 
-void HelloTriangleApplication::setupDebugMessenger()
+BenchmarkMeasurement HelloTriangleApplication::measureConfiguration(uint32_t warmupFrames, uint32_t frames)
 {
-    if (!validationLayersEnabled) return;
-
-    VkDebugUtilsMessengerCreateInfoEXT createInfo;
-    populateDebugMessengerCreateInfo(createInfo);
-    
-    if (CreateDebugUtilsMessengerEXT(m_instance, &createInfo, nullptr, &m_debugMessenger) != VK_SUCCESS)
+    // Warming up takes ownership of whatever the configuration uploaded, and pushes the previous
+    // configuration's GPU timings, which arrive frames late, out of the timed window
+    for (uint32_t frame = 0; frame < warmupFrames; frame++)
     {
-        throw std::runtime_error("failed to set up debug messenger!");
+        drawOffscreenFrame();
     }
-}
 
-VKAPI_ATTR VkBool32 VKAPI_CALL HelloTriangleApplication::debugCallback(
-    VkDebugUtilsMessageSeverityFlagBitsEXT          messageSeverity,
-    VkDebugUtilsMessageTypeFlagsEXT                 messageType,
-    const VkDebugUtilsMessengerCallbackDataEXT*     pCallbackData,
-    void*                                           pUserData
-)
-{
-    if (messageSeverity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT)
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint32_t frame = 0; frame < frames; frame++)
     {
-        std::cerr << "validation layer: " << pCallbackData->pMessage << std::endl;
+        drawOffscreenFrame();
     }
 
-    return VK_FALSE;
+    // The GPU work of the last frames counts too
+    vkDeviceWaitIdle(m_logicalDevice);
+
+    BenchmarkMeasurement measurement;
+    measurement.frameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+    measurement.channels = m_frameProfiler.statistics(frames);
+
+    return measurement;
+}
+
+void HelloTriangleApplication::runCullBenchmark()
+{
+    std::cout << "Culling benchmark on " << m_physicalDeviceProperties.deviceName 
+              << " (" << g_CULL_BENCHMARK_FRAMES << " frames each)" << std::endl;
+
+    if (!m_cullingPassCreated)
+    {
+        std::cout << "GPU-driven drawing is not available on this device" << std::endl;
+        return;
+    }
+
+    struct Configuration
+    {
+        const char*     name;
+        bool            gpuDriven;
+        DrawCommand     view;
+    };
+
+    // Zoomed in, only about a quarter of the grid is on screen for the culling pass to keep.
+    // The CPU recorded path does not cull, so it is only timed with everything on screen
+    const Configuration configurations[] = {
+        { "cpu recorded",           false,  { 0.0f, 0.0f, 1.0f, 0.0f } },
+        { "gpu driven",             true,   { 0.0f, 0.0f, 1.0f, 0.0f } },
+        { "gpu driven, 2x zoom",    true,   { 0.0f, 0.0f, 2.0f, 0.0f } }
+    };
+
+    for (uint32_t drawCount : { 10000u, 50000u, 100000u })
+    {
+        // The object buffer is replaced outright, nothing may still be reading it
+        vkDeviceWaitIdle(m_logicalDevice);
+        m_drawList = buildGridDrawList(drawCount);
+        m_cullingPass.setObjects(m_drawList, m_mesh.indexCount, m_mesh.boundingRadius);
+        m_stagingUploader.waitIdle();
+
+        for (const Configuration& configuration : configurations)
+        {
+            m_gpuDriven = configuration.gpuDriven;
+            m_view = configuration.view;
+
+            m_pipelineRegistry.waitForPending();
+
+            BenchmarkMeasurement measurement = measureConfiguration(g_CULL_BENCHMARK_WARMUP_FRAMES, g_CULL_BENCHMARK_FRAMES);
+
+            std::cout << "  " << drawCount << " draws, " << configuration.name << ": frame " << measurement.frameMs 
+                      << " ms, record mean " << measurement.channel("cpu.record").meanMs << " ms";
+
+            if (m_gpuProfiler.isSupported())
+            {
+                std::cout << ", gpu cull " << (configuration.gpuDriven ? measurement.channel("gpu.cull").meanMs : 0.0) 
+                          << " ms, gpu render pass " << measurement.channel("gpu.render_pass").meanMs << " ms";
+            }
+
+            std::cout << std::endl;
+        }
+    }
+
+    // Leave things as configured on the command line
+    vkDeviceWaitIdle(m_logicalDevice);
+    m_drawList = buildGridDrawList(m_settings.drawCount);
+    m_cullingPass.setObjects(m_drawList, m_mesh.indexCount, m_mesh.boundingRadius);
+    m_gpuDriven = m_settings.gpuDriven;
+    m_view = { 0.0f, 0.0f, 1.0f, 0.0f };
+}
+
+void HelloTriangleApplication::runVertexBenchmark()
+{
+    std::cout << "Vertex encoding benchmark on " << m_physicalDeviceProperties.deviceName 
+              << " (" << g_VERTEX_BENCHMARK_DRAWS << " draws of the mesh, " << g_VERTEX_BENCHMARK_FRAMES << " frames each)" << std::endl;
+
+    // Overlapping copies of a dense mesh, small on screen, so vertex fetch rather than
+    // rasterization sets the pace
+    m_drawList = buildGridDrawList(g_VERTEX_BENCHMARK_DRAWS);
+    m_pipelineRegistry.waitForPending();
+
+    GpuMesh configuredMesh = m_mesh;
+
+    for (uint32_t cells : { 64u, 256u, 1024u })
+    {
+        MeshData grid = buildGridMesh(cells);
+        double floatFrameMs = 0.0;
+
+        for (VertexEncoding encoding : { VertexEncoding::Float, VertexEncoding::Quantized })
+        {
+            bool quantized = encoding == VertexEncoding::Quantized;
+
+            GpuMesh mesh;
+            mesh.boundingRadius = grid.boundingRadius();
+            mesh.lods = { { 0, static_cast<uint32_t>(grid.indices.size()), 0 } };
+            mesh.encoding = encoding;
+            mesh.positionScale = quantized ? grid.positionQuantizationScale() : 1.0f;
+
+            std::vector<PackedVertex> packed;
+            if (quantized) packed = grid.quantizedVertices(mesh.positionScale);
+
+            const void* vertices = quantized ? static_cast<const void*>(packed.data()) : static_cast<const void*>(grid.vertices.data());
+            VkDeviceSize vertexBytes = quantized ? sizeof(PackedVertex) * packed.size() : sizeof(Vertex) * grid.vertices.size();
+
+            uploadMesh(mesh, vertices, vertexBytes, grid.indices.data(), sizeof(uint32_t) * grid.indices.size());
+            m_stagingUploader.waitIdle();
+            m_mesh = mesh;
+
+            BenchmarkMeasurement measurement = measureConfiguration(g_VERTEX_BENCHMARK_WARMUP_FRAMES, g_VERTEX_BENCHMARK_FRAMES);
+            double frameMs = measurement.frameMs;
+
+            std::cout << "  " << grid.vertices.size() << " vertices, " << (quantized ? "quantized" : "float32  ") << ": " 
+                      << (vertexBytes / grid.vertices.size()) << " bytes/vertex, " << (vertexBytes / 1024) << " KiB, frame " 
+                      << frameMs << " ms";
+
+            if (m_gpuProfiler.isSupported())
+            {
+                std::cout << ", gpu render pass " << measurement.channel("gpu.render_pass").meanMs << " ms";
+            }
+
+            if (quantized && floatFrameMs > 0.0)
+            {
+                std::cout << " (" << (100.0 * (frameMs - floatFrameMs) / floatFrameMs) << "% frame time against float32)";
+            }
+
+            std::cout << std::endl;
+            floatFrameMs = frameMs;
+
+            // Nothing is in flight any more after the wait above
+            m_deviceAllocator.destroyBuffer(mesh.vertexBuffer, mesh.vertexAllocation);
+            m_deviceAllocator.destroyBuffer(mesh.indexBuffer, mesh.indexAllocation);
+        }
+    }
+
+    // Leave things as configured on the command line
+    m_mesh = configuredMesh;
+    m_drawList = buildGridDrawList(m_settings.drawCount);
+}
+
+void HelloTriangleApplication::runMipBenchmark()
+{
+    std::cout << "Mip generation benchmark on " << m_physicalDeviceProperties.deviceName 
+              << " (RGBA8, " << g_MIP_BENCHMARK_FRAMES << " frames each)" << std::endl;
+
+    m_pipelineRegistry.waitForPending();
+
+    for (uint32_t size : { 1024u, 2048u, 4096u, 8192u })
+    {
+        uint32_t levelCount = 1;
+        while ((size >> levelCount) > 0) levelCount++;
+
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+        imageInfo.extent = { size, size, 1 };
+        imageInfo.mipLevels = levelCount;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        VkImage image;
+        MemoryAllocation allocation;
+        m_deviceAllocator.createImage(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, allocation);
+
+        MipChain chain = m_mipGenerator.createChain(image, imageInfo.format, { size, size }, levelCount);
+        double blitMs = 0.0;
+
+        for (MipGenerationMethod method : { MipGenerationMethod::Blit, MipGenerationMethod::Compute })
+        {
+            bool compute = method == MipGenerationMethod::Compute;
+
+            if (!m_mipGenerator.supports(chain, method) || (compute && !m_mipGenerator.isReady()))
+            {
+                std::cout << "  " << size << "x" << size << ", " << (compute ? "compute" : "blit") << ": not supported on this device" << std::endl;
+                continue;
+            }
+
+            // Level 0 keeps whatever it held, the timings do not depend on it
+            m_mipBenchmarkChain = &chain;
+            m_mipBenchmarkMethod = method;
+            m_mipBenchmarkLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+            BenchmarkMeasurement measurement = measureConfiguration(g_MIP_BENCHMARK_WARMUP_FRAMES, g_MIP_BENCHMARK_FRAMES);
+            ProfileChannelStatistics mipgen = measurement.channel("gpu.mipgen");
+
+            std::cout << "  " << size << "x" << size << ", " << levelCount << " levels, " << (compute ? "compute" : "blit   ") 
+                      << ": frame " << measurement.frameMs << " ms";
+
+            if (m_gpuProfiler.isSupported())
+            {
+                std::cout << ", gpu mipgen " << mipgen.meanMs << " ms";
+
+                if (compute && blitMs > 0.0)
+                {
+                    std::cout << " (" << (blitMs / mipgen.meanMs) << "x the blit chain's speed)";
+                }
+
+                blitMs = compute ? blitMs : mipgen.meanMs;
+            }
+
+            std::cout << std::endl;
+        }
+
+        // Nothing is in flight any more after the waits above
+        m_mipBenchmarkChain = nullptr;
+        m_mipGenerator.destroyChain(chain);
+        m_deviceAllocator.destroyImage(image, allocation);
+    }
+}
+
+void HelloTriangleApplication::runParticleBenchmark()
+{
+    std::cout << "Particle benchmark on " << m_physicalDeviceProperties.deviceName 
+              << " (" << g_PARTICLE_BENCHMARK_FRAMES << " frames each)" << std::endl;
+
+    if (!m_bindlessSupported)
+    {
+        std::cout << "Particles are not available on this device" << std::endl;
+        return;
+    }
+
+    if (!m_particleSystem.usesDedicatedQueue())
+    {
+        std::cout << "  No compute only queue family, async steps go to the graphics queue as separate submissions" << std::endl;
+    }
+
+    m_pipelineRegistry.waitForPending();
+
+    for (uint32_t particleCount : { 1u << 20, 4u << 20, 8u << 20 })
+    {
+        if (particleCount * 16ull > m_physicalDeviceProperties.limits.maxStorageBufferRange)
+        {
+            std::cout << "  " << particleCount << " particles: larger than a storage buffer may be on this device" << std::endl;
+            continue;
+        }
+
+        // The buffers are replaced outright, nothing may still be using them
+        vkDeviceWaitIdle(m_logicalDevice);
+        m_particleSystem.setParticleCount(particleCount);
+
+        double graphicsQueueFrameMs = 0.0;
+
+        for (bool async : { false, true })
+        {
+            m_asyncParticles = async;
+
+            BenchmarkMeasurement measurement = measureConfiguration(g_PARTICLE_BENCHMARK_WARMUP_FRAMES, g_PARTICLE_BENCHMARK_FRAMES);
+            double frameMs = measurement.frameMs;
+            ProfileChannelStatistics particles = measurement.channel("gpu.particles");
+            ProfileChannelStatistics renderPass = measurement.channel("gpu.render_pass");
+
+            std::cout << "  " << particleCount << " particles, " << (async ? "async compute " : "graphics queue") 
+                      << ": frame " << frameMs << " ms";
+
+            if (m_gpuProfiler.isSupported() && particles.meanMs > 0.0)
+            {
+                // Timestamps of different queues do not share a timeline, so the overlap comes from
+                // the frame time instead: whatever the two took beyond it ran concurrently. The
+                // frames are GPU bound, so the frame time is the GPU's time per frame
+                double shorter = std::min(particles.meanMs, renderPass.meanMs);
+                double overlap = shorter > 0.0 ? std::clamp((particles.meanMs + renderPass.meanMs - frameMs) / shorter, 0.0, 1.0) : 0.0;
+
+                std::cout << ", gpu particles " << particles.meanMs << " ms, gpu render pass " << renderPass.meanMs 
+                          << " ms, " << (100.0 * overlap) << "% overlapped";
+            }
+
+            if (async && graphicsQueueFrameMs > 0.0)
+            {
+                std::cout << " (" << (100.0 * (graphicsQueueFrameMs - frameMs) / graphicsQueueFrameMs) << "% frame time saved)";
+            }
+
+            std::cout << std::endl;
+            graphicsQueueFrameMs = frameMs;
+        }
+    }
+
+    // Leave things as configured on the command line
+    vkDeviceWaitIdle(m_logicalDevice);
+    m_particleSystem.setParticleCount(m_settings.particleCount);
+    m_asyncParticles = !m_settings.particlesOnGraphicsQueue;
+}
+
+void HelloTriangleApplication::runOverdrawBenchmark()
+{
+    std::cout << "Overdraw benchmark on " << m_physicalDeviceProperties.deviceName 
+              << " (" << m_swapChainExtent.width << "x" << m_swapChainExtent.height 
+              << ", " << g_OVERDRAW_BENCHMARK_FRAMES << " frames each)" << std::endl;
+
+    if (m_deviceAllocator.hasMemoryType(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT))
+    {
+        std::cout << "  Depth is transient, in lazily allocated memory" << std::endl;
+    }
+
+    m_pipelineRegistry.waitForPending();
+    m_overdrawScene = true;
+
+    for (uint32_t layers : { 4u, 16u, 64u })
+    {
+        // Back to front is the worst case without a prepass, every layer is shaded. Front to back
+        // early depth testing already rejects most of them, which is the best a prepass can do
+        for (bool frontToBack : { false, true })
+        {
+            m_drawList = buildOverdrawDrawList(layers, frontToBack);
+
+            double withoutPrepassMs = 0.0;
+
+            for (bool prepass : { false, true })
+            {
+                m_depthPrepass = prepass;
+
+                BenchmarkMeasurement measurement = measureConfiguration(g_OVERDRAW_BENCHMARK_WARMUP_FRAMES, g_OVERDRAW_BENCHMARK_FRAMES);
+                double frameMs = measurement.frameMs;
+
+                std::cout << "  " << layers << " layers, " << (frontToBack ? "front to back" : "back to front") 
+                          << ", " << (prepass ? "prepass   " : "no prepass") << ": frame " << frameMs << " ms";
+
+                if (m_gpuProfiler.isSupported())
+                {
+                    std::cout << ", gpu render pass " << measurement.channel("gpu.render_pass").meanMs << " ms";
+                }
+
+                if (prepass && withoutPrepassMs > 0.0)
+                {
+                    std::cout << " (" << (100.0 * (withoutPrepassMs - frameMs) / withoutPrepassMs) << "% frame time saved)";
+                }
+
+                std::cout << std::endl;
+                withoutPrepassMs = frameMs;
+            }
+        }
+    }
+
+    // Leave things as configured on the command line
+    m_overdrawScene = false;
+    m_depthPrepass = m_settings.depthPrepass;
+    m_drawList = buildGridDrawList(m_settings.drawCount);
+}
+
+void HelloTriangleApplication::runMsaaBenchmark()
+{
+    std::cout << "MSAA benchmark on " << m_physicalDeviceProperties.deviceName 
+              << " (" << m_swapChainExtent.width << "x" << m_swapChainExtent.height 
+              << ", " << g_MSAA_BENCHMARK_DRAWS << " draws, " << g_MSAA_BENCHMARK_FRAMES << " frames each)" << std::endl;
+
+    bool lazilyAllocated = m_deviceAllocator.hasMemoryType(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+
+    if (lazilyAllocated)
+    {
+        std::cout << "  Multisampled attachments are transient, in lazily allocated memory" << std::endl;
+    }
+
+    m_drawList = buildGridDrawList(g_MSAA_BENCHMARK_DRAWS);
+
+    const VkPhysicalDeviceLimits& limits = m_physicalDeviceProperties.limits;
+    VkSampleCountFlags supported = limits.framebufferColorSampleCounts & limits.framebufferDepthSampleCounts;
+    double singleSampleFrameMs = 0.0;
+
+    for (uint32_t samples = 1; samples <= 64; samples *= 2)
+    {
+        if ((supported & samples) == 0) continue;
+
+        setSampleCount(static_cast<VkSampleCountFlagBits>(samples));
+        m_pipelineRegistry.waitForPending();
+
+        BenchmarkMeasurement measurement = measureConfiguration(g_MSAA_BENCHMARK_WARMUP_FRAMES, g_MSAA_BENCHMARK_FRAMES);
+        double frameMs = measurement.frameMs;
+
+        // There are no portable bandwidth counters, so traffic is estimated from what the
+        // attachments keep in memory: lazily allocated memory only holds what the GPU actually
+        // spilled out of tile memory. Backed samples are written at least once and read back at
+        // least once, by the depth test or the resolve, and the resolve writes the swapchain image
+        VkDeviceSize attachmentBytes = 0;
+        VkDeviceSize backedBytes = 0;
+
+        for (const MemoryAllocation* allocation : { &m_depthAllocation, &m_colorAllocation })
+        {
+            if (allocation->memory == VK_NULL_HANDLE) continue;
+
+            VkDeviceSize committed = allocation->size;
+
+            // Attachments always get dedicated memory when it is lazily allocated
+            if (lazilyAllocated)
+            {
+                vkGetDeviceMemoryCommitment(m_logicalDevice, allocation->memory, &committed);
+            }
+
+            attachmentBytes += allocation->size;
+            backedBytes += committed;
+        }
+
+        VkDeviceSize resolvedBytes = static_cast<VkDeviceSize>(m_swapChainExtent.width) * m_swapChainExtent.height * 4;
+        double trafficMiB = (resolvedBytes + 2.0 * backedBytes) / (1024.0 * 1024.0);
+
+        std::cout << "  " << samples << "x: frame " << frameMs << " ms";
+
+        if (m_gpuProfiler.isSupported())
+        {
+            std::cout << ", gpu render pass " << measurement.channel("gpu.render_pass").meanMs << " ms";
+        }
+
+        std::cout << ", attachments " << attachmentBytes / (1024.0 * 1024.0) << " MiB (" 
+                  << backedBytes / (1024.0 * 1024.0) << " MiB backed), ~" << trafficMiB << " MiB/frame, ~" 
+                  << trafficMiB / 1024.0 / (frameMs / 1000.0) << " GiB/s";
+
+        if (samples > 1 && singleSampleFrameMs > 0.0)
+        {
+            std::cout << " (" << (100.0 * (frameMs - singleSampleFrameMs) / singleSampleFrameMs) << "% frame time against 1x)";
+        }
+
+        std::cout << std::endl;
+
+        if (samples == 1) singleSampleFrameMs = frameMs;
+    }
+
+    // Leave things as configured on the command line
+    setSampleCount(chooseSampleCount(m_settings.msaaSamples));
+    m_drawList = buildGridDrawList(m_settings.drawCount);
+}
+
+void HelloTriangleApplication::runRenderingBenchmark()
+{
+    std::cout << "Rendering path benchmark on " << m_physicalDeviceProperties.deviceName 
+              << " (" << m_swapChainExtent.width << "x" << m_swapChainExtent.height 
+              << ", " << g_RENDERING_BENCHMARK_FRAMES << " frames each)" << std::endl;
+
+    if (!m_dynamicRenderingSupported)
+    {
+        std::cout << "  VK_KHR_dynamic_rendering and VK_KHR_synchronization2 are not available, only the render pass path can run" << std::endl;
+        return;
+    }
+
+    for (uint32_t draws : { 1000u, 10000u })
+    {
+        m_drawList = buildGridDrawList(draws);
+
+        for (bool dynamicRendering : { false, true })
+        {
+            setDynamicRendering(dynamicRendering);
+            m_pipelineRegistry.waitForPending();
+
+            // What a swapchain recreation rebuilds besides the swapchain itself. The render pass
+            // path recreates its render pass and one framebuffer per image, dynamic rendering
+            // has nothing to rebuild. Pipelines outlive the render pass, a new one is compatible
+            auto rebuildStart = std::chrono::steady_clock::now();
+
+            for (uint32_t rebuild = 0; rebuild < g_RENDERING_BENCHMARK_REBUILDS; rebuild++)
+            {
+                for (auto framebuffer : m_swapChainFramebuffers)
+                {
+                    vkDestroyFramebuffer(m_logicalDevice, framebuffer, m_hostAllocator.callbacks());
+                }
+
+                m_swapChainFramebuffers.clear();
+                vkDestroyRenderPass(m_logicalDevice, m_renderPass, m_hostAllocator.callbacks());
+                m_renderPass = VK_NULL_HANDLE;
+
+                createRenderPass();
+                createFrameBuffers();
+            }
+
+            double rebuildUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - rebuildStart).count() / g_RENDERING_BENCHMARK_REBUILDS;
+
+            // Pipelines are looked up by render pass, so point them at the latest one
+            createGraphicsPipeline();
+            m_pipelineRegistry.waitForPending();
+
+            BenchmarkMeasurement measurement = measureConfiguration(g_RENDERING_BENCHMARK_WARMUP_FRAMES, g_RENDERING_BENCHMARK_FRAMES);
+
+            std::cout << "  " << (dynamicRendering ? "dynamic rendering" : "render pass      ") << ", " << draws << " draws: frame " 
+                      << measurement.frameMs << " ms, record " << measurement.channel("cpu.record").meanMs << " ms";
+
+            if (m_gpuProfiler.isSupported())
+            {
+                std::cout << ", gpu render pass " << measurement.channel("gpu.render_pass").meanMs << " ms";
+            }
+
+            std::cout << ", render target rebuild " << rebuildUs << " us" << std::endl;
+        }
+    }
+
+    // Leave things as configured on the command line
+    setDynamicRendering(m_dynamicRenderingSupported && !m_settings.legacyRenderPass);
+    m_drawList = buildGridDrawList(m_settings.drawCount);
+}
+
+void HelloTriangleApplication::runRenderGraphBenchmark()
+{
+    VkExtent2D extent = m_swapChainExtent;
+
+    // The passes are stand ins made of clears and blits, which needs linearly filtered blits of
+    // the HDR format. Most devices have them for 16 bit floats
+    VkFormat hdrFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+    VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(m_physicalDevice, hdrFormat, &formatProperties);
+
+    if ((formatProperties.optimalTilingFeatures & blitFeatures) != blitFeatures)
+    {
+        hdrFormat = VK_FORMAT_R8G8B8A8_UNORM;
+    }
+
+    std::cout << "Render graph benchmark on " << m_physicalDeviceProperties.deviceName 
+              << " (" << extent.width << "x" << extent.height << ", " 
+              << (m_cmdPipelineBarrier2 != nullptr ? "synchronization2" : "vkCmdPipelineBarrier") << " barriers)" << std::endl;
+
+    // The graph's only output, read back so that something outside the graph wants the frame
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = static_cast<VkDeviceSize>(extent.width) * extent.height * 4;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VkBuffer readback;
+    MemoryAllocation readbackAllocation;
+    m_deviceAllocator.createBuffer(bufferInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, readback, readbackAllocation);
+
+    auto scaled = [extent](uint32_t shift) {
+        return VkExtent2D{ std::max(1u, extent.width >> shift), std::max(1u, extent.height >> shift) };
+    };
+
+    // Scales all of source into the given rectangle of destination, both in their transfer layouts
+    auto blit = [](VkCommandBuffer commandBuffer, VkImage source, VkExtent2D sourceExtent, VkImage destination, VkOffset3D dstMin, VkOffset3D dstMax) {
+        VkImageBlit region{};
+        region.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+        region.srcOffsets[1] = { static_cast<int32_t>(sourceExtent.width), static_cast<int32_t>(sourceExtent.height), 1 };
+        region.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+        region.dstOffsets[0] = dstMin;
+        region.dstOffsets[1] = dstMax;
+
+        vkCmdBlitImage(commandBuffer, source, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, destination, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region, VK_FILTER_LINEAR);
+    };
+
+    int32_t width = static_cast<int32_t>(extent.width);
+    int32_t height = static_cast<int32_t>(extent.height);
+
+    // Handed out by buildGraph(), and read by the passes below when the graph executes. The graph
+    // keeps pointers to the passes, so they live out here rather than in buildGraph()
+    RenderGraphResource albedo, normal, lit, debugView, bloomHalf, bloomQuarter, bloomEighth, bloom, ldr, output;
+
+    auto gbufferPass = [&](VkCommandBuffer commandBuffer, const RenderGraph& graph) {
+        VkClearColorValue clearColor = { {0.25f, 0.5f, 0.75f, 1.0f} };
+        VkImageSubresourceRange range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+        vkCmdClearColorImage(commandBuffer, graph.image(albedo), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clearColor, 1, &range);
+        vkCmdClearColorImage(commandBuffer, graph.image(normal), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clearColor, 1, &range);
+    };
+
+    auto lightingPass = [&](VkCommandBuffer commandBuffer, const RenderGraph& graph) {
+        blit(commandBuffer, graph.image(albedo), extent, graph.image(lit), { 0, 0, 0 }, { width / 2, height, 1 });
+        blit(commandBuffer, graph.image(normal), extent, graph.image(lit), { width / 2, 0, 0 }, { width, height, 1 });
+    };
+
+    auto debugPass = [&](VkCommandBuffer commandBuffer, const RenderGraph& graph) {
+        blit(commandBuffer, graph.image(normal), extent, graph.image(debugView), { 0, 0, 0 }, { width, height, 1 });
+    };
+
+    // Downsampled to 1/8 and back up to 1/4, one pass per step
+    RenderGraphResource* chain[] = { &lit, &bloomHalf, &bloomQuarter, &bloomEighth, &bloom };
+    VkExtent2D chainExtents[] = { extent, scaled(1), scaled(2), scaled(3), scaled(2) };
+    const char* chainNames[] = { "bloom downsample 1/2", "bloom downsample 1/4", "bloom downsample 1/8", "bloom upsample" };
+
+    auto chainPass = [&](uint32_t step) {
+        return [&, step](VkCommandBuffer commandBuffer, const RenderGraph& graph) {
+            VkOffset3D destinationMax = { static_cast<int32_t>(chainExtents[step + 1].width), static_cast<int32_t>(chainExtents[step + 1].height), 1 };
+            blit(commandBuffer, graph.image(*chain[step]), chainExtents[step], graph.image(*chain[step + 1]), { 0, 0, 0 }, destinationMax);
+        };
+    };
+
+    decltype(chainPass(0)) chainPasses[] = { chainPass(0), chainPass(1), chainPass(2), chainPass(3) };
+
+    auto tonemapPass = [&](VkCommandBuffer commandBuffer, const RenderGraph& graph) {
+        blit(commandBuffer, graph.image(lit), extent, graph.image(ldr), { 0, 0, 0 }, { width, height / 2, 1 });
+        blit(commandBuffer, graph.image(bloom), scaled(2), graph.image(ldr), { 0, height / 2, 0 }, { width, height, 1 });
+    };
+
+    auto readbackPass = [&](VkCommandBuffer commandBuffer, const RenderGraph& graph) {
+        VkBufferImageCopy region{};
+        region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+        region.imageExtent = { extent.width, extent.height, 1 };
+
+        vkCmdCopyImageToBuffer(commandBuffer, graph.image(ldr), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, graph.buffer(output), 1, &region);
+    };
+
+    // A deferred frame's shape: G-buffer, lighting, a bloom chain and tone mapping. The debug view
+    // reads the G-buffer but nothing reads it, so it is culled. Passes after lighting no longer
+    // need the G-buffer, whose memory goes to the images they create
+    auto buildGraph = [&]() {
+        m_renderGraph.reset();
+
+        albedo = m_renderGraph.createImage("albedo", { VK_FORMAT_R8G8B8A8_UNORM, extent, VK_SAMPLE_COUNT_1_BIT });
+        normal = m_renderGraph.createImage("normal", { hdrFormat, extent, VK_SAMPLE_COUNT_1_BIT });
+        lit = m_renderGraph.createImage("hdr", { hdrFormat, extent, VK_SAMPLE_COUNT_1_BIT });
+        debugView = m_renderGraph.createImage("debug view", { VK_FORMAT_R8G8B8A8_UNORM, extent, VK_SAMPLE_COUNT_1_BIT });
+        bloomHalf = m_renderGraph.createImage("bloom 1/2", { hdrFormat, scaled(1), VK_SAMPLE_COUNT_1_BIT });
+        bloomQuarter = m_renderGraph.createImage("bloom 1/4", { hdrFormat, scaled(2), VK_SAMPLE_COUNT_1_BIT });
+        bloomEighth = m_renderGraph.createImage("bloom 1/8", { hdrFormat, scaled(3), VK_SAMPLE_COUNT_1_BIT });
+        bloom = m_renderGraph.createImage("bloom", { hdrFormat, scaled(2), VK_SAMPLE_COUNT_1_BIT });
+        ldr = m_renderGraph.createImage("ldr", { VK_FORMAT_R8G8B8A8_UNORM, extent, VK_SAMPLE_COUNT_1_BIT });
+        output = m_renderGraph.importBuffer("readback", readback, RenderGraphImportState{});
+
+        uint32_t gbuffer = m_renderGraph.addPass("gbuffer", gbufferPass);
+        m_renderGraph.write(gbuffer, albedo, RenderGraphAccess::TransferDestination);
+        m_renderGraph.write(gbuffer, normal, RenderGraphAccess::TransferDestination);
+
+        uint32_t lighting = m_renderGraph.addPass("lighting", lightingPass);
+        m_renderGraph.read(lighting, albedo, RenderGraphAccess::TransferSource);
+        m_renderGraph.read(lighting, normal, RenderGraphAccess::TransferSource);
+        m_renderGraph.write(lighting, lit, RenderGraphAccess::TransferDestination);
+
+        uint32_t debug = m_renderGraph.addPass("debug view", debugPass);
+        m_renderGraph.read(debug, normal, RenderGraphAccess::TransferSource);
+        m_renderGraph.write(debug, debugView, RenderGraphAccess::TransferDestination);
+
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            uint32_t pass = m_renderGraph.addPass(chainNames[i], chainPasses[i]);
+            m_renderGraph.read(pass, *chain[i], RenderGraphAccess::TransferSource);
+            m_renderGraph.write(pass, *chain[i + 1], RenderGraphAccess::TransferDestination);
+        }
+
+        uint32_t tonemap = m_renderGraph.addPass("tonemap", tonemapPass);
+        m_renderGraph.read(tonemap, lit, RenderGraphAccess::TransferSource);
+        m_renderGraph.read(tonemap, bloom, RenderGraphAccess::TransferSource);
+        m_renderGraph.write(tonemap, ldr, RenderGraphAccess::TransferDestination);
+
+        uint32_t copy = m_renderGraph.addPass("readback", readbackPass);
+        m_renderGraph.read(copy, ldr, RenderGraphAccess::TransferSource);
+        m_renderGraph.write(copy, output, RenderGraphAccess::TransferDestination);
+    };
+
+    buildGraph();
+    m_renderGraph.compile(m_frameScheduler.submittedValue());
+    m_renderGraph.writeSchedule(std::cout);
+
+    const RenderGraphStatistics& statistics = m_renderGraph.statistics();
+
+    std::cout << "  " << statistics.passCount << " passes, " << statistics.culledPassCount << " culled" << std::endl;
+    std::cout << "  " << statistics.imageBarrierCount << " image and " << statistics.bufferBarrierCount << " buffer barriers in " 
+              << statistics.batchCount << " pipeline barrier commands" << std::endl;
+    std::cout << "  " << statistics.transientImageCount << " transient images need " << statistics.transientBytes / (1024.0 * 1024.0) 
+              << " MiB apart, aliased into " << statistics.allocatedBytes / (1024.0 * 1024.0) << " MiB (" 
+              << (statistics.transientBytes > 0 ? 100.0 * (statistics.transientBytes - statistics.allocatedBytes) / statistics.transientBytes : 0.0) 
+              << "% saved)" << std::endl;
+
+    // Rebuilt with the same shape, as a frame would, so the transient images are kept
+    auto compileStart = std::chrono::steady_clock::now();
+
+    for (uint32_t i = 0; i < g_RENDER_GRAPH_BENCHMARK_COMPILES; i++)
+    {
+        buildGraph();
+        m_renderGraph.compile(m_frameScheduler.submittedValue());
+    }
+
+    double compileUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - compileStart).count() / g_RENDER_GRAPH_BENCHMARK_COMPILES;
+
+    VkCommandBufferAllocateInfo allocateInfo{};
+    allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocateInfo.commandPool = m_commandPool;
+    allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocateInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+
+    if (vkAllocateCommandBuffers(m_logicalDevice, &allocateInfo, &commandBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to allocate render graph benchmark command buffer");
+    }
+
+    // Each run waits for the last, the first one is left out as warmup
+    double runMs = 0.0;
+
+    for (uint32_t run = 0; run <= g_RENDER_GRAPH_BENCHMARK_RUNS; run++)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to begin recording command buffer");
+        }
+
+        m_renderGraph.execute(commandBuffer);
+
+        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to record command buffer");
+        }
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffer;
+
+        if (vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to submit render graph benchmark");
+        }
+
+        vkQueueWaitIdle(m_graphicsQueue);
+
+        if (run > 0)
+        {
+            runMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+    }
+
+    std::cout << "  build and compile " << compileUs << " us, record to completion " << runMs / g_RENDER_GRAPH_BENCHMARK_RUNS << " ms" << std::endl;
+
+    vkFreeCommandBuffers(m_logicalDevice, m_commandPool, 1, &commandBuffer);
+
+    // The passes refer to this function's locals
+    m_renderGraph.reset();
+    m_deviceAllocator.destroyBuffer(readback, readbackAllocation);
+}
+
+void HelloTriangleApplication::createVkInstance()
+{
+    // Initialize application information struct
+    VkApplicationInfo appInfo{};
+    appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    appInfo.pNext = nullptr;
+    appInfo.pApplicationName = "Hello Triangle";
+    appInfo.applicationVersion = VK_MAKE_API_VERSION(0, 1, 0, 0);
+    appInfo.pEngineName = "No Engine";
+    appInfo.engineVersion = VK_MAKE_API_VERSION(0, 1, 0, 0);
+    appInfo.apiVersion = VK_API_VERSION_1_2;
+
+    // Initialize the instance creation struct, providing appInfo
+    VkInstanceCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    createInfo.pApplicationInfo = &appInfo;
+
+    // Get a vector of all the required GLFW extensions for this instance
+    std::vector<const char*> requiredExtensions = getRequiredGLFWExtensions();
+
+    // Assert that the required glfw extensions and validation layers are all
+    // available for use in this VkInstance
+    assertRequiredGLFWExtensionsAreAvailable();
+    assertRequiredValidationLayersAreAvailable();
+
+    // Finish initializing the instance creation struct
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(requiredExtensions.size());
+    createInfo.ppEnabledExtensionNames = requiredExtensions.data();
+
+    VkDebugUtilsMessengerCreateInfoEXT debugCreateInfo{};
+
+    // If in debug mode, include the validation layers in our initialization 
+    if (validationLayersEnabled)
+    {
+        createInfo.enabledLayerCount = static_cast<uint32_t>(m_validationLayers.size());
+        createInfo.ppEnabledLayerNames = m_validationLayers.data();
+
+        populateDebugMessengerCreateInfo(debugCreateInfo);
+        createInfo.pNext = (VkDebugUtilsMessengerCreateInfoEXT*)&debugCreateInfo;
+    }
+    else
+    {
+        createInfo.enabledLayerCount = 0;
+
+        createInfo.pNext = nullptr;
+    }
+
+    // Create and validate the instance
+    if (vkCreateInstance(&createInfo, m_hostAllocator.callbacks(), &m_instance) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create VkInstance");
+    }
+}
+
+std::vector<const char*> HelloTriangleApplication::getRequiredGLFWExtensions()
+{
+    // This ensures that the order for calling assertRequiredGLFWExtensionsAreAvailable() is preserved
+    m_requiredGLFWExtensionsEstablished = true;
+
+    // Get all required glfw extensions and their count. Headless runs never initialize glfw and need none
+    if (m_settings.headless)
+    {
+        m_glfwExtensions = nullptr;
+        m_glfwExtensionCount = 0;
+    }
+    else
+    {
+        m_glfwExtensions = glfwGetRequiredInstanceExtensions(&m_glfwExtensionCount);
+    }
+
+    std::vector<const char*> extensions(m_glfwExtensions, m_glfwExtensions + m_glfwExtensionCount);
+
+    if (validationLayersEnabled)
+    {
+        extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+    }
+
+    return extensions;
+}
+
+void HelloTriangleApplication::assertRequiredGLFWExtensionsAreAvailable()
+{
+    // getRequiredGLFWExtensions() must be called before this function to prevent errors
+    if (!m_requiredGLFWExtensionsEstablished)
+    {
+        throw std::runtime_error("assertRequiredGLFWExtensionsAreAvailable() called before getRequiredGLFWExtensions()");
+    }
+
+    // Get a count of all the available extensions
+    uint32_t numberOfAvailableExtensions = 0;
+    vkEnumerateInstanceExtensionProperties(nullptr, &numberOfAvailableExtensions, nullptr);
+
+    // Init a vector of VkExtensionProperties to the size of the number of available extensions established above
+    std::vector<VkExtensionProperties> allAvailableExtensions(numberOfAvailableExtensions);
+
+    // Find all available extensions and place them in the vector
+    vkEnumerateInstanceExtensionProperties(nullptr, &numberOfAvailableExtensions, allAvailableExtensions.data());
+
+    // Assertion loop. The ith required tested against the jth available. If not found, exception thrown
+    for (unsigned int i = 0; i < m_glfwExtensionCount; i++)
+    {
+        bool extensionNotFound = true;
+        
+        for (int j = 0; j < allAvailableExtensions.size(); j++)
+        {
+            if (strcmp(m_glfwExtensions[i], allAvailableExtensions[j].extensionName) == 0)
+            {
+                extensionNotFound = false;
+                break;
+            }
+        }
+
+        if (extensionNotFound)
+        {
+            throw std::runtime_error("Required GLFW extension missing");
+        }
+    }
+}
+
+void HelloTriangleApplication::assertRequiredValidationLayersAreAvailable()
+{
+    // Get a count of all of the available validation layers
+    uint32_t validationLayerCount = 0;
+    vkEnumerateInstanceLayerProperties(&validationLayerCount, nullptr);
+
+    // Init a vector of VkLayerProperties to the size of the available validation layers found above
+    std::vector<VkLayerProperties> availableLayers(validationLayerCount);
+
+    // Fill the vector with all of the available validation layers
+    vkEnumerateInstanceLayerProperties(&validationLayerCount, availableLayers.data());
+
+    // Assertion loop. The ith required tested against the jth available. If not found, exception thrown
+    for (const char* validationLayerName : m_validationLayers)    // ith
+    {
+        bool layerNotFound = true;
+
+        for (const auto& availableLayer : availableLayers)      // jth
+        {
+            if (strcmp(validationLayerName, availableLayer.layerName) == 0)
+            {
+                layerNotFound = false;
+                break;
+            }
+        }
+        
+        if (layerNotFound)
+        {
+            throw std::runtime_error("Required validation layer not found in available layers");
+        }
+    }
+}
+
+void HelloTriangleApplication::setupDebugMessenger()
+{
+    if (!validationLayersEnabled) return;
+
+    VkDebugUtilsMessengerCreateInfoEXT createInfo;
+    populateDebugMessengerCreateInfo(createInfo);
+    
+    if (CreateDebugUtilsMessengerEXT(m_instance, &createInfo, m_hostAllocator.callbacks(), &m_debugMessenger) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to set up debug messenger!");
+    }
+}
+
+VKAPI_ATTR VkBool32 VKAPI_CALL HelloTriangleApplication::debugCallback(
+    VkDebugUtilsMessageSeverityFlagBitsEXT          messageSeverity,
+    VkDebugUtilsMessageTypeFlagsEXT                 messageType,
+    const VkDebugUtilsMessengerCallbackDataEXT*     pCallbackData,
+    void*                                           pUserData
+)
+{
+    if (messageSeverity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT)
+    {
+        std::cerr << "validation layer: " << pCallbackData->pMessage << std::endl;
+    }
+
+    return VK_FALSE;
 }
 
 void HelloTriangleApplication::populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo) 
@@ -358,7 +1597,9 @@ void HelloTriangleApplication::DestroyDebugUtilsMessengerEXT(
 
 void HelloTriangleApplication::createSurface()
 {
-    if (glfwCreateWindowSurface(m_instance, m_window, nullptr, &m_surface) != VK_SUCCESS)
+    if (m_settings.headless) return;
+
+    if (glfwCreateWindowSurface(m_instance, m_window, m_hostAllocator.callbacks(), &m_surface) != VK_SUCCESS)
     {
         throw std::runtime_error("failed to create window surface!");
     }
@@ -396,6 +1637,10 @@ void HelloTriangleApplication::selectPhysicalDevice()
     {
         m_physicalDevice = physicalDeviceCandidatesMap.rbegin()->second;
         m_queueFamilyIndices = findQueueFamilies(m_physicalDevice);
+
+        // Scoring leaves the properties of the last scored device behind, re-query for the chosen one
+        vkGetPhysicalDeviceProperties(m_physicalDevice, &m_physicalDeviceProperties);
+        queryPhysicalDeviceFeatures(m_physicalDevice);
     }
     else
     {
@@ -418,21 +1663,24 @@ void HelloTriangleApplication::scorePhysicalDevice(
     vkGetPhysicalDeviceProperties(physicalDevice, &m_physicalDeviceProperties);
 
     // Query for features of the provided physical device
-    vkGetPhysicalDeviceFeatures(physicalDevice, &m_physicalDeviceFeatures);
+    queryPhysicalDeviceFeatures(physicalDevice);
 
     auto queueFamilyIndices = findQueueFamilies(physicalDevice);
 
-    auto swapChainSupportDetails = querySwapChainSupport(physicalDevice);
-
     bool allExtensionsAreSupported = checkDeviceExtensionSupport(physicalDevice);
 
+    // There is no surface to present to when headless, so any device that can render will do
+    bool swapChainIsAdequate = m_settings.headless || querySwapChainSupport(physicalDevice).swapChainIsAdequate();
+
     int physicalDeviceScore = 0;
 
-    // Geometry shaders are required, queue families must be initialized, all extensions must be supported, and swap chain must be adequate
+    // Geometry shaders are required, queue families must be initialized, all extensions must be supported, and swap chain must be adequate.
+    // Frame pacing is built on Vulkan 1.2 timeline semaphores
     if (!m_physicalDeviceFeatures.geometryShader            || 
+        !m_physicalDeviceVulkan12Features.timelineSemaphore || 
         !queueFamilyIndices.graphicsFamilyIsInitialized()   || 
         !allExtensionsAreSupported                          || 
-        !swapChainSupportDetails.swapChainIsAdequate()
+        !swapChainIsAdequate
     )
     {
         physicalDeviceCandidatesMap.insert(std::make_pair(physicalDeviceScore, physicalDevice));
@@ -448,9 +1696,84 @@ void HelloTriangleApplication::scorePhysicalDevice(
     // Maximum possible size of textures affects graphics quality
     physicalDeviceScore += m_physicalDeviceProperties.limits.maxImageDimension2D;
 
+    // Without descriptor indexing the bindless table, and everything reading through it, is off
+    if (bindlessIsSupported())
+    {
+        physicalDeviceScore += 1000;
+    }
+
     physicalDeviceCandidatesMap.insert(std::make_pair(physicalDeviceScore, physicalDevice));
 }
 
+void HelloTriangleApplication::queryPhysicalDeviceFeatures(VkPhysicalDevice physicalDevice)
+{
+    m_physicalDeviceVulkan12Features = {};
+    m_physicalDeviceVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    m_dynamicRenderingFeatures = {};
+    m_dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+    m_synchronization2Features = {};
+    m_synchronization2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+
+    // Devices older than 1.2 cannot report 1.2 features, they are left all false
+    if (m_physicalDeviceProperties.apiVersion < VK_API_VERSION_1_2)
+    {
+        vkGetPhysicalDeviceFeatures(physicalDevice, &m_physicalDeviceFeatures);
+        return;
+    }
+
+    VkPhysicalDeviceFeatures2 features2{};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = &m_physicalDeviceVulkan12Features;
+
+    // Extension features can only be asked about when the device has the extension
+    if (deviceExtensionIsAvailable(physicalDevice, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME) && 
+        deviceExtensionIsAvailable(physicalDevice, VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME))
+    {
+        m_physicalDeviceVulkan12Features.pNext = &m_dynamicRenderingFeatures;
+        m_dynamicRenderingFeatures.pNext = &m_synchronization2Features;
+    }
+
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+
+    m_physicalDeviceFeatures = features2.features;
+    m_physicalDeviceVulkan12Features.pNext = nullptr;
+    m_dynamicRenderingFeatures.pNext = nullptr;
+}
+
+bool HelloTriangleApplication::bindlessIsSupported() const
+{
+    const VkPhysicalDeviceVulkan12Features& features = m_physicalDeviceVulkan12Features;
+
+    return features.runtimeDescriptorArray && 
+           features.descriptorBindingPartiallyBound && 
+           features.descriptorBindingSampledImageUpdateAfterBind && 
+           features.descriptorBindingStorageBufferUpdateAfterBind && 
+           features.descriptorBindingUpdateUnusedWhilePending;
+}
+
+bool HelloTriangleApplication::dynamicRenderingIsSupported() const
+{
+    // Rendering without render passes leaves every layout transition to explicit barriers, which
+    // are written against synchronization2
+    return m_dynamicRenderingFeatures.dynamicRendering && m_synchronization2Features.synchronization2;
+}
+
+bool HelloTriangleApplication::deviceExtensionIsAvailable(VkPhysicalDevice device, const char* extensionName)
+{
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+    for (const auto& extension : availableExtensions)
+    {
+        if (strcmp(extension.extensionName, extensionName) == 0) return true;
+    }
+
+    return false;
+}
+
 bool HelloTriangleApplication::checkDeviceExtensionSupport(VkPhysicalDevice device) 
 {
     // Get a count of the available device extensions
@@ -487,27 +1810,68 @@ QueueFamilyIndices HelloTriangleApplication::findQueueFamilies(VkPhysicalDevice&
     // Populate the vector with all availble queue families
     vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
 
-    int i = 0;
-    for (const auto& queueFamily : queueFamilies) 
-    {
-        if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) 
+    bool transferOnly = false;
+
+    uint32_t i = 0;
+    for (const auto& queueFamily : queueFamilies) 
+    {
+        if ((queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) && !queueFamilyIndices.graphicsFamily.has_value()) 
+        {
+            queueFamilyIndices.graphicsFamily = i;
+        }
+
+        // Uploads run on a family without graphics when there is one, ideally a transfer only
+        // family (the copy engine), so they never compete with rendering for a queue
+        if ((queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT))
+        {
+            bool familyIsTransferOnly = !(queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT);
+
+            if (!queueFamilyIndices.transferFamily.has_value() || (familyIsTransferOnly && !transferOnly))
+            {
+                queueFamilyIndices.transferFamily = i;
+                transferOnly = familyIsTransferOnly;
+            }
+        }
+
+        // Likewise simulation work prefers a compute family without graphics, whose queues the
+        // hardware can run alongside the graphics queue
+        if ((queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) && !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) && !queueFamilyIndices.computeFamily.has_value())
         {
-            queueFamilyIndices.graphicsFamily = i;
+            queueFamilyIndices.computeFamily = i;
         }
 
         VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_surface, &presentSupport);
 
-        if (presentSupport) 
+        if (m_settings.headless)
         {
-            queueFamilyIndices.presentFamily = i;
+            // Nothing is presented, the graphics family stands in for the present family
+            presentSupport = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+        }
+        else
+        {
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_surface, &presentSupport);
         }
 
-        if (queueFamilyIndices.graphicsFamilyIsInitialized()) break;
+        if (presentSupport && !queueFamilyIndices.presentFamily.has_value()) 
+        {
+            queueFamilyIndices.presentFamily = i;
+        }
 
         i++;
     }
 
+    // Every graphics family supports transfers, so it doubles as the transfer family if need be
+    if (!queueFamilyIndices.transferFamily.has_value())
+    {
+        queueFamilyIndices.transferFamily = queueFamilyIndices.graphicsFamily;
+    }
+
+    // And for compute
+    if (!queueFamilyIndices.computeFamily.has_value())
+    {
+        queueFamilyIndices.computeFamily = queueFamilyIndices.graphicsFamily;
+    }
+
     return queueFamilyIndices;
 }
 
@@ -516,7 +1880,9 @@ void HelloTriangleApplication::createLogicalDevice()
     std::vector<VkDeviceQueueCreateInfo>    queueCreateInfos;
     std::set<uint32_t>                      uniqueQueueFamilies = { 
         m_queueFamilyIndices.graphicsFamily.value(),
-        m_queueFamilyIndices.presentFamily.value()
+        m_queueFamilyIndices.presentFamily.value(),
+        m_queueFamilyIndices.transferFamily.value(),
+        m_queueFamilyIndices.computeFamily.value()
     };
 
     float queuePriority = 1.0f;
@@ -531,9 +1897,46 @@ void HelloTriangleApplication::createLogicalDevice()
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
+    // Only the 1.2 features something actually relies on are enabled
+    VkPhysicalDeviceVulkan12Features vulkan12Features{};
+    vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    vulkan12Features.timelineSemaphore = VK_TRUE;
+    vulkan12Features.drawIndirectCount = m_physicalDeviceVulkan12Features.drawIndirectCount;
+
+    // The BindlessTable's runtime sized, partially bound, update-after-bind arrays
+    m_bindlessSupported = bindlessIsSupported();
+    vulkan12Features.runtimeDescriptorArray = m_bindlessSupported;
+    vulkan12Features.descriptorBindingPartiallyBound = m_bindlessSupported;
+    vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = m_bindlessSupported;
+    vulkan12Features.descriptorBindingStorageBufferUpdateAfterBind = m_bindlessSupported;
+    vulkan12Features.descriptorBindingUpdateUnusedWhilePending = m_bindlessSupported;
+    vulkan12Features.shaderSampledImageArrayNonUniformIndexing = m_physicalDeviceVulkan12Features.shaderSampledImageArrayNonUniformIndexing;
+    vulkan12Features.shaderStorageBufferArrayNonUniformIndexing = m_physicalDeviceVulkan12Features.shaderStorageBufferArrayNonUniformIndexing;
+
+    // Enabled wherever the device has them, so the rendering benchmark can compare both paths even
+    // when --legacy-render-pass picks the render pass one
+    VkPhysicalDeviceSynchronization2FeaturesKHR synchronization2Features{};
+    synchronization2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+    synchronization2Features.synchronization2 = VK_TRUE;
+
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures{};
+    dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+    dynamicRenderingFeatures.pNext = &synchronization2Features;
+    dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+
+    m_dynamicRenderingSupported = dynamicRenderingIsSupported();
+
+    if (m_dynamicRenderingSupported)
+    {
+        m_deviceExtensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+        m_deviceExtensions.push_back(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+        vulkan12Features.pNext = &dynamicRenderingFeatures;
+    }
+
     // Logical device info struct assignment
     VkDeviceCreateInfo logicalDeviceCreateInfo{};
     logicalDeviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    logicalDeviceCreateInfo.pNext = &vulkan12Features;
     logicalDeviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     logicalDeviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
     logicalDeviceCreateInfo.pEnabledFeatures = &m_physicalDeviceFeatures;
@@ -551,16 +1954,311 @@ void HelloTriangleApplication::createLogicalDevice()
         logicalDeviceCreateInfo.enabledLayerCount = 0;
     }
 
-    if (vkCreateDevice(m_physicalDevice, &logicalDeviceCreateInfo, nullptr, &m_logicalDevice) != VK_SUCCESS)
+    if (vkCreateDevice(m_physicalDevice, &logicalDeviceCreateInfo, m_hostAllocator.callbacks(), &m_logicalDevice) != VK_SUCCESS)
     {
         throw std::runtime_error("Failed to create logical device");
     }
+
+    // Extension commands are not exported by the loader
+    if (m_dynamicRenderingSupported)
+    {
+        m_cmdBeginRendering = (PFN_vkCmdBeginRenderingKHR) vkGetDeviceProcAddr(m_logicalDevice, "vkCmdBeginRenderingKHR");
+        m_cmdEndRendering = (PFN_vkCmdEndRenderingKHR) vkGetDeviceProcAddr(m_logicalDevice, "vkCmdEndRenderingKHR");
+        m_cmdPipelineBarrier2 = (PFN_vkCmdPipelineBarrier2KHR) vkGetDeviceProcAddr(m_logicalDevice, "vkCmdPipelineBarrier2KHR");
+    }
+
+    m_dynamicRendering = m_dynamicRenderingSupported && !m_settings.legacyRenderPass;
 }
 
 void HelloTriangleApplication::getDeviceQueue()
 {
     vkGetDeviceQueue(m_logicalDevice, m_queueFamilyIndices.graphicsFamily.value(), 0, &m_graphicsQueue);
     vkGetDeviceQueue(m_logicalDevice, m_queueFamilyIndices.presentFamily.value(), 0, &m_presentQueue);
+    vkGetDeviceQueue(m_logicalDevice, m_queueFamilyIndices.transferFamily.value(), 0, &m_transferQueue);
+    vkGetDeviceQueue(m_logicalDevice, m_queueFamilyIndices.computeFamily.value(), 0, &m_computeQueue);
+}
+
+void HelloTriangleApplication::createDeviceAllocator()
+{
+    m_deviceAllocator.create(m_physicalDevice, m_logicalDevice, m_hostAllocator.callbacks(), m_frameProfiler);
+}
+
+void HelloTriangleApplication::createFrameAllocator()
+{
+    m_frameAllocator.create(
+        m_logicalDevice, 
+        m_hostAllocator.callbacks(), 
+        m_deviceAllocator, 
+        m_frameProfiler, 
+        m_physicalDeviceProperties.limits.minUniformBufferOffsetAlignment, 
+        m_settings.framesInFlight, 
+        g_FRAME_ALLOCATOR_BYTES_PER_FRAME, 
+        sizeof(FrameConstants)
+    );
+}
+
+void HelloTriangleApplication::createBindlessTable()
+{
+    if (!m_bindlessSupported)
+    {
+        std::cout << "Descriptor indexing is not supported, GPU-driven drawing, textures and particles are disabled" << std::endl;
+        return;
+    }
+
+    m_bindlessTable.create(m_logicalDevice, m_hostAllocator.callbacks(), g_BINDLESS_TEXTURE_CAPACITY, g_BINDLESS_BUFFER_CAPACITY);
+}
+
+void HelloTriangleApplication::createStagingUploader()
+{
+    m_stagingUploader.create(
+        m_logicalDevice, 
+        m_hostAllocator.callbacks(), 
+        m_deviceAllocator, 
+        m_frameProfiler, 
+        m_transferQueue, 
+        m_queueFamilyIndices.transferFamily.value(), 
+        m_queueFamilyIndices.graphicsFamily.value(), 
+        g_STAGING_RING_SIZE
+    );
+
+    if (m_stagingUploader.usesDedicatedQueue())
+    {
+        std::cout << "Uploading on dedicated transfer queue family " << m_queueFamilyIndices.transferFamily.value() << std::endl;
+    }
+}
+
+void HelloTriangleApplication::createMeshBuffers()
+{
+    if (m_settings.meshPath.empty())
+    {
+        MeshData mesh = buildTriangleMesh();
+
+        m_mesh.boundingRadius = mesh.boundingRadius();
+        m_mesh.lods = { { 0, static_cast<uint32_t>(mesh.indices.size()), 0 } };
+        m_mesh.encoding = mesh.preferredEncoding();
+
+        if (m_mesh.encoding == VertexEncoding::Quantized)
+        {
+            m_mesh.positionScale = mesh.positionQuantizationScale();
+            std::vector<PackedVertex> packed = mesh.quantizedVertices(m_mesh.positionScale);
+
+            uploadMesh(m_mesh, packed.data(), sizeof(PackedVertex) * packed.size(), mesh.indices.data(), sizeof(uint32_t) * mesh.indices.size());
+        }
+        else
+        {
+            uploadMesh(m_mesh, mesh.vertices.data(), sizeof(Vertex) * mesh.vertices.size(), mesh.indices.data(), sizeof(uint32_t) * mesh.indices.size());
+        }
+
+        return;
+    }
+
+    auto loadStart = std::chrono::steady_clock::now();
+
+    // The blobs are copied into the staging ring straight from the mapping, so the file never
+    // passes through the heap and its pages can be dropped again as soon as they have been copied
+    MappedFile file;
+    file.open(m_settings.meshPath);
+
+    MeshFileView view = parseMeshFile(file.data(), file.size());
+    const MeshFileHeader& header = *view.header;
+
+    // Draws always start at the front of the index buffer
+    if (header.indexCount > UINT32_MAX || view.lods[0].firstIndex != 0 || view.lods[0].vertexOffset != 0)
+    {
+        throw std::runtime_error(m_settings.meshPath + " must start its index blob with LOD 0 and hold at most 2^32 indices");
+    }
+
+    m_mesh.boundingRadius = header.boundingRadius;
+    m_mesh.encoding = static_cast<VertexEncoding>(header.vertexEncoding);
+    m_mesh.positionScale = header.positionScale;
+    m_mesh.lods.clear();
+
+    for (uint32_t i = 0; i < header.lodCount; i++)
+    {
+        m_mesh.lods.push_back({ view.lods[i].firstIndex, view.lods[i].indexCount, view.lods[i].vertexOffset });
+    }
+
+    // uploadBuffer() copies synchronously, the mapping is not needed past this
+    uploadMesh(m_mesh, view.vertices, view.vertexBytes(), view.indices, view.indexBytes());
+    file.close();
+
+    std::chrono::duration<double, std::milli> loadTime = std::chrono::steady_clock::now() - loadStart;
+
+    std::cout << "Loaded " << m_settings.meshPath << ": " << header.vertexCount << " vertices of " << header.vertexStride 
+              << " bytes, " << (m_mesh.indexCount / 3) << " triangles, " << header.lodCount << " LODs in " 
+              << loadTime.count() << " ms" << std::endl;
+}
+
+void HelloTriangleApplication::uploadMesh(GpuMesh& mesh, const void* vertices, VkDeviceSize vertexBytes, const uint32_t* indices, VkDeviceSize indexBytes)
+{
+    // Exclusive to one family at a time, ownership moves from transfer to graphics by barriers
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = vertexBytes;
+    bufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    m_deviceAllocator.createBuffer(bufferInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mesh.vertexBuffer, mesh.vertexAllocation);
+
+    bufferInfo.size = indexBytes;
+    bufferInfo.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+    m_deviceAllocator.createBuffer(bufferInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mesh.indexBuffer, mesh.indexAllocation);
+
+    mesh.indexCount = mesh.lods[0].indexCount;
+
+    m_stagingUploader.uploadBuffer(mesh.vertexBuffer, 0, vertices, vertexBytes, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+    mesh.upload = m_stagingUploader.uploadBuffer(mesh.indexBuffer, 0, indices, indexBytes, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT);
+
+    // Start copying right away, frames draw without the mesh until it has arrived
+    m_stagingUploader.update();
+}
+
+void HelloTriangleApplication::createInstanceField()
+{
+    if (m_settings.instanceCount == 0) return;
+
+    m_instanceField.create(m_deviceAllocator, m_frameProfiler, m_settings.instanceCount, m_settings.framesInFlight);
+}
+
+void HelloTriangleApplication::createCullingPass()
+{
+    if (!m_settings.gpuDriven && !m_settings.cullBenchmark) return;
+
+    // Objects are read through the bindless table
+    if (!m_bindlessSupported) return;
+
+    // Indirect draws find their object through firstInstance
+    if (!m_physicalDeviceFeatures.drawIndirectFirstInstance)
+    {
+        std::cout << "GPU-driven drawing needs drawIndirectFirstInstance, recording draws on the CPU instead" << std::endl;
+        return;
+    }
+
+    m_cullingPass.create(
+        m_logicalDevice, 
+        m_hostAllocator.callbacks(), 
+        m_deviceAllocator, 
+        m_stagingUploader, 
+        m_pipelineRegistry, 
+        m_bindlessTable, 
+        m_physicalDeviceVulkan12Features.drawIndirectCount == VK_TRUE, 
+        m_physicalDeviceFeatures.multiDrawIndirect == VK_TRUE
+    );
+
+    m_cullingPass.setObjects(m_drawList, m_mesh.indexCount, m_mesh.boundingRadius);
+    m_cullingPassCreated = true;
+    m_gpuDriven = m_settings.gpuDriven;
+
+    std::cout << "GPU-driven drawing with " << (m_cullingPass.usesDrawCount() ? "vkCmdDrawIndexedIndirectCount" : "vkCmdDrawIndexedIndirect") << std::endl;
+}
+
+void HelloTriangleApplication::createTextureStreamer()
+{
+    // Streamed textures are sampled through the bindless table
+    if (!m_bindlessSupported) return;
+
+    m_textureStreamer.create(
+        m_physicalDevice, 
+        m_logicalDevice, 
+        m_hostAllocator.callbacks(), 
+        m_deviceAllocator, 
+        m_stagingUploader, 
+        m_bindlessTable, 
+        m_threadPool, 
+        m_deletionQueue, 
+        m_frameProfiler, 
+        m_mipGenerator, 
+        m_settings.textureBudget
+    );
+
+    for (const std::string& path : m_settings.texturePaths)
+    {
+        m_textureStreamer.load(path);
+    }
+}
+
+void HelloTriangleApplication::createMipGenerator()
+{
+    m_mipGenerator.create(m_physicalDevice, m_logicalDevice, m_hostAllocator.callbacks(), m_deviceAllocator, m_pipelineRegistry);
+}
+
+void HelloTriangleApplication::createRenderGraph()
+{
+    // Without synchronization2 the graph merges each batch of barriers into one stage mask pair
+    m_renderGraph.create(m_logicalDevice, m_hostAllocator.callbacks(), m_deviceAllocator, m_deletionQueue, m_frameProfiler, m_cmdPipelineBarrier2);
+}
+
+void HelloTriangleApplication::createParticleSystem()
+{
+    // Particles are read and written through the bindless table
+    if (!m_bindlessSupported) return;
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &queueFamilyCount, nullptr);
+
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    // Steps submitted to the compute queue are timed there, with that family's timestamp bits
+    uint32_t timestampValidBits = queueFamilies[m_queueFamilyIndices.computeFamily.value()].timestampValidBits;
+
+    m_particleSystem.create(
+        m_logicalDevice, 
+        m_hostAllocator.callbacks(), 
+        m_physicalDeviceProperties, 
+        m_deviceAllocator, 
+        m_pipelineRegistry, 
+        m_bindlessTable, 
+        m_frameProfiler, 
+        m_computeQueue, 
+        m_queueFamilyIndices.computeFamily.value(), 
+        m_queueFamilyIndices.graphicsFamily.value(), 
+        timestampValidBits, 
+        m_settings.framesInFlight
+    );
+
+    m_particleSystem.setParticleCount(m_settings.particleCount);
+
+    if (m_particleSystem.particleCount() > 0 && m_asyncParticles && m_particleSystem.usesDedicatedQueue())
+    {
+        std::cout << "Simulating particles on async compute queue family " << m_queueFamilyIndices.computeFamily.value() << std::endl;
+    }
+}
+
+void HelloTriangleApplication::createGpuProfiler()
+{
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &queueFamilyCount, nullptr);
+
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    // Timestamps are written on the graphics queue, its family decides how many bits are valid
+    uint32_t timestampValidBits = queueFamilies[m_queueFamilyIndices.graphicsFamily.value()].timestampValidBits;
+
+    m_gpuProfiler.create(m_logicalDevice, m_hostAllocator.callbacks(), m_physicalDeviceProperties, timestampValidBits, m_frameProfiler);
+}
+
+void HelloTriangleApplication::createPipelineCache()
+{
+    m_pipelineCache.create(m_logicalDevice, m_hostAllocator.callbacks(), m_physicalDeviceProperties, m_settings.pipelineCachePath);
+
+    // Startup latency is what the persistent cache is for, so say whether we got one
+    if (m_pipelineCache.isWarm())
+    {
+        std::cout << "Warm pipeline cache, " << m_pipelineCache.loadedBytes() << " bytes from " << m_settings.pipelineCachePath << std::endl;
+    }
+    else
+    {
+        std::cout << "Cold pipeline cache" << std::endl;
+    }
+}
+
+void HelloTriangleApplication::createPipelineRegistry()
+{
+    m_threadPool.create(m_settings.workerThreads);
+    m_pipelineRegistry.create(m_logicalDevice, m_hostAllocator.callbacks(), m_pipelineCache.handle(), m_threadPool, m_frameProfiler);
 }
 
 SwapChainSupportDetails HelloTriangleApplication::querySwapChainSupport(VkPhysicalDevice device)
@@ -628,13 +2326,8 @@ VkExtent2D HelloTriangleApplication::chooseSwapExtent(const VkSurfaceCapabilitie
         return capabilities.currentExtent;
     }
 
-    int width, height;
-    glfwGetFramebufferSize(m_window, &width, &height);
-
-    VkExtent2D actualExtent = {
-        static_cast<uint32_t>(width),
-        static_cast<uint32_t>(height)
-    };
+    // Called on the render thread, which must not query GLFW; use the last size it was sent
+    VkExtent2D actualExtent = m_framebufferExtent;
 
     actualExtent.width  = std::clamp(actualExtent.width,  capabilities.minImageExtent.width,  capabilities.maxImageExtent.width);
     actualExtent.height = std::clamp(actualExtent.height, capabilities.minImageExtent.height, capabilities.maxImageExtent.height);
@@ -642,7 +2335,7 @@ VkExtent2D HelloTriangleApplication::chooseSwapExtent(const VkSurfaceCapabilitie
     return actualExtent;
 }
 
-void HelloTriangleApplication::createSwapChain() 
+void HelloTriangleApplication::createSwapChain(VkSwapchainKHR oldSwapChain) 
 {
     SwapChainSupportDetails swapChainSupport = querySwapChainSupport(m_physicalDevice);
     VkSurfaceFormatKHR      surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
@@ -687,9 +2380,9 @@ void HelloTriangleApplication::createSwapChain()
     createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     createInfo.presentMode = presentMode;
     createInfo.clipped = VK_TRUE;
-    createInfo.oldSwapchain = VK_NULL_HANDLE;
+    createInfo.oldSwapchain = oldSwapChain;
 
-    if (vkCreateSwapchainKHR(m_logicalDevice, &createInfo, nullptr, &m_swapChain) != VK_SUCCESS) 
+    if (vkCreateSwapchainKHR(m_logicalDevice, &createInfo, m_hostAllocator.callbacks(), &m_swapChain) != VK_SUCCESS) 
     {
         throw std::runtime_error("Failed to create swap chain");
     }
@@ -702,6 +2395,35 @@ void HelloTriangleApplication::createSwapChain()
     m_swapChainExtent = extent;
 }
 
+void HelloTriangleApplication::createOffscreenImages()
+{
+    // Stand-ins for the swapchain images when running headless. Everything downstream (image views,
+    // framebuffers, command buffers) treats them exactly like swapchain images
+    m_swapChainImageFormat = VK_FORMAT_R8G8B8A8_UNORM;
+    m_swapChainExtent = { m_settings.width, m_settings.height };
+
+    m_swapChainImages.resize(g_HEADLESS_IMAGE_COUNT);
+    m_offscreenImageAllocations.resize(g_HEADLESS_IMAGE_COUNT);
+
+    for (size_t i = 0; i < m_swapChainImages.size(); i++)
+    {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = m_swapChainImageFormat;
+        imageInfo.extent = { m_swapChainExtent.width, m_swapChainExtent.height, 1 };
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        m_deviceAllocator.createImage(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_swapChainImages[i], m_offscreenImageAllocations[i]);
+    }
+}
+
 void HelloTriangleApplication::createImageViews()
 {
     m_swapChainImageViews.resize(m_swapChainImages.size());
@@ -724,261 +2446,420 @@ void HelloTriangleApplication::createImageViews()
         createInfo.subresourceRange.baseArrayLayer = 0;
         createInfo.subresourceRange.layerCount = 1;
 
-        if (vkCreateImageView(m_logicalDevice, &createInfo, nullptr, &m_swapChainImageViews[i]) != VK_SUCCESS) 
+        if (vkCreateImageView(m_logicalDevice, &createInfo, m_hostAllocator.callbacks(), &m_swapChainImageViews[i]) != VK_SUCCESS) 
         {
             throw std::runtime_error("Failed to create image views");
         }
     }
 }
 
+VkSampleCountFlagBits HelloTriangleApplication::chooseSampleCount(uint32_t requested) const
+{
+    // Colour and depth have to agree on the count
+    const VkPhysicalDeviceLimits& limits = m_physicalDeviceProperties.limits;
+    VkSampleCountFlags supported = limits.framebufferColorSampleCounts & limits.framebufferDepthSampleCounts;
+
+    for (uint32_t samples = requested; samples > 1; samples /= 2)
+    {
+        if (supported & samples) return static_cast<VkSampleCountFlagBits>(samples);
+    }
+
+    return VK_SAMPLE_COUNT_1_BIT;
+}
+
+void HelloTriangleApplication::createAttachmentImages()
+{
+    // Chosen once, the render pass and every pipeline depend on them. Only the MSAA benchmark
+    // changes the sample count later
+    if (m_depthFormat == VK_FORMAT_UNDEFINED)
+    {
+        m_sampleCount = chooseSampleCount(m_settings.msaaSamples);
+
+        if (m_sampleCount != m_settings.msaaSamples)
+        {
+            std::cout << m_settings.msaaSamples << "x MSAA is not supported, using " << m_sampleCount << "x" << std::endl;
+        }
+
+        for (VkFormat format : { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT })
+        {
+            VkFormatProperties properties;
+            vkGetPhysicalDeviceFormatProperties(m_physicalDevice, format, &properties);
+
+            if (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT)
+            {
+                m_depthFormat = format;
+                break;
+            }
+        }
+
+        if (m_depthFormat == VK_FORMAT_UNDEFINED)
+        {
+            throw std::runtime_error("Failed to find a supported depth format");
+        }
+    }
+
+    createTransientAttachment(m_depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, depthAspects(), m_depthImage, m_depthAllocation, m_depthImageView);
+
+    // Multisampled colour is resolved into the swapchain image at the end of the subpass, so it
+    // is as short lived as depth
+    if (m_sampleCount != VK_SAMPLE_COUNT_1_BIT)
+    {
+        createTransientAttachment(m_swapChainImageFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_IMAGE_ASPECT_COLOR_BIT, m_colorImage, m_colorAllocation, m_colorImageView);
+    }
+}
+
+void HelloTriangleApplication::createTransientAttachment(
+    VkFormat format, 
+    VkImageUsageFlags usage, 
+    VkImageAspectFlags aspects, 
+    VkImage& image, 
+    MemoryAllocation& allocation, 
+    VkImageView& imageView
+)
+{
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = format;
+    imageInfo.extent = { m_swapChainExtent.width, m_swapChainExtent.height, 1 };
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = m_sampleCount;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = usage | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    // Cleared at the start of the render pass and discarded at the end, so a tile based GPU never
+    // has to back it with memory at all. Elsewhere it is an ordinary device local image
+    VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+    if (m_deviceAllocator.hasMemoryType(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT))
+    {
+        properties |= VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+    }
+
+    m_deviceAllocator.createImage(imageInfo, properties, image, allocation);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = format;
+    viewInfo.subresourceRange.aspectMask = aspects;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+
+    if (vkCreateImageView(m_logicalDevice, &viewInfo, m_hostAllocator.callbacks(), &imageView) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create attachment image view");
+    }
+}
+
+VkImageAspectFlags HelloTriangleApplication::depthAspects() const
+{
+    // Views and barriers of combined formats cover both aspects
+    if (m_depthFormat == VK_FORMAT_D32_SFLOAT) return VK_IMAGE_ASPECT_DEPTH_BIT;
+
+    return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+}
+
+void HelloTriangleApplication::destroyAttachmentImages()
+{
+    vkDestroyImageView(m_logicalDevice, m_depthImageView, m_hostAllocator.callbacks());
+    m_deviceAllocator.destroyImage(m_depthImage, m_depthAllocation);
+    vkDestroyImageView(m_logicalDevice, m_colorImageView, m_hostAllocator.callbacks());
+    m_deviceAllocator.destroyImage(m_colorImage, m_colorAllocation);
+
+    m_depthImage = VK_NULL_HANDLE;
+    m_depthImageView = VK_NULL_HANDLE;
+    m_colorImage = VK_NULL_HANDLE;
+    m_colorImageView = VK_NULL_HANDLE;
+}
+
+void HelloTriangleApplication::rebuildRenderTargets()
+{
+    // Only benchmarks change the sample count or rendering path, rarely enough to simply idle the
+    // device. Pipelines built for the old render pass stay in the registry, harmlessly, until shutdown
+    m_pipelineRegistry.waitForPending();
+    vkDeviceWaitIdle(m_logicalDevice);
+
+    for (auto framebuffer : m_swapChainFramebuffers)
+    {
+        vkDestroyFramebuffer(m_logicalDevice, framebuffer, m_hostAllocator.callbacks());
+    }
+
+    m_swapChainFramebuffers.clear();
+    destroyAttachmentImages();
+    vkDestroyRenderPass(m_logicalDevice, m_renderPass, m_hostAllocator.callbacks());
+    m_renderPass = VK_NULL_HANDLE;
+
+    createAttachmentImages();
+    createRenderPass();
+    createGraphicsPipeline();
+    createFrameBuffers();
+}
+
+void HelloTriangleApplication::setSampleCount(VkSampleCountFlagBits samples)
+{
+    if (samples == m_sampleCount) return;
+
+    m_sampleCount = samples;
+    rebuildRenderTargets();
+}
+
+void HelloTriangleApplication::setDynamicRendering(bool dynamicRendering)
+{
+    if (dynamicRendering == m_dynamicRendering) return;
+
+    m_dynamicRendering = dynamicRendering;
+    rebuildRenderTargets();
+}
+
 void HelloTriangleApplication::createRenderPass()
 {
+    // Dynamic rendering describes the attachments when it begins, see beginRendering()
+    if (m_dynamicRendering)
+    {
+        m_renderPass = VK_NULL_HANDLE;
+        return;
+    }
+
+    bool multisampled = m_sampleCount != VK_SAMPLE_COUNT_1_BIT;
+
+    // The swapchain image is always attachment 0. With MSAA it only receives the resolve, which
+    // overwrites all of it, so there is nothing to clear
     VkAttachmentDescription colorAttachment{};
     colorAttachment.format = m_swapChainImageFormat;
     colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachment.loadOp = multisampled ? VK_ATTACHMENT_LOAD_OP_DONT_CARE : VK_ATTACHMENT_LOAD_OP_CLEAR;
     colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
     colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    colorAttachment.finalLayout = m_settings.headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+    // Cleared and discarded every frame, nothing outside the render pass ever sees it. The depth
+    // prepass draws into the same subpass, ahead of the colour draws, which keeps depth on chip
+    VkAttachmentDescription depthAttachment{};
+    depthAttachment.format = m_depthFormat;
+    depthAttachment.samples = m_sampleCount;
+    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    // Rendered into with MSAA and resolved into attachment 0 as the subpass ends, so the samples
+    // themselves are discarded without ever leaving tile memory on a tile based GPU
+    VkAttachmentDescription multisampledAttachment = depthAttachment;
+    multisampledAttachment.format = m_swapChainImageFormat;
+    multisampledAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
     VkAttachmentReference colorAttachmentRef{};
-    colorAttachmentRef.attachment = 0;
+    colorAttachmentRef.attachment = multisampled ? 2 : 0;
     colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+    VkAttachmentReference resolveAttachmentRef{};
+    resolveAttachmentRef.attachment = 0;
+    resolveAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference depthAttachmentRef{};
+    depthAttachmentRef.attachment = 1;
+    depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
     VkSubpassDescription subpass{};
     subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
     subpass.colorAttachmentCount = 1;
     subpass.pColorAttachments = &colorAttachmentRef;
+    subpass.pResolveAttachments = multisampled ? &resolveAttachmentRef : nullptr;
+    subpass.pDepthStencilAttachment = &depthAttachmentRef;
 
+    // One depth image serves every frame in flight, so this frame's clear also has to wait for the
+    // previous frame's depth tests
     VkSubpassDependency dependency{};
     dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
     dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.srcAccessMask = 0;
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+    VkAttachmentDescription attachments[] = { colorAttachment, depthAttachment, multisampledAttachment };
 
     VkRenderPassCreateInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    renderPassInfo.attachmentCount = 1;
-    renderPassInfo.pAttachments = &colorAttachment;
+    renderPassInfo.attachmentCount = multisampled ? 3 : 2;
+    renderPassInfo.pAttachments = attachments;
     renderPassInfo.subpassCount = 1;
     renderPassInfo.pSubpasses = &subpass;
     renderPassInfo.dependencyCount = 1;
     renderPassInfo.pDependencies = &dependency;
 
-    if (vkCreateRenderPass(m_logicalDevice, &renderPassInfo, nullptr, &m_renderPass) != VK_SUCCESS) 
-    {
-        throw std::runtime_error("Failed to create render pass");
-    }
-}
-
-void HelloTriangleApplication::createGraphicsPipeline()
-{
-    auto vertShaderCode = readFile("shaders/vert.spv");
-    auto fragShaderCode = readFile("shaders/frag.spv");
-
-    VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-    VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
-
-    VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
-    vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-    vertShaderStageInfo.module = vertShaderModule;
-    vertShaderStageInfo.pName = "main";
-
-    VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
-    fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    fragShaderStageInfo.module = fragShaderModule;
-    fragShaderStageInfo.pName = "main";
-
-    VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
-
-    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputInfo.vertexBindingDescriptionCount = 0;
-    vertexInputInfo.pVertexBindingDescriptions = nullptr;   // Optional
-    vertexInputInfo.vertexAttributeDescriptionCount = 0;
-    vertexInputInfo.pVertexAttributeDescriptions = nullptr; // Optional
-
-    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
-    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-    inputAssembly.primitiveRestartEnable = VK_FALSE;
-
-    VkViewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width  = (float) m_swapChainExtent.width;
-    viewport.height = (float) m_swapChainExtent.height;
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-
-    VkRect2D scissor{};
-    scissor.offset = { 0, 0 };
-    scissor.extent = m_swapChainExtent;
-
-    VkPipelineViewportStateCreateInfo viewportState{};
-    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-    viewportState.viewportCount = 1;
-    viewportState.pViewports = &viewport;
-    viewportState.scissorCount = 1;
-    viewportState.pScissors = &scissor;
-
-    VkPipelineRasterizationStateCreateInfo rasterizer{};
-    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-    rasterizer.depthClampEnable = VK_FALSE;
-    rasterizer.rasterizerDiscardEnable = VK_FALSE;
-    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-    rasterizer.lineWidth = 1.0f;
-    rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-    rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
-    rasterizer.depthBiasEnable = VK_FALSE;
-    rasterizer.depthBiasConstantFactor = 0.0f;  // Optional
-    rasterizer.depthBiasClamp = 0.0f;           // Optional
-    rasterizer.depthBiasSlopeFactor = 0.0f;     // Optional
-
-    VkPipelineMultisampleStateCreateInfo multisampling{};
-    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multisampling.sampleShadingEnable = VK_FALSE;
-    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-    multisampling.minSampleShading = 1.0f;              // Optional
-    multisampling.pSampleMask = nullptr;                // Optional
-    multisampling.alphaToCoverageEnable = VK_FALSE;     // Optional
-    multisampling.alphaToOneEnable = VK_FALSE;          // Optional
-
-    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    colorBlendAttachment.blendEnable = VK_FALSE;
-    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;     // Optional
-    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;    // Optional
-    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;                // Optional
-    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;     // Optional
-    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;    // Optional
-    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;                // Optional
-
-    VkPipelineColorBlendStateCreateInfo colorBlending{};
-    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-    colorBlending.logicOpEnable = VK_FALSE;
-    colorBlending.logicOp = VK_LOGIC_OP_COPY;   // Optional
-    colorBlending.attachmentCount = 1;
-    colorBlending.pAttachments = &colorBlendAttachment;
-    colorBlending.blendConstants[0] = 0.0f;     // Optional
-    colorBlending.blendConstants[1] = 0.0f;     // Optional
-    colorBlending.blendConstants[2] = 0.0f;     // Optional
-    colorBlending.blendConstants[3] = 0.0f;     // Optional
-
-    /*VkDynamicState dynamicStates[] = {
-    VK_DYNAMIC_STATE_VIEWPORT,
-    VK_DYNAMIC_STATE_LINE_WIDTH
-    };
+    if (vkCreateRenderPass(m_logicalDevice, &renderPassInfo, m_hostAllocator.callbacks(), &m_renderPass) != VK_SUCCESS) 
+    {
+        throw std::runtime_error("Failed to create render pass");
+    }
+}
 
-    VkPipelineDynamicStateCreateInfo dynamicState{};
-    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-    dynamicState.dynamicStateCount = 2;
-    dynamicState.pDynamicStates = dynamicStates;*/
+void HelloTriangleApplication::createGraphicsPipeline()
+{
+    // The layout does not depend on the render pass, so it outlives format changes
+    if (m_pipelineLayout == VK_NULL_HANDLE)
+    {
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        // Per frame data comes from the frame allocator, at a dynamic offset given when binding.
+        // Everything else shaders read is in the bindless table, where the device has one
+        VkDescriptorSetLayout setLayouts[2] = { m_frameAllocator.descriptorSetLayout(), m_bindlessTable.descriptorSetLayout() };
+        pipelineLayoutInfo.setLayoutCount = m_bindlessSupported ? 2 : 1;
+        pipelineLayoutInfo.pSetLayouts = setLayouts;
+
+        // Each draw of the draw list places its triangle through push constants, followed by the
+        // constants of the mesh it draws and, for the fragment shader, the texture it samples
+        VkPushConstantRange pushConstantRanges[2]{};
+        pushConstantRanges[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        pushConstantRanges[0].offset = 0;
+        pushConstantRanges[0].size = sizeof(DrawCommand) + sizeof(MeshConstants);
+        pushConstantRanges[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+        pushConstantRanges[1].offset = sizeof(DrawCommand) + sizeof(MeshConstants);
+        pushConstantRanges[1].size = sizeof(MaterialConstants);
+
+        pipelineLayoutInfo.pushConstantRangeCount = 2;
+        pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges;
+
+        if (vkCreatePipelineLayout(m_logicalDevice, &pipelineLayoutInfo, m_hostAllocator.callbacks(), &m_pipelineLayout) != VK_SUCCESS) 
+        {
+            throw std::runtime_error("Failed to create pipeline layout");
+        }
+    }
 
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 0;              // Optional
-    pipelineLayoutInfo.pSetLayouts = nullptr;           // Optional
-    pipelineLayoutInfo.pushConstantRangeCount = 0;      // Optional
-    pipelineLayoutInfo.pPushConstantRanges = nullptr;   // Optional
+    PipelineDescription description;
+    description.vertexShader = "shaders/vert.spv";
+    description.fragmentShader = "shaders/frag.spv";
+    description.layout = m_pipelineLayout;
+    description.renderPass = m_renderPass;
+    description.samples = m_sampleCount;
 
-    if (vkCreatePipelineLayout(m_logicalDevice, &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS) 
+    // Dynamic rendering pipelines only depend on the attachment formats, never on a render pass
+    if (m_dynamicRendering)
     {
-        throw std::runtime_error("Failed to create pipeline layout");
+        description.colorFormat = m_swapChainImageFormat;
+        description.depthFormat = m_depthFormat;
     }
 
-    VkGraphicsPipelineCreateInfo pipelineInfo{};
-    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipelineInfo.stageCount = 2;
-    pipelineInfo.pStages = shaderStages;
-    pipelineInfo.pVertexInputState = &vertexInputInfo;
-    pipelineInfo.pInputAssemblyState = &inputAssembly;
-    pipelineInfo.pViewportState = &viewportState;
-    pipelineInfo.pRasterizationState = &rasterizer;
-    pipelineInfo.pMultisampleState = &multisampling;
-    pipelineInfo.pDepthStencilState = nullptr;          // Optional
-    pipelineInfo.pColorBlendState = &colorBlending;
-    pipelineInfo.pDynamicState = nullptr;               // Optional
-    pipelineInfo.layout = m_pipelineLayout;
-    pipelineInfo.renderPass = m_renderPass;
-    pipelineInfo.subpass = 0;
-    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
-    pipelineInfo.basePipelineIndex = -1; // Optional
+    // Compiles in the background, frames skip the draw until it is ready
+    m_trianglePipeline = m_pipelineRegistry.request(description);
 
-    if (vkCreateGraphicsPipelines(m_logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_graphicsPipeline) != VK_SUCCESS) 
+    description.vertexShader = "shaders/draw_list.spv";
+    m_drawListPipelines = requestDrawPipelines(description);
+
+    if (m_settings.overdrawBenchmark)
     {
-        throw std::runtime_error("Failed to create graphics pipeline");
+        description.fragmentShader = "shaders/overdraw.spv";
+        m_overdrawPipelines = requestDrawPipelines(description);
+        description.fragmentShader = "shaders/frag.spv";
     }
 
-    vkDestroyShaderModule(m_logicalDevice, fragShaderModule, nullptr);
-    vkDestroyShaderModule(m_logicalDevice, vertShaderModule, nullptr);
-}
+    // Meshes come in either encoding, the benchmark compares both. With textures they sample one
+    description.vertexShader = "shaders/mesh.spv";
+    description.vertexFormat = VertexFormat::PositionColor;
 
-std::vector<char> HelloTriangleApplication::readFile(const std::string& filename) 
-{
-    std::ifstream file(filename, std::ios::ate | std::ios::binary);
+    if (!m_settings.texturePaths.empty() && m_bindlessSupported)
+    {
+        description.fragmentShader = "shaders/textured.spv";
+    }
 
-    if (!file.is_open()) 
+    for (VertexEncoding encoding : { VertexEncoding::Float, VertexEncoding::Quantized })
     {
-        throw std::runtime_error("Failed to open file");
+        if (encoding != m_mesh.encoding && !m_settings.vertexBenchmark) continue;
+
+        description.vertexEncoding = encoding;
+        m_meshPipelines[static_cast<uint32_t>(encoding)] = requestDrawPipelines(description);
     }
 
-    // std::ios::ate places the cursor at the eof, and tellg returns that position which we then cast to size_t! 
-    size_t fileSize = (size_t) file.tellg();
+    description.vertexEncoding = m_mesh.encoding;
+    description.fragmentShader = "shaders/frag.spv";
 
-    // Doing this gives us the perfect sized buffer for our char vector
-    std::vector<char> buffer(fileSize);
+    // The shaders below read the bindless table, which the pipeline layout only has with descriptor
+    // indexing
+    if ((m_settings.gpuDriven || m_settings.cullBenchmark) && m_bindlessSupported)
+    {
+        description.vertexShader = "shaders/gpu_driven.spv";
+        description.vertexFormat = VertexFormat::PositionColor;
+        m_gpuDrivenPipeline = m_pipelineRegistry.request(description);
+    }
 
-    // Read the file in from the beginning
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
-    file.close();
+    if (m_settings.instanceCount > 0)
+    {
+        description.vertexShader = "shaders/instanced.spv";
+        description.vertexFormat = VertexFormat::PositionColorInstanced;
+        m_instancedPipeline = m_pipelineRegistry.request(description);
+    }
 
-    return buffer;
+    // Particles are pulled from their buffer by the vertex shader, one point each
+    if ((m_settings.particleCount > 0 || m_settings.particleBenchmark) && m_bindlessSupported)
+    {
+        description.vertexShader = "shaders/particles.spv";
+        description.vertexFormat = VertexFormat::None;
+        description.topology = VK_PRIMITIVE_TOPOLOGY_POINT_LIST;
+        m_particlePipeline = m_pipelineRegistry.request(description);
+    }
 }
 
-VkShaderModule HelloTriangleApplication::createShaderModule(const std::vector<char>& code) 
+DrawPipelines HelloTriangleApplication::requestDrawPipelines(const PipelineDescription& description)
 {
-    VkShaderModuleCreateInfo createInfo{};
-    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = code.size();
-    createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+    DrawPipelines pipelines;
+    pipelines.color = m_pipelineRegistry.request(description);
 
-    VkShaderModule shaderModule;
-    if (vkCreateShaderModule(m_logicalDevice, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) 
-    {
-        throw std::runtime_error("Failed to create shader module");
-    }
+    if (!m_settings.depthPrepass && !m_settings.overdrawBenchmark) return pipelines;
+
+    // The prepass only runs the vertex shader, whatever the material
+    PipelineDescription depthOnly = description;
+    depthOnly.fragmentShader.clear();
+    depthOnly.colorWrite = false;
+    pipelines.depthOnly = m_pipelineRegistry.request(depthOnly);
 
-    return shaderModule;
+    // Depth is final by the time colour is drawn, so only the visible surface passes and nothing
+    // needs writing
+    PipelineDescription colorEqual = description;
+    colorEqual.depthCompareOp = VK_COMPARE_OP_EQUAL;
+    colorEqual.depthWrite = false;
+    pipelines.colorEqual = m_pipelineRegistry.request(colorEqual);
+
+    return pipelines;
 }
 
 void HelloTriangleApplication::createFrameBuffers()
 {
+    // Dynamic rendering renders straight into the image views, there is nothing to rebuild when
+    // they change
+    if (m_dynamicRendering) return;
+
     m_swapChainFramebuffers.resize(m_swapChainImageViews.size());
 
     for (size_t i = 0; i < m_swapChainImageViews.size(); i++) 
     {
+        // In render pass order, the multisampled colour image only exists with MSAA
         VkImageView attachments[] = {
-            m_swapChainImageViews[i]
+            m_swapChainImageViews[i],
+            m_depthImageView,
+            m_colorImageView
         };
 
         VkFramebufferCreateInfo framebufferInfo{};
         framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
         framebufferInfo.renderPass = m_renderPass;
-        framebufferInfo.attachmentCount = 1;
+        framebufferInfo.attachmentCount = m_colorImageView != VK_NULL_HANDLE ? 3 : 2;
         framebufferInfo.pAttachments = attachments;
         framebufferInfo.width = m_swapChainExtent.width;
         framebufferInfo.height = m_swapChainExtent.height;
         framebufferInfo.layers = 1;
 
-        if (vkCreateFramebuffer(m_logicalDevice, &framebufferInfo, nullptr, &m_swapChainFramebuffers[i]) != VK_SUCCESS) 
+        if (vkCreateFramebuffer(m_logicalDevice, &framebufferInfo, m_hostAllocator.callbacks(), &m_swapChainFramebuffers[i]) != VK_SUCCESS) 
         {
             throw std::runtime_error("failed to create framebuffer!");
         }
@@ -990,9 +2871,9 @@ void HelloTriangleApplication::createCommandPool()
     VkCommandPoolCreateInfo poolInfo{};
     poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
     poolInfo.queueFamilyIndex = m_queueFamilyIndices.graphicsFamily.value();
-    poolInfo.flags = 0; // Optional
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;   // Re-recorded every frame
 
-    if (vkCreateCommandPool(m_logicalDevice, &poolInfo, nullptr, &m_commandPool) != VK_SUCCESS) 
+    if (vkCreateCommandPool(m_logicalDevice, &poolInfo, m_hostAllocator.callbacks(), &m_commandPool) != VK_SUCCESS) 
     {
         throw std::runtime_error("failed to create command pool!");
     }
@@ -1000,7 +2881,9 @@ void HelloTriangleApplication::createCommandPool()
 
 void HelloTriangleApplication::createCommandBuffers() 
 {
-    m_commandBuffers.resize(m_swapChainFramebuffers.size());
+    // One command buffer per frame slot, re-recorded every frame. Nothing in them depends on the
+    // swapchain, so resizing never has to touch them
+    m_commandBuffers.resize(m_settings.framesInFlight);
 
     VkCommandBufferAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -1013,76 +2896,604 @@ void HelloTriangleApplication::createCommandBuffers()
         throw std::runtime_error("Failed to allocate command buffers");
     }
 
-    for (size_t i = 0; i < m_commandBuffers.size(); i++) 
+    // One set of timestamp queries per frame slot, as each is in flight independently
+    m_gpuProfiler.setSlotCount(static_cast<uint32_t>(m_commandBuffers.size()));
+
+    // The draw list itself goes into secondaries recorded from per thread pools
+    m_commandRecorder.create(m_logicalDevice, m_hostAllocator.callbacks(), m_queueFamilyIndices.graphicsFamily.value(), m_settings.recordThreads, m_settings.framesInFlight);
+}
+
+void HelloTriangleApplication::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t slot, uint32_t imageIndex)
+{
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.pInheritanceInfo = nullptr;   // Optional
+
+    // Beginning implicitly resets the buffer, its previous submission is known to be complete
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) 
+    {
+        throw std::runtime_error("Failed to begin recording command buffer");
+    }
+
+    m_gpuProfiler.beginFrame(commandBuffer, slot);
+
+    // Takes ownership of finished uploads, which must happen outside the render pass
+    m_stagingUploader.recordAcquires(commandBuffer, m_frameScheduler);
+
+    // Textures uploaded without mips get them before anything samples them
+    if (m_bindlessSupported) m_textureStreamer.recordMipGeneration(commandBuffer);
+
+    // Everything recorded below, secondaries included, binds this frame's constants
+    FrameConstants frameConstants;
+    frameConstants.viewOffset[0] = m_view.offsetX;
+    frameConstants.viewOffset[1] = m_view.offsetY;
+    frameConstants.viewScale = m_view.scale;
+    frameConstants.time = std::chrono::duration<float>(std::chrono::steady_clock::now() - m_startTime).count();
+
+    m_frameConstantsOffset = m_frameAllocator.push(frameConstants);
+
+    // Until the mesh has been uploaded (or its pipeline compiled) the draw list pipeline places a
+    // triangle without any vertex input, and until that one is ready the plain triangle stands in.
+    // With nothing compiled yet the pass still clears, the draws just appear a few frames later.
+    // The overdraw benchmark's scene always goes through the draw list pipeline
+    bool meshReady = m_stagingUploader.isReady(m_mesh.upload) && m_mesh.indexBuffer != VK_NULL_HANDLE;
+    bool texturesReady = m_textureStreamer.textureCount() == 0 || m_textureStreamer.isReady();
+    const DrawPipelines& meshPipelines = m_meshPipelines[static_cast<uint32_t>(m_mesh.encoding)];
+    const DrawPipelines* drawPipelines = m_overdrawScene ? &m_overdrawPipelines : &m_drawListPipelines;
+    bool useMesh = !m_overdrawScene && meshReady && texturesReady && m_pipelineRegistry.get(meshPipelines.color) != VK_NULL_HANDLE;
+
+    if (useMesh)
     {
-        VkCommandBufferBeginInfo beginInfo{};
-        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        beginInfo.flags = 0;                    // Optional
-        beginInfo.pInheritanceInfo = nullptr;   // Optional
+        drawPipelines = &meshPipelines;
+    }
+
+    VkPipeline pipeline = m_pipelineRegistry.get(drawPipelines->color, m_overdrawScene ? INVALID_PIPELINE_HANDLE : m_trianglePipeline);
+
+    // With the prepass the draws are drawn twice, depth only and then shaded against final depth.
+    // Until both of those pipelines are ready the draws are drawn once, as without it
+    VkPipeline depthPipeline = VK_NULL_HANDLE;
+
+    if (m_depthPrepass && pipeline != VK_NULL_HANDLE)
+    {
+        VkPipeline depthOnly = m_pipelineRegistry.get(drawPipelines->depthOnly);
+        VkPipeline colorEqual = m_pipelineRegistry.get(drawPipelines->colorEqual);
 
-        if (vkBeginCommandBuffer(m_commandBuffers[i], &beginInfo) != VK_SUCCESS) 
+        if (depthOnly != VK_NULL_HANDLE && colorEqual != VK_NULL_HANDLE)
         {
-            throw std::runtime_error("Failed to begin recording command buffer");
+            depthPipeline = depthOnly;
+            pipeline = colorEqual;
         }
+    }
 
-        VkRenderPassBeginInfo renderPassInfo{};
-        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassInfo.renderPass = m_renderPass;
-        renderPassInfo.framebuffer = m_swapChainFramebuffers[i];
-        renderPassInfo.renderArea.offset = { 0, 0 };
-        renderPassInfo.renderArea.extent = m_swapChainExtent;
+    // Resolved once on this thread, recording threads only read the slots. Whatever is sampled
+    // here counts as used, which is what decides what streams in
+    uint32_t drawCount = static_cast<uint32_t>(m_drawList.size());
+    m_frameTextures.clear();
+
+    for (TextureHandle texture = 0; useMesh && texture < m_textureStreamer.textureCount() && texture < drawCount; texture++)
+    {
+        m_frameTextures.push_back(m_textureStreamer.use(texture));
+    }
+
+    // GPU-driven, the draws are culled and written before the render pass begins
+    VkPipeline gpuDrivenPipeline = VK_NULL_HANDLE;
+
+    if (m_gpuDriven && meshReady && m_cullingPass.isReady())
+    {
+        gpuDrivenPipeline = m_pipelineRegistry.get(m_gpuDrivenPipeline);
+    }
+
+    // The compute passes ahead of the scene, added to the frame's render graph below, which orders
+    // them against each other, the draws and the previous frame
+    auto cullResetPass = [this](VkCommandBuffer commandBuffer, const RenderGraph&) {
+        m_cullingPass.recordReset(commandBuffer);
+    };
+
+    auto cullPass = [this, slot](VkCommandBuffer commandBuffer, const RenderGraph&) {
+        uint32_t cullScope = m_gpuProfiler.beginScope(commandBuffer, slot, "cull");
+        m_cullingPass.record(commandBuffer, m_view);
+        m_gpuProfiler.endScope(commandBuffer, slot, cullScope);
+    };
+
+    // The graph has already waited for the previous frame's generation and put every level in
+    // SHADER_READ_ONLY, the generator only orders the levels among themselves
+    auto mipPass = [this, slot](VkCommandBuffer commandBuffer, const RenderGraph&) {
+        uint32_t mipScope = m_gpuProfiler.beginScope(commandBuffer, slot, "mipgen");
+
+        m_mipGenerator.record(
+            commandBuffer, 
+            *m_mipBenchmarkChain, 
+            m_mipBenchmarkMethod, 
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 
+            VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 
+            0, 
+            VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+        );
+
+        m_gpuProfiler.endScope(commandBuffer, slot, mipScope);
+    };
+
+    auto particlePass = [this, slot](VkCommandBuffer commandBuffer, const RenderGraph&) {
+        uint32_t particleScope = m_gpuProfiler.beginScope(commandBuffer, slot, "particles");
+        m_particleSystem.record(commandBuffer);
+        m_gpuProfiler.endScope(commandBuffer, slot, particleScope);
+    };
+
+    // The instanced stress mode replaces the draw list with a single draw once the mesh and its
+    // pipeline are there. It has nothing to split between threads
+    VkPipeline instancedPipeline = VK_NULL_HANDLE;
+
+    if (meshReady && m_instanceField.instanceCount() > 0)
+    {
+        instancedPipeline = m_pipelineRegistry.get(m_instancedPipeline);
+    }
+
+    // Everything drawn into the frame's attachments
+    auto recordScene = [&]() {
+        if (instancedPipeline != VK_NULL_HANDLE)
+        {
+            beginRendering(commandBuffer, imageIndex, VK_SUBPASS_CONTENTS_INLINE);
+            recordInstancedDraw(commandBuffer, instancedPipeline, slot);
+            recordParticleDraw(commandBuffer);
+        }
+        else if (gpuDrivenPipeline != VK_NULL_HANDLE)
+        {
+            beginRendering(commandBuffer, imageIndex, VK_SUBPASS_CONTENTS_INLINE);
+            recordGpuDrivenDraws(commandBuffer, gpuDrivenPipeline);
+            recordParticleDraw(commandBuffer);
+        }
+        else if (pipeline != VK_NULL_HANDLE && m_commandRecorder.threadCount() > 1)
+        {
+            // Without a render pass, secondaries are told the attachment formats instead
+            VkFormat colorFormat = m_swapChainImageFormat;
+
+            VkCommandBufferInheritanceRenderingInfoKHR renderingInheritance{};
+            renderingInheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO_KHR;
+            renderingInheritance.colorAttachmentCount = 1;
+            renderingInheritance.pColorAttachmentFormats = &colorFormat;
+            renderingInheritance.depthAttachmentFormat = m_depthFormat;
+            renderingInheritance.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
+            renderingInheritance.rasterizationSamples = m_sampleCount;
+
+            VkCommandBufferInheritanceInfo inheritanceInfo{};
+            inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+            inheritanceInfo.pNext = m_dynamicRendering ? &renderingInheritance : nullptr;
+            inheritanceInfo.renderPass = m_renderPass;
+            inheritanceInfo.subpass = 0;
+            inheritanceInfo.framebuffer = m_dynamicRendering ? VK_NULL_HANDLE : m_swapChainFramebuffers[imageIndex];
+
+            const std::vector<VkCommandBuffer>& secondaries = m_commandRecorder.record(slot, inheritanceInfo, drawCount, 
+                [this, pipeline, depthPipeline, useMesh](VkCommandBuffer secondary, uint32_t begin, uint32_t end) {
+                    recordDraws(secondary, pipeline, depthPipeline, useMesh, begin, end);
+                });
+
+            beginRendering(commandBuffer, imageIndex, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+            if (!secondaries.empty())
+            {
+                vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaries.size()), secondaries.data());
+            }
+        }
+        else
+        {
+            // A single thread gains nothing from secondaries, record straight into the primary
+            beginRendering(commandBuffer, imageIndex, VK_SUBPASS_CONTENTS_INLINE);
+
+            if (pipeline != VK_NULL_HANDLE)
+            {
+                recordDraws(commandBuffer, pipeline, depthPipeline, useMesh, 0, drawCount);
+            }
 
-        VkClearValue clearColor = { {{0.0f, 0.0f, 0.0f, 1.0f}} };
-        renderPassInfo.clearValueCount = 1;
+            // Settings keep particles off the secondaries path, they are only drawn inline
+            recordParticleDraw(commandBuffer);
+        }
+
+        endRendering(commandBuffer);
+    };
 
-        renderPassInfo.pClearValues = &clearColor;
+    // Recorded into the frame's command buffer, which is the one the graph executes into
+    auto scenePass = [&](VkCommandBuffer, const RenderGraph&) {
+        uint32_t renderPassScope = m_gpuProfiler.beginScope(commandBuffer, slot, "render_pass");
+        recordScene();
+        m_gpuProfiler.endScope(commandBuffer, slot, renderPassScope);
+    };
 
-        vkCmdBeginRenderPass(m_commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    m_renderGraph.reset();
 
-        vkCmdBindPipeline(m_commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
+    RenderGraphResource drawCommands = INVALID_RENDER_GRAPH_RESOURCE;
+    RenderGraphResource drawCountBuffer = INVALID_RENDER_GRAPH_RESOURCE;
+    RenderGraphResource steppedParticles = INVALID_RENDER_GRAPH_RESOURCE;
 
-        vkCmdDraw(m_commandBuffers[i], 3, 1, 0, 0);
+    // The previous frame's draws read the indirect buffers last, overwriting them only has to wait
+    // for those
+    if (gpuDrivenPipeline != VK_NULL_HANDLE)
+    {
+        RenderGraphImportState drawn{};
+        drawn.stages = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
 
-        vkCmdEndRenderPass(m_commandBuffers[i]);
+        drawCommands = m_renderGraph.importBuffer("draw commands", m_cullingPass.indirectBuffer(), drawn);
 
-        if (vkEndCommandBuffer(m_commandBuffers[i]) != VK_SUCCESS) 
+        if (m_cullingPass.usesDrawCount())
         {
-            throw std::runtime_error("Failed to record command buffer");
+            drawCountBuffer = m_renderGraph.importBuffer("draw count", m_cullingPass.countBuffer(), drawn);
+
+            uint32_t reset = m_renderGraph.addPass("cull reset", cullResetPass);
+            m_renderGraph.write(reset, drawCountBuffer, RenderGraphAccess::TransferDestination);
+        }
+
+        uint32_t cull = m_renderGraph.addPass("cull", cullPass);
+        m_renderGraph.write(cull, drawCommands, RenderGraphAccess::StorageCompute);
+
+        if (drawCountBuffer != INVALID_RENDER_GRAPH_RESOURCE)
+        {
+            m_renderGraph.read(cull, drawCountBuffer, RenderGraphAccess::StorageCompute);
+            m_renderGraph.write(cull, drawCountBuffer, RenderGraphAccess::StorageCompute);
+        }
+    }
+
+    // Sampled by nothing, but chained to the previous frame's generation
+    if (m_mipBenchmarkChain != nullptr)
+    {
+        RenderGraphImportState generated{};
+        generated.layout = m_mipBenchmarkLayout;
+        generated.stages = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        generated.access = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+        RenderGraphResource chain = m_renderGraph.importImage(
+            "mip chain", 
+            m_mipBenchmarkChain->image, 
+            VK_NULL_HANDLE, 
+            VK_IMAGE_ASPECT_COLOR_BIT, 
+            generated, 
+            VK_IMAGE_LAYOUT_UNDEFINED
+        );
+
+        uint32_t mips = m_renderGraph.addPass("mipgen", mipPass);
+        m_renderGraph.write(mips, chain, RenderGraphAccess::MipGeneration);
+
+        m_mipBenchmarkLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    }
+
+    // Stepped here when they stay on the graphics queue, otherwise the step was submitted to the
+    // compute queue before recording started. The previous step wrote the buffer read here, and
+    // read the one written, which the frame before drew
+    if (!m_asyncParticles && m_particleSystem.isReady())
+    {
+        RenderGraphImportState stepped{};
+        stepped.stages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        stepped.access = VK_ACCESS_SHADER_WRITE_BIT;
+
+        RenderGraphImportState read{};
+        read.stages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+
+        RenderGraphResource particles = m_renderGraph.importBuffer("particles", m_particleSystem.sourceBuffer(), stepped);
+        steppedParticles = m_renderGraph.importBuffer("stepped particles", m_particleSystem.destinationBuffer(), read);
+
+        uint32_t step = m_renderGraph.addPass("particles", particlePass);
+        m_renderGraph.read(step, particles, RenderGraphAccess::StorageCompute);
+        m_renderGraph.write(step, steppedParticles, RenderGraphAccess::StorageCompute);
+    }
+
+    uint32_t scene = m_renderGraph.addPass("scene", scenePass);
+
+    if (drawCommands != INVALID_RENDER_GRAPH_RESOURCE)
+    {
+        m_renderGraph.read(scene, drawCommands, RenderGraphAccess::Indirect);
+    }
+
+    if (drawCountBuffer != INVALID_RENDER_GRAPH_RESOURCE)
+    {
+        m_renderGraph.read(scene, drawCountBuffer, RenderGraphAccess::Indirect);
+    }
+
+    if (steppedParticles != INVALID_RENDER_GRAPH_RESOURCE)
+    {
+        m_renderGraph.read(scene, steppedParticles, RenderGraphAccess::StorageVertex);
+    }
+
+    // With dynamic rendering the graph works out the barriers around the attachments too. The
+    // render pass orders its attachments itself, the graph only has to keep the scene
+    if (m_dynamicRendering)
+    {
+        RenderGraphImportState acquired{};
+        acquired.stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+
+        RenderGraphResource swapChainImage = m_renderGraph.importImage(
+            "swapchain", 
+            m_swapChainImages[imageIndex], 
+            m_swapChainImageViews[imageIndex], 
+            VK_IMAGE_ASPECT_COLOR_BIT, 
+            acquired, 
+            m_settings.headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+        );
+
+        // One depth image, and one multisampled image, serve every frame in flight. Their contents
+        // are discarded once the previous frame is done with them
+        RenderGraphImportState depthUsed{};
+        depthUsed.stages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        depthUsed.access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+        RenderGraphResource depth = m_renderGraph.importImage("depth", m_depthImage, m_depthImageView, depthAspects(), depthUsed, VK_IMAGE_LAYOUT_UNDEFINED);
+
+        m_renderGraph.write(scene, swapChainImage, RenderGraphAccess::ColorAttachment);
+        m_renderGraph.write(scene, depth, RenderGraphAccess::DepthAttachment);
+
+        if (m_sampleCount != VK_SAMPLE_COUNT_1_BIT)
+        {
+            RenderGraphImportState colorUsed{};
+            colorUsed.stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+            colorUsed.access = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+            RenderGraphResource color = m_renderGraph.importImage("multisampled color", m_colorImage, m_colorImageView, VK_IMAGE_ASPECT_COLOR_BIT, colorUsed, VK_IMAGE_LAYOUT_UNDEFINED);
+            m_renderGraph.write(scene, color, RenderGraphAccess::ColorAttachment);
         }
     }
+    else
+    {
+        m_renderGraph.keep(scene);
+    }
+
+    m_renderGraph.compile(m_frameScheduler.submittedValue());
+    m_renderGraph.execute(commandBuffer);
+
+    // Either way the frame draws a state some compute queue step may still be writing, or that the
+    // step recorded above reads
+    if (m_particleSystem.pendingValue() > 0)
+    {
+        m_frameScheduler.addWait(
+            m_particleSystem.timelineSemaphore(), 
+            m_particleSystem.pendingValue(), 
+            VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+        );
+    }
+
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) 
+    {
+        throw std::runtime_error("Failed to record command buffer");
+    }
 }
 
-void HelloTriangleApplication::createSynchronizationObjects()
+void HelloTriangleApplication::recordDraws(VkCommandBuffer commandBuffer, VkPipeline pipeline, VkPipeline depthPipeline, bool useMesh, uint32_t begin, uint32_t end)
 {
-    m_imageAvailableSemaphores.resize(g_MAX_FRAMES_IN_FLIGHT);
-    m_renderFinishedSemaphores.resize(g_MAX_FRAMES_IN_FLIGHT);
-    m_inFlightFences.resize(g_MAX_FRAMES_IN_FLIGHT);
-    m_imagesInFlight.resize(m_swapChainImages.size(), VK_NULL_HANDLE);
+    // Secondaries inherit nothing but the render pass, so every buffer sets up its own state
+    setPipelineState(commandBuffer, depthPipeline != VK_NULL_HANDLE ? depthPipeline : pipeline);
+
+    if (useMesh)
+    {
+        VkDeviceSize vertexOffset = 0;
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_mesh.vertexBuffer, &vertexOffset);
+        vkCmdBindIndexBuffer(commandBuffer, m_mesh.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+    }
+
+    // Each secondary lays down the depth of its own range before shading it. Ranges shaded earlier
+    // may still be covered by later ones, which costs some overdraw but never changes the result
+    if (depthPipeline != VK_NULL_HANDLE)
+    {
+        for (uint32_t i = begin; i < end; i++)
+        {
+            vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(DrawCommand), &m_drawList[i]);
+
+            if (useMesh)    vkCmdDrawIndexed(commandBuffer, m_mesh.indexCount, 1, 0, 0, 0);
+            else            vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+        }
+
+        // Same layout and dynamic state, so the descriptor sets, push constants and viewport stay
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+    }
 
-    VkSemaphoreCreateInfo semaphoreInfo{};
-    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    if (!useMesh)
+    {
+        for (uint32_t i = begin; i < end; i++)
+        {
+            vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(DrawCommand), &m_drawList[i]);
+            vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+        }
 
-    VkFenceCreateInfo fenceInfo{};
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+        return;
+    }
 
-    for (size_t i = 0; i < g_MAX_FRAMES_IN_FLIGHT; i++)
+    for (uint32_t i = begin; i < end; i++)
     {
-        if (vkCreateSemaphore(m_logicalDevice, &semaphoreInfo, nullptr, &m_imageAvailableSemaphores[i]) != VK_SUCCESS ||
-            vkCreateSemaphore(m_logicalDevice, &semaphoreInfo, nullptr, &m_renderFinishedSemaphores[i]) != VK_SUCCESS ||
-            vkCreateFence(m_logicalDevice, &fenceInfo, nullptr, &m_inFlightFences[i]) != VK_SUCCESS)
+        vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(DrawCommand), &m_drawList[i]);
+
+        // Textures are spread over the draws round robin
+        if (!m_frameTextures.empty())
         {
-            throw std::runtime_error("Failed to create synchronization object(s) for ith frame");
+            MaterialConstants material{ m_frameTextures[i % m_frameTextures.size()] };
+            vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, sizeof(DrawCommand) + sizeof(MeshConstants), sizeof(MaterialConstants), &material);
         }
+
+        vkCmdDrawIndexed(commandBuffer, m_mesh.indexCount, 1, 0, 0, 0);
+    }
+}
+
+void HelloTriangleApplication::recordInstancedDraw(VkCommandBuffer commandBuffer, VkPipeline pipeline, uint32_t slot)
+{
+    setPipelineState(commandBuffer, pipeline);
+
+    VkDeviceSize vertexOffset = 0;
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_mesh.vertexBuffer, &vertexOffset);
+    m_instanceField.bind(commandBuffer, slot);
+    vkCmdBindIndexBuffer(commandBuffer, m_mesh.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+
+    // Each instance carries its own position, so the push constants only size the mesh
+    DrawCommand draw{ 0.0f, 0.0f, m_instanceField.instanceScale(), 0.0f };
+    vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(DrawCommand), &draw);
+    vkCmdDrawIndexed(commandBuffer, m_mesh.indexCount, m_instanceField.instanceCount(), 0, 0, 0);
+}
+
+void HelloTriangleApplication::recordGpuDrivenDraws(VkCommandBuffer commandBuffer, VkPipeline pipeline)
+{
+    setPipelineState(commandBuffer, pipeline);
+
+    VkDeviceSize vertexOffset = 0;
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_mesh.vertexBuffer, &vertexOffset);
+    vkCmdBindIndexBuffer(commandBuffer, m_mesh.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+
+    // Objects place themselves, read through the object buffer's handle where the other paths
+    // push their DrawCommand. The view comes from the frame constants
+    BindlessHandle objectBuffer = m_cullingPass.objectBuffer();
+    vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(BindlessHandle), &objectBuffer);
+    m_cullingPass.draw(commandBuffer);
+}
+
+void HelloTriangleApplication::recordParticleDraw(VkCommandBuffer commandBuffer)
+{
+    BindlessHandle particleBuffer = m_particleSystem.drawBuffer();
+    VkPipeline pipeline = m_pipelineRegistry.get(m_particlePipeline);
+
+    if (particleBuffer == INVALID_BINDLESS_HANDLE || pipeline == VK_NULL_HANDLE) return;
+
+    setPipelineState(commandBuffer, pipeline);
+
+    // Points read themselves from the particle buffer, whose handle goes where the other draws
+    // push their DrawCommand
+    vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(BindlessHandle), &particleBuffer);
+    vkCmdDraw(commandBuffer, m_particleSystem.particleCount(), 1, 0, 0);
+}
+
+void HelloTriangleApplication::setPipelineState(VkCommandBuffer commandBuffer, VkPipeline pipeline)
+{
+    VkViewport viewport{};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width  = (float) m_swapChainExtent.width;
+    viewport.height = (float) m_swapChainExtent.height;
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+
+    VkRect2D scissor{};
+    scissor.offset = { 0, 0 };
+    scissor.extent = m_swapChainExtent;
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+    // Once per command buffer, draws select their resources by handle rather than rebinding
+    VkDescriptorSet sets[2] = { m_frameAllocator.descriptorSet(), m_bindlessTable.descriptorSet() };
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, m_bindlessSupported ? 2 : 1, sets, 1, &m_frameConstantsOffset);
+
+    // Stays put behind the DrawCommands the draws push in front of it
+    MeshConstants meshConstants{ m_mesh.positionScale };
+    vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, sizeof(DrawCommand), sizeof(MeshConstants), &meshConstants);
+}
+
+void HelloTriangleApplication::beginRendering(VkCommandBuffer commandBuffer, uint32_t imageIndex, VkSubpassContents contents)
+{
+    bool multisampled = m_sampleCount != VK_SAMPLE_COUNT_1_BIT;
+
+    if (!m_dynamicRendering)
+    {
+        VkRenderPassBeginInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass = m_renderPass;
+        renderPassInfo.framebuffer = m_swapChainFramebuffers[imageIndex];
+        renderPassInfo.renderArea.offset = { 0, 0 };
+        renderPassInfo.renderArea.extent = m_swapChainExtent;
+
+        // Indexed by attachment, with MSAA the multisampled image is the one cleared
+        VkClearValue clearValues[3]{};
+        clearValues[0].color = { {0.0f, 0.0f, 0.0f, 1.0f} };
+        clearValues[1].depthStencil = { 1.0f, 0 };
+        clearValues[2].color = { {0.0f, 0.0f, 0.0f, 1.0f} };
+        renderPassInfo.clearValueCount = multisampled ? 3 : 2;
+
+        renderPassInfo.pClearValues = clearValues;
+
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents);
+        return;
+    }
+
+    // The attachments are already in their layouts, recordCommandBuffer() runs this inside the
+    // frame's render graph. With MSAA the samples are resolved into the swapchain image as rendering ends and discarded
+    VkRenderingAttachmentInfoKHR colorAttachment{};
+    colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+    colorAttachment.imageView = multisampled ? m_colorImageView : m_swapChainImageViews[imageIndex];
+    colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    colorAttachment.resolveMode = multisampled ? VK_RESOLVE_MODE_AVERAGE_BIT : VK_RESOLVE_MODE_NONE;
+    colorAttachment.resolveImageView = multisampled ? m_swapChainImageViews[imageIndex] : VK_NULL_HANDLE;
+    colorAttachment.resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachment.storeOp = multisampled ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
+    colorAttachment.clearValue.color = { {0.0f, 0.0f, 0.0f, 1.0f} };
+
+    VkRenderingAttachmentInfoKHR depthAttachment{};
+    depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+    depthAttachment.imageView = m_depthImageView;
+    depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depthAttachment.resolveMode = VK_RESOLVE_MODE_NONE;
+    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.clearValue.depthStencil = { 1.0f, 0 };
+
+    VkRenderingInfoKHR renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+    renderingInfo.flags = contents == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT_KHR : 0;
+    renderingInfo.renderArea.offset = { 0, 0 };
+    renderingInfo.renderArea.extent = m_swapChainExtent;
+    renderingInfo.layerCount = 1;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachments = &colorAttachment;
+    renderingInfo.pDepthAttachment = &depthAttachment;
+
+    m_cmdBeginRendering(commandBuffer, &renderingInfo);
+}
+
+void HelloTriangleApplication::endRendering(VkCommandBuffer commandBuffer)
+{
+    if (!m_dynamicRendering)
+    {
+        vkCmdEndRenderPass(commandBuffer);
+        return;
     }
+
+    // The render graph hands the swapchain image over for presentation afterwards
+    m_cmdEndRendering(commandBuffer);
+}
+
+void HelloTriangleApplication::createSynchronizationObjects()
+{
+    m_frameScheduler.create(m_logicalDevice, m_hostAllocator.callbacks(), m_settings.framesInFlight, !m_settings.headless);
+    m_frameScheduler.setImageCount(static_cast<uint32_t>(m_swapChainImages.size()));
 }
 
 void HelloTriangleApplication::drawFrame()
 {
-    vkWaitForFences(m_logicalDevice, 1, &m_inFlightFences[m_currentFrame], VK_TRUE, UINT64_MAX);
+    FrameProfiler::Scope frameScope(m_frameProfiler, FramePhase::Frame);
+
+    uint32_t slot;
+
+    {
+        FrameProfiler::Scope scope(m_frameProfiler, FramePhase::FrameSlotWait);
+        slot = m_frameScheduler.beginFrame();
+    }
+
+    // This slot's previous frame is complete: its timestamps are ready and whatever was retired
+    // before it can go
+    m_gpuProfiler.collect(slot);
+    m_pipelineRegistry.collectCompileTimes();
+    m_deletionQueue.flush(m_frameScheduler.completedValue());
+    if (m_bindlessSupported) m_textureStreamer.update(m_frameScheduler.submittedValue());
+    m_stagingUploader.update();
+    m_frameAllocator.beginFrame(slot);
+    m_hostAllocator.publishStatistics();
+    m_instanceField.update(slot);
+
+    // On the compute queue this frame's step runs alongside its rendering, which draws the last one
+    if (m_asyncParticles && m_particleSystem.isReady())
+    {
+        m_particleSystem.submit(slot, m_frameScheduler.timelineSemaphore(), m_frameScheduler.submittedValue());
+    }
 
     uint32_t imageIndex;
-    VkResult result = vkAcquireNextImageKHR(m_logicalDevice, m_swapChain, UINT64_MAX, m_imageAvailableSemaphores[m_currentFrame], VK_NULL_HANDLE, &imageIndex);
+    VkResult result;
+
+    {
+        FrameProfiler::Scope scope(m_frameProfiler, FramePhase::Acquire);
+        result = vkAcquireNextImageKHR(m_logicalDevice, m_swapChain, UINT64_MAX, m_frameScheduler.imageAvailableSemaphore(), VK_NULL_HANDLE, &imageIndex);
+    }
 
     if (result == VK_ERROR_OUT_OF_DATE_KHR) 
     {
@@ -1094,38 +3505,36 @@ void HelloTriangleApplication::drawFrame()
         throw std::runtime_error("Failed to acquire swap chain image");
     }
 
-    // Check if a previous frame is using this image 
-    if (m_imagesInFlight[imageIndex] != VK_NULL_HANDLE) 
+    // The new swapchain has handed out an image, so the old ones are no longer being presented.
+    // Frames up to the last submitted one may still render to their images though
+    for (auto& destroy : m_retiredSwapChains)
     {
-        vkWaitForFences(m_logicalDevice, 1, &m_imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
+        m_deletionQueue.push(m_frameScheduler.submittedValue(), std::move(destroy));
     }
 
-    m_imagesInFlight[imageIndex] = m_inFlightFences[m_currentFrame];
+    m_retiredSwapChains.clear();
 
-    VkSubmitInfo submitInfo{};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-
-    VkSemaphore waitSemaphores[] = { m_imageAvailableSemaphores[m_currentFrame] };
-
-    VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = waitSemaphores;
-    submitInfo.pWaitDstStageMask = waitStages;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &m_commandBuffers[imageIndex];
-
-    VkSemaphore signalSemaphores[] = { m_renderFinishedSemaphores[m_currentFrame] };
+    // Check if a previous frame is using this image 
+    {
+        FrameProfiler::Scope scope(m_frameProfiler, FramePhase::ImageInFlightWait);
+        m_frameScheduler.waitForImage(imageIndex);
+    }
 
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = signalSemaphores;
+    {
+        FrameProfiler::Scope scope(m_frameProfiler, FramePhase::Record);
+        recordCommandBuffer(m_commandBuffers[slot], slot, imageIndex);
+    }
 
-    vkResetFences(m_logicalDevice, 1, &m_inFlightFences[m_currentFrame]);
+    // Fetched before submitting, which moves the scheduler on to the next slot
+    VkSemaphore signalSemaphores[] = { m_frameScheduler.renderFinishedSemaphore() };
 
-    if (vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, m_inFlightFences[m_currentFrame]) != VK_SUCCESS)
     {
-        throw std::runtime_error("Failed to submit draw command buffer");
+        FrameProfiler::Scope scope(m_frameProfiler, FramePhase::Submit);
+        m_frameScheduler.submit(m_graphicsQueue, m_commandBuffers[slot], imageIndex);
     }
 
+    m_gpuProfiler.markSubmitted(slot);
+
     VkPresentInfoKHR presentInfo{};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
     presentInfo.waitSemaphoreCount = 1;
@@ -1138,17 +3547,69 @@ void HelloTriangleApplication::drawFrame()
     presentInfo.pImageIndices = &imageIndex;
     presentInfo.pResults = nullptr; // Optional
 
-    result = vkQueuePresentKHR(m_presentQueue, &presentInfo);
+    {
+        FrameProfiler::Scope scope(m_frameProfiler, FramePhase::Present);
+        result = vkQueuePresentKHR(m_presentQueue, &presentInfo);
+    }
 
-    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || m_framebufferResized) 
+    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) 
     {
-        m_framebufferResized = false;
         recreateSwapChain();
     }
     else if (result != VK_SUCCESS) 
     {
         throw std::runtime_error("failed to present swap chain image!");
     }
+}
+
+void HelloTriangleApplication::drawOffscreenFrame()
+{
+    FrameProfiler::Scope frameScope(m_frameProfiler, FramePhase::Frame);
+
+    uint32_t slot;
+
+    {
+        FrameProfiler::Scope scope(m_frameProfiler, FramePhase::FrameSlotWait);
+        slot = m_frameScheduler.beginFrame();
+    }
+
+    // This slot's previous frame is complete: its timestamps are ready and whatever was retired
+    // before it can go
+    m_gpuProfiler.collect(slot);
+    m_pipelineRegistry.collectCompileTimes();
+    m_deletionQueue.flush(m_frameScheduler.completedValue());
+    if (m_bindlessSupported) m_textureStreamer.update(m_frameScheduler.submittedValue());
+    m_stagingUploader.update();
+    m_frameAllocator.beginFrame(slot);
+    m_hostAllocator.publishStatistics();
+    m_instanceField.update(slot);
+
+    // On the compute queue this frame's step runs alongside its rendering, which draws the last one
+    if (m_asyncParticles && m_particleSystem.isReady())
+    {
+        m_particleSystem.submit(slot, m_frameScheduler.timelineSemaphore(), m_frameScheduler.submittedValue());
+    }
+
+    // Nothing to acquire from, the offscreen images are simply used round robin
+    uint32_t imageIndex = m_nextOffscreenImage;
+    m_nextOffscreenImage = (m_nextOffscreenImage + 1) % static_cast<uint32_t>(m_swapChainImages.size());
+
+    // Check if a previous frame is using this image 
+    {
+        FrameProfiler::Scope scope(m_frameProfiler, FramePhase::ImageInFlightWait);
+        m_frameScheduler.waitForImage(imageIndex);
+    }
+
+    {
+        FrameProfiler::Scope scope(m_frameProfiler, FramePhase::Record);
+        recordCommandBuffer(m_commandBuffers[slot], slot, imageIndex);
+    }
+
+    // No acquire/present semaphores, the timeline alone paces the CPU against the GPU
+    {
+        FrameProfiler::Scope scope(m_frameProfiler, FramePhase::Submit);
+        m_frameScheduler.submit(m_graphicsQueue, m_commandBuffers[slot], imageIndex);
+    }
 
-    ++m_currentFrame %= g_MAX_FRAMES_IN_FLIGHT;
+    m_gpuProfiler.markSubmitted(slot);
 }
\ No newline at end of file
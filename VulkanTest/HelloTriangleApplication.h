@@ -1,11 +1,15 @@
 // Jesse Rankins 2021
 #pragma once
 
-#define VK_USE_PLATFORM_WIN32_KHR           // Windowed application using Vulkan
+#ifdef _WIN32                               // Windowed application using Vulkan
+#define VK_USE_PLATFORM_WIN32_KHR           //
+#endif                                      //
 #define GLFW_INCLUDE_VULKAN                 //
 #include <GLFW/glfw3.h>                     //
+#ifdef _WIN32                               //
 #define GLFW_EXPOSE_NATIVE_WIN32            //
 #include <GLFW/glfw3native.h>               //
+#endif                                      //
 
 #define STDEXCEPT_INCLUDED_IN_APPLICATION   // Prevent main from re-including
 #define IOSTREAM_INCLUDED_IN_APPLICATION    //
@@ -20,13 +24,46 @@ const bool validationLayersEnabled = true;  //
 #include <algorithm>                        // Necessary for std::clamp
 #include <iostream>                         // nullptr, cout
 #include <cstdint>                          // Necessary for UINT32_MAX
-#include <fstream>                          // Reading/loading shader binaries
+#include <cstring>                          // strcmp for extension/layer names
+#include <string>                           // Shader file names
+#include <chrono>                           // Headless frames/sec measurement
+#include <thread>                           // Render thread
+#include <atomic>                           // Render thread lifetime flag
+#include <exception>                        // Render thread errors, rethrown on the main thread
+#include <fstream>                          // Profile report output
 #include <vector>                           // allAvailableExtensions
+#include <functional>                       // Retired swapchains waiting on an acquire
 #include <map>                              // Rating GPU in scorePhysicalDevice
 #include <set>                              // Queue families value set
 
 #include "GlobalApplicationConstants.h"     // const uint32_t WINDOW_HEIGHT etc
 #include "QueueFamilyIndices.h"             // Struct for vulkan detected qfams
+#include "ApplicationSettings.h"            // Runtime configuration (headless etc)
+#include "FrameProfiler.h"                  // Per-phase CPU frame timings
+#include "GpuProfiler.h"                    // Timestamp queries around the render pass
+#include "FrameScheduler.h"                 // Timeline semaphore frame pacing
+#include "DeletionQueue.h"                  // Deferred destruction keyed on the frame timeline
+#include "HostAllocator.h"                  // Counted host allocations for the driver
+#include "DeviceAllocator.h"                // Sub-allocated device memory for buffers and images
+#include "StagingUploader.h"                // Uploads through the transfer queue
+#include "FrameAllocator.h"                 // Per frame uniform data
+#include "BindlessTable.h"                  // Textures and buffers indexed by handle
+#include "Mesh.h"                           // Vertex/index buffers
+#include "MeshFile.h"                       // Binary meshes loaded with --mesh
+#include "MappedFile.h"                     // Which are read through a memory mapping
+#include "InstanceField.h"                  // Instanced stress mode
+#include "CullingPass.h"                    // GPU-driven culling and indirect draws
+#include "TextureStreamer.h"                // KTX2 textures loaded with --texture
+#include "MipGenerator.h"                   // Mip chains generated on the GPU
+#include "ParticleSystem.h"                 // Particles simulated on the compute queue
+#include "RenderGraph.h"                    // Barriers and transient images worked out from pass declarations
+#include "PipelineCache.h"                  // Pipeline cache persisted across runs
+#include "PipelineRegistry.h"               // Deduplicated, background compiled pipelines
+#include "ThreadPool.h"                     // Workers for the pipeline registry
+#include "CommandRecorder.h"                // Parallel secondary command buffer recording
+#include "DrawList.h"                       // Per draw push constants
+#include "SpscQueue.h"                      // Lock-free event thread -> render thread queue
+#include "WindowEvent.h"                    // Messages carried by that queue
 
 // Declared here in order to avoid reimporting Vulkan libraries
 struct SwapChainSupportDetails
@@ -43,24 +80,56 @@ struct SwapChainSupportDetails
     }
 };
 
+// The variants one set of shaders is drawn with. The depth prepass draws depthOnly and then shades
+// with colorEqual, otherwise color does both at once
+struct DrawPipelines
+{
+    // MEMBERS
+    PipelineHandle                      color = INVALID_PIPELINE_HANDLE;
+    PipelineHandle                      depthOnly = INVALID_PIPELINE_HANDLE;    // Only requested for the prepass
+    PipelineHandle                      colorEqual = INVALID_PIPELINE_HANDLE;   //
+};
+
+// What a benchmark configuration measured over its timed frames, see measureConfiguration()
+struct BenchmarkMeasurement
+{
+    // MEMBERS
+    double                                  frameMs = 0.0;          // Wall clock per frame, GPU work included
+    std::vector<ProfileChannelStatistics>   channels;               // Over the timed frames only
+
+    // FUNCTIONS
+    ProfileChannelStatistics channel(const char* name) const
+    {
+        for (const ProfileChannelStatistics& statistics : channels)
+        {
+            if (statistics.name == name) return statistics;
+        }
+
+        return ProfileChannelStatistics{};
+    }
+};
+
 class HelloTriangleApplication
 {
 public:
     // CONSTRUCTOR/DESTRUCTOR
     //------------------------------------------------------------------------//
-    HelloTriangleApplication();
+    HelloTriangleApplication(const ApplicationSettings&);
     ~HelloTriangleApplication();
     //------------------------------------------------------------------------//
 
     // PUBLIC FUNCTIONS
     //------------------------------------------------------------------------//
     void run();
+    void reportFrameTimings(std::ostream&, ProfileReportFormat) const;
     //------------------------------------------------------------------------//
 
 private:
     // PRIVATE MEMBERS
     //------------------------------------------------------------------------//
+    ApplicationSettings                     m_settings;
     GLFWwindow*                             m_window;
+    HostAllocator                           m_hostAllocator;            // Passed to every Vulkan create/destroy call
     VkInstance                              m_instance;
     uint32_t                                m_glfwExtensionCount;
     bool                                    m_requiredGLFWExtensionsEstablished;
@@ -68,42 +137,101 @@ private:
     const std::vector<const char*>          m_validationLayers = {
         "VK_LAYER_KHRONOS_validation"
     };
-    const std::vector<const char*>          m_deviceExtensions = {
-        VK_KHR_SWAPCHAIN_EXTENSION_NAME
-    };
+    std::vector<const char*>                m_deviceExtensions;
     VkDebugUtilsMessengerEXT                m_debugMessenger;
     VkSurfaceKHR                            m_surface;
     VkPhysicalDevice                        m_physicalDevice;
     VkPhysicalDeviceProperties              m_physicalDeviceProperties;
     VkPhysicalDeviceFeatures                m_physicalDeviceFeatures;
+    VkPhysicalDeviceVulkan12Features        m_physicalDeviceVulkan12Features;
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR m_dynamicRenderingFeatures;
+    VkPhysicalDeviceSynchronization2FeaturesKHR m_synchronization2Features;
     VkDevice                                m_logicalDevice;
+    bool                                    m_dynamicRenderingSupported; // Its extensions are enabled on the device
+    bool                                    m_bindlessSupported;        // Descriptor indexing is enabled, the bindless table exists
+    bool                                    m_dynamicRendering;         // Render without render pass and framebuffer objects
+    PFN_vkCmdBeginRenderingKHR              m_cmdBeginRendering;        // Loaded when dynamic rendering is supported
+    PFN_vkCmdEndRenderingKHR                m_cmdEndRendering;          //
+    PFN_vkCmdPipelineBarrier2KHR            m_cmdPipelineBarrier2;      //
+    DeviceAllocator                         m_deviceAllocator;
     VkQueue                                 m_graphicsQueue;
     VkQueue                                 m_presentQueue;
+    VkQueue                                 m_transferQueue;            // The graphics queue if there is no transfer family
+    VkQueue                                 m_computeQueue;             // The graphics queue if there is no compute only family
+    StagingUploader                         m_stagingUploader;
+    FrameAllocator                          m_frameAllocator;
+    BindlessTable                           m_bindlessTable;
+    uint32_t                                m_frameConstantsOffset;     // This frame's FrameConstants in the frame allocator
+    GpuMesh                                 m_mesh;
+    InstanceField                           m_instanceField;            // Empty unless --instances was given
+    CullingPass                             m_cullingPass;
+    bool                                    m_cullingPassCreated;       // The device supports it and it was asked for
+    TextureStreamer                         m_textureStreamer;
+    std::vector<BindlessHandle>             m_frameTextures;            // Slot of every texture for the frame being recorded
+    MipGenerator                            m_mipGenerator;
+    const MipChain*                         m_mipBenchmarkChain;        // Regenerated every frame by --mip-benchmark, or null
+    MipGenerationMethod                     m_mipBenchmarkMethod;
+    VkImageLayout                           m_mipBenchmarkLayout;       // Of its level 0 when the next frame starts
+    ParticleSystem                          m_particleSystem;           // Empty unless --particles was given
+    bool                                    m_asyncParticles;           // Step it on the compute queue rather than in the frame
+    RenderGraph                             m_renderGraph;              // Rebuilt every frame: the compute passes, then the scene
+    bool                                    m_gpuDriven;                // Draw the draw list through the culling pass
+    bool                                    m_depthPrepass;             // Draw the draw list depth only before shading it
+    bool                                    m_overdrawScene;            // Shade the draw list with the overdraw benchmark's material
+    DrawCommand                             m_view;                     // Applied to everything drawn, and culled against
+    std::chrono::steady_clock::time_point   m_startTime;
     QueueFamilyIndices                      m_queueFamilyIndices;
     VkSwapchainKHR                          m_swapChain;
     std::vector<VkImage>                    m_swapChainImages;
     VkFormat                                m_swapChainImageFormat;
     VkExtent2D                              m_swapChainExtent;
     std::vector<VkImageView>                m_swapChainImageViews;
-    VkRenderPass                            m_renderPass;
+    VkSampleCountFlagBits                   m_sampleCount;              // Of the depth and colour attachments
+    VkFormat                                m_depthFormat;
+    VkImage                                 m_depthImage;               // Shared by every framebuffer, never stored
+    MemoryAllocation                        m_depthAllocation;          // Lazily allocated where the device has it
+    VkImageView                             m_depthImageView;
+    VkImage                                 m_colorImage;               // Multisampled, resolved into the swapchain image. Null without MSAA
+    MemoryAllocation                        m_colorAllocation;          // Lazily allocated where the device has it
+    VkImageView                             m_colorImageView;
+    std::vector<MemoryAllocation>           m_offscreenImageAllocations; // Headless only
+    uint32_t                                m_nextOffscreenImage;       // Headless only
+    VkRenderPass                            m_renderPass;               // Null with dynamic rendering
     VkPipelineLayout                        m_pipelineLayout;
-    VkPipeline                              m_graphicsPipeline;
-    std::vector<VkFramebuffer>              m_swapChainFramebuffers;
+    PipelineHandle                          m_trianglePipeline;
+    DrawPipelines                           m_drawListPipelines;
+    DrawPipelines                           m_meshPipelines[2];         // Indexed by VertexEncoding
+    DrawPipelines                           m_overdrawPipelines;        // --overdraw-benchmark only
+    PipelineHandle                          m_instancedPipeline;
+    PipelineHandle                          m_gpuDrivenPipeline;
+    PipelineHandle                          m_particlePipeline;
+    std::vector<DrawCommand>                m_drawList;
+    std::vector<VkFramebuffer>              m_swapChainFramebuffers;   // Empty with dynamic rendering
     VkCommandPool                           m_commandPool;
     std::vector<VkCommandBuffer>            m_commandBuffers;
-    VkSemaphore                             m_imageAvailableSemaphore;
-    VkSemaphore                             m_renderFinishedSemaphore;
-    std::vector<VkSemaphore>                m_imageAvailableSemaphores;
-    std::vector<VkSemaphore>                m_renderFinishedSemaphores;
-    size_t                                  m_currentFrame;
-    std::vector<VkFence>                    m_inFlightFences;
-    std::vector<VkFence>                    m_imagesInFlight;
-    bool                                    m_framebufferResized;
+    CommandRecorder                         m_commandRecorder;          // Secondaries for the draw list
+    FrameScheduler                          m_frameScheduler;
+    DeletionQueue                           m_deletionQueue;            // Resources retired by swapchain recreation
+    std::vector<std::function<void()>>      m_retiredSwapChains;        // Queued for deletion once the new swapchain hands out an image
+    PipelineCache                           m_pipelineCache;
+    ThreadPool                              m_threadPool;               // Background work, e.g. pipeline compiles
+    PipelineRegistry                        m_pipelineRegistry;
+    VkExtent2D                              m_framebufferExtent;        // Owned by the render thread once it starts
+    SpscQueue<WindowEvent, g_WINDOW_EVENT_QUEUE_CAPACITY> m_windowEvents; // Event thread -> render thread
+    std::thread                             m_renderThread;
+    std::atomic<bool>                       m_renderThreadRunning;
+    std::exception_ptr                      m_renderThreadError;
+    FrameProfiler                           m_frameProfiler;
+    GpuProfiler                             m_gpuProfiler;
     //------------------------------------------------------------------------//
 
     // PRIVATE FUNCTIONS
     //------------------------------------------------------------------------//
     void mainLoop();
+    void renderLoop();
+    void pushWindowEvent(const WindowEvent&);
+    void runResizeStorm();
+    void writeResizeStormSummary();
     void initWindow();
     void initVulkan();
     void createVkInstance();
@@ -114,6 +242,10 @@ private:
     void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT&);
     void createSurface();
     void selectPhysicalDevice();
+    void queryPhysicalDeviceFeatures(VkPhysicalDevice);
+    bool bindlessIsSupported() const;       // Of the features last queried
+    bool dynamicRenderingIsSupported() const; //
+    bool deviceExtensionIsAvailable(VkPhysicalDevice, const char*);
     void scorePhysicalDevice(
         VkPhysicalDevice&, 
         std::multimap<int, VkPhysicalDevice>&
@@ -122,6 +254,21 @@ private:
     QueueFamilyIndices findQueueFamilies(VkPhysicalDevice&);
     void createLogicalDevice();
     void getDeviceQueue();
+    void createDeviceAllocator();
+    void createStagingUploader();
+    void createFrameAllocator();
+    void createBindlessTable();
+    void createMeshBuffers();
+    void uploadMesh(GpuMesh&, const void* vertices, VkDeviceSize vertexBytes, const uint32_t* indices, VkDeviceSize indexBytes);
+    void createInstanceField();
+    void createCullingPass();
+    void createTextureStreamer();
+    void createMipGenerator();
+    void createParticleSystem();
+    void createRenderGraph();
+    void createGpuProfiler();
+    void createPipelineCache();
+    void createPipelineRegistry();
     SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice);
     VkSurfaceFormatKHR chooseSwapSurfaceFormat(
         const std::vector<VkSurfaceFormatKHR>&
@@ -130,15 +277,45 @@ private:
         const std::vector<VkPresentModeKHR>&
     );
     VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR&);
-    void createSwapChain();
+    void createSwapChain(VkSwapchainKHR oldSwapChain);
+    void createOffscreenImages();
     void createImageViews();
+    VkSampleCountFlagBits chooseSampleCount(uint32_t requested) const;
+    void createAttachmentImages();
+    void createTransientAttachment(VkFormat, VkImageUsageFlags, VkImageAspectFlags, VkImage&, MemoryAllocation&, VkImageView&);
+    void destroyAttachmentImages();
+    VkImageAspectFlags depthAspects() const;
+    void rebuildRenderTargets();
+    void setSampleCount(VkSampleCountFlagBits);
+    void setDynamicRendering(bool);
     void createRenderPass();
     void createGraphicsPipeline();
+    DrawPipelines requestDrawPipelines(const PipelineDescription&);
     void createFrameBuffers();
-    VkShaderModule createShaderModule(const std::vector<char>&);
     void createCommandPool();
     void createCommandBuffers();
+    void recordCommandBuffer(VkCommandBuffer, uint32_t slot, uint32_t imageIndex);
+    void recordDraws(VkCommandBuffer, VkPipeline, VkPipeline depthPipeline, bool useMesh, uint32_t begin, uint32_t end);
+    void recordInstancedDraw(VkCommandBuffer, VkPipeline, uint32_t slot);
+    void recordGpuDrivenDraws(VkCommandBuffer, VkPipeline);
+    void recordParticleDraw(VkCommandBuffer);
+    void setPipelineState(VkCommandBuffer, VkPipeline);
+    void beginRendering(VkCommandBuffer, uint32_t imageIndex, VkSubpassContents);
+    void endRendering(VkCommandBuffer);
     void drawFrame();
+    void drawOffscreenFrame();
+    void runHeadless();
+    BenchmarkMeasurement measureConfiguration(uint32_t warmupFrames, uint32_t frames);
+    void runRecordBenchmark();
+    void runCullBenchmark();
+    void runVertexBenchmark();
+    void runMipBenchmark();
+    void runParticleBenchmark();
+    void runOverdrawBenchmark();
+    void runMsaaBenchmark();
+    void runRenderingBenchmark();
+    void runRenderGraphBenchmark();
+    void writeExitReport();
     void createSynchronizationObjects();
     void recreateSwapChain();
     void destructSwapChain();
@@ -165,7 +342,7 @@ private:
         const VkDebugUtilsMessengerCallbackDataEXT*,
         void*
     );
-    static std::vector<char> readFile(const std::string&);
     static void framebufferResizeCallback(GLFWwindow*, int, int);
+    static void keyCallback(GLFWwindow*, int, int, int, int);
     //------------------------------------------------------------------------//
 };
\ No newline at end of file
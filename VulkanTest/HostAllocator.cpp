@@ -0,0 +1,284 @@
+#include "HostAllocator.h"
+
+#include <algorithm>                        // std::max, std::min
+#include <cstdlib>                          // malloc, free
+#include <cstring>                          // memcpy
+#include <memory>                           // Per thread arena storage
+
+namespace
+{
+    struct Arena;
+
+    // In front of every allocation, so a free or reallocation knows where the memory came from
+    // and how large it was
+    struct AllocationHeader
+    {
+        void*                               base;       // What malloc returned, heap only
+        Arena*                              arena;      // Null for heap allocations
+        size_t                              size;
+        VkSystemAllocationScope             scope;
+    };
+
+    // Bump allocator for command scope allocations. Only its thread allocates from it, but the
+    // live count is atomic in case the driver frees on another thread
+    struct Arena
+    {
+        std::unique_ptr<unsigned char[]>    memory;
+        size_t                              head;
+        std::atomic<uint32_t>               liveAllocations;
+    };
+
+    thread_local std::unique_ptr<Arena> t_arena;
+
+    uintptr_t alignUp(uintptr_t value, size_t alignment)
+    {
+        return (value + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+    }
+
+    AllocationHeader* headerOf(void* memory)
+    {
+        return reinterpret_cast<AllocationHeader*>(memory) - 1;
+    }
+
+    // The arena of the calling thread, rewound if nothing in it is live
+    Arena& callingThreadArena()
+    {
+        if (!t_arena)
+        {
+            t_arena = std::make_unique<Arena>();
+            t_arena->memory = std::make_unique<unsigned char[]>(g_HOST_ARENA_SIZE);
+            t_arena->head = 0;
+            t_arena->liveAllocations.store(0, std::memory_order_relaxed);
+        }
+
+        if (t_arena->liveAllocations.load(std::memory_order_acquire) == 0) t_arena->head = 0;
+
+        return *t_arena;
+    }
+}
+
+HostAllocator::HostAllocator()
+{
+    m_callbacks = {};
+    m_callbacks.pUserData = this;
+    m_callbacks.pfnAllocation = allocationCallback;
+    m_callbacks.pfnReallocation = reallocationCallback;
+    m_callbacks.pfnFree = freeCallback;
+    m_callbacks.pfnInternalAllocation = internalAllocationCallback;
+    m_callbacks.pfnInternalFree = internalFreeCallback;
+
+    for (Scope& scope : m_scopes)
+    {
+        scope.allocations.store(0, std::memory_order_relaxed);
+        scope.liveAllocations.store(0, std::memory_order_relaxed);
+        scope.liveBytes.store(0, std::memory_order_relaxed);
+        scope.peakBytes.store(0, std::memory_order_relaxed);
+        scope.internalBytes.store(0, std::memory_order_relaxed);
+    }
+
+    m_arenaAllocations.store(0, std::memory_order_relaxed);
+    m_arenaOverflows.store(0, std::memory_order_relaxed);
+    m_publishedAllocations = 0;
+    m_frameProfiler = nullptr;
+
+    for (uint32_t i = 0; i < GaugeCount; i++) m_gauges[i] = 0;
+}
+
+void HostAllocator::create(FrameProfiler& frameProfiler)
+{
+    m_frameProfiler = &frameProfiler;
+
+    m_gauges[CommandBytesGauge] = frameProfiler.registerGauge("host.command_bytes");
+    m_gauges[ObjectBytesGauge] = frameProfiler.registerGauge("host.object_bytes");
+    m_gauges[CacheBytesGauge] = frameProfiler.registerGauge("host.cache_bytes");
+    m_gauges[DeviceBytesGauge] = frameProfiler.registerGauge("host.device_bytes");
+    m_gauges[InstanceBytesGauge] = frameProfiler.registerGauge("host.instance_bytes");
+    m_gauges[FrameAllocationsGauge] = frameProfiler.registerGauge("host.allocations_per_frame");
+    m_gauges[ArenaOverflowsGauge] = frameProfiler.registerGauge("host.arena_overflows");
+}
+
+const VkAllocationCallbacks* HostAllocator::callbacks() const
+{
+    return &m_callbacks;
+}
+
+HostAllocationStatistics HostAllocator::statistics(VkSystemAllocationScope scope) const
+{
+    const Scope& counters = m_scopes[scope];
+
+    HostAllocationStatistics statistics;
+    statistics.allocations = counters.allocations.load(std::memory_order_relaxed);
+    statistics.liveAllocations = counters.liveAllocations.load(std::memory_order_relaxed);
+    statistics.liveBytes = counters.liveBytes.load(std::memory_order_relaxed);
+    statistics.peakBytes = counters.peakBytes.load(std::memory_order_relaxed);
+    statistics.internalBytes = counters.internalBytes.load(std::memory_order_relaxed);
+
+    return statistics;
+}
+
+uint64_t HostAllocator::arenaAllocations() const
+{
+    return m_arenaAllocations.load(std::memory_order_relaxed);
+}
+
+uint64_t HostAllocator::arenaOverflows() const
+{
+    return m_arenaOverflows.load(std::memory_order_relaxed);
+}
+
+void HostAllocator::publishStatistics()
+{
+    if (m_frameProfiler == nullptr) return;
+
+    uint64_t allocations = 0;
+
+    for (uint32_t scope = 0; scope < SCOPE_COUNT; scope++)
+    {
+        allocations += m_scopes[scope].allocations.load(std::memory_order_relaxed);
+        m_frameProfiler->setGauge(m_gauges[CommandBytesGauge + scope], static_cast<double>(m_scopes[scope].liveBytes.load(std::memory_order_relaxed)));
+    }
+
+    m_frameProfiler->setGauge(m_gauges[FrameAllocationsGauge], static_cast<double>(allocations - m_publishedAllocations));
+    m_frameProfiler->setGauge(m_gauges[ArenaOverflowsGauge], static_cast<double>(arenaOverflows()));
+
+    m_publishedAllocations = allocations;
+}
+
+void* HostAllocator::allocate(size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+    if (size == 0) return nullptr;
+
+    // The header sits right in front of the returned memory, which must keep it aligned too
+    alignment = std::max(alignment, alignof(AllocationHeader));
+
+    void* memory = nullptr;
+    Arena* arena = nullptr;
+    void* base = nullptr;
+
+    if (scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND)
+    {
+        Arena& threadArena = callingThreadArena();
+
+        uintptr_t start = reinterpret_cast<uintptr_t>(threadArena.memory.get());
+        uintptr_t address = alignUp(start + threadArena.head + sizeof(AllocationHeader), alignment);
+
+        if (address + size <= start + g_HOST_ARENA_SIZE)
+        {
+            threadArena.head = address + size - start;
+            threadArena.liveAllocations.fetch_add(1, std::memory_order_relaxed);
+
+            memory = reinterpret_cast<void*>(address);
+            arena = &threadArena;
+
+            m_arenaAllocations.fetch_add(1, std::memory_order_relaxed);
+        }
+        else
+        {
+            m_arenaOverflows.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    if (memory == nullptr)
+    {
+        base = malloc(size + alignment - 1 + sizeof(AllocationHeader));
+        if (base == nullptr) return nullptr;
+
+        memory = reinterpret_cast<void*>(alignUp(reinterpret_cast<uintptr_t>(base) + sizeof(AllocationHeader), alignment));
+    }
+
+    AllocationHeader* header = headerOf(memory);
+    header->base = base;
+    header->arena = arena;
+    header->size = size;
+    header->scope = scope;
+
+    countAllocation(scope, size);
+
+    return memory;
+}
+
+void* HostAllocator::reallocate(void* original, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+    if (original == nullptr) return allocate(size, alignment, scope);
+
+    if (size == 0)
+    {
+        free(original);
+        return nullptr;
+    }
+
+    // On failure the original must stay intact
+    void* memory = allocate(size, alignment, scope);
+    if (memory == nullptr) return nullptr;
+
+    memcpy(memory, original, std::min(size, headerOf(original)->size));
+    free(original);
+
+    return memory;
+}
+
+void HostAllocator::free(void* memory)
+{
+    if (memory == nullptr) return;
+
+    AllocationHeader* header = headerOf(memory);
+    countFree(header->scope, header->size);
+
+    // Arena memory is reclaimed as a whole once nothing in the arena is live
+    if (header->arena != nullptr)
+    {
+        header->arena->liveAllocations.fetch_sub(1, std::memory_order_release);
+    }
+    else
+    {
+        ::free(header->base);
+    }
+}
+
+void HostAllocator::countAllocation(VkSystemAllocationScope scope, size_t size)
+{
+    Scope& counters = m_scopes[scope];
+
+    counters.allocations.fetch_add(1, std::memory_order_relaxed);
+    counters.liveAllocations.fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t live = counters.liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+    uint64_t peak = counters.peakBytes.load(std::memory_order_relaxed);
+
+    while (live > peak && !counters.peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+    {
+    }
+}
+
+void HostAllocator::countFree(VkSystemAllocationScope scope, size_t size)
+{
+    Scope& counters = m_scopes[scope];
+
+    counters.liveAllocations.fetch_sub(1, std::memory_order_relaxed);
+    counters.liveBytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+void* VKAPI_CALL HostAllocator::allocationCallback(void* userData, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+    return static_cast<HostAllocator*>(userData)->allocate(size, alignment, scope);
+}
+
+void* VKAPI_CALL HostAllocator::reallocationCallback(void* userData, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+    return static_cast<HostAllocator*>(userData)->reallocate(original, size, alignment, scope);
+}
+
+void VKAPI_CALL HostAllocator::freeCallback(void* userData, void* memory)
+{
+    static_cast<HostAllocator*>(userData)->free(memory);
+}
+
+void VKAPI_CALL HostAllocator::internalAllocationCallback(void* userData, size_t size, VkInternalAllocationType, VkSystemAllocationScope scope)
+{
+    static_cast<HostAllocator*>(userData)->m_scopes[scope].internalBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+void VKAPI_CALL HostAllocator::internalFreeCallback(void* userData, size_t size, VkInternalAllocationType, VkSystemAllocationScope scope)
+{
+    static_cast<HostAllocator*>(userData)->m_scopes[scope].internalBytes.fetch_sub(size, std::memory_order_relaxed);
+}
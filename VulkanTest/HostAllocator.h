@@ -0,0 +1,101 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "GlobalApplicationConstants.h"     // g_HOST_ARENA_SIZE
+#include "FrameProfiler.h"                  // Host memory gauges
+
+// Host memory the driver has taken through HostAllocator within one VkSystemAllocationScope
+struct HostAllocationStatistics
+{
+    uint64_t            allocations;            // Allocation and reallocation calls, ever
+    uint64_t            liveAllocations;
+    uint64_t            liveBytes;
+    uint64_t            peakBytes;
+    uint64_t            internalBytes;          // Allocated by the driver itself and only reported to us
+};
+
+// VkAllocationCallbacks for every Vulkan object the application creates, so the driver's host
+// allocations are counted per VkSystemAllocationScope instead of disappearing into malloc.
+// Command scope allocations live only for the duration of a single Vulkan call, so they are bump
+// allocated from an arena per thread which rewinds whenever it is empty. Anything larger than
+// what is left of the arena falls back to the heap.
+//
+// Thread safe, the driver calls back from whichever thread makes the Vulkan call. Statistics are
+// published as host.* gauges on the FrameProfiler by publishStatistics(), which also reports how
+// many allocations were made since its last call, i.e. the churn of one frame.
+class HostAllocator
+{
+public:
+    static const uint32_t SCOPE_COUNT = VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1;
+
+    // CONSTRUCTOR
+    //------------------------------------------------------------------------//
+    HostAllocator();
+    //------------------------------------------------------------------------//
+
+    // PUBLIC FUNCTIONS
+    //------------------------------------------------------------------------//
+    void create(FrameProfiler&);
+
+    // Pass to every vkCreate*, vkAllocateMemory and their matching destroy/free call
+    const VkAllocationCallbacks* callbacks() const;
+
+    HostAllocationStatistics statistics(VkSystemAllocationScope) const;
+    uint64_t arenaAllocations() const;
+    uint64_t arenaOverflows() const;          // Command scope allocations that went to the heap
+
+    void publishStatistics();
+    //------------------------------------------------------------------------//
+
+private:
+    struct Scope
+    {
+        std::atomic<uint64_t>               allocations;
+        std::atomic<uint64_t>               liveAllocations;
+        std::atomic<uint64_t>               liveBytes;
+        std::atomic<uint64_t>               peakBytes;
+        std::atomic<uint64_t>               internalBytes;
+    };
+
+    enum Gauge
+    {
+        CommandBytesGauge,
+        ObjectBytesGauge,
+        CacheBytesGauge,
+        DeviceBytesGauge,
+        InstanceBytesGauge,
+        FrameAllocationsGauge,
+        ArenaOverflowsGauge,
+        GaugeCount
+    };
+
+    // PRIVATE MEMBERS
+    //------------------------------------------------------------------------//
+    VkAllocationCallbacks                   m_callbacks;
+    Scope                                   m_scopes[SCOPE_COUNT];
+    std::atomic<uint64_t>                   m_arenaAllocations;
+    std::atomic<uint64_t>                   m_arenaOverflows;
+    uint64_t                                m_publishedAllocations;     // Total at the last publishStatistics()
+    FrameProfiler*                          m_frameProfiler;
+    uint32_t                                m_gauges[GaugeCount];
+    //------------------------------------------------------------------------//
+
+    // PRIVATE FUNCTIONS
+    //------------------------------------------------------------------------//
+    void* allocate(size_t size, size_t alignment, VkSystemAllocationScope);
+    void* reallocate(void* original, size_t size, size_t alignment, VkSystemAllocationScope);
+    void free(void* memory);
+    void countAllocation(VkSystemAllocationScope, size_t size);
+    void countFree(VkSystemAllocationScope, size_t size);
+
+    static void* VKAPI_CALL allocationCallback(void* userData, size_t size, size_t alignment, VkSystemAllocationScope);
+    static void* VKAPI_CALL reallocationCallback(void* userData, void* original, size_t size, size_t alignment, VkSystemAllocationScope);
+    static void VKAPI_CALL freeCallback(void* userData, void* memory);
+    static void VKAPI_CALL internalAllocationCallback(void* userData, size_t size, VkInternalAllocationType, VkSystemAllocationScope);
+    static void VKAPI_CALL internalFreeCallback(void* userData, size_t size, VkInternalAllocationType, VkSystemAllocationScope);
+    //------------------------------------------------------------------------//
+};
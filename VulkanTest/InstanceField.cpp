@@ -0,0 +1,241 @@
+#include "InstanceField.h"
+
+#include <algorithm>                        // std::min, std::max
+#include <cmath>                            // std::ceil, std::sqrt
+#include <random>                           // Initial state
+#include <stdexcept>                        // Error reporting
+
+// SSE2 is part of every x86-64 target, other architectures take the scalar loops
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define INSTANCE_FIELD_SSE2
+#include <emmintrin.h>                      // SSE2 intrinsics
+#endif
+
+namespace
+{
+    const float PI = 3.14159265358979f;
+
+    // A long stall (a breakpoint, a minimized window) must not fling everything off screen, and
+    // the rotation wrap below relies on a step never turning more than a full circle
+    const float MAX_TIME_STEP = 0.1f;
+
+    // Moves x by v * dt, reflecting off the edges of clip space
+    void integrateBounceScalar(float& x, float& v, float dt)
+    {
+        x += v * dt;
+
+        if (x > 1.0f || x < -1.0f)
+        {
+            v = -v;
+            x = std::min(std::max(x, -1.0f), 1.0f);
+        }
+    }
+
+    // Turns a by s * dt, keeping it within [-pi, pi] so precision does not drain away over time
+    void integrateRotationScalar(float& a, float s, float dt)
+    {
+        a += s * dt;
+
+        if (a > PI) a -= 2.0f * PI;
+        if (a < -PI) a += 2.0f * PI;
+    }
+
+    void integrateBounce(float* position, float* velocity, float* out, uint32_t count, float dt)
+    {
+        uint32_t i = 0;
+
+#ifdef INSTANCE_FIELD_SSE2
+        const __m128 step = _mm_set1_ps(dt);
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 minusOne = _mm_set1_ps(-1.0f);
+        const __m128 signBit = _mm_set1_ps(-0.0f);
+
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 x = _mm_loadu_ps(position + i);
+            __m128 v = _mm_loadu_ps(velocity + i);
+
+            x = _mm_add_ps(x, _mm_mul_ps(v, step));
+
+            // Flip the velocity's sign in the lanes that left [-1, 1], then pull them back in
+            __m128 outside = _mm_cmpgt_ps(_mm_andnot_ps(signBit, x), one);
+            v = _mm_xor_ps(v, _mm_and_ps(outside, signBit));
+            x = _mm_min_ps(_mm_max_ps(x, minusOne), one);
+
+            _mm_storeu_ps(position + i, x);
+            _mm_storeu_ps(velocity + i, v);
+            _mm_storeu_ps(out + i, x);
+        }
+#endif
+
+        for (; i < count; i++)
+        {
+            integrateBounceScalar(position[i], velocity[i], dt);
+            out[i] = position[i];
+        }
+    }
+
+    void integrateRotation(float* rotation, const float* spin, float* out, uint32_t count, float dt)
+    {
+        uint32_t i = 0;
+
+#ifdef INSTANCE_FIELD_SSE2
+        const __m128 step = _mm_set1_ps(dt);
+        const __m128 pi = _mm_set1_ps(PI);
+        const __m128 minusPi = _mm_set1_ps(-PI);
+        const __m128 fullTurn = _mm_set1_ps(2.0f * PI);
+
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 a = _mm_loadu_ps(rotation + i);
+            __m128 s = _mm_loadu_ps(spin + i);
+
+            a = _mm_add_ps(a, _mm_mul_ps(s, step));
+            a = _mm_sub_ps(a, _mm_and_ps(_mm_cmpgt_ps(a, pi), fullTurn));
+            a = _mm_add_ps(a, _mm_and_ps(_mm_cmplt_ps(a, minusPi), fullTurn));
+
+            _mm_storeu_ps(rotation + i, a);
+            _mm_storeu_ps(out + i, a);
+        }
+#endif
+
+        for (; i < count; i++)
+        {
+            integrateRotationScalar(rotation[i], spin[i], dt);
+            out[i] = rotation[i];
+        }
+    }
+}
+
+InstanceField::InstanceField()
+{
+    m_allocator = nullptr;
+    m_frameProfiler = nullptr;
+    m_updateChannel = 0;
+    m_instanceCount = 0;
+}
+
+void InstanceField::create(DeviceAllocator& allocator, FrameProfiler& frameProfiler, uint32_t instanceCount, uint32_t slotCount)
+{
+    if (instanceCount == 0)
+    {
+        throw std::runtime_error("An instance field needs at least one instance");
+    }
+
+    m_allocator = &allocator;
+    m_frameProfiler = &frameProfiler;
+    m_updateChannel = frameProfiler.registerChannel("cpu.instance_update");
+    m_instanceCount = instanceCount;
+
+    // Fixed seed, so runs with the same count are comparable
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    m_positionX.resize(instanceCount);
+    m_positionY.resize(instanceCount);
+    m_velocityX.resize(instanceCount);
+    m_velocityY.resize(instanceCount);
+    m_rotation.resize(instanceCount);
+    m_spin.resize(instanceCount);
+
+    std::vector<uint32_t> colors(instanceCount);
+
+    for (uint32_t i = 0; i < instanceCount; i++)
+    {
+        m_positionX[i] = unit(random);
+        m_positionY[i] = unit(random);
+        m_velocityX[i] = 0.25f * unit(random);
+        m_velocityY[i] = 0.25f * unit(random);
+        m_rotation[i] = PI * unit(random);
+        m_spin[i] = 2.0f * unit(random);
+
+        // RGBA8 unorm, red in the lowest byte
+        uint32_t r = static_cast<uint32_t>(127.5f + 127.5f * unit(random));
+        uint32_t g = static_cast<uint32_t>(127.5f + 127.5f * unit(random));
+        uint32_t b = static_cast<uint32_t>(127.5f + 127.5f * unit(random));
+        colors[i] = r | (g << 8) | (b << 16) | (0xFFu << 24);
+    }
+
+    // Host visible so the CPU can write each frame's transforms in place. One buffer per slot
+    // keeps each allocation well below maxMemoryAllocationSize even with millions of instances
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = static_cast<VkDeviceSize>(instanceCount) * 4 * InstanceStreamCount;
+    bufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    m_slots.resize(slotCount);
+
+    for (uint32_t slot = 0; slot < slotCount; slot++)
+    {
+        m_slots[slot].buffer = VK_NULL_HANDLE;
+        allocator.createBuffer(bufferInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_slots[slot].buffer, m_slots[slot].allocation);
+
+        // Every slot starts out with the initial state, so a slot drawn before its first update
+        // still shows something sensible
+        std::copy(m_positionX.begin(), m_positionX.end(), static_cast<float*>(streamPointer(slot, InstancePositionX)));
+        std::copy(m_positionY.begin(), m_positionY.end(), static_cast<float*>(streamPointer(slot, InstancePositionY)));
+        std::copy(m_rotation.begin(), m_rotation.end(), static_cast<float*>(streamPointer(slot, InstanceRotation)));
+        std::copy(colors.begin(), colors.end(), static_cast<uint32_t*>(streamPointer(slot, InstanceColor)));
+    }
+
+    m_lastUpdate = std::chrono::steady_clock::now();
+}
+
+void InstanceField::destruct()
+{
+    for (auto& slot : m_slots)
+    {
+        m_allocator->destroyBuffer(slot.buffer, slot.allocation);
+    }
+
+    m_slots.clear();
+    m_instanceCount = 0;
+}
+
+void InstanceField::update(uint32_t slot)
+{
+    if (m_instanceCount == 0) return;
+
+    FrameProfiler::Scope scope(*m_frameProfiler, m_updateChannel);
+
+    auto now = std::chrono::steady_clock::now();
+    float dt = std::min(std::chrono::duration<float>(now - m_lastUpdate).count(), MAX_TIME_STEP);
+    m_lastUpdate = now;
+
+    integrateBounce(m_positionX.data(), m_velocityX.data(), static_cast<float*>(streamPointer(slot, InstancePositionX)), m_instanceCount, dt);
+    integrateBounce(m_positionY.data(), m_velocityY.data(), static_cast<float*>(streamPointer(slot, InstancePositionY)), m_instanceCount, dt);
+    integrateRotation(m_rotation.data(), m_spin.data(), static_cast<float*>(streamPointer(slot, InstanceRotation)), m_instanceCount, dt);
+}
+
+void InstanceField::bind(VkCommandBuffer commandBuffer, uint32_t slot) const
+{
+    VkBuffer buffers[InstanceStreamCount];
+    VkDeviceSize offsets[InstanceStreamCount];
+
+    for (uint32_t stream = 0; stream < InstanceStreamCount; stream++)
+    {
+        buffers[stream] = m_slots[slot].buffer;
+        offsets[stream] = static_cast<VkDeviceSize>(m_instanceCount) * 4 * stream;
+    }
+
+    vkCmdBindVertexBuffers(commandBuffer, 1, InstanceStreamCount, buffers, offsets);
+}
+
+uint32_t InstanceField::instanceCount() const
+{
+    return m_instanceCount;
+}
+
+float InstanceField::instanceScale() const
+{
+    // As if the instances were tiled over clip space like the draw list's grid
+    float columns = std::ceil(std::sqrt(static_cast<float>(std::max(m_instanceCount, 1u))));
+    return 2.0f / columns;
+}
+
+void* InstanceField::streamPointer(uint32_t slot, InstanceStream stream) const
+{
+    // Every stream element is four bytes
+    return static_cast<char*>(m_slots[slot].allocation.mapped) + static_cast<size_t>(m_instanceCount) * 4 * stream;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <chrono>                           // Time step between updates
+#include <cstdint>
+#include <vector>
+
+#include "DeviceAllocator.h"                // Per slot instance buffers
+#include "FrameProfiler.h"                  // Update cost
+#include "Vertex.h"                         // InstanceStream
+
+// A field of instances drifting and spinning around clip space, for stressing vertex throughput
+// with a single instanced draw. The simulation state is kept on the CPU as structure of arrays
+// and advanced every frame by SIMD kernels, which write the transforms straight into a
+// persistently mapped buffer per frame slot. The buffer holds one tightly packed array per
+// InstanceStream, matching the instance bindings of VertexFormat::PositionColorInstanced.
+//
+// Colours never change, so they are written into every slot's buffer once at creation.
+//
+// Render thread only.
+class InstanceField
+{
+public:
+    // CONSTRUCTOR
+    //------------------------------------------------------------------------//
+    InstanceField();
+    //------------------------------------------------------------------------//
+
+    // PUBLIC FUNCTIONS
+    //------------------------------------------------------------------------//
+    void create(DeviceAllocator&, FrameProfiler&, uint32_t instanceCount, uint32_t slotCount);
+    void destruct();
+
+    // Advances the simulation by the time since the last update and writes the result into the
+    // slot's buffer. The frame that last read that buffer must be complete
+    void update(uint32_t slot);
+
+    // Binds the slot's streams to bindings 1 to InstanceStreamCount, after the mesh's vertices
+    void bind(VkCommandBuffer, uint32_t slot) const;
+
+    uint32_t instanceCount() const;
+    float instanceScale() const;            // Mesh scale that keeps the instances from overlapping much
+    //------------------------------------------------------------------------//
+
+private:
+    struct SlotBuffer
+    {
+        VkBuffer                            buffer;
+        MemoryAllocation                    allocation;
+    };
+
+    // PRIVATE MEMBERS
+    //------------------------------------------------------------------------//
+    DeviceAllocator*                        m_allocator;
+    FrameProfiler*                          m_frameProfiler;
+    uint32_t                                m_updateChannel;
+    uint32_t                                m_instanceCount;
+    std::vector<SlotBuffer>                 m_slots;
+    std::vector<float>                      m_positionX;            // Simulation state, CPU only.
+    std::vector<float>                      m_positionY;            // Mapped memory is write
+    std::vector<float>                      m_velocityX;            // combined on many devices and
+    std::vector<float>                      m_velocityY;            // must never be read back
+    std::vector<float>                      m_rotation;
+    std::vector<float>                      m_spin;
+    std::chrono::steady_clock::time_point   m_lastUpdate;
+    //------------------------------------------------------------------------//
+
+    // PRIVATE FUNCTIONS
+    //------------------------------------------------------------------------//
+    void* streamPointer(uint32_t slot, InstanceStream) const;
+    //------------------------------------------------------------------------//
+};
@@ -0,0 +1,85 @@
+#include "Ktx2File.h"
+
+#include <algorithm>                        // std::max
+#include <cstring>                          // memcmp
+#include <stdexcept>                        // Error reporting
+#include <string>
+
+namespace
+{
+    const uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+}
+
+uint32_t Ktx2View::levelWidth(uint32_t level) const
+{
+    return std::max(1u, width >> level);
+}
+
+uint32_t Ktx2View::levelHeight(uint32_t level) const
+{
+    return std::max(1u, height >> level);
+}
+
+Ktx2View parseKtx2File(const void* data, size_t size)
+{
+    if (size < sizeof(Ktx2Header))
+    {
+        throw std::runtime_error("KTX2 file is too small for its header");
+    }
+
+    const Ktx2Header& header = *static_cast<const Ktx2Header*>(data);
+
+    if (memcmp(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+    {
+        throw std::runtime_error("Not a KTX2 file");
+    }
+
+    if (header.vkFormat == VK_FORMAT_UNDEFINED || header.supercompressionScheme != 0)
+    {
+        throw std::runtime_error("Supercompressed (Basis Universal) KTX2 files need transcoding and are not supported");
+    }
+
+    if (header.pixelWidth == 0 || header.pixelHeight == 0 || header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1)
+    {
+        throw std::runtime_error("Only single 2D KTX2 images are supported");
+    }
+
+    // A level count of 0 stores level 0 alone, the loader generates the rest
+    bool generateMips = header.levelCount == 0;
+    uint32_t levelCount = generateMips ? 1 : header.levelCount;
+
+    if (levelCount > KTX2_MAX_LEVELS || (std::max(header.pixelWidth, header.pixelHeight) >> (levelCount - 1)) == 0)
+    {
+        throw std::runtime_error("KTX2 file has an unsupported level count " + std::to_string(header.levelCount));
+    }
+
+    if ((size - sizeof(Ktx2Header)) / sizeof(Ktx2LevelIndex) < levelCount)
+    {
+        throw std::runtime_error("KTX2 file is truncated in its level index");
+    }
+
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    const Ktx2LevelIndex* levels = reinterpret_cast<const Ktx2LevelIndex*>(bytes + sizeof(Ktx2Header));
+
+    Ktx2View view;
+    view.format = static_cast<VkFormat>(header.vkFormat);
+    view.width = header.pixelWidth;
+    view.height = header.pixelHeight;
+    view.levelCount = levelCount;
+    view.generateMips = generateMips;
+
+    for (uint32_t level = 0; level < levelCount; level++)
+    {
+        const Ktx2LevelIndex& index = levels[level];
+
+        if (index.byteLength == 0 || index.byteOffset > size || index.byteLength > size - index.byteOffset)
+        {
+            throw std::runtime_error("KTX2 level " + std::to_string(level) + " lies outside the file");
+        }
+
+        view.levels[level] = bytes + index.byteOffset;
+        view.levelBytes[level] = static_cast<size_t>(index.byteLength);
+    }
+
+    return view;
+}
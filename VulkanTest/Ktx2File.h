@@ -0,0 +1,64 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <cstdint>
+
+// KTX 2.0 texture container, read in place from a memory mapping. Only what can be uploaded as is
+// is accepted: a single 2D image (no array layers, cube faces or depth) in a concrete vkFormat
+// without supercompression. Basis Universal files (vkFormat undefined, or BasisLZ/zstd
+// supercompression) need a transcoder first and are rejected. A level count of 0 is accepted as
+// level 0 alone, with generateMips set for the loader to fill in the rest.
+//
+// All fields are little endian, which is every platform this renders on.
+const uint32_t KTX2_MAX_LEVELS = 16;
+
+struct Ktx2Header
+{
+    uint8_t     identifier[12];
+    uint32_t    vkFormat;
+    uint32_t    typeSize;
+    uint32_t    pixelWidth;
+    uint32_t    pixelHeight;
+    uint32_t    pixelDepth;
+    uint32_t    layerCount;
+    uint32_t    faceCount;
+    uint32_t    levelCount;                         // 0 stores level 0 only and asks the loader to generate mips
+    uint32_t    supercompressionScheme;
+    uint32_t    dfdByteOffset;
+    uint32_t    dfdByteLength;
+    uint32_t    kvdByteOffset;
+    uint32_t    kvdByteLength;
+    uint64_t    sgdByteOffset;
+    uint64_t    sgdByteLength;
+};
+
+// Follows the header, one per mip level with level 0 the largest
+struct Ktx2LevelIndex
+{
+    uint64_t    byteOffset;                         // From the start of the file
+    uint64_t    byteLength;
+    uint64_t    uncompressedByteLength;
+};
+
+static_assert(sizeof(Ktx2Header) == 80, "Ktx2Header must match the on-disk layout");
+static_assert(sizeof(Ktx2LevelIndex) == 24, "Ktx2LevelIndex must match the on-disk layout");
+
+// Pointers into a mapped file, valid for as long as the mapping is
+struct Ktx2View
+{
+    VkFormat                    format = VK_FORMAT_UNDEFINED;
+    uint32_t                    width = 0;
+    uint32_t                    height = 0;
+    uint32_t                    levelCount = 0;             // Stored levels, 1 when generateMips is set
+    bool                        generateMips = false;       // The file asks for the rest of the chain
+    const unsigned char*        levels[KTX2_MAX_LEVELS] = {};
+    size_t                      levelBytes[KTX2_MAX_LEVELS] = {};
+
+    uint32_t levelWidth(uint32_t level) const;
+    uint32_t levelHeight(uint32_t level) const;
+};
+
+// Validates the header and that every level lies within the file. Throws std::runtime_error for
+// anything malformed or unsupported
+Ktx2View parseKtx2File(const void* data, size_t size);
@@ -0,0 +1,164 @@
+#include "MappedFile.h"
+
+#include <stdexcept>                        // Error reporting
+#include <utility>                          // std::swap
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>                        // CreateFileMapping, MapViewOfFile
+#else
+#include <fcntl.h>                          // open
+#include <sys/mman.h>                       // mmap, madvise
+#include <sys/stat.h>                       // fstat
+#include <unistd.h>                         // close
+#endif
+
+MappedFile::MappedFile()
+{
+    m_data = nullptr;
+    m_size = 0;
+#ifdef _WIN32
+    m_file = nullptr;
+    m_mapping = nullptr;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : MappedFile()
+{
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    std::swap(m_data, other.m_data);
+    std::swap(m_size, other.m_size);
+#ifdef _WIN32
+    std::swap(m_file, other.m_file);
+    std::swap(m_mapping, other.m_mapping);
+#endif
+
+    return *this;
+}
+
+#ifdef _WIN32
+
+void MappedFile::open(const std::string& path)
+{
+    close();
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        throw std::runtime_error("Failed to open " + path);
+    }
+
+    LARGE_INTEGER fileSize;
+
+    if (!GetFileSizeEx(file, &fileSize))
+    {
+        CloseHandle(file);
+        throw std::runtime_error("Failed to query the size of " + path);
+    }
+
+    m_file = file;
+    m_size = static_cast<size_t>(fileSize.QuadPart);
+
+    // Mapping an empty file fails, there is nothing to map anyway
+    if (m_size == 0) return;
+
+    m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    m_data = m_mapping != nullptr ? MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+
+    if (m_data == nullptr)
+    {
+        close();
+        throw std::runtime_error("Failed to map " + path);
+    }
+}
+
+void MappedFile::close()
+{
+    if (m_data != nullptr) UnmapViewOfFile(m_data);
+    if (m_mapping != nullptr) CloseHandle(m_mapping);
+    if (m_file != nullptr) CloseHandle(m_file);
+
+    m_data = nullptr;
+    m_size = 0;
+    m_file = nullptr;
+    m_mapping = nullptr;
+}
+
+#else
+
+void MappedFile::open(const std::string& path)
+{
+    close();
+
+    int file = ::open(path.c_str(), O_RDONLY);
+
+    if (file < 0)
+    {
+        throw std::runtime_error("Failed to open " + path);
+    }
+
+    struct stat status;
+
+    if (fstat(file, &status) != 0)
+    {
+        ::close(file);
+        throw std::runtime_error("Failed to query the size of " + path);
+    }
+
+    size_t size = static_cast<size_t>(status.st_size);
+
+    // mmap rejects a zero length, there is nothing to map anyway
+    if (size == 0)
+    {
+        ::close(file);
+        return;
+    }
+
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+
+    // The mapping keeps its own reference to the file
+    ::close(file);
+
+    if (data == MAP_FAILED)
+    {
+        throw std::runtime_error("Failed to map " + path);
+    }
+
+    // Assets are read front to back once, so read ahead aggressively
+    madvise(data, size, MADV_SEQUENTIAL);
+
+    m_data = data;
+    m_size = size;
+}
+
+void MappedFile::close()
+{
+    if (m_data != nullptr) munmap(m_data, m_size);
+
+    m_data = nullptr;
+    m_size = 0;
+}
+
+#endif
+
+const void* MappedFile::data() const
+{
+    return m_data;
+}
+
+size_t MappedFile::size() const
+{
+    return m_size;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file. Pages are faulted in from the page cache as they are
+// touched and never count against the heap, so large assets can be copied straight out of the
+// mapping without an intermediate buffer.
+//
+// Move only. Any thread may read the mapping, open() and close() are not synchronized.
+class MappedFile
+{
+public:
+    // CONSTRUCTOR
+    //------------------------------------------------------------------------//
+    MappedFile();
+    ~MappedFile();
+    MappedFile(MappedFile&&) noexcept;
+    MappedFile& operator=(MappedFile&&) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    //------------------------------------------------------------------------//
+
+    // PUBLIC FUNCTIONS
+    //------------------------------------------------------------------------//
+    // Throws std::runtime_error if the file cannot be opened or mapped. An empty file maps to
+    // nullptr with size 0
+    void open(const std::string& path);
+    void close();
+
+    const void* data() const;
+    size_t size() const;
+    //------------------------------------------------------------------------//
+
+private:
+    // PRIVATE MEMBERS
+    //------------------------------------------------------------------------//
+    void*                                   m_data;
+    size_t                                  m_size;
+#ifdef _WIN32
+    void*                                   m_file;                 // HANDLEs, kept opaque so that
+    void*                                   m_mapping;              // windows.h stays out of here
+#endif
+    //------------------------------------------------------------------------//
+};
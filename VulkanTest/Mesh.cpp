@@ -0,0 +1,140 @@
+#include "Mesh.h"
+
+#include <algorithm>                        // std::min, std::max
+#include <limits>                           // std::numeric_limits
+#include <cmath>                            // std::sqrt, std::lround, std::abs
+
+#include "GlobalApplicationConstants.h"     // g_MIN_QUANTIZED_EDGE_STEPS
+
+MeshData buildTriangleMesh()
+{
+    MeshData mesh;
+
+    mesh.vertices = {
+        { {  0.0f, -0.5f }, { 1.0f, 0.0f, 0.0f } },
+        { {  0.5f,  0.5f }, { 0.0f, 1.0f, 0.0f } },
+        { { -0.5f,  0.5f }, { 0.0f, 0.0f, 1.0f } }
+    };
+
+    mesh.indices = { 0, 1, 2 };
+
+    return mesh;
+}
+
+MeshData buildGridMesh(uint32_t cells)
+{
+    MeshData mesh;
+    uint32_t rowLength = cells + 1;
+
+    mesh.vertices.reserve(static_cast<size_t>(rowLength) * rowLength);
+    mesh.indices.reserve(static_cast<size_t>(cells) * cells * 6);
+
+    for (uint32_t y = 0; y < rowLength; y++)
+    {
+        for (uint32_t x = 0; x < rowLength; x++)
+        {
+            float u = static_cast<float>(x) / cells;
+            float v = static_cast<float>(y) / cells;
+
+            mesh.vertices.push_back({ { u - 0.5f, v - 0.5f }, { u, v, 1.0f - u } });
+        }
+    }
+
+    // Clockwise in Vulkan's downward clip space, matching the pipelines' front face
+    for (uint32_t y = 0; y < cells; y++)
+    {
+        for (uint32_t x = 0; x < cells; x++)
+        {
+            uint32_t topLeft = y * rowLength + x;
+            uint32_t bottomLeft = topLeft + rowLength;
+
+            mesh.indices.insert(mesh.indices.end(), { topLeft, topLeft + 1, bottomLeft + 1 });
+            mesh.indices.insert(mesh.indices.end(), { topLeft, bottomLeft + 1, bottomLeft });
+        }
+    }
+
+    return mesh;
+}
+
+float MeshData::boundingRadius() const
+{
+    float radiusSquared = 0.0f;
+
+    for (const Vertex& vertex : vertices)
+    {
+        float x = vertex.position[0];
+        float y = vertex.position[1];
+        radiusSquared = std::max(radiusSquared, x * x + y * y);
+    }
+
+    return std::sqrt(radiusSquared);
+}
+
+float MeshData::positionQuantizationScale() const
+{
+    float scale = 0.0f;
+
+    for (const Vertex& vertex : vertices)
+    {
+        scale = std::max(scale, std::max(std::abs(vertex.position[0]), std::abs(vertex.position[1])));
+    }
+
+    // A mesh collapsed onto the origin still needs a usable scale
+    return scale > 0.0f ? scale : 1.0f;
+}
+
+VertexEncoding MeshData::preferredEncoding() const
+{
+    // Quantization moves a vertex by up to half a step on each axis. Edges spanning fewer than
+    // g_MIN_QUANTIZED_EDGE_STEPS steps would visibly distort (or collapse) their triangles
+    float step = positionQuantizationScale() / 32767.0f;
+    float minEdgeSquared = std::numeric_limits<float>::max();
+
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        for (size_t corner = 0; corner < 3; corner++)
+        {
+            const Vertex& a = vertices[indices[i + corner]];
+            const Vertex& b = vertices[indices[i + (corner + 1) % 3]];
+
+            float dx = a.position[0] - b.position[0];
+            float dy = a.position[1] - b.position[1];
+            float lengthSquared = dx * dx + dy * dy;
+
+            // Degenerate edges stay degenerate, they say nothing about precision
+            if (lengthSquared > 0.0f) minEdgeSquared = std::min(minEdgeSquared, lengthSquared);
+        }
+    }
+
+    float minEdgeSteps = g_MIN_QUANTIZED_EDGE_STEPS * step;
+
+    return minEdgeSquared >= minEdgeSteps * minEdgeSteps ? VertexEncoding::Quantized : VertexEncoding::Float;
+}
+
+std::vector<PackedVertex> MeshData::quantizedVertices(float positionScale) const
+{
+    std::vector<PackedVertex> packed(vertices.size());
+
+    auto snorm16 = [positionScale](float value) {
+        float normalized = std::min(std::max(value / positionScale, -1.0f), 1.0f);
+        return static_cast<int16_t>(std::lround(normalized * 32767.0f));
+    };
+
+    auto unorm8 = [](float value) {
+        return static_cast<uint8_t>(std::lround(std::min(std::max(value, 0.0f), 1.0f) * 255.0f));
+    };
+
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        const Vertex& vertex = vertices[i];
+
+        packed[i].position[0] = snorm16(vertex.position[0]);
+        packed[i].position[1] = snorm16(vertex.position[1]);
+        packed[i].color[0] = unorm8(vertex.color[0]);
+        packed[i].color[1] = unorm8(vertex.color[1]);
+        packed[i].color[2] = unorm8(vertex.color[2]);
+        packed[i].color[3] = 255;
+    }
+
+    return packed;
+}
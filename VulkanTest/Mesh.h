@@ -0,0 +1,63 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "Vertex.h"
+#include "DeviceAllocator.h"                // MemoryAllocation
+#include "StagingUploader.h"                // UploadTicket
+
+// Geometry on the CPU side, ready to be uploaded
+struct MeshData
+{
+    std::vector<Vertex>         vertices;
+    std::vector<uint32_t>       indices;
+
+    // Distance of the furthest vertex from the origin
+    float boundingRadius() const;
+
+    // Largest absolute coordinate on either axis, which quantized positions are relative to
+    float positionQuantizationScale() const;
+
+    // Quantized, unless snorm16 steps would be a noticeable fraction of the shortest edge
+    VertexEncoding preferredEncoding() const;
+
+    std::vector<PackedVertex> quantizedVertices(float positionScale) const;
+};
+
+// Push constants following the DrawCommand, set once for the mesh bound to binding 0
+struct MeshConstants
+{
+    float                       positionScale;
+};
+
+// Index range of one level of detail
+struct MeshLod
+{
+    uint32_t                    firstIndex;
+    uint32_t                    indexCount;
+    int32_t                     vertexOffset;
+};
+
+// Geometry in device local buffers. Only usable for drawing once the graphics queue has acquired
+// it, see StagingUploader::isReady
+struct GpuMesh
+{
+    VkBuffer                    vertexBuffer = VK_NULL_HANDLE;
+    MemoryAllocation            vertexAllocation;
+    VkBuffer                    indexBuffer = VK_NULL_HANDLE;
+    MemoryAllocation            indexAllocation;
+    uint32_t                    indexCount = 0;                     // LOD 0's, which starts the index buffer
+    float                       boundingRadius = 0.0f;
+    VertexEncoding              encoding = VertexEncoding::Float;
+    float                       positionScale = 1.0f;               // Dequantizes PackedVertex positions
+    UploadTicket                upload = 0;                         // Last of the mesh's uploads
+    std::vector<MeshLod>        lods;                               // Most detailed first
+};
+
+// The triangle the shaders used to hardcode, as real geometry
+MeshData buildTriangleMesh();
+
+// A square of cells x cells quads filling [-0.5, 0.5], for vertex throughput tests
+MeshData buildGridMesh(uint32_t cells);
@@ -0,0 +1,89 @@
+#include "MeshFile.h"
+
+#include <stdexcept>                        // Error reporting
+#include <string>
+
+// Whether [offset, offset + count * elementSize) lies within a file of fileSize bytes, without
+// overflowing on hostile values
+static bool rangeFits(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t fileSize)
+{
+    if (offset > fileSize || offset % MESH_FILE_ALIGNMENT != 0) return false;
+
+    return count <= (fileSize - offset) / elementSize;
+}
+
+size_t MeshFileView::vertexBytes() const
+{
+    return static_cast<size_t>(header->vertexCount * header->vertexStride);
+}
+
+size_t MeshFileView::indexBytes() const
+{
+    return static_cast<size_t>(header->indexCount * sizeof(uint32_t));
+}
+
+uint64_t alignMeshFileOffset(uint64_t offset)
+{
+    return (offset + MESH_FILE_ALIGNMENT - 1) & ~static_cast<uint64_t>(MESH_FILE_ALIGNMENT - 1);
+}
+
+MeshFileView parseMeshFile(const void* data, size_t size)
+{
+    if (size < sizeof(MeshFileHeader))
+    {
+        throw std::runtime_error("Mesh file is too small for its header");
+    }
+
+    MeshFileView view;
+    view.header = static_cast<const MeshFileHeader*>(data);
+
+    const MeshFileHeader& header = *view.header;
+
+    if (header.magic != MESH_FILE_MAGIC)
+    {
+        throw std::runtime_error("Not a mesh file");
+    }
+
+    if (header.version != MESH_FILE_VERSION)
+    {
+        throw std::runtime_error("Unsupported mesh file version " + std::to_string(header.version));
+    }
+
+    bool knownEncoding = 
+        (header.vertexEncoding == static_cast<uint32_t>(VertexEncoding::Float) && header.vertexStride == sizeof(Vertex)) || 
+        (header.vertexEncoding == static_cast<uint32_t>(VertexEncoding::Quantized) && header.vertexStride == sizeof(PackedVertex));
+
+    if (!knownEncoding || !(header.positionScale > 0.0f))
+    {
+        throw std::runtime_error("Mesh file vertex encoding " + std::to_string(header.vertexEncoding) + " is not supported");
+    }
+
+    if (header.vertexCount == 0 || header.indexCount == 0 || header.lodCount == 0)
+    {
+        throw std::runtime_error("Mesh file holds no geometry");
+    }
+
+    if (!rangeFits(header.lodOffset, header.lodCount, sizeof(MeshFileLod), size) ||
+        !rangeFits(header.vertexOffset, header.vertexCount, header.vertexStride, size) ||
+        !rangeFits(header.indexOffset, header.indexCount, sizeof(uint32_t), size))
+    {
+        throw std::runtime_error("Mesh file is truncated or its offsets are misaligned");
+    }
+
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    view.lods = reinterpret_cast<const MeshFileLod*>(bytes + header.lodOffset);
+    view.vertices = bytes + header.vertexOffset;
+    view.indices = reinterpret_cast<const uint32_t*>(bytes + header.indexOffset);
+
+    for (uint32_t i = 0; i < header.lodCount; i++)
+    {
+        const MeshFileLod& lod = view.lods[i];
+
+        if (lod.indexCount == 0 || lod.firstIndex > header.indexCount || lod.indexCount > header.indexCount - lod.firstIndex)
+        {
+            throw std::runtime_error("Mesh file LOD " + std::to_string(i) + " lies outside the index blob");
+        }
+    }
+
+    return view;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "Vertex.h"                         // Vertex and PackedVertex, stored as they are
+
+// Binary mesh container (.vmesh), written by MeshConverter and read in place from a memory
+// mapping. The file is a header followed by the LOD table, the vertex blob and the index blob,
+// each starting on a MESH_FILE_ALIGNMENT boundary so the blobs can be handed to the staging
+// uploader straight from the mapping. Every LOD indexes the shared vertex blob.
+//
+// All fields are little endian, which is every platform this renders on.
+const uint32_t MESH_FILE_MAGIC = 0x48534D56;        // "VMSH"
+const uint32_t MESH_FILE_VERSION = 2;
+const uint32_t MESH_FILE_ALIGNMENT = 16;
+
+struct MeshFileHeader
+{
+    uint32_t    magic;
+    uint32_t    version;
+    uint32_t    vertexEncoding;                     // VertexEncoding, Vertex or PackedVertex
+    uint32_t    vertexStride;
+    uint64_t    vertexOffset;                       // Byte offsets from the start of the file
+    uint64_t    vertexCount;
+    uint64_t    indexOffset;                        // uint32_t indices
+    uint64_t    indexCount;
+    uint64_t    lodOffset;
+    uint32_t    lodCount;
+    float       boundingRadius;                     // Distance of the furthest vertex from the origin
+    float       boundsMin[2];
+    float       boundsMax[2];
+    float       positionScale;                      // Dequantizes PackedVertex positions, 1 for Vertex
+    uint32_t    reserved;
+};
+
+// Index range of one level of detail, LOD 0 being the most detailed
+struct MeshFileLod
+{
+    uint32_t    firstIndex;
+    uint32_t    indexCount;
+    int32_t     vertexOffset;                       // Added to every index of the range
+    uint32_t    reserved;
+};
+
+static_assert(sizeof(MeshFileHeader) == 88, "MeshFileHeader must match the on-disk layout");
+static_assert(sizeof(MeshFileLod) == 16, "MeshFileLod must match the on-disk layout");
+
+// Pointers into a mapped file, valid for as long as the mapping is
+struct MeshFileView
+{
+    const MeshFileHeader*       header = nullptr;
+    const MeshFileLod*          lods = nullptr;
+    const void*                 vertices = nullptr;
+    const uint32_t*             indices = nullptr;
+
+    size_t vertexBytes() const;
+    size_t indexBytes() const;
+};
+
+// Validates the header and that every blob and LOD range lies within the file. Throws
+// std::runtime_error for anything malformed. Index values themselves are not checked, that would
+// mean touching every page of the index blob
+MeshFileView parseMeshFile(const void* data, size_t size);
+
+// Rounds an offset up to the next MESH_FILE_ALIGNMENT boundary
+uint64_t alignMeshFileOffset(uint64_t offset);
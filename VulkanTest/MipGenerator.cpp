@@ -0,0 +1,460 @@
+#include "MipGenerator.h"
+
+#include <algorithm>                        // std::max
+#include <stdexcept>                        // Error reporting
+#include <string>
+
+namespace
+{
+    // Level 0 texels per workgroup and dimension, matches the tile reduced by mipgen.comp
+    const uint32_t MIPGEN_TILE_SIZE = 64;
+
+    const uint32_t SOURCE_BINDING = 0;
+    const uint32_t LEVELS_BINDING = 1;
+    const uint32_t COUNTER_BINDING = 2;
+
+    uint32_t levelSize(uint32_t size, uint32_t level)
+    {
+        return std::max(1u, size >> level);
+    }
+}
+
+MipGenerator::MipGenerator()
+{
+    m_physicalDevice = VK_NULL_HANDLE;
+    m_device = VK_NULL_HANDLE;
+    m_allocationCallbacks = nullptr;
+    m_allocator = nullptr;
+    m_pipelineRegistry = nullptr;
+    m_computeSupported = false;
+    m_descriptorSetLayout = VK_NULL_HANDLE;
+    m_descriptorPool = VK_NULL_HANDLE;
+    m_pipelineLayout = VK_NULL_HANDLE;
+    m_pipeline = INVALID_PIPELINE_HANDLE;
+    m_counterBuffer = VK_NULL_HANDLE;
+}
+
+void MipGenerator::create(VkPhysicalDevice physicalDevice, VkDevice device, const VkAllocationCallbacks* allocationCallbacks, DeviceAllocator& allocator, PipelineRegistry& pipelineRegistry)
+{
+    m_physicalDevice = physicalDevice;
+    m_device = device;
+    m_allocationCallbacks = allocationCallbacks;
+    m_allocator = &allocator;
+    m_pipelineRegistry = &pipelineRegistry;
+
+    // createLogicalDevice() enables every core feature the device has, so support is enough
+    VkPhysicalDeviceFeatures features;
+    vkGetPhysicalDeviceFeatures(m_physicalDevice, &features);
+
+    VkPhysicalDeviceSubgroupProperties subgroupProperties{};
+    subgroupProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES;
+
+    VkPhysicalDeviceProperties2 properties{};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &subgroupProperties;
+    vkGetPhysicalDeviceProperties2(m_physicalDevice, &properties);
+
+    m_computeSupported =
+        features.shaderStorageImageReadWithoutFormat &&
+        features.shaderStorageImageWriteWithoutFormat &&
+        features.shaderStorageImageArrayDynamicIndexing &&
+        (subgroupProperties.supportedStages & VK_SHADER_STAGE_COMPUTE_BIT) &&
+        (subgroupProperties.supportedOperations & VK_SUBGROUP_FEATURE_QUAD_BIT) &&
+        subgroupProperties.subgroupSize >= 4;
+
+    if (!m_computeSupported) return;
+
+    // Level 0, the levels below it and the workgroup counters, in mipgen.comp's binding order
+    VkDescriptorSetLayoutBinding bindings[3]{};
+    bindings[SOURCE_BINDING].binding = SOURCE_BINDING;
+    bindings[SOURCE_BINDING].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    bindings[SOURCE_BINDING].descriptorCount = 1;
+    bindings[SOURCE_BINDING].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    bindings[LEVELS_BINDING].binding = LEVELS_BINDING;
+    bindings[LEVELS_BINDING].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    bindings[LEVELS_BINDING].descriptorCount = g_MIPGEN_MAX_LEVELS - 1;
+    bindings[LEVELS_BINDING].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    bindings[COUNTER_BINDING].binding = COUNTER_BINDING;
+    bindings[COUNTER_BINDING].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[COUNTER_BINDING].descriptorCount = 1;
+    bindings[COUNTER_BINDING].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 3;
+    layoutInfo.pBindings = bindings;
+
+    if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, m_allocationCallbacks, &m_descriptorSetLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create mip generation descriptor set layout");
+    }
+
+    VkDescriptorPoolSize poolSizes[2]{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    poolSizes[0].descriptorCount = g_MIPGEN_MAX_CHAINS * g_MIPGEN_MAX_LEVELS;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[1].descriptorCount = g_MIPGEN_MAX_CHAINS;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+    poolInfo.maxSets = g_MIPGEN_MAX_CHAINS;
+    poolInfo.poolSizeCount = 2;
+    poolInfo.pPoolSizes = poolSizes;
+
+    if (vkCreateDescriptorPool(m_device, &poolInfo, m_allocationCallbacks, &m_descriptorPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create mip generation descriptor pool");
+    }
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(MipConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &m_descriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, m_allocationCallbacks, &m_pipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create mip generation pipeline layout");
+    }
+
+    // Zeroed before every dispatch that uses one
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = sizeof(uint32_t) * g_MIPGEN_MAX_CHAINS;
+    bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    m_allocator->createBuffer(bufferInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_counterBuffer, m_counterAllocation);
+
+    for (uint32_t counter = g_MIPGEN_MAX_CHAINS; counter-- > 0;)
+    {
+        m_freeCounters.push_back(counter);
+    }
+
+    PipelineDescription description;
+    description.computeShader = "shaders/mipgen.spv";
+    description.layout = m_pipelineLayout;
+
+    m_pipeline = pipelineRegistry.request(description);
+}
+
+void MipGenerator::destruct()
+{
+    // The registry owns the pipeline itself and outlives this
+    if (m_counterBuffer != VK_NULL_HANDLE) m_allocator->destroyBuffer(m_counterBuffer, m_counterAllocation);
+    if (m_pipelineLayout != VK_NULL_HANDLE) vkDestroyPipelineLayout(m_device, m_pipelineLayout, m_allocationCallbacks);
+    if (m_descriptorPool != VK_NULL_HANDLE) vkDestroyDescriptorPool(m_device, m_descriptorPool, m_allocationCallbacks);
+    if (m_descriptorSetLayout != VK_NULL_HANDLE) vkDestroyDescriptorSetLayout(m_device, m_descriptorSetLayout, m_allocationCallbacks);
+
+    m_counterBuffer = VK_NULL_HANDLE;
+    m_pipelineLayout = VK_NULL_HANDLE;
+    m_descriptorPool = VK_NULL_HANDLE;
+    m_descriptorSetLayout = VK_NULL_HANDLE;
+    m_freeCounters.clear();
+}
+
+MipChain MipGenerator::createChain(VkImage image, VkFormat format, VkExtent2D extent, uint32_t levelCount)
+{
+    MipChain chain;
+    chain.image = image;
+    chain.format = format;
+    chain.extent = extent;
+    chain.levelCount = levelCount;
+
+    if (levelCount < 2)
+    {
+        throw std::runtime_error("A mip chain needs at least two levels");
+    }
+
+    bool compute = m_computeSupported &&
+                   levelCount <= g_MIPGEN_MAX_LEVELS &&
+                   formatSupports(format, VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT) &&
+                   !m_freeCounters.empty();
+
+    if (!compute)
+    {
+        if (!supports(chain, MipGenerationMethod::Blit))
+        {
+            throw std::runtime_error("Format " + std::to_string(format) + " supports neither compute nor blit mip generation");
+        }
+
+        return chain;
+    }
+
+    for (uint32_t level = 0; level < levelCount; level++)
+    {
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = format;
+        viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1 };
+
+        VkImageView view;
+
+        if (vkCreateImageView(m_device, &viewInfo, m_allocationCallbacks, &view) != VK_SUCCESS)
+        {
+            destroyChain(chain);
+            throw std::runtime_error("Failed to create mip level view");
+        }
+
+        chain.levelViews.push_back(view);
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_descriptorSetLayout;
+
+    if (vkAllocateDescriptorSets(m_device, &allocInfo, &chain.descriptorSet) != VK_SUCCESS)
+    {
+        destroyChain(chain);
+        throw std::runtime_error("Failed to allocate mip generation descriptor set");
+    }
+
+    chain.counter = m_freeCounters.back();
+    m_freeCounters.pop_back();
+
+    // Array elements past the last level are never accessed, but must still be valid
+    VkDescriptorImageInfo imageInfos[g_MIPGEN_MAX_LEVELS]{};
+
+    for (uint32_t level = 0; level < g_MIPGEN_MAX_LEVELS; level++)
+    {
+        imageInfos[level].imageView = chain.levelViews[std::min(level, levelCount - 1)];
+        imageInfos[level].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    }
+
+    VkDescriptorBufferInfo counterInfo = { m_counterBuffer, 0, VK_WHOLE_SIZE };
+
+    VkWriteDescriptorSet writes[3]{};
+    writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[0].dstSet = chain.descriptorSet;
+    writes[0].dstBinding = SOURCE_BINDING;
+    writes[0].descriptorCount = 1;
+    writes[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    writes[0].pImageInfo = &imageInfos[0];
+
+    writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[1].dstSet = chain.descriptorSet;
+    writes[1].dstBinding = LEVELS_BINDING;
+    writes[1].descriptorCount = g_MIPGEN_MAX_LEVELS - 1;
+    writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    writes[1].pImageInfo = &imageInfos[1];
+
+    writes[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[2].dstSet = chain.descriptorSet;
+    writes[2].dstBinding = COUNTER_BINDING;
+    writes[2].descriptorCount = 1;
+    writes[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writes[2].pBufferInfo = &counterInfo;
+
+    vkUpdateDescriptorSets(m_device, 3, writes, 0, nullptr);
+
+    return chain;
+}
+
+void MipGenerator::destroyChain(MipChain& chain)
+{
+    for (VkImageView view : chain.levelViews)
+    {
+        vkDestroyImageView(m_device, view, m_allocationCallbacks);
+    }
+
+    if (chain.descriptorSet != VK_NULL_HANDLE)
+    {
+        vkFreeDescriptorSets(m_device, m_descriptorPool, 1, &chain.descriptorSet);
+        m_freeCounters.push_back(chain.counter);
+    }
+
+    chain = MipChain();
+}
+
+VkImageUsageFlags MipGenerator::imageUsage(VkFormat format) const
+{
+    if (!formatSupports(format, VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT))
+    {
+        return 0;
+    }
+
+    VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+    if (m_computeSupported && formatSupports(format, VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT))
+    {
+        usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+    }
+
+    return usage;
+}
+
+MipGenerationMethod MipGenerator::preferredMethod(const MipChain& chain) const
+{
+    return supports(chain, MipGenerationMethod::Compute) ? MipGenerationMethod::Compute : MipGenerationMethod::Blit;
+}
+
+bool MipGenerator::supports(const MipChain& chain, MipGenerationMethod method) const
+{
+    if (method == MipGenerationMethod::Compute)
+    {
+        return chain.descriptorSet != VK_NULL_HANDLE;
+    }
+
+    return formatSupports(chain.format, VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT);
+}
+
+bool MipGenerator::isReady() const
+{
+    return m_pipeline != INVALID_PIPELINE_HANDLE && m_pipelineRegistry->get(m_pipeline) != VK_NULL_HANDLE;
+}
+
+void MipGenerator::record(
+    VkCommandBuffer         commandBuffer,
+    const MipChain&         chain,
+    MipGenerationMethod     method,
+    VkImageLayout           level0Layout,
+    VkPipelineStageFlags    srcStage,
+    VkAccessFlags           srcAccess,
+    VkPipelineStageFlags    dstStage)
+{
+    if (!supports(chain, method) || (method == MipGenerationMethod::Compute && !isReady()))
+    {
+        throw std::runtime_error(std::string(method == MipGenerationMethod::Compute ? "Compute" : "Blit") + " mip generation is not available for this image");
+    }
+
+    if (method == MipGenerationMethod::Compute)
+    {
+        recordCompute(commandBuffer, chain, level0Layout, srcStage, srcAccess, dstStage);
+    }
+    else
+    {
+        recordBlit(commandBuffer, chain, level0Layout, srcStage, srcAccess, dstStage);
+    }
+}
+
+void MipGenerator::recordCompute(VkCommandBuffer commandBuffer, const MipChain& chain, VkImageLayout level0Layout, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage)
+{
+    vkCmdFillBuffer(commandBuffer, m_counterBuffer, sizeof(uint32_t) * chain.counter, sizeof(uint32_t), 0);
+
+    // One barrier for everything in front of the dispatch: level 0 becomes readable, the other
+    // levels writable, and the counter is zeroed
+    VkImageMemoryBarrier barriers[2]{};
+    barriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barriers[0].srcAccessMask = srcAccess;
+    barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barriers[0].oldLayout = level0Layout;
+    barriers[0].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[0].image = chain.image;
+    barriers[0].subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+    barriers[1] = barriers[0];
+    barriers[1].srcAccessMask = 0;
+    barriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barriers[1].subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 1, chain.levelCount - 1, 0, 1 };
+
+    VkBufferMemoryBarrier counterBarrier{};
+    counterBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    counterBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    counterBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    counterBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    counterBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    counterBarrier.buffer = m_counterBuffer;
+    counterBarrier.offset = sizeof(uint32_t) * chain.counter;
+    counterBarrier.size = sizeof(uint32_t);
+
+    vkCmdPipelineBarrier(commandBuffer, srcStage | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 1, &counterBarrier, 2, barriers);
+
+    uint32_t groupCountX = (chain.extent.width + MIPGEN_TILE_SIZE - 1) / MIPGEN_TILE_SIZE;
+    uint32_t groupCountY = (chain.extent.height + MIPGEN_TILE_SIZE - 1) / MIPGEN_TILE_SIZE;
+
+    MipConstants constants;
+    constants.mipCount = chain.levelCount - 1;
+    constants.workgroupCount = groupCountX * groupCountY;
+    constants.counter = chain.counter;
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineRegistry->get(m_pipeline));
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &chain.descriptorSet, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(MipConstants), &constants);
+    vkCmdDispatch(commandBuffer, groupCountX, groupCountY, 1);
+
+    VkImageMemoryBarrier toShaderRead = barriers[0];
+    toShaderRead.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    toShaderRead.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    toShaderRead.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+    toShaderRead.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    toShaderRead.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, chain.levelCount, 0, 1 };
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, dstStage, 0, 0, nullptr, 0, nullptr, 1, &toShaderRead);
+}
+
+void MipGenerator::recordBlit(VkCommandBuffer commandBuffer, const MipChain& chain, VkImageLayout level0Layout, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage)
+{
+    VkImageMemoryBarrier barriers[2]{};
+    barriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barriers[0].srcAccessMask = srcAccess;
+    barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barriers[0].oldLayout = level0Layout;
+    barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[0].image = chain.image;
+    barriers[0].subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+    barriers[1] = barriers[0];
+    barriers[1].srcAccessMask = 0;
+    barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barriers[1].subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 1, chain.levelCount - 1, 0, 1 };
+
+    vkCmdPipelineBarrier(commandBuffer, srcStage, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 2, barriers);
+
+    // Each level is read by the next blit, so the transfer stage drains once per level
+    for (uint32_t level = 1; level < chain.levelCount; level++)
+    {
+        VkImageBlit blit{};
+        blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1 };
+        blit.srcOffsets[1] = { static_cast<int32_t>(levelSize(chain.extent.width, level - 1)), static_cast<int32_t>(levelSize(chain.extent.height, level - 1)), 1 };
+        blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+        blit.dstOffsets[1] = { static_cast<int32_t>(levelSize(chain.extent.width, level)), static_cast<int32_t>(levelSize(chain.extent.height, level)), 1 };
+
+        vkCmdBlitImage(commandBuffer, chain.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, chain.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+        VkImageMemoryBarrier toSource = barriers[1];
+        toSource.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        toSource.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        toSource.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        toSource.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        toSource.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1 };
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &toSource);
+    }
+
+    VkImageMemoryBarrier toShaderRead = barriers[0];
+    toShaderRead.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    toShaderRead.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    toShaderRead.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    toShaderRead.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    toShaderRead.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, chain.levelCount, 0, 1 };
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0, 0, nullptr, 0, nullptr, 1, &toShaderRead);
+}
+
+bool MipGenerator::formatSupports(VkFormat format, VkFormatFeatureFlags requiredFeatures) const
+{
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(m_physicalDevice, format, &formatProperties);
+
+    return (formatProperties.optimalTilingFeatures & requiredFeatures) == requiredFeatures;
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "GlobalApplicationConstants.h"     // g_MIPGEN_* limits
+#include "DeviceAllocator.h"                // The workgroup counters
+#include "PipelineRegistry.h"               // The downsampling compute pipeline
+
+enum class MipGenerationMethod
+{
+    Compute,                                                        // Single dispatch, mipgen.comp
+    Blit                                                            // vkCmdBlitImage level by level
+};
+
+// An image registered with the MipGenerator, with one storage view per level for the compute path
+struct MipChain
+{
+    VkImage                             image = VK_NULL_HANDLE;
+    VkFormat                            format = VK_FORMAT_UNDEFINED;
+    VkExtent2D                          extent = { 0, 0 };
+    uint32_t                            levelCount = 0;
+    std::vector<VkImageView>            levelViews;                 // Empty unless compute can run on it
+    VkDescriptorSet                     descriptorSet = VK_NULL_HANDLE;
+    uint32_t                            counter = 0;                // Slot in the workgroup counter buffer
+};
+
+// Fills levels 1 and up of an image from level 0.
+//
+// The compute path does it in one dispatch, after AMD's single pass downsampler: each workgroup
+// reduces a 64x64 tile of level 0 down to one texel of level 6, going through subgroup quad
+// shuffles and shared memory rather than memory between levels. The last workgroup to finish,
+// found with an atomic counter, then writes the levels past 6 from level 6. There are no barriers
+// between levels and the GPU never drains between them, where a blit chain needs one per level.
+//
+// It needs subgroup quad operations in compute, storage images that load and store without a
+// format, dynamically indexed storage image arrays, and a format with storage image support. Any
+// other image falls back to the blit chain, which needs linear filtered blits of its format.
+//
+// Images need STORAGE usage for the compute path and TRANSFER_SRC and TRANSFER_DST for the blit
+// chain, imageUsage() says which. TextureStreamer generates the chains of textures whose files only
+// hold level 0, --mip-benchmark compares the two paths. Render thread only.
+class MipGenerator
+{
+public:
+    // CONSTRUCTOR
+    //------------------------------------------------------------------------//
+    MipGenerator();
+    //------------------------------------------------------------------------//
+
+    // PUBLIC FUNCTIONS
+    //------------------------------------------------------------------------//
+    void create(VkPhysicalDevice, VkDevice, const VkAllocationCallbacks*, DeviceAllocator&, PipelineRegistry&);
+    void destruct();
+
+    // Throws std::runtime_error when neither path can handle the image, or more than
+    // g_MIPGEN_MAX_CHAINS chains would exist at once
+    MipChain createChain(VkImage, VkFormat, VkExtent2D, uint32_t levelCount);
+
+    // Nothing in flight may still use the chain
+    void destroyChain(MipChain&);
+
+    // Usage an image of this format needs for createChain() to always succeed: the blit chain's,
+    // plus STORAGE where compute can run on it. 0 when the format cannot be blitted, as compute
+    // chains may run out
+    VkImageUsageFlags imageUsage(VkFormat) const;
+
+    // Compute if the chain supports it, the blit chain otherwise
+    MipGenerationMethod preferredMethod(const MipChain&) const;
+    bool supports(const MipChain&, MipGenerationMethod) const;
+
+    // The compute pipeline has been compiled. Until then record() has to blit
+    bool isReady() const;
+
+    // Outside a render pass. Level 0 is in level0Layout, last written at srcStage/srcAccess
+    // (UNDEFINED discards it, which only benchmarks want). Every level ends up in
+    // SHADER_READ_ONLY_OPTIMAL, visible to dstStage
+    void record(
+        VkCommandBuffer,
+        const MipChain&,
+        MipGenerationMethod,
+        VkImageLayout level0Layout,
+        VkPipelineStageFlags srcStage,
+        VkAccessFlags srcAccess,
+        VkPipelineStageFlags dstStage
+    );
+    //------------------------------------------------------------------------//
+
+private:
+    // Matches MipConstants in mipgen.comp
+    struct MipConstants
+    {
+        uint32_t                            mipCount;
+        uint32_t                            workgroupCount;
+        uint32_t                            counter;
+    };
+
+    // PRIVATE MEMBERS
+    //------------------------------------------------------------------------//
+    VkPhysicalDevice                        m_physicalDevice;
+    VkDevice                                m_device;
+    const VkAllocationCallbacks*            m_allocationCallbacks;
+    DeviceAllocator*                        m_allocator;
+    PipelineRegistry*                       m_pipelineRegistry;
+    bool                                    m_computeSupported;     // Device features, independent of format
+    VkDescriptorSetLayout                   m_descriptorSetLayout;
+    VkDescriptorPool                        m_descriptorPool;
+    VkPipelineLayout                        m_pipelineLayout;
+    PipelineHandle                          m_pipeline;
+    VkBuffer                                m_counterBuffer;        // One uint per chain
+    MemoryAllocation                        m_counterAllocation;
+    std::vector<uint32_t>                   m_freeCounters;
+    //------------------------------------------------------------------------//
+
+    // PRIVATE FUNCTIONS
+    //------------------------------------------------------------------------//
+    void recordCompute(VkCommandBuffer, const MipChain&, VkImageLayout level0Layout, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage);
+    void recordBlit(VkCommandBuffer, const MipChain&, VkImageLayout level0Layout, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage);
+    bool formatSupports(VkFormat, VkFormatFeatureFlags) const;
+    //------------------------------------------------------------------------//
+};
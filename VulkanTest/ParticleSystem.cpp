@@ -0,0 +1,398 @@
+#include "ParticleSystem.h"
+
+#include <stdexcept>                        // Error reporting
+#include <string>                           // std::to_string
+
+namespace
+{
+    // Matches local_size_x in simulate_particles.comp
+    const uint32_t PARTICLE_GROUP_SIZE = 256;
+
+    // Position and velocity, two vec2s
+    const VkDeviceSize PARTICLE_SIZE = 16;
+}
+
+ParticleSystem::ParticleSystem()
+{
+    m_device = VK_NULL_HANDLE;
+    m_allocationCallbacks = nullptr;
+    m_allocator = nullptr;
+    m_pipelineRegistry = nullptr;
+    m_bindlessTable = nullptr;
+    m_computeQueue = VK_NULL_HANDLE;
+    m_computeFamily = 0;
+    m_graphicsFamily = 0;
+    m_maxBufferRange = 0;
+    m_pipelineLayout = VK_NULL_HANDLE;
+    m_pipeline = INVALID_PIPELINE_HANDLE;
+    m_commandPool = VK_NULL_HANDLE;
+    m_timeline = VK_NULL_HANDLE;
+    m_submittedValue = 0;
+    m_buffers[0] = VK_NULL_HANDLE;
+    m_buffers[1] = VK_NULL_HANDLE;
+    m_handles[0] = INVALID_BINDLESS_HANDLE;
+    m_handles[1] = INVALID_BINDLESS_HANDLE;
+    m_particleCount = 0;
+    m_latest = -1;
+    m_latestValue = 0;
+    m_drawn = -1;
+    m_drawnValue = 0;
+    m_stepCount = 0;
+}
+
+void ParticleSystem::create(
+    VkDevice device,
+    const VkAllocationCallbacks* allocationCallbacks,
+    const VkPhysicalDeviceProperties& properties,
+    DeviceAllocator& allocator,
+    PipelineRegistry& pipelineRegistry,
+    BindlessTable& bindlessTable,
+    FrameProfiler& frameProfiler,
+    VkQueue computeQueue,
+    uint32_t computeFamily,
+    uint32_t graphicsFamily,
+    uint32_t timestampValidBits,
+    uint32_t slotCount)
+{
+    m_device = device;
+    m_allocationCallbacks = allocationCallbacks;
+    m_allocator = &allocator;
+    m_pipelineRegistry = &pipelineRegistry;
+    m_bindlessTable = &bindlessTable;
+    m_computeQueue = computeQueue;
+    m_computeFamily = computeFamily;
+    m_graphicsFamily = graphicsFamily;
+    m_maxBufferRange = properties.limits.maxStorageBufferRange;
+
+    // Both buffers are reached through the bindless table, the step only pushes their handles
+    VkDescriptorSetLayout setLayout = bindlessTable.descriptorSetLayout();
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(ParticleConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &setLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, m_allocationCallbacks, &m_pipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create particle pipeline layout");
+    }
+
+    PipelineDescription description;
+    description.computeShader = "shaders/simulate_particles.spv";
+    description.layout = m_pipelineLayout;
+
+    m_pipeline = pipelineRegistry.request(description);
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = m_computeFamily;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;   // Re-recorded every frame
+
+    if (vkCreateCommandPool(m_device, &poolInfo, m_allocationCallbacks, &m_commandPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create particle command pool");
+    }
+
+    m_commandBuffers.resize(slotCount);
+    m_slotValues.assign(slotCount, 0);
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = m_commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = slotCount;
+
+    if (vkAllocateCommandBuffers(m_device, &allocInfo, m_commandBuffers.data()) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to allocate particle command buffers");
+    }
+
+    VkSemaphoreTypeCreateInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    timelineInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    timelineInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &timelineInfo;
+
+    if (vkCreateSemaphore(m_device, &semaphoreInfo, m_allocationCallbacks, &m_timeline) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create particle timeline semaphore");
+    }
+
+    // Timestamps from another queue, possibly with fewer valid bits than the graphics queue's
+    m_profiler.create(m_device, m_allocationCallbacks, properties, timestampValidBits, frameProfiler);
+    m_profiler.setSlotCount(slotCount);
+}
+
+void ParticleSystem::destruct()
+{
+    if (m_device == VK_NULL_HANDLE) return;
+
+    waitForValue(m_submittedValue);
+
+    destroyBuffers();
+    m_profiler.destruct();
+
+    // The registry owns the pipeline itself and outlives this
+    vkDestroySemaphore(m_device, m_timeline, m_allocationCallbacks);
+    vkDestroyCommandPool(m_device, m_commandPool, m_allocationCallbacks);
+    vkDestroyPipelineLayout(m_device, m_pipelineLayout, m_allocationCallbacks);
+
+    m_timeline = VK_NULL_HANDLE;
+    m_commandPool = VK_NULL_HANDLE;
+    m_pipelineLayout = VK_NULL_HANDLE;
+    m_commandBuffers.clear();
+    m_device = VK_NULL_HANDLE;
+}
+
+void ParticleSystem::setParticleCount(uint32_t count)
+{
+    if (count > g_MAX_PARTICLES || count * PARTICLE_SIZE > m_maxBufferRange)
+    {
+        throw std::runtime_error("Too many particles for this device: " + std::to_string(count));
+    }
+
+    destroyBuffers();
+
+    m_particleCount = count;
+
+    if (m_particleCount == 0) return;
+
+    uint32_t queueFamilies[] = { m_graphicsFamily, m_computeFamily };
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = count * PARTICLE_SIZE;
+    bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+
+    if (m_computeFamily != m_graphicsFamily)
+    {
+        bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        bufferInfo.queueFamilyIndexCount = 2;
+        bufferInfo.pQueueFamilyIndices = queueFamilies;
+    }
+    else
+    {
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
+
+    // Never uploaded, the first step seeds them
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        m_allocator->createBuffer(bufferInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_buffers[i], m_allocations[i]);
+        m_handles[i] = m_bindlessTable->addBuffer(m_buffers[i], 0, VK_WHOLE_SIZE);
+    }
+}
+
+bool ParticleSystem::isReady() const
+{
+    return m_particleCount > 0 && m_pipelineRegistry->get(m_pipeline) != VK_NULL_HANDLE;
+}
+
+void ParticleSystem::submit(uint32_t slot, VkSemaphore graphicsTimeline, uint64_t graphicsValue)
+{
+    // The slot's previous step is normally long done, the frames drawing its result waited for it
+    waitForValue(m_slotValues[slot]);
+    m_profiler.collect(slot);
+
+    VkCommandBuffer commandBuffer = m_commandBuffers[slot];
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to begin recording particle command buffer");
+    }
+
+    m_profiler.beginFrame(commandBuffer, slot);
+    uint32_t scope = m_profiler.beginScope(commandBuffer, slot, "particles");
+
+    // The previous step's writes become visible to this one, which must also not overwrite the
+    // buffer before that step's reads of it are done. Draws of it happened on the graphics queue,
+    // the semaphore wait below orders them
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 1, &barrier, 0, nullptr, 0, nullptr
+    );
+
+    int destination = recordStep(commandBuffer);
+
+    m_profiler.endScope(commandBuffer, slot, scope);
+
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to record particle command buffer");
+    }
+
+    uint64_t value = m_submittedValue + 1;
+    VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount = 1;
+    timelineInfo.pWaitSemaphoreValues = &graphicsValue;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &value;
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.waitSemaphoreCount = 1;
+    submitInfo.pWaitSemaphores = &graphicsTimeline;
+    submitInfo.pWaitDstStageMask = &waitStage;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &m_timeline;
+
+    if (vkQueueSubmit(m_computeQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to submit particle command buffer");
+    }
+
+    m_profiler.markSubmitted(slot);
+    m_slotValues[slot] = value;
+    m_submittedValue = value;
+
+    // This frame draws what the previous step left, while this one runs
+    m_drawn = m_latest;
+    m_drawnValue = m_latestValue;
+    m_latest = destination;
+    m_latestValue = value;
+}
+
+void ParticleSystem::record(VkCommandBuffer commandBuffer)
+{
+    // A step that ran on the compute queue before may have written the buffer read here
+    uint64_t sourceValue = m_latestValue;
+
+    int destination = recordStep(commandBuffer);
+
+    m_drawn = destination;
+    m_drawnValue = sourceValue;
+    m_latest = destination;
+    m_latestValue = 0;
+}
+
+VkBuffer ParticleSystem::sourceBuffer() const
+{
+    return m_buffers[sourceIndex()];
+}
+
+VkBuffer ParticleSystem::destinationBuffer() const
+{
+    return m_buffers[1 - sourceIndex()];
+}
+
+BindlessHandle ParticleSystem::drawBuffer() const
+{
+    return m_drawn < 0 ? INVALID_BINDLESS_HANDLE : m_handles[m_drawn];
+}
+
+uint64_t ParticleSystem::pendingValue() const
+{
+    return m_drawnValue;
+}
+
+VkSemaphore ParticleSystem::timelineSemaphore() const
+{
+    return m_timeline;
+}
+
+bool ParticleSystem::usesDedicatedQueue() const
+{
+    return m_computeFamily != m_graphicsFamily;
+}
+
+uint32_t ParticleSystem::particleCount() const
+{
+    return m_particleCount;
+}
+
+int ParticleSystem::sourceIndex() const
+{
+    // The first step seeds the buffer it writes and reads nothing
+    return m_latest < 0 ? 1 : m_latest;
+}
+
+int ParticleSystem::recordStep(VkCommandBuffer commandBuffer)
+{
+    bool seed = m_latest < 0;
+    int source = sourceIndex();
+    int destination = 1 - source;
+
+    ParticleConstants constants{};
+    constants.source = m_handles[source];
+    constants.destination = m_handles[destination];
+    constants.count = m_particleCount;
+    constants.seed = seed ? 1 : 0;
+    constants.timeStep = g_PARTICLE_TIME_STEP;
+    constants.time = static_cast<float>(m_stepCount * g_PARTICLE_TIME_STEP);
+
+    VkDescriptorSet descriptorSet = m_bindlessTable->descriptorSet();
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineRegistry->get(m_pipeline));
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ParticleConstants), &constants);
+    vkCmdDispatch(commandBuffer, (m_particleCount + PARTICLE_GROUP_SIZE - 1) / PARTICLE_GROUP_SIZE, 1, 1);
+
+    m_stepCount++;
+
+    return destination;
+}
+
+void ParticleSystem::waitForValue(uint64_t value)
+{
+    if (value == 0) return;
+
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &m_timeline;
+    waitInfo.pValues = &value;
+
+    if (vkWaitSemaphores(m_device, &waitInfo, UINT64_MAX) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to wait on the particle timeline semaphore");
+    }
+}
+
+void ParticleSystem::destroyBuffers()
+{
+    if (m_allocator == nullptr) return;
+
+    // Like the buffers, the slots are reused right away
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        m_bindlessTable->removeBuffer(m_handles[i]);
+        m_allocator->destroyBuffer(m_buffers[i], m_allocations[i]);
+
+        m_handles[i] = INVALID_BINDLESS_HANDLE;
+        m_buffers[i] = VK_NULL_HANDLE;
+    }
+
+    m_particleCount = 0;
+    m_latest = -1;
+    m_latestValue = 0;
+    m_drawn = -1;
+    m_drawnValue = 0;
+    m_stepCount = 0;
+}
@@ -0,0 +1,142 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "GlobalApplicationConstants.h"     // g_MAX_PARTICLES
+#include "DeviceAllocator.h"                // The particle buffers
+#include "PipelineRegistry.h"               // The simulation compute pipeline
+#include "BindlessTable.h"                  // Particles are read and written through their slots
+#include "GpuProfiler.h"                    // Timestamps on the compute queue
+#include "FrameProfiler.h"                  // Where those land
+
+// A GPU particle simulation, stepped once per frame by simulate_particles.comp. Particles live in
+// two buffers that alternate between being read and written; each step reads the latest state and
+// writes the other buffer, and the first step seeds it instead.
+//
+// Steps run one of two ways:
+//
+//   submit()   on the compute queue, in a submission of its own, so the step overlaps with the
+//              graphics work of the same frame. That frame draws the previous step's result, and
+//              the step waits on the graphics timeline for the frames drawing the buffer it
+//              overwrites. On devices with an async compute family the two really run side by side
+//   record()   into the graphics command buffer ahead of the render pass, so simulation and
+//              rendering take turns on the graphics queue. The frame's render graph places the
+//              barriers on either side, from the accesses to sourceBuffer() and destinationBuffer()
+//
+// Either way the graphics submission drawing drawBuffer() has to wait for pendingValue() of
+// timelineSemaphore(). The buffers are shared concurrently by the two families, so neither way
+// needs queue family ownership transfers.
+//
+// Render thread only.
+class ParticleSystem
+{
+public:
+    // CONSTRUCTOR
+    //------------------------------------------------------------------------//
+    ParticleSystem();
+    //------------------------------------------------------------------------//
+
+    // PUBLIC FUNCTIONS
+    //------------------------------------------------------------------------//
+    void create(
+        VkDevice,
+        const VkAllocationCallbacks*,
+        const VkPhysicalDeviceProperties&,
+        DeviceAllocator&,
+        PipelineRegistry&,
+        BindlessTable&,
+        FrameProfiler&,
+        VkQueue computeQueue,
+        uint32_t computeFamily,
+        uint32_t graphicsFamily,
+        uint32_t timestampValidBits,                                // Of the compute family
+        uint32_t slotCount
+    );
+
+    // Waits for the compute queue, the graphics queue must be idle
+    void destruct();
+
+    // Replaces the buffers, which are seeded again by the next step. Nothing may still use the old
+    // ones. Throws std::runtime_error above g_MAX_PARTICLES or the device's storage buffer range
+    void setParticleCount(uint32_t);
+
+    // The compute pipeline is compiled and there is something to simulate
+    bool isReady() const;
+
+    // Steps the simulation on the compute queue. Frames up to graphicsValue of graphicsTimeline may
+    // still draw the buffer this step overwrites, so it waits for them first
+    void submit(uint32_t slot, VkSemaphore graphicsTimeline, uint64_t graphicsValue);
+
+    // Steps the simulation inside a graphics command buffer, outside a render pass. Records no
+    // barriers: the caller orders it after earlier accesses to the step's buffers, and the draws
+    // of the result after it
+    void record(VkCommandBuffer);
+
+    // The buffers the next step reads and writes. The step's result becomes drawBuffer()
+    VkBuffer sourceBuffer() const;
+    VkBuffer destinationBuffer() const;
+
+    // The latest state the graphics queue may draw, INVALID_BINDLESS_HANDLE before the first step
+    BindlessHandle drawBuffer() const;
+
+    // The value of timelineSemaphore() to wait for before drawing drawBuffer(), 0 for none
+    uint64_t pendingValue() const;
+    VkSemaphore timelineSemaphore() const;
+
+    // The compute queue is not the graphics queue
+    bool usesDedicatedQueue() const;
+    uint32_t particleCount() const;
+    //------------------------------------------------------------------------//
+
+private:
+    // Matches ParticleConstants in simulate_particles.comp
+    struct ParticleConstants
+    {
+        BindlessHandle                      source;
+        BindlessHandle                      destination;
+        uint32_t                            count;
+        uint32_t                            seed;                   // Nonzero on the first step
+        float                               timeStep;
+        float                               time;                   // Simulated, steps times the time step
+    };
+
+    // PRIVATE MEMBERS
+    //------------------------------------------------------------------------//
+    VkDevice                                m_device;
+    const VkAllocationCallbacks*            m_allocationCallbacks;
+    DeviceAllocator*                        m_allocator;
+    PipelineRegistry*                       m_pipelineRegistry;
+    BindlessTable*                          m_bindlessTable;
+    VkQueue                                 m_computeQueue;
+    uint32_t                                m_computeFamily;
+    uint32_t                                m_graphicsFamily;
+    VkDeviceSize                            m_maxBufferRange;
+    VkPipelineLayout                        m_pipelineLayout;
+    PipelineHandle                          m_pipeline;
+    VkCommandPool                           m_commandPool;          // On the compute family
+    std::vector<VkCommandBuffer>            m_commandBuffers;       // One per frame slot
+    std::vector<uint64_t>                   m_slotValues;           // Timeline value of each slot's last step
+    VkSemaphore                             m_timeline;             // Signalled by compute queue steps
+    uint64_t                                m_submittedValue;
+    GpuProfiler                             m_profiler;
+    VkBuffer                                m_buffers[2];
+    MemoryAllocation                        m_allocations[2];
+    BindlessHandle                          m_handles[2];
+    uint32_t                                m_particleCount;
+    int                                     m_latest;               // Buffer holding the latest step, -1 before the first
+    uint64_t                                m_latestValue;          // Its compute timeline value, 0 if on the graphics queue
+    int                                     m_drawn;                // Buffer drawBuffer() returns
+    uint64_t                                m_drawnValue;
+    uint64_t                                m_stepCount;
+    //------------------------------------------------------------------------//
+
+    // PRIVATE FUNCTIONS
+    //------------------------------------------------------------------------//
+    int sourceIndex() const;
+    int recordStep(VkCommandBuffer);
+    void waitForValue(uint64_t);
+    void destroyBuffers();
+    //------------------------------------------------------------------------//
+};
@@ -0,0 +1,229 @@
+#include "PipelineCache.h"
+
+#include <cstring>                          // memcmp/memcpy on headers
+#include <filesystem>                       // Atomic replace of the cache file
+#include <fstream>                          // Cache file IO
+#include <iostream>                         // Cache status messages
+#include <stdexcept>                        // Error reporting
+#include <vector>
+
+namespace
+{
+    const uint32_t PIPELINE_CACHE_FILE_MAGIC = 0x43505054;     // "TPPC"
+    const uint32_t PIPELINE_CACHE_FILE_VERSION = 1;
+
+    // Precedes the driver's blob on disk. driverVersion is not part of the driver's own header,
+    // but a driver update is exactly when a stale cache is most likely
+    struct PipelineCacheFileHeader
+    {
+        uint32_t    magic;
+        uint32_t    version;
+        uint32_t    vendorID;
+        uint32_t    deviceID;
+        uint32_t    driverVersion;
+        uint8_t     pipelineCacheUUID[VK_UUID_SIZE];
+        uint64_t    dataSize;
+        uint64_t    dataHash;
+    };
+
+    // FNV-1a, only there to catch truncated or corrupted files
+    uint64_t hashBytes(const char* data, size_t size)
+    {
+        uint64_t hash = 14695981039346656037ull;
+
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= static_cast<uint8_t>(data[i]);
+            hash *= 1099511628211ull;
+        }
+
+        return hash;
+    }
+}
+
+PipelineCache::PipelineCache()
+{
+    m_device = VK_NULL_HANDLE;
+    m_allocationCallbacks = nullptr;
+    m_cache = VK_NULL_HANDLE;
+    m_properties = {};
+    m_loadedBytes = 0;
+    m_savedBytes = 0;
+}
+
+void PipelineCache::create(VkDevice device, const VkAllocationCallbacks* allocationCallbacks, const VkPhysicalDeviceProperties& properties, const std::string& path)
+{
+    m_device = device;
+    m_allocationCallbacks = allocationCallbacks;
+    m_properties = properties;
+    m_path = path;
+
+    std::string data = loadValidatedData();
+
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheInfo.initialDataSize = data.size();
+    cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+    if (vkCreatePipelineCache(m_device, &cacheInfo, m_allocationCallbacks, &m_cache) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create pipeline cache");
+    }
+
+    m_loadedBytes = data.size();
+    m_savedBytes = data.size();
+}
+
+void PipelineCache::destruct()
+{
+    if (m_cache == VK_NULL_HANDLE) return;
+
+    save();
+
+    vkDestroyPipelineCache(m_device, m_cache, m_allocationCallbacks);
+    m_cache = VK_NULL_HANDLE;
+}
+
+std::string PipelineCache::loadValidatedData() const
+{
+    if (m_path.empty()) return std::string();
+
+    std::ifstream file(m_path, std::ios::binary);
+
+    // No file yet is the normal first run, not worth a message
+    if (!file.is_open()) return std::string();
+
+    PipelineCacheFileHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    const char* rejection = nullptr;
+
+    if (!file || header.magic != PIPELINE_CACHE_FILE_MAGIC || header.version != PIPELINE_CACHE_FILE_VERSION)
+    {
+        rejection = "not a pipeline cache file";
+    }
+    else if (header.vendorID != m_properties.vendorID || header.deviceID != m_properties.deviceID)
+    {
+        rejection = "written for a different device";
+    }
+    else if (header.driverVersion != m_properties.driverVersion || 
+             memcmp(header.pipelineCacheUUID, m_properties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+    {
+        rejection = "written by a different driver";
+    }
+
+    std::string data;
+
+    if (rejection == nullptr)
+    {
+        data.resize(static_cast<size_t>(header.dataSize));
+        file.read(&data[0], data.size());
+
+        if (!file || hashBytes(data.data(), data.size()) != header.dataHash)
+        {
+            rejection = "truncated or corrupted";
+        }
+    }
+
+    // The driver's own header must agree with ours too, or the driver would ignore the blob anyway
+    VkPipelineCacheHeaderVersionOne driverHeader{};
+
+    if (rejection == nullptr && data.size() >= sizeof(driverHeader))
+    {
+        memcpy(&driverHeader, data.data(), sizeof(driverHeader));
+
+        if (driverHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE || 
+            driverHeader.vendorID != m_properties.vendorID || 
+            driverHeader.deviceID != m_properties.deviceID || 
+            memcmp(driverHeader.pipelineCacheUUID, m_properties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+        {
+            rejection = "driver header does not match this device";
+        }
+    }
+
+    if (rejection != nullptr)
+    {
+        std::cout << "Discarding pipeline cache " << m_path << ": " << rejection << std::endl;
+        return std::string();
+    }
+
+    return data;
+}
+
+void PipelineCache::save()
+{
+    if (m_cache == VK_NULL_HANDLE || m_path.empty()) return;
+
+    size_t size = 0;
+    vkGetPipelineCacheData(m_device, m_cache, &size, nullptr);
+
+    std::vector<char> data(size);
+    if (size == 0 || vkGetPipelineCacheData(m_device, m_cache, &size, data.data()) != VK_SUCCESS) return;
+
+    PipelineCacheFileHeader header{};
+    header.magic = PIPELINE_CACHE_FILE_MAGIC;
+    header.version = PIPELINE_CACHE_FILE_VERSION;
+    header.vendorID = m_properties.vendorID;
+    header.deviceID = m_properties.deviceID;
+    header.driverVersion = m_properties.driverVersion;
+    memcpy(header.pipelineCacheUUID, m_properties.pipelineCacheUUID, VK_UUID_SIZE);
+    header.dataSize = size;
+    header.dataHash = hashBytes(data.data(), size);
+
+    std::string temporaryPath = m_path + ".tmp";
+
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(data.data(), size);
+
+        // A failed save only costs the next start its warm cache, never worth aborting over
+        if (!file)
+        {
+            std::cout << "Failed to write pipeline cache " << temporaryPath << std::endl;
+            return;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, m_path, error);
+
+    if (error)
+    {
+        std::cout << "Failed to replace pipeline cache " << m_path << ": " << error.message() << std::endl;
+        std::filesystem::remove(temporaryPath, error);
+        return;
+    }
+
+    m_savedBytes = size;
+}
+
+void PipelineCache::saveIfChanged()
+{
+    if (m_cache == VK_NULL_HANDLE || m_path.empty()) return;
+
+    // Drivers only ever add to a cache, so an unchanged size means nothing new to persist
+    size_t size = 0;
+    vkGetPipelineCacheData(m_device, m_cache, &size, nullptr);
+
+    if (size != m_savedBytes)
+    {
+        save();
+    }
+}
+
+VkPipelineCache PipelineCache::handle() const
+{
+    return m_cache;
+}
+
+bool PipelineCache::isWarm() const
+{
+    return m_loadedBytes > 0;
+}
+
+size_t PipelineCache::loadedBytes() const
+{
+    return m_loadedBytes;
+}
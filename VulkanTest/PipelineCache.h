@@ -0,0 +1,50 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <string>
+
+// VkPipelineCache persisted between runs. The file carries its own header identifying the
+// device and driver that produced it (vendor, device, driver version, pipelineCacheUUID) plus a
+// checksum of the data, and anything that does not match is discarded in favour of a cold cache,
+// since feeding a driver a foreign or corrupted blob is undefined at worst and useless at best.
+// Saving writes a temporary file and renames it over the old one, so a crash mid-save never
+// leaves a truncated cache behind.
+class PipelineCache
+{
+public:
+    // CONSTRUCTOR
+    //------------------------------------------------------------------------//
+    PipelineCache();
+    //------------------------------------------------------------------------//
+
+    // PUBLIC FUNCTIONS
+    //------------------------------------------------------------------------//
+    // An empty path keeps the cache in memory only
+    void create(VkDevice, const VkAllocationCallbacks*, const VkPhysicalDeviceProperties&, const std::string& path);
+    void destruct();
+    void save();
+    void saveIfChanged();
+
+    VkPipelineCache handle() const;
+    bool isWarm() const;
+    size_t loadedBytes() const;
+    //------------------------------------------------------------------------//
+
+private:
+    // PRIVATE MEMBERS
+    //------------------------------------------------------------------------//
+    VkDevice                                m_device;
+    const VkAllocationCallbacks*            m_allocationCallbacks;
+    VkPipelineCache                         m_cache;
+    VkPhysicalDeviceProperties              m_properties;
+    std::string                             m_path;
+    size_t                                  m_loadedBytes;          // Size of the blob accepted at startup, 0 when cold
+    size_t                                  m_savedBytes;           // Size of the blob last written to disk
+    //------------------------------------------------------------------------//
+
+    // PRIVATE FUNCTIONS
+    //------------------------------------------------------------------------//
+    std::string loadValidatedData() const;
+    //------------------------------------------------------------------------//
+};
@@ -0,0 +1,104 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <functional>                       // std::hash
+#include <string>
+
+#include "Vertex.h"                         // VertexFormat
+
+// Everything that distinguishes one graphics pipeline from another. Two equal descriptions
+// always produce interchangeable pipelines, which is what lets the PipelineRegistry share them.
+// Viewport and scissor are always dynamic and so are not part of it. A compute pipeline only
+// needs computeShader and layout, everything else keeps its default. A graphics pipeline without
+// a fragment shader only writes depth, as a depth prepass does.
+struct PipelineDescription
+{
+    // MEMBERS
+    std::string             vertexShader;                               // SPIR-V file paths
+    std::string             fragmentShader;                             // Empty for depth only pipelines
+    std::string             computeShader;                              // Set for compute pipelines only
+    VkPipelineLayout        layout = VK_NULL_HANDLE;
+    VkRenderPass            renderPass = VK_NULL_HANDLE;                // Any compatible render pass, null for dynamic rendering
+    VkFormat                colorFormat = VK_FORMAT_UNDEFINED;          // Attachment formats, only for dynamic rendering
+    VkFormat                depthFormat = VK_FORMAT_UNDEFINED;          //
+    VertexFormat            vertexFormat = VertexFormat::None;
+    VertexEncoding          vertexEncoding = VertexEncoding::Float;     // Of binding 0, ignored for None
+    uint32_t                subpass = 0;
+    VkPrimitiveTopology     topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    VkPolygonMode           polygonMode = VK_POLYGON_MODE_FILL;
+    VkCullModeFlags         cullMode = VK_CULL_MODE_BACK_BIT;
+    VkFrontFace             frontFace = VK_FRONT_FACE_CLOCKWISE;
+    VkSampleCountFlagBits   samples = VK_SAMPLE_COUNT_1_BIT;
+    bool                    blendEnable = false;
+    bool                    colorWrite = true;
+    VkCompareOp             depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL; // ALWAYS without depthWrite disables the test
+    bool                    depthWrite = true;
+
+    // FUNCTIONS
+    bool operator==(const PipelineDescription& other) const
+    {
+        return vertexShader == other.vertexShader && 
+               fragmentShader == other.fragmentShader && 
+               computeShader == other.computeShader && 
+               layout == other.layout && 
+               renderPass == other.renderPass && 
+               colorFormat == other.colorFormat && 
+               depthFormat == other.depthFormat && 
+               vertexFormat == other.vertexFormat && 
+               vertexEncoding == other.vertexEncoding && 
+               subpass == other.subpass && 
+               topology == other.topology && 
+               polygonMode == other.polygonMode && 
+               cullMode == other.cullMode && 
+               frontFace == other.frontFace && 
+               samples == other.samples && 
+               blendEnable == other.blendEnable && 
+               colorWrite == other.colorWrite && 
+               depthCompareOp == other.depthCompareOp && 
+               depthWrite == other.depthWrite;
+    }
+
+    bool operator!=(const PipelineDescription& other) const
+    {
+        return !(*this == other);
+    }
+
+    size_t hash() const
+    {
+        size_t seed = std::hash<std::string>()(vertexShader);
+
+        auto combine = [&seed](size_t value) {
+            seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        };
+
+        combine(std::hash<std::string>()(fragmentShader));
+        combine(std::hash<std::string>()(computeShader));
+        combine(std::hash<VkPipelineLayout>()(layout));
+        combine(std::hash<VkRenderPass>()(renderPass));
+        combine(static_cast<size_t>(colorFormat));
+        combine(static_cast<size_t>(depthFormat));
+        combine(static_cast<size_t>(vertexFormat));
+        combine(static_cast<size_t>(vertexEncoding));
+        combine(subpass);
+        combine(static_cast<size_t>(topology));
+        combine(static_cast<size_t>(polygonMode));
+        combine(static_cast<size_t>(cullMode));
+        combine(static_cast<size_t>(frontFace));
+        combine(static_cast<size_t>(samples));
+        combine(blendEnable ? 1 : 0);
+        combine(colorWrite ? 1 : 0);
+        combine(static_cast<size_t>(depthCompareOp));
+        combine(depthWrite ? 1 : 0);
+
+        return seed;
+    }
+};
+
+struct PipelineDescriptionHasher
+{
+    size_t operator()(const PipelineDescription& description) const
+    {
+        return description.hash();
+    }
+};
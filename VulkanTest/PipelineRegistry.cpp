@@ -0,0 +1,382 @@
+#include "PipelineRegistry.h"
+
+#include <chrono>                           // Compile times
+#include <iostream>                         // Compile status messages
+#include <sstream>                          // One line per message across threads
+#include <stdexcept>                        // Error reporting
+
+#include "MappedFile.h"                     // Reading shader binaries
+
+namespace
+{
+    // SPIR-V is handed to the driver straight from the mapping, which is page aligned as pCode
+    // requires
+    VkShaderModule createShaderModule(VkDevice device, const VkAllocationCallbacks* allocationCallbacks, const std::string& filename)
+    {
+        MappedFile file;
+
+        try
+        {
+            file.open(filename);
+        }
+        catch (const std::runtime_error&)
+        {
+            throw std::runtime_error("Failed to open shader " + filename);
+        }
+
+        VkShaderModuleCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        createInfo.codeSize = file.size();
+        createInfo.pCode = static_cast<const uint32_t*>(file.data());
+
+        VkShaderModule shaderModule;
+        if (vkCreateShaderModule(device, &createInfo, allocationCallbacks, &shaderModule) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create shader module");
+        }
+
+        return shaderModule;
+    }
+
+    // For status messages
+    std::string shaderNames(const PipelineDescription& description)
+    {
+        if (!description.computeShader.empty()) return description.computeShader;
+
+        if (description.fragmentShader.empty()) return description.vertexShader + " (depth only)";
+
+        return description.vertexShader + " + " + description.fragmentShader;
+    }
+}
+
+PipelineRegistry::PipelineRegistry() : m_entryCount(0)
+{
+    m_device = VK_NULL_HANDLE;
+    m_allocationCallbacks = nullptr;
+    m_cache = VK_NULL_HANDLE;
+    m_threadPool = nullptr;
+    m_frameProfiler = nullptr;
+    m_compileChannel = 0;
+}
+
+void PipelineRegistry::create(VkDevice device, const VkAllocationCallbacks* allocationCallbacks, VkPipelineCache cache, ThreadPool& threadPool, FrameProfiler& frameProfiler)
+{
+    m_device = device;
+    m_allocationCallbacks = allocationCallbacks;
+    m_cache = cache;
+    m_threadPool = &threadPool;
+    m_frameProfiler = &frameProfiler;
+    m_compileChannel = frameProfiler.registerChannel("cpu.pipeline_create");
+}
+
+void PipelineRegistry::destruct()
+{
+    // Compile jobs reference the entries, they have to finish first
+    waitForPending();
+
+    uint32_t count = m_entryCount.load(std::memory_order_acquire);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        VkPipeline pipeline = m_entries[i]->pipeline.load(std::memory_order_acquire);
+
+        if (pipeline != VK_NULL_HANDLE)
+        {
+            vkDestroyPipeline(m_device, pipeline, m_allocationCallbacks);
+        }
+
+        m_entries[i].reset();
+    }
+
+    m_entryCount.store(0, std::memory_order_release);
+    m_handles.clear();
+}
+
+PipelineHandle PipelineRegistry::request(const PipelineDescription& description)
+{
+    std::lock_guard<std::mutex> lock(m_requestMutex);
+
+    auto existing = m_handles.find(description);
+    if (existing != m_handles.end()) return existing->second;
+
+    uint32_t count = m_entryCount.load(std::memory_order_relaxed);
+
+    if (count == g_PIPELINE_REGISTRY_CAPACITY)
+    {
+        throw std::runtime_error("Pipeline registry is full");
+    }
+
+    m_entries[count] = std::make_unique<Entry>();
+    Entry& entry = *m_entries[count];
+    entry.description = description;
+    entry.pipeline.store(VK_NULL_HANDLE, std::memory_order_relaxed);
+    entry.state.store(EntryState::Pending, std::memory_order_relaxed);
+
+    // Publish the entry to get() before a worker can possibly finish it
+    m_entryCount.store(count + 1, std::memory_order_release);
+    m_handles.emplace(description, count);
+
+    m_threadPool->submit([this, &entry]() { compile(entry); });
+
+    return count;
+}
+
+VkPipeline PipelineRegistry::get(PipelineHandle handle, PipelineHandle fallback) const
+{
+    if (handle < m_entryCount.load(std::memory_order_acquire))
+    {
+        VkPipeline pipeline = m_entries[handle]->pipeline.load(std::memory_order_acquire);
+        if (pipeline != VK_NULL_HANDLE) return pipeline;
+    }
+
+    // The fallback may well still be compiling too, in which case the caller skips the draw
+    if (fallback != INVALID_PIPELINE_HANDLE)
+    {
+        return get(fallback);
+    }
+
+    return VK_NULL_HANDLE;
+}
+
+bool PipelineRegistry::isPending(PipelineHandle handle) const
+{
+    if (handle >= m_entryCount.load(std::memory_order_acquire)) return false;
+
+    return m_entries[handle]->state.load(std::memory_order_acquire) == EntryState::Pending;
+}
+
+void PipelineRegistry::waitForPending()
+{
+    if (m_threadPool != nullptr)
+    {
+        m_threadPool->waitIdle();
+    }
+}
+
+void PipelineRegistry::collectCompileTimes()
+{
+    // Never stall the frame over this, a busy lock just means collecting next frame instead
+    std::unique_lock<std::mutex> lock(m_compileTimesMutex, std::try_to_lock);
+    if (!lock.owns_lock() || m_compileTimes.empty()) return;
+
+    // The profiler wants a single writer per channel, which is why workers do not record directly
+    for (uint64_t nanoseconds : m_compileTimes)
+    {
+        m_frameProfiler->record(m_compileChannel, nanoseconds);
+    }
+
+    m_compileTimes.clear();
+}
+
+void PipelineRegistry::compile(Entry& entry)
+{
+    const PipelineDescription& description = entry.description;
+
+    bool isCompute = !description.computeShader.empty();
+
+    VkShaderModule vertShaderModule = VK_NULL_HANDLE;
+    VkShaderModule fragShaderModule = VK_NULL_HANDLE;
+    VkShaderModule computeShaderModule = VK_NULL_HANDLE;
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkResult result = VK_ERROR_INITIALIZATION_FAILED;
+    std::chrono::steady_clock::duration compileTime{};
+
+    try
+    {
+        if (isCompute)
+        {
+            computeShaderModule = createShaderModule(m_device, m_allocationCallbacks, description.computeShader);
+        }
+        else
+        {
+            vertShaderModule = createShaderModule(m_device, m_allocationCallbacks, description.vertexShader);
+
+            if (!description.fragmentShader.empty())
+            {
+                fragShaderModule = createShaderModule(m_device, m_allocationCallbacks, description.fragmentShader);
+            }
+        }
+
+        // The cache is internally synchronized, any number of workers may compile against it
+        auto compileStart = std::chrono::steady_clock::now();
+
+        if (isCompute)
+        {
+            result = createComputePipeline(description, computeShaderModule, pipeline);
+        }
+        else
+        {
+            result = createGraphicsPipeline(description, vertShaderModule, fragShaderModule, pipeline);
+        }
+
+        compileTime = std::chrono::steady_clock::now() - compileStart;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Pipeline " << shaderNames(description) << ": " << e.what() << std::endl;
+    }
+
+    if (computeShaderModule != VK_NULL_HANDLE) vkDestroyShaderModule(m_device, computeShaderModule, m_allocationCallbacks);
+    if (fragShaderModule != VK_NULL_HANDLE) vkDestroyShaderModule(m_device, fragShaderModule, m_allocationCallbacks);
+    if (vertShaderModule != VK_NULL_HANDLE) vkDestroyShaderModule(m_device, vertShaderModule, m_allocationCallbacks);
+
+    if (result != VK_SUCCESS)
+    {
+        // Left as a permanent skip-draw rather than retried every frame
+        entry.state.store(EntryState::Failed, std::memory_order_release);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_compileTimesMutex);
+        m_compileTimes.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(compileTime).count());
+    }
+
+    std::ostringstream message;
+    message << "Pipeline " << shaderNames(description) << " compiled in " 
+            << std::chrono::duration<double, std::milli>(compileTime).count() << " ms" << std::endl;
+    std::cout << message.str();
+
+    entry.pipeline.store(pipeline, std::memory_order_release);
+    entry.state.store(EntryState::Ready, std::memory_order_release);
+}
+
+VkResult PipelineRegistry::createGraphicsPipeline(const PipelineDescription& description, VkShaderModule vertShaderModule, VkShaderModule fragShaderModule, VkPipeline& pipeline)
+{
+    VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
+    vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+    vertShaderStageInfo.module = vertShaderModule;
+    vertShaderStageInfo.pName = "main";
+
+    VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
+    fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    fragShaderStageInfo.module = fragShaderModule;
+    fragShaderStageInfo.pName = "main";
+
+    // Depth only pipelines have no fragment stage at all, rather than an empty one
+    VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
+    uint32_t stageCount = fragShaderModule != VK_NULL_HANDLE ? 2 : 1;
+
+    VertexInputDescription vertexInput = VertexInputDescription::of(description.vertexFormat, description.vertexEncoding);
+
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(vertexInput.bindings.size());
+    vertexInputInfo.pVertexBindingDescriptions = vertexInput.bindings.data();
+    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertexInput.attributes.size());
+    vertexInputInfo.pVertexAttributeDescriptions = vertexInput.attributes.data();
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = description.topology;
+    inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+    // Viewport and scissor are set while recording (see dynamicState), so resizes keep the pipeline
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.depthClampEnable = VK_FALSE;
+    rasterizer.rasterizerDiscardEnable = VK_FALSE;
+    rasterizer.polygonMode = description.polygonMode;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = description.cullMode;
+    rasterizer.frontFace = description.frontFace;
+    rasterizer.depthBiasEnable = VK_FALSE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.sampleShadingEnable = VK_FALSE;
+    multisampling.rasterizationSamples = description.samples;
+    multisampling.minSampleShading = 1.0f;
+
+    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+    colorBlendAttachment.colorWriteMask = description.colorWrite ? VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT : 0;
+    colorBlendAttachment.blendEnable = description.blendEnable ? VK_TRUE : VK_FALSE;
+    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.logicOpEnable = VK_FALSE;
+    colorBlending.logicOp = VK_LOGIC_OP_COPY;
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments = &colorBlendAttachment;
+
+    // Every render pass has a depth attachment. Fragments only pass an EQUAL test against depth
+    // written with the same vertex shader, which is why prepass shaders declare gl_Position invariant
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = description.depthCompareOp != VK_COMPARE_OP_ALWAYS || description.depthWrite ? VK_TRUE : VK_FALSE;
+    depthStencil.depthWriteEnable = description.depthWrite ? VK_TRUE : VK_FALSE;
+    depthStencil.depthCompareOp = description.depthCompareOp;
+    depthStencil.depthBoundsTestEnable = VK_FALSE;
+    depthStencil.stencilTestEnable = VK_FALSE;
+
+    VkDynamicState dynamicStates[] = {
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR
+    };
+
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
+
+    // Without a render pass the pipeline is drawn with dynamic rendering, which only needs the
+    // attachment formats. Depth formats with stencil are still only ever depth attachments
+    VkPipelineRenderingCreateInfoKHR renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachmentFormats = &description.colorFormat;
+    renderingInfo.depthAttachmentFormat = description.depthFormat;
+    renderingInfo.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.pNext = description.renderPass == VK_NULL_HANDLE ? &renderingInfo : nullptr;
+    pipelineInfo.stageCount = stageCount;
+    pipelineInfo.pStages = shaderStages;
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = &depthStencil;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = description.layout;
+    pipelineInfo.renderPass = description.renderPass;
+    pipelineInfo.subpass = description.subpass;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+    pipelineInfo.basePipelineIndex = -1;
+
+    return vkCreateGraphicsPipelines(m_device, m_cache, 1, &pipelineInfo, m_allocationCallbacks, &pipeline);
+}
+
+VkResult PipelineRegistry::createComputePipeline(const PipelineDescription& description, VkShaderModule computeShaderModule, VkPipeline& pipeline)
+{
+    VkPipelineShaderStageCreateInfo computeShaderStageInfo{};
+    computeShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    computeShaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    computeShaderStageInfo.module = computeShaderModule;
+    computeShaderStageInfo.pName = "main";
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage = computeShaderStageInfo;
+    pipelineInfo.layout = description.layout;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+    pipelineInfo.basePipelineIndex = -1;
+
+    return vkCreateComputePipelines(m_device, m_cache, 1, &pipelineInfo, m_allocationCallbacks, &pipeline);
+}
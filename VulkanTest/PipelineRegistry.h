@@ -0,0 +1,82 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <array>                            // Fixed entry storage, stable for lock-free reads
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "GlobalApplicationConstants.h"     // g_PIPELINE_REGISTRY_CAPACITY
+#include "PipelineDescription.h"
+#include "ThreadPool.h"                     // Background compilation
+#include "FrameProfiler.h"                  // Compile times
+
+typedef uint32_t PipelineHandle;
+const PipelineHandle INVALID_PIPELINE_HANDLE = UINT32_MAX;
+
+// Owns every pipeline, graphics and compute. request() deduplicates by description and hands
+// back a handle immediately; the pipeline itself is compiled on the ThreadPool, and get() returns
+// VK_NULL_HANDLE (or the fallback) until it is ready, so recording never waits on the driver.
+class PipelineRegistry
+{
+public:
+    // CONSTRUCTOR
+    //------------------------------------------------------------------------//
+    PipelineRegistry();
+    //------------------------------------------------------------------------//
+
+    // PUBLIC FUNCTIONS
+    //------------------------------------------------------------------------//
+    void create(VkDevice, const VkAllocationCallbacks*, VkPipelineCache, ThreadPool&, FrameProfiler&);
+    void destruct();
+
+    PipelineHandle request(const PipelineDescription&);
+    VkPipeline get(PipelineHandle, PipelineHandle fallback = INVALID_PIPELINE_HANDLE) const;
+    bool isPending(PipelineHandle) const;
+    void waitForPending();
+
+    // Render thread, once per frame: moves finished compile times into the profiler
+    void collectCompileTimes();
+    //------------------------------------------------------------------------//
+
+private:
+    enum class EntryState : uint32_t
+    {
+        Pending,
+        Ready,
+        Failed
+    };
+
+    struct Entry
+    {
+        PipelineDescription         description;
+        std::atomic<VkPipeline>     pipeline;
+        std::atomic<EntryState>     state;
+    };
+
+    // PRIVATE MEMBERS
+    //------------------------------------------------------------------------//
+    VkDevice                                m_device;
+    const VkAllocationCallbacks*            m_allocationCallbacks;
+    VkPipelineCache                         m_cache;
+    ThreadPool*                             m_threadPool;
+    FrameProfiler*                          m_frameProfiler;
+    uint32_t                                m_compileChannel;
+    std::array<std::unique_ptr<Entry>, g_PIPELINE_REGISTRY_CAPACITY> m_entries;
+    std::atomic<uint32_t>                   m_entryCount;
+    std::unordered_map<PipelineDescription, PipelineHandle, PipelineDescriptionHasher> m_handles;
+    std::mutex                              m_requestMutex;         // request() only
+    std::vector<uint64_t>                   m_compileTimes;         // Nanoseconds, not yet in the profiler
+    std::mutex                              m_compileTimesMutex;
+    //------------------------------------------------------------------------//
+
+    // PRIVATE FUNCTIONS
+    //------------------------------------------------------------------------//
+    void compile(Entry&);
+    VkResult createGraphicsPipeline(const PipelineDescription&, VkShaderModule vertex, VkShaderModule fragment, VkPipeline&);
+    VkResult createComputePipeline(const PipelineDescription&, VkShaderModule compute, VkPipeline&);
+    //------------------------------------------------------------------------//
+};
@@ -6,6 +6,8 @@ struct QueueFamilyIndices
 {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentFamily;
+    std::optional<uint32_t> transferFamily;     // Dedicated to transfers if the device has one, else the graphics family
+    std::optional<uint32_t> computeFamily;      // Compute without graphics (async compute) if there is one, else the graphics family
 
     bool graphicsFamilyIsInitialized() 
     {
@@ -0,0 +1,1012 @@
+#include "RenderGraph.h"
+
+#include <algorithm>                        // std::sort
+#include <stdexcept>                        // Error reporting
+#include <string>
+
+namespace
+{
+    // What each RenderGraphAccess means to the GPU. Indexed by RenderGraphAccess
+    struct AccessInfo
+    {
+        VkPipelineStageFlags            stages;
+        VkAccessFlags                   readAccess;
+        VkAccessFlags                   writeAccess;                // 0 for accesses that cannot write
+        VkImageLayout                   layout;                     // UNDEFINED for buffer only accesses
+        VkImageUsageFlags               usage;
+    };
+
+    const AccessInfo ACCESS_INFO[static_cast<uint32_t>(RenderGraphAccess::Count)] = {
+        // ColorAttachment
+        {
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            VK_ACCESS_COLOR_ATTACHMENT_READ_BIT,
+            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT
+        },
+        // DepthAttachment
+        {
+            VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+            VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT
+        },
+        // SampledFragment
+        {
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            VK_ACCESS_SHADER_READ_BIT,
+            0,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_IMAGE_USAGE_SAMPLED_BIT
+        },
+        // SampledCompute
+        {
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_READ_BIT,
+            0,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_IMAGE_USAGE_SAMPLED_BIT
+        },
+        // StorageCompute
+        {
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_READ_BIT,
+            VK_ACCESS_SHADER_WRITE_BIT,
+            VK_IMAGE_LAYOUT_GENERAL,
+            VK_IMAGE_USAGE_STORAGE_BIT
+        },
+        // StorageVertex
+        {
+            VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+            VK_ACCESS_SHADER_READ_BIT,
+            0,
+            VK_IMAGE_LAYOUT_GENERAL,
+            VK_IMAGE_USAGE_STORAGE_BIT
+        },
+        // Indirect
+        {
+            VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+            VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+            0,
+            VK_IMAGE_LAYOUT_UNDEFINED,
+            0
+        },
+        // TransferSource
+        {
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_ACCESS_TRANSFER_READ_BIT,
+            0,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            VK_IMAGE_USAGE_TRANSFER_SRC_BIT
+        },
+        // TransferDestination
+        {
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0,
+            VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_IMAGE_USAGE_TRANSFER_DST_BIT
+        },
+        // MipGeneration. The generator moves levels between layouts itself, but starts from and
+        // leaves every level in SHADER_READ_ONLY
+        {
+            VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
+            VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT
+        }
+    };
+
+    const AccessInfo& accessInfo(RenderGraphAccess access)
+    {
+        return ACCESS_INFO[static_cast<uint32_t>(access)];
+    }
+
+    VkImageAspectFlags formatAspects(VkFormat format)
+    {
+        switch (format)
+        {
+        case VK_FORMAT_D16_UNORM:
+        case VK_FORMAT_X8_D24_UNORM_PACK32:
+        case VK_FORMAT_D32_SFLOAT:
+            return VK_IMAGE_ASPECT_DEPTH_BIT;
+        case VK_FORMAT_D16_UNORM_S8_UINT:
+        case VK_FORMAT_D24_UNORM_S8_UINT:
+        case VK_FORMAT_D32_SFLOAT_S8_UINT:
+            return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+        case VK_FORMAT_S8_UINT:
+            return VK_IMAGE_ASPECT_STENCIL_BIT;
+        default:
+            return VK_IMAGE_ASPECT_COLOR_BIT;
+        }
+    }
+
+    // The layouts accesses use, for writeSchedule()
+    const char* layoutName(VkImageLayout layout)
+    {
+        switch (layout)
+        {
+        case VK_IMAGE_LAYOUT_UNDEFINED:                         return "UNDEFINED";
+        case VK_IMAGE_LAYOUT_GENERAL:                           return "GENERAL";
+        case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:          return "COLOR_ATTACHMENT";
+        case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:  return "DEPTH_STENCIL_ATTACHMENT";
+        case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:          return "SHADER_READ_ONLY";
+        case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:              return "TRANSFER_SRC";
+        case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:              return "TRANSFER_DST";
+        case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:                   return "PRESENT_SRC";
+        default:                                                return "other";
+        }
+    }
+
+    bool sameDescription(const RenderGraphImageDescription& a, const RenderGraphImageDescription& b)
+    {
+        return a.format == b.format && a.extent.width == b.extent.width && a.extent.height == b.extent.height && a.samples == b.samples;
+    }
+}
+
+RenderGraph::RenderGraph()
+{
+    m_device = VK_NULL_HANDLE;
+    m_allocationCallbacks = nullptr;
+    m_allocator = nullptr;
+    m_deletionQueue = nullptr;
+    m_frameProfiler = nullptr;
+    m_cmdPipelineBarrier2 = nullptr;
+    m_finalBarrier = 0;
+    m_compiled = false;
+    m_statistics = {};
+
+    for (uint32_t i = 0; i < GaugeCount; i++) m_gauges[i] = 0;
+}
+
+void RenderGraph::create(
+    VkDevice                        device,
+    const VkAllocationCallbacks*    allocationCallbacks,
+    DeviceAllocator&                allocator,
+    DeletionQueue&                  deletionQueue,
+    FrameProfiler&                  frameProfiler,
+    PFN_vkCmdPipelineBarrier2KHR    cmdPipelineBarrier2)
+{
+    m_device = device;
+    m_allocationCallbacks = allocationCallbacks;
+    m_allocator = &allocator;
+    m_deletionQueue = &deletionQueue;
+    m_frameProfiler = &frameProfiler;
+    m_cmdPipelineBarrier2 = cmdPipelineBarrier2;
+
+    m_gauges[PassCountGauge] = frameProfiler.registerGauge("graph.passes");
+    m_gauges[CulledPassCountGauge] = frameProfiler.registerGauge("graph.culled_passes");
+    m_gauges[BarrierCountGauge] = frameProfiler.registerGauge("graph.barriers");
+    m_gauges[TransientBytesGauge] = frameProfiler.registerGauge("graph.transient_bytes");
+    m_gauges[AllocatedBytesGauge] = frameProfiler.registerGauge("graph.allocated_bytes");
+}
+
+void RenderGraph::destruct()
+{
+    reset();
+
+    for (TransientImage& transient : m_transients)
+    {
+        vkDestroyImageView(m_device, transient.view, m_allocationCallbacks);
+        vkDestroyImage(m_device, transient.image, m_allocationCallbacks);
+    }
+
+    for (MemoryAllocation& slot : m_slots)
+    {
+        m_allocator->free(slot);
+    }
+
+    m_transients.clear();
+    m_slots.clear();
+}
+
+void RenderGraph::reset()
+{
+    m_resources.clear();
+    m_passes.clear();
+    m_accesses.clear();
+    m_schedule.clear();
+    m_barriers.clear();
+    m_finalBarrier = 0;
+    m_compiled = false;
+}
+
+RenderGraphResource RenderGraph::addResource(const char* name)
+{
+    Resource resource{};
+    resource.name = name;
+    resource.finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    resource.transient = UINT32_MAX;
+    resource.predecessor = INVALID_RENDER_GRAPH_RESOURCE;
+
+    m_resources.push_back(resource);
+    return static_cast<RenderGraphResource>(m_resources.size() - 1);
+}
+
+RenderGraphResource RenderGraph::importImage(
+    const char*                     name,
+    VkImage                         image,
+    VkImageView                     view,
+    VkImageAspectFlags              aspects,
+    const RenderGraphImportState&   initial,
+    VkImageLayout                   finalLayout)
+{
+    RenderGraphResource handle = addResource(name);
+    Resource& resource = m_resources[handle];
+    resource.imported = true;
+    resource.image = image;
+    resource.view = view;
+    resource.aspects = aspects;
+    resource.initial = initial;
+    resource.finalLayout = finalLayout;
+
+    return handle;
+}
+
+RenderGraphResource RenderGraph::importBuffer(const char* name, VkBuffer buffer, const RenderGraphImportState& initial)
+{
+    RenderGraphResource handle = addResource(name);
+    Resource& resource = m_resources[handle];
+    resource.imported = true;
+    resource.isBuffer = true;
+    resource.buffer = buffer;
+    resource.initial = initial;
+
+    return handle;
+}
+
+RenderGraphResource RenderGraph::createImage(const char* name, const RenderGraphImageDescription& description)
+{
+    RenderGraphResource handle = addResource(name);
+    Resource& resource = m_resources[handle];
+    resource.description = description;
+    resource.aspects = formatAspects(description.format);
+
+    return handle;
+}
+
+uint32_t RenderGraph::addPass(const char* name, RecordFunction record, void* context)
+{
+    Pass pass{};
+    pass.name = name;
+    pass.record = record;
+    pass.context = context;
+
+    m_passes.push_back(pass);
+    return static_cast<uint32_t>(m_passes.size() - 1);
+}
+
+void RenderGraph::read(uint32_t pass, RenderGraphResource resource, RenderGraphAccess access)
+{
+    addAccess(pass, resource, access, true, false);
+}
+
+void RenderGraph::write(uint32_t pass, RenderGraphResource resource, RenderGraphAccess access)
+{
+    if (accessInfo(access).writeAccess == 0)
+    {
+        throw std::runtime_error(std::string("Render graph pass ") + m_passes[pass].name + " cannot write " + m_resources[resource].name + " with a read only access");
+    }
+
+    addAccess(pass, resource, access, false, true);
+}
+
+void RenderGraph::keep(uint32_t pass)
+{
+    m_passes[pass].kept = true;
+}
+
+void RenderGraph::addAccess(uint32_t pass, RenderGraphResource resource, RenderGraphAccess access, bool reads, bool writes)
+{
+    const AccessInfo& info = accessInfo(access);
+
+    // Attachments, sampling and mips only make sense for images, indirect arguments only for buffers
+    bool imageOnly = (info.usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT)) != 0
+        || access == RenderGraphAccess::MipGeneration;
+    bool bufferOnly = info.layout == VK_IMAGE_LAYOUT_UNDEFINED;
+
+    if (m_resources[resource].isBuffer ? imageOnly : bufferOnly)
+    {
+        throw std::runtime_error(std::string("Render graph pass ") + m_passes[pass].name + " accesses " + m_resources[resource].name + " in a way only "
+            + (m_resources[resource].isBuffer ? "images" : "buffers") + " can be");
+    }
+
+    m_accesses.push_back({ pass, resource, access, reads, writes });
+}
+
+void RenderGraph::compile(uint64_t retireValue)
+{
+    // Accesses grouped by pass, then by resource so that a pass touching a resource several ways
+    // is planned as one access. Their order within a group does not matter, and std::sort, unlike
+    // std::stable_sort, needs no temporary buffer
+    std::sort(m_accesses.begin(), m_accesses.end(), [](const Access& a, const Access& b) {
+        return a.pass != b.pass ? a.pass < b.pass : a.resource < b.resource;
+    });
+
+    for (uint32_t i = 0, pass = 0; pass < m_passes.size(); pass++)
+    {
+        m_passes[pass].firstAccess = i;
+
+        while (i < m_accesses.size() && m_accesses[i].pass == pass) i++;
+
+        m_passes[pass].accessCount = i - m_passes[pass].firstAccess;
+    }
+
+    cull();
+    gatherLifetimes();
+    allocateTransients(retireValue);
+    planBarriers();
+
+    m_statistics.passCount = static_cast<uint32_t>(m_passes.size());
+    m_statistics.culledPassCount = static_cast<uint32_t>(m_passes.size() - m_schedule.size());
+
+    m_frameProfiler->setGauge(m_gauges[PassCountGauge], m_statistics.passCount);
+    m_frameProfiler->setGauge(m_gauges[CulledPassCountGauge], m_statistics.culledPassCount);
+    m_frameProfiler->setGauge(m_gauges[BarrierCountGauge], m_statistics.imageBarrierCount + m_statistics.bufferBarrierCount);
+    m_frameProfiler->setGauge(m_gauges[TransientBytesGauge], static_cast<double>(m_statistics.transientBytes));
+    m_frameProfiler->setGauge(m_gauges[AllocatedBytesGauge], static_cast<double>(m_statistics.allocatedBytes));
+
+    m_compiled = true;
+}
+
+void RenderGraph::cull()
+{
+    // Walking backwards, a resource is live while some pass still to run (or whoever uses an
+    // imported resource after the graph) wants its current contents. A pass is kept if it writes
+    // anything live, or was asked to be, and then its own reads become live
+    m_live.resize(m_resources.size());
+
+    for (size_t i = 0; i < m_resources.size(); i++)
+    {
+        m_live[i] = m_resources[i].imported;
+    }
+
+    m_schedule.clear();
+
+    for (uint32_t pass = static_cast<uint32_t>(m_passes.size()); pass-- > 0;)
+    {
+        Pass& current = m_passes[pass];
+        uint32_t end = current.firstAccess + current.accessCount;
+        bool needed = current.kept;
+
+        for (uint32_t i = current.firstAccess; i < end; i++)
+        {
+            needed = needed || (m_accesses[i].writes && m_live[m_accesses[i].resource]);
+        }
+
+        current.culled = !needed;
+
+        if (!needed) continue;
+
+        m_schedule.push_back(pass);
+
+        // Overwritten contents are dead before this pass, unless it also reads them
+        for (uint32_t i = current.firstAccess; i < end; i++)
+        {
+            if (m_accesses[i].writes) m_live[m_accesses[i].resource] = false;
+        }
+
+        for (uint32_t i = current.firstAccess; i < end; i++)
+        {
+            if (m_accesses[i].reads) m_live[m_accesses[i].resource] = true;
+        }
+    }
+
+    std::reverse(m_schedule.begin(), m_schedule.end());
+}
+
+void RenderGraph::gatherLifetimes()
+{
+    for (Resource& resource : m_resources)
+    {
+        resource.usage = 0;
+        resource.firstPass = UINT32_MAX;
+        resource.lastPass = 0;
+        resource.usedStages = 0;
+        resource.writtenAccess = 0;
+        resource.transient = UINT32_MAX;
+        resource.predecessor = INVALID_RENDER_GRAPH_RESOURCE;
+    }
+
+    for (uint32_t position = 0; position < m_schedule.size(); position++)
+    {
+        const Pass& pass = m_passes[m_schedule[position]];
+
+        for (uint32_t i = pass.firstAccess; i < pass.firstAccess + pass.accessCount; i++)
+        {
+            const Access& access = m_accesses[i];
+            const AccessInfo& info = accessInfo(access.access);
+            Resource& resource = m_resources[access.resource];
+
+            // The first access to a transient image decides whether it has any contents to read
+            if (resource.firstPass == UINT32_MAX && !resource.imported)
+            {
+                bool reads = false;
+
+                for (uint32_t j = i; j < pass.firstAccess + pass.accessCount && m_accesses[j].resource == access.resource; j++)
+                {
+                    reads = reads || m_accesses[j].reads;
+                }
+
+                if (reads)
+                {
+                    throw std::runtime_error(std::string("Render graph pass ") + pass.name + " reads transient image " + resource.name + " before anything writes it");
+                }
+            }
+
+            resource.usage |= info.usage;
+            resource.firstPass = std::min(resource.firstPass, position);
+            resource.lastPass = position;
+            resource.usedStages |= info.stages;
+
+            if (access.writes) resource.writtenAccess |= info.writeAccess;
+        }
+    }
+}
+
+void RenderGraph::allocateTransients(uint64_t retireValue)
+{
+    // The transient images the schedule uses, in resource order
+    m_used.clear();
+
+    for (RenderGraphResource i = 0; i < m_resources.size(); i++)
+    {
+        const Resource& resource = m_resources[i];
+
+        if (!resource.imported && resource.firstPass != UINT32_MAX) m_used.push_back(i);
+    }
+
+    bool unchanged = m_used.size() == m_transients.size();
+
+    for (size_t i = 0; unchanged && i < m_used.size(); i++)
+    {
+        const Resource& resource = m_resources[m_used[i]];
+        const TransientImage& transient = m_transients[i];
+
+        unchanged = sameDescription(resource.description, transient.description) && resource.usage == transient.usage
+            && resource.firstPass == transient.firstPass && resource.lastPass == transient.lastPass;
+    }
+
+    if (!unchanged)
+    {
+        retireTransients(retireValue);
+
+        m_transients.resize(m_used.size());
+
+        for (size_t i = 0; i < m_used.size(); i++)
+        {
+            const Resource& resource = m_resources[m_used[i]];
+            TransientImage& transient = m_transients[i];
+            transient = {};
+            transient.description = resource.description;
+            transient.usage = resource.usage;
+            transient.firstPass = resource.firstPass;
+            transient.lastPass = resource.lastPass;
+
+            VkImageCreateInfo imageInfo{};
+            imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            imageInfo.imageType = VK_IMAGE_TYPE_2D;
+            imageInfo.format = resource.description.format;
+            imageInfo.extent = { resource.description.extent.width, resource.description.extent.height, 1 };
+            imageInfo.mipLevels = 1;
+            imageInfo.arrayLayers = 1;
+            imageInfo.samples = resource.description.samples;
+            imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+            imageInfo.usage = resource.usage;
+            imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+            if (vkCreateImage(m_device, &imageInfo, m_allocationCallbacks, &transient.image) != VK_SUCCESS)
+            {
+                throw std::runtime_error(std::string("Failed to create render graph image ") + resource.name);
+            }
+
+            vkGetImageMemoryRequirements(m_device, transient.image, &transient.requirements);
+        }
+
+        // Largest first, each into the first slot whose occupants are all dead before it starts
+        // or born after it ends. Slots grow to their largest occupant
+        m_order.resize(m_transients.size());
+
+        for (uint32_t i = 0; i < m_order.size(); i++) m_order[i] = i;
+
+        std::sort(m_order.begin(), m_order.end(), [this](uint32_t a, uint32_t b) {
+            return m_transients[a].requirements.size > m_transients[b].requirements.size;
+        });
+
+        // Only built when the images are recreated, which allocates anyway
+        std::vector<VkMemoryRequirements> slotRequirements;
+        std::vector<std::vector<uint32_t>> slotOccupants;
+
+        for (uint32_t index : m_order)
+        {
+            TransientImage& transient = m_transients[index];
+            uint32_t slot = 0;
+
+            for (; slot < slotRequirements.size(); slot++)
+            {
+                if ((slotRequirements[slot].memoryTypeBits & transient.requirements.memoryTypeBits) == 0) continue;
+
+                bool disjoint = true;
+
+                for (uint32_t occupant : slotOccupants[slot])
+                {
+                    const TransientImage& other = m_transients[occupant];
+                    disjoint = disjoint && (other.lastPass < transient.firstPass || transient.lastPass < other.firstPass);
+                }
+
+                if (disjoint) break;
+            }
+
+            if (slot == slotRequirements.size())
+            {
+                slotRequirements.push_back(transient.requirements);
+                slotOccupants.emplace_back();
+            }
+
+            VkMemoryRequirements& requirements = slotRequirements[slot];
+            requirements.size = std::max(requirements.size, transient.requirements.size);
+            requirements.alignment = std::max(requirements.alignment, transient.requirements.alignment);
+            requirements.memoryTypeBits &= transient.requirements.memoryTypeBits;
+
+            slotOccupants[slot].push_back(index);
+            transient.slot = slot;
+        }
+
+        m_slots.resize(slotRequirements.size());
+
+        for (size_t slot = 0; slot < m_slots.size(); slot++)
+        {
+            m_slots[slot] = m_allocator->allocate(slotRequirements[slot], VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryResourceKind::Optimal);
+        }
+
+        for (size_t i = 0; i < m_transients.size(); i++)
+        {
+            TransientImage& transient = m_transients[i];
+            const MemoryAllocation& memory = m_slots[transient.slot];
+            const Resource& resource = m_resources[m_used[i]];
+
+            if (vkBindImageMemory(m_device, transient.image, memory.memory, memory.offset) != VK_SUCCESS)
+            {
+                throw std::runtime_error(std::string("Failed to bind render graph image ") + resource.name);
+            }
+
+            VkImageViewCreateInfo viewInfo{};
+            viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            viewInfo.image = transient.image;
+            viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            viewInfo.format = resource.description.format;
+            viewInfo.subresourceRange = { resource.aspects, 0, 1, 0, 1 };
+
+            if (vkCreateImageView(m_device, &viewInfo, m_allocationCallbacks, &transient.view) != VK_SUCCESS)
+            {
+                throw std::runtime_error(std::string("Failed to create render graph image view ") + resource.name);
+            }
+        }
+    }
+
+    m_statistics.transientImageCount = static_cast<uint32_t>(m_transients.size());
+    m_statistics.transientBytes = 0;
+    m_statistics.allocatedBytes = 0;
+
+    for (size_t i = 0; i < m_used.size(); i++)
+    {
+        Resource& resource = m_resources[m_used[i]];
+        resource.transient = static_cast<uint32_t>(i);
+        resource.image = m_transients[i].image;
+        resource.view = m_transients[i].view;
+
+        m_statistics.transientBytes += m_transients[i].requirements.size;
+    }
+
+    for (const MemoryAllocation& slot : m_slots)
+    {
+        m_statistics.allocatedBytes += slot.size;
+    }
+
+    // Each image follows the one before it in its slot, and the first follows the last, which
+    // used the memory in the previous frame. On its own in a slot, an image follows itself
+    for (uint32_t slot = 0; slot < m_slots.size(); slot++)
+    {
+        m_occupants.clear();
+
+        for (RenderGraphResource resource : m_used)
+        {
+            if (m_transients[m_resources[resource].transient].slot == slot) m_occupants.push_back(resource);
+        }
+
+        std::sort(m_occupants.begin(), m_occupants.end(), [this](RenderGraphResource a, RenderGraphResource b) {
+            return m_resources[a].firstPass < m_resources[b].firstPass;
+        });
+
+        for (size_t i = 0; i < m_occupants.size(); i++)
+        {
+            m_resources[m_occupants[i]].predecessor = m_occupants[(i + m_occupants.size() - 1) % m_occupants.size()];
+        }
+    }
+}
+
+void RenderGraph::retireTransients(uint64_t retireValue)
+{
+    if (m_transients.empty() && m_slots.empty()) return;
+
+    VkDevice device = m_device;
+    const VkAllocationCallbacks* allocationCallbacks = m_allocationCallbacks;
+    DeviceAllocator* allocator = m_allocator;
+    std::vector<TransientImage> transients = std::move(m_transients);
+    std::vector<MemoryAllocation> slots = std::move(m_slots);
+
+    m_deletionQueue->push(retireValue, [device, allocationCallbacks, allocator, transients, slots]() mutable {
+        for (TransientImage& transient : transients)
+        {
+            vkDestroyImageView(device, transient.view, allocationCallbacks);
+            vkDestroyImage(device, transient.image, allocationCallbacks);
+        }
+
+        for (MemoryAllocation& slot : slots) allocator->free(slot);
+    });
+
+    m_transients.clear();
+    m_slots.clear();
+}
+
+void RenderGraph::planBarriers()
+{
+    m_states.resize(m_resources.size());
+
+    for (size_t i = 0; i < m_resources.size(); i++)
+    {
+        const Resource& resource = m_resources[i];
+        ResourceState& state = m_states[i];
+        state = {};
+
+        if (resource.imported)
+        {
+            state.layout = resource.initial.layout;
+            state.writeStages = resource.initial.stages;
+            state.writeAccess = resource.initial.access;
+        }
+        else if (resource.predecessor != INVALID_RENDER_GRAPH_RESOURCE)
+        {
+            // Whatever had the memory last has to be done with it, reads included
+            const Resource& predecessor = m_resources[resource.predecessor];
+            state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+            state.writeStages = predecessor.usedStages;
+            state.writeAccess = predecessor.writtenAccess;
+        }
+    }
+
+    m_barriers.clear();
+
+    for (uint32_t passIndex : m_schedule)
+    {
+        Pass& pass = m_passes[passIndex];
+        pass.firstBarrier = static_cast<uint32_t>(m_barriers.size());
+
+        uint32_t end = pass.firstAccess + pass.accessCount;
+
+        for (uint32_t i = pass.firstAccess; i < end;)
+        {
+            RenderGraphResource resource = m_accesses[i].resource;
+            const Resource& current = m_resources[resource];
+            VkPipelineStageFlags stages = 0;
+            VkAccessFlags access = 0;
+            VkAccessFlags writeAccess = 0;
+            VkImageLayout layout = accessInfo(m_accesses[i].access).layout;
+
+            for (; i < end && m_accesses[i].resource == resource; i++)
+            {
+                const AccessInfo& info = accessInfo(m_accesses[i].access);
+
+                if (!current.isBuffer && info.layout != layout)
+                {
+                    throw std::runtime_error(std::string("Render graph pass ") + pass.name + " needs " + current.name + " in two layouts at once");
+                }
+
+                // Passes that write still read what they write, depth tests and blending do
+                stages |= info.stages;
+                access |= info.readAccess;
+
+                if (m_accesses[i].writes) writeAccess |= info.writeAccess;
+            }
+
+            planAccess(m_states[resource], resource, stages, access | writeAccess, writeAccess, current.isBuffer ? VK_IMAGE_LAYOUT_UNDEFINED : layout);
+        }
+
+        pass.barrierCount = static_cast<uint32_t>(m_barriers.size()) - pass.firstBarrier;
+    }
+
+    // Imported images are handed back in the layout whoever comes next expects
+    m_finalBarrier = static_cast<uint32_t>(m_barriers.size());
+
+    for (RenderGraphResource i = 0; i < m_resources.size(); i++)
+    {
+        const Resource& resource = m_resources[i];
+        const ResourceState& state = m_states[i];
+
+        if (!resource.imported || resource.isBuffer) continue;
+        if (resource.finalLayout == VK_IMAGE_LAYOUT_UNDEFINED || resource.finalLayout == state.layout) continue;
+
+        Barrier barrier{};
+        barrier.resource = i;
+        barrier.srcStages = state.readStages != 0 ? state.readStages : state.writeStages;
+        barrier.srcAccess = state.readStages != 0 ? 0 : state.writeAccess;
+        barrier.dstStages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+        barrier.dstAccess = 0;
+        barrier.oldLayout = state.layout;
+        barrier.newLayout = resource.finalLayout;
+
+        m_barriers.push_back(barrier);
+    }
+
+    m_statistics.batchCount = 0;
+    m_statistics.imageBarrierCount = 0;
+    m_statistics.bufferBarrierCount = 0;
+
+    for (uint32_t passIndex : m_schedule)
+    {
+        if (m_passes[passIndex].barrierCount > 0) m_statistics.batchCount++;
+    }
+
+    if (m_finalBarrier < m_barriers.size()) m_statistics.batchCount++;
+
+    for (const Barrier& barrier : m_barriers)
+    {
+        if (m_resources[barrier.resource].isBuffer) m_statistics.bufferBarrierCount++;
+        else                                        m_statistics.imageBarrierCount++;
+    }
+}
+
+void RenderGraph::planAccess(ResourceState& state, RenderGraphResource resource, VkPipelineStageFlags stages, VkAccessFlags access, VkAccessFlags writeAccess, VkImageLayout layout)
+{
+    bool transition = !m_resources[resource].isBuffer && layout != state.layout;
+
+    Barrier barrier{};
+    barrier.resource = resource;
+    barrier.dstStages = stages;
+    barrier.dstAccess = access;
+    barrier.oldLayout = state.layout;
+    barrier.newLayout = layout;
+
+    if (writeAccess != 0 || transition)
+    {
+        // Writes, and layout transitions, wait for the reads since the last write. Those already
+        // waited for the write, so only without them does the write itself need waiting for
+        barrier.srcStages = state.readStages != 0 ? state.readStages : state.writeStages;
+        barrier.srcAccess = state.readStages != 0 ? 0 : state.writeAccess;
+
+        if (transition || barrier.srcStages != 0)
+        {
+            m_barriers.push_back(barrier);
+        }
+
+        // A transition counts as a write that later accesses in other stages have to wait for
+        state.layout = layout;
+        state.writeStages = stages;
+        state.writeAccess = writeAccess;
+        state.readStages = writeAccess != 0 ? 0 : stages;
+        state.visibleStages = writeAccess != 0 ? 0 : stages;
+        state.visibleAccess = writeAccess != 0 ? 0 : access;
+        return;
+    }
+
+    // Reads of a write already made visible to them need nothing
+    if (state.writeStages != 0 && ((stages & ~state.visibleStages) != 0 || (access & ~state.visibleAccess) != 0))
+    {
+        barrier.srcStages = state.writeStages;
+        barrier.srcAccess = state.writeAccess;
+
+        m_barriers.push_back(barrier);
+
+        state.visibleStages |= stages;
+        state.visibleAccess |= access;
+    }
+
+    state.readStages |= stages;
+}
+
+void RenderGraph::execute(VkCommandBuffer commandBuffer)
+{
+    if (!m_compiled)
+    {
+        throw std::runtime_error("Render graph executed without being compiled");
+    }
+
+    for (uint32_t passIndex : m_schedule)
+    {
+        const Pass& pass = m_passes[passIndex];
+
+        recordBarriers(commandBuffer, pass.firstBarrier, pass.barrierCount);
+
+        if (pass.record != nullptr) pass.record(commandBuffer, *this, pass.context);
+    }
+
+    recordBarriers(commandBuffer, m_finalBarrier, static_cast<uint32_t>(m_barriers.size()) - m_finalBarrier);
+}
+
+void RenderGraph::recordBarriers(VkCommandBuffer commandBuffer, uint32_t first, uint32_t count)
+{
+    if (count == 0) return;
+
+    if (m_cmdPipelineBarrier2 != nullptr)
+    {
+        m_imageBarriers2.clear();
+        m_bufferBarriers2.clear();
+
+        for (uint32_t i = first; i < first + count; i++)
+        {
+            const Barrier& barrier = m_barriers[i];
+            const Resource& resource = m_resources[barrier.resource];
+
+            if (resource.isBuffer)
+            {
+                VkBufferMemoryBarrier2KHR bufferBarrier{};
+                bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2_KHR;
+                bufferBarrier.srcStageMask = barrier.srcStages;
+                bufferBarrier.srcAccessMask = barrier.srcAccess;
+                bufferBarrier.dstStageMask = barrier.dstStages;
+                bufferBarrier.dstAccessMask = barrier.dstAccess;
+                bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                bufferBarrier.buffer = resource.buffer;
+                bufferBarrier.offset = 0;
+                bufferBarrier.size = VK_WHOLE_SIZE;
+
+                m_bufferBarriers2.push_back(bufferBarrier);
+                continue;
+            }
+
+            VkImageMemoryBarrier2KHR imageBarrier{};
+            imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR;
+            imageBarrier.srcStageMask = barrier.srcStages;
+            imageBarrier.srcAccessMask = barrier.srcAccess;
+            imageBarrier.dstStageMask = barrier.dstStages;
+            imageBarrier.dstAccessMask = barrier.dstAccess;
+            imageBarrier.oldLayout = barrier.oldLayout;
+            imageBarrier.newLayout = barrier.newLayout;
+            imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageBarrier.image = resource.image;
+            imageBarrier.subresourceRange = { resource.aspects, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+
+            m_imageBarriers2.push_back(imageBarrier);
+        }
+
+        VkDependencyInfoKHR dependencyInfo{};
+        dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR;
+        dependencyInfo.bufferMemoryBarrierCount = static_cast<uint32_t>(m_bufferBarriers2.size());
+        dependencyInfo.pBufferMemoryBarriers = m_bufferBarriers2.data();
+        dependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(m_imageBarriers2.size());
+        dependencyInfo.pImageMemoryBarriers = m_imageBarriers2.data();
+
+        m_cmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+        return;
+    }
+
+    // One stage mask pair for the whole batch
+    VkPipelineStageFlags srcStages = 0;
+    VkPipelineStageFlags dstStages = 0;
+
+    m_imageBarriers.clear();
+    m_bufferBarriers.clear();
+
+    for (uint32_t i = first; i < first + count; i++)
+    {
+        const Barrier& barrier = m_barriers[i];
+        const Resource& resource = m_resources[barrier.resource];
+
+        srcStages |= barrier.srcStages;
+        dstStages |= barrier.dstStages;
+
+        if (resource.isBuffer)
+        {
+            VkBufferMemoryBarrier bufferBarrier{};
+            bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            bufferBarrier.srcAccessMask = barrier.srcAccess;
+            bufferBarrier.dstAccessMask = barrier.dstAccess;
+            bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            bufferBarrier.buffer = resource.buffer;
+            bufferBarrier.offset = 0;
+            bufferBarrier.size = VK_WHOLE_SIZE;
+
+            m_bufferBarriers.push_back(bufferBarrier);
+            continue;
+        }
+
+        VkImageMemoryBarrier imageBarrier{};
+        imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        imageBarrier.srcAccessMask = barrier.srcAccess;
+        imageBarrier.dstAccessMask = barrier.dstAccess;
+        imageBarrier.oldLayout = barrier.oldLayout;
+        imageBarrier.newLayout = barrier.newLayout;
+        imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.image = resource.image;
+        imageBarrier.subresourceRange = { resource.aspects, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+
+        m_imageBarriers.push_back(imageBarrier);
+    }
+
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        srcStages != 0 ? srcStages : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
+        dstStages != 0 ? dstStages : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT),
+        0,
+        0, nullptr,
+        static_cast<uint32_t>(m_bufferBarriers.size()), m_bufferBarriers.data(),
+        static_cast<uint32_t>(m_imageBarriers.size()), m_imageBarriers.data()
+    );
+}
+
+VkImage RenderGraph::image(RenderGraphResource resource) const
+{
+    return m_resources[resource].image;
+}
+
+VkImageView RenderGraph::imageView(RenderGraphResource resource) const
+{
+    return m_resources[resource].view;
+}
+
+VkBuffer RenderGraph::buffer(RenderGraphResource resource) const
+{
+    return m_resources[resource].buffer;
+}
+
+const RenderGraphStatistics& RenderGraph::statistics() const
+{
+    return m_statistics;
+}
+
+void RenderGraph::writeSchedule(std::ostream& out) const
+{
+    for (uint32_t pass = 0; pass < m_passes.size(); pass++)
+    {
+        const Pass& current = m_passes[pass];
+
+        if (current.culled)
+        {
+            out << "  " << current.name << " (culled)" << std::endl;
+            continue;
+        }
+
+        out << "  " << current.name << std::endl;
+
+        for (uint32_t i = current.firstBarrier; i < current.firstBarrier + current.barrierCount; i++)
+        {
+            const Barrier& barrier = m_barriers[i];
+            out << "    barrier " << m_resources[barrier.resource].name;
+
+            if (barrier.oldLayout != barrier.newLayout)
+            {
+                out << " " << layoutName(barrier.oldLayout) << " -> " << layoutName(barrier.newLayout);
+            }
+
+            out << std::endl;
+        }
+    }
+
+    for (uint32_t i = m_finalBarrier; i < m_barriers.size(); i++)
+    {
+        const Barrier& barrier = m_barriers[i];
+        out << "  final " << m_resources[barrier.resource].name << " " << layoutName(barrier.oldLayout) << " -> " << layoutName(barrier.newLayout) << std::endl;
+    }
+
+    for (uint32_t slot = 0; slot < m_slots.size(); slot++)
+    {
+        out << "  memory " << slot << " (" << m_slots[slot].size / 1024 << " KiB):";
+
+        for (const Resource& resource : m_resources)
+        {
+            if (resource.transient == UINT32_MAX || m_transients[resource.transient].slot != slot) continue;
+
+            out << " " << resource.name << " [" << resource.firstPass << "-" << resource.lastPass << "]";
+        }
+
+        out << std::endl;
+    }
+}
@@ -0,0 +1,307 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <ostream>                          // Schedule dumps
+#include <vector>
+
+#include "DeviceAllocator.h"                // Transient image memory
+#include "DeletionQueue.h"                  // Transient images retire with the frame timeline
+#include "FrameProfiler.h"                  // Compilation gauges
+
+// Index of a resource within the graph being built, only meaningful until the next reset()
+typedef uint32_t RenderGraphResource;
+const RenderGraphResource INVALID_RENDER_GRAPH_RESOURCE = UINT32_MAX;
+
+// How a pass uses a resource. Each one fixes the pipeline stages, access flags and image layout,
+// whether it is a read or a write is declared separately
+enum class RenderGraphAccess
+{
+    ColorAttachment,                                                // Resolves too
+    DepthAttachment,
+    SampledFragment,
+    SampledCompute,
+    StorageCompute,                                                 // GENERAL layout for images
+    StorageVertex,                                                  // Buffers read by the vertex shader
+    Indirect,                                                       // Buffers only
+    TransferSource,
+    TransferDestination,
+    MipGeneration,                                                  // MipGenerator::record(), either path
+    Count
+};
+
+// What a transient image looks like. Usage follows from how the passes access it
+struct RenderGraphImageDescription
+{
+    VkFormat                            format = VK_FORMAT_UNDEFINED;
+    VkExtent2D                          extent = { 0, 0 };
+    VkSampleCountFlagBits               samples = VK_SAMPLE_COUNT_1_BIT;
+};
+
+// Where an imported resource was last used before the graph, outside of it or in the previous
+// frame. An UNDEFINED layout discards the image's contents
+struct RenderGraphImportState
+{
+    VkImageLayout                       layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkPipelineStageFlags                stages = 0;
+    VkAccessFlags                       access = 0;                 // Writes to make available
+};
+
+struct RenderGraphStatistics
+{
+    uint32_t                            passCount;
+    uint32_t                            culledPassCount;
+    uint32_t                            batchCount;                 // Pipeline barrier commands
+    uint32_t                            imageBarrierCount;
+    uint32_t                            bufferBarrierCount;
+    uint32_t                            transientImageCount;
+    VkDeviceSize                        transientBytes;             // What the transient images would need apart
+    VkDeviceSize                        allocatedBytes;             // What they share
+};
+
+// A frame described as passes that declare what they read and write, rather than as command
+// buffer code with barriers in between. compile() works out the rest:
+//
+//   culling    passes none of whose writes reach an imported resource, directly or through other
+//              passes' reads, are dropped along with the transient images only they touch, unless
+//              keep() says otherwise
+//   barriers   each pass gets at most one pipeline barrier command holding every layout transition
+//              and memory dependency its accesses need, from the last access to each resource.
+//              Reads that follow reads share the previous barrier
+//   aliasing   transient images whose lifetimes, in passes, do not overlap are bound to the same
+//              memory. Each one starts from UNDEFINED after whatever occupied the memory before
+//
+// Passes run in the order they were added, the graph does not reorder them. Transient images stay
+// allocated from one compile to the next as long as their descriptions and lifetimes stay the
+// same, so a graph rebuilt every frame with the same shape allocates no device memory. Nor does it
+// allocate host memory once the graph has been that size before: passes keep a function pointer
+// and a context rather than an owning callback, and compile() plans in reused scratch vectors.
+//
+// With a vkCmdPipelineBarrier2KHR entry point every barrier keeps its own stages, without one the
+// stages of a batch are merged into a single vkCmdPipelineBarrier.
+//
+// Render thread only.
+class RenderGraph
+{
+public:
+    // Called with the context given to addPass()
+    typedef void (*RecordFunction)(VkCommandBuffer, const RenderGraph&, void* context);
+
+    // CONSTRUCTOR
+    //------------------------------------------------------------------------//
+    RenderGraph();
+    //------------------------------------------------------------------------//
+
+    // PUBLIC FUNCTIONS
+    //------------------------------------------------------------------------//
+    void create(
+        VkDevice,
+        const VkAllocationCallbacks*,
+        DeviceAllocator&,
+        DeletionQueue&,
+        FrameProfiler&,
+        PFN_vkCmdPipelineBarrier2KHR                                // May be null
+    );
+
+    // The device must be idle
+    void destruct();
+
+    // Starts building a new graph. Transient images survive until the next compile()
+    void reset();
+
+    // Imported images are left in finalLayout, or whatever layout their last access needs when
+    // that is UNDEFINED
+    RenderGraphResource importImage(
+        const char* name,
+        VkImage,
+        VkImageView,
+        VkImageAspectFlags,
+        const RenderGraphImportState&,
+        VkImageLayout finalLayout
+    );
+
+    RenderGraphResource importBuffer(const char* name, VkBuffer, const RenderGraphImportState&);
+    RenderGraphResource createImage(const char* name, const RenderGraphImageDescription&);
+
+    // Returns the pass, to declare its accesses with. The function may be null for passes that
+    // only exist to order their accesses. The context has to outlive execute()
+    uint32_t addPass(const char* name, RecordFunction, void* context);
+
+    // Records with record(commandBuffer, graph). Only a pointer to the callable is kept, so it is
+    // taken by reference, and has to outlive execute() like any other context
+    template<typename Record>
+    uint32_t addPass(const char* name, Record& record)
+    {
+        return addPass(name, [](VkCommandBuffer commandBuffer, const RenderGraph& graph, void* context) {
+            (*static_cast<Record*>(context))(commandBuffer, graph);
+        }, &record);
+    }
+
+    // The pass uses the resource's current contents
+    void read(uint32_t pass, RenderGraphResource, RenderGraphAccess);
+
+    // The pass produces new contents. Declared without a read of the same resource, the old
+    // contents are not needed. Throws std::runtime_error for accesses that cannot write
+    void write(uint32_t pass, RenderGraphResource, RenderGraphAccess);
+
+    // Culling keeps the pass whatever it writes, for passes with effects the graph cannot see,
+    // such as a render pass that transitions its attachments itself
+    void keep(uint32_t pass);
+
+    // Culls, plans barriers and binds the transient images. Images replaced since the last compile
+    // are retired once the frame at retireValue is complete. Throws std::runtime_error if a pass
+    // needs one resource in two layouts, or reads a transient image nothing has written
+    void compile(uint64_t retireValue);
+
+    // Records the passes that survived culling with their barriers, then the final transitions
+    void execute(VkCommandBuffer);
+
+    // Transient images are only valid after compile()
+    VkImage image(RenderGraphResource) const;
+    VkImageView imageView(RenderGraphResource) const;
+    VkBuffer buffer(RenderGraphResource) const;
+
+    const RenderGraphStatistics& statistics() const;
+
+    // The compiled passes in order, with their barriers and which transient images share memory
+    void writeSchedule(std::ostream&) const;
+    //------------------------------------------------------------------------//
+
+private:
+    struct Resource
+    {
+        const char*                         name;
+        bool                                imported;
+        bool                                isBuffer;
+        VkImage                             image;
+        VkImageView                         view;
+        VkBuffer                            buffer;
+        VkImageAspectFlags                  aspects;
+        RenderGraphImageDescription         description;            // Transient images
+        RenderGraphImportState              initial;                // Imported resources
+        VkImageLayout                       finalLayout;
+        VkImageUsageFlags                   usage;                  // Gathered from the surviving accesses
+        uint32_t                            firstPass;              // Lifetime in schedule positions
+        uint32_t                            lastPass;
+        VkPipelineStageFlags                usedStages;             // Over the whole lifetime
+        VkAccessFlags                       writtenAccess;
+        uint32_t                            transient;              // Index into m_transients
+        uint32_t                            predecessor;            // Resource using its memory before it
+    };
+
+    struct Access
+    {
+        uint32_t                            pass;
+        RenderGraphResource                 resource;
+        RenderGraphAccess                   access;
+        bool                                reads;
+        bool                                writes;
+    };
+
+    struct Pass
+    {
+        const char*                         name;
+        RecordFunction                      record;
+        void*                               context;
+        uint32_t                            firstAccess;            // Into m_accesses, once sorted
+        uint32_t                            accessCount;
+        bool                                kept;                   // Never culled
+        bool                                culled;
+        uint32_t                            firstBarrier;           // Into m_barriers
+        uint32_t                            barrierCount;
+    };
+
+    // Per resource while planning barriers
+    struct ResourceState
+    {
+        VkImageLayout                       layout;
+        VkPipelineStageFlags                writeStages;            // Of the last write, or layout transition
+        VkAccessFlags                       writeAccess;            // Not yet made available
+        VkPipelineStageFlags                readStages;             // Reads since then
+        VkPipelineStageFlags                visibleStages;          // The last write is visible to
+        VkAccessFlags                       visibleAccess;
+    };
+
+    struct Barrier
+    {
+        RenderGraphResource                 resource;
+        VkPipelineStageFlags                srcStages;
+        VkAccessFlags                       srcAccess;
+        VkPipelineStageFlags                dstStages;
+        VkAccessFlags                       dstAccess;
+        VkImageLayout                       oldLayout;
+        VkImageLayout                       newLayout;
+    };
+
+    // A transient image as allocated, kept across compiles while the graph keeps its shape
+    struct TransientImage
+    {
+        RenderGraphImageDescription         description;
+        VkImageUsageFlags                   usage;
+        uint32_t                            firstPass;
+        uint32_t                            lastPass;
+        uint32_t                            slot;                   // Into m_slots
+        VkImage                             image;
+        VkImageView                         view;
+        VkMemoryRequirements                requirements;
+    };
+
+    enum GaugeIndex
+    {
+        PassCountGauge,
+        CulledPassCountGauge,
+        BarrierCountGauge,
+        TransientBytesGauge,
+        AllocatedBytesGauge,
+        GaugeCount
+    };
+
+    // PRIVATE MEMBERS
+    //------------------------------------------------------------------------//
+    VkDevice                                m_device;
+    const VkAllocationCallbacks*            m_allocationCallbacks;
+    DeviceAllocator*                        m_allocator;
+    DeletionQueue*                          m_deletionQueue;
+    FrameProfiler*                          m_frameProfiler;
+    PFN_vkCmdPipelineBarrier2KHR            m_cmdPipelineBarrier2;
+    uint32_t                                m_gauges[GaugeCount];
+
+    std::vector<Resource>                   m_resources;
+    std::vector<Pass>                       m_passes;
+    std::vector<Access>                     m_accesses;
+    std::vector<uint32_t>                   m_schedule;             // Surviving passes in order
+    std::vector<Barrier>                    m_barriers;
+    uint32_t                                m_finalBarrier;         // Final transitions, to the end of m_barriers
+    bool                                    m_compiled;
+
+    std::vector<TransientImage>             m_transients;
+    std::vector<MemoryAllocation>           m_slots;                // Memory shared by transient images
+    RenderGraphStatistics                   m_statistics;
+
+    // Scratch reused by compile() so a graph of a size seen before does not allocate
+    std::vector<bool>                       m_live;                 // Per resource, while culling
+    std::vector<RenderGraphResource>        m_used;                 // Transient images the schedule uses
+    std::vector<uint32_t>                   m_order;                // Into m_transients, largest first
+    std::vector<RenderGraphResource>        m_occupants;            // Of one memory slot, by first use
+    std::vector<ResourceState>              m_states;               // Per resource, while planning barriers
+
+    // Reused while recording so execute() does not allocate
+    std::vector<VkImageMemoryBarrier>       m_imageBarriers;
+    std::vector<VkBufferMemoryBarrier>      m_bufferBarriers;
+    std::vector<VkImageMemoryBarrier2KHR>   m_imageBarriers2;
+    std::vector<VkBufferMemoryBarrier2KHR>  m_bufferBarriers2;
+    //------------------------------------------------------------------------//
+
+    // PRIVATE FUNCTIONS
+    //------------------------------------------------------------------------//
+    RenderGraphResource addResource(const char* name);
+    void addAccess(uint32_t pass, RenderGraphResource, RenderGraphAccess, bool reads, bool writes);
+    void cull();
+    void gatherLifetimes();
+    void allocateTransients(uint64_t retireValue);
+    void retireTransients(uint64_t retireValue);
+    void planBarriers();
+    void planAccess(ResourceState&, RenderGraphResource, VkPipelineStageFlags, VkAccessFlags access, VkAccessFlags writeAccess, VkImageLayout);
+    void recordBarriers(VkCommandBuffer, uint32_t first, uint32_t count);
+    //------------------------------------------------------------------------//
+};
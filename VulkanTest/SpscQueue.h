@@ -0,0 +1,70 @@
+#pragma once
+#include <array>                            // Fixed size ring storage
+#include <atomic>                           // Lock-free head/tail
+#include <cstddef>
+
+// Bounded single-producer single-consumer ring. One thread may call tryPush and one other thread
+// tryPop; neither ever blocks or allocates. Capacity must be a power of two.
+template <typename T, size_t Capacity>
+class SpscQueue
+{
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+public:
+    // CONSTRUCTOR
+    //------------------------------------------------------------------------//
+    SpscQueue() : m_head(0), m_cachedTail(0), m_tail(0), m_cachedHead(0) {}
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+    //------------------------------------------------------------------------//
+
+    // PUBLIC FUNCTIONS
+    //------------------------------------------------------------------------//
+    // Producer only. Returns false when the queue is full
+    bool tryPush(const T& item)
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+
+        // Only re-read the consumer's index when the cached one says the ring is full
+        if (tail - m_cachedHead == Capacity)
+        {
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+            if (tail - m_cachedHead == Capacity) return false;
+        }
+
+        m_items[tail & (Capacity - 1)] = item;
+        m_tail.store(tail + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    // Consumer only. Returns false when the queue is empty
+    bool tryPop(T& item)
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+
+        if (head == m_cachedTail)
+        {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+            if (head == m_cachedTail) return false;
+        }
+
+        item = m_items[head & (Capacity - 1)];
+        m_head.store(head + 1, std::memory_order_release);
+
+        return true;
+    }
+    //------------------------------------------------------------------------//
+
+private:
+    // PRIVATE MEMBERS
+    //------------------------------------------------------------------------//
+    // Each side's index and its cached copy of the other side's index share a cache line, so the
+    // two threads only contend when one actually has to look at the other's progress
+    alignas(64) std::atomic<size_t>         m_head;                 // Next slot to pop, written by the consumer
+    size_t                                  m_cachedTail;           // Consumer's view of m_tail
+    alignas(64) std::atomic<size_t>         m_tail;                 // Next slot to push, written by the producer
+    size_t                                  m_cachedHead;           // Producer's view of m_head
+    alignas(64) std::array<T, Capacity>     m_items;
+    //------------------------------------------------------------------------//
+};
@@ -0,0 +1,485 @@
+#include "StagingUploader.h"
+
+#include <algorithm>                        // std::min
+#include <chrono>                           // Ring stall timing
+#include <cstring>                          // memcpy
+#include <stdexcept>                        // Error reporting
+#include <string>
+
+namespace
+{
+    // Copy sources stay 16 byte aligned, which satisfies any texel block an image upload may need
+    const VkDeviceSize STAGING_ALIGNMENT = 16;
+
+    VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+StagingUploader::StagingUploader()
+{
+    m_device = VK_NULL_HANDLE;
+    m_allocationCallbacks = nullptr;
+    m_allocator = nullptr;
+    m_frameProfiler = nullptr;
+    m_waitChannel = 0;
+    m_transferQueue = VK_NULL_HANDLE;
+    m_transferFamily = 0;
+    m_graphicsFamily = 0;
+    m_commandPool = VK_NULL_HANDLE;
+    m_recording = VK_NULL_HANDLE;
+    m_timeline = VK_NULL_HANDLE;
+    m_submittedValue = 0;
+    m_completedValue = 0;
+    m_ringBuffer = VK_NULL_HANDLE;
+    m_ringSize = 0;
+    m_ringHead = 0;
+    m_ringTail = 0;
+    m_nextTicket = 1;
+    m_readyTicket = 0;
+}
+
+void StagingUploader::create(
+    VkDevice                        device,
+    const VkAllocationCallbacks*    allocationCallbacks,
+    DeviceAllocator&                allocator,
+    FrameProfiler&                  frameProfiler,
+    VkQueue                         transferQueue,
+    uint32_t                        transferFamily,
+    uint32_t                        graphicsFamily,
+    VkDeviceSize                    ringSize)
+{
+    m_device = device;
+    m_allocationCallbacks = allocationCallbacks;
+    m_allocator = &allocator;
+    m_frameProfiler = &frameProfiler;
+    m_waitChannel = frameProfiler.registerChannel("cpu.staging_wait");
+    m_transferQueue = transferQueue;
+    m_transferFamily = transferFamily;
+    m_graphicsFamily = graphicsFamily;
+    m_ringSize = ringSize;
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = m_transferFamily;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+    if (vkCreateCommandPool(m_device, &poolInfo, m_allocationCallbacks, &m_commandPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create upload command pool");
+    }
+
+    VkSemaphoreTypeCreateInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    timelineInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    timelineInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &timelineInfo;
+
+    if (vkCreateSemaphore(m_device, &semaphoreInfo, m_allocationCallbacks, &m_timeline) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create upload timeline semaphore");
+    }
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = m_ringSize;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    // Coherent, so writes through the mapping need no explicit flush before the copy
+    m_allocator->createBuffer(bufferInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_ringBuffer, m_ringAllocation);
+}
+
+void StagingUploader::destruct()
+{
+    if (m_device == VK_NULL_HANDLE) return;
+
+    waitIdle();
+
+    m_allocator->destroyBuffer(m_ringBuffer, m_ringAllocation);
+    vkDestroySemaphore(m_device, m_timeline, m_allocationCallbacks);
+
+    // Frees every command buffer allocated from it
+    vkDestroyCommandPool(m_device, m_commandPool, m_allocationCallbacks);
+
+    m_freeCommandBuffers.clear();
+    m_pendingAcquires.clear();
+    m_device = VK_NULL_HANDLE;
+}
+
+UploadTicket StagingUploader::uploadBuffer(
+    VkBuffer                dstBuffer,
+    VkDeviceSize            dstOffset,
+    const void*             data,
+    VkDeviceSize            size,
+    VkPipelineStageFlags    dstStage,
+    VkAccessFlags           dstAccess)
+{
+    // Half the ring at a time, so one chunk can always be written while the previous one copies
+    VkDeviceSize maxChunk = m_ringSize / 2;
+    UploadTicket ticket = m_nextTicket - 1;
+
+    for (VkDeviceSize done = 0; done < size; )
+    {
+        VkDeviceSize chunk = std::min(size - done, maxChunk);
+        VkDeviceSize ringOffset = allocateRange(chunk);
+
+        memcpy(static_cast<char*>(m_ringAllocation.mapped) + ringOffset, static_cast<const char*>(data) + done, static_cast<size_t>(chunk));
+
+        VkCommandBuffer commandBuffer = recordingCommandBuffer();
+
+        VkBufferCopy copyRegion{};
+        copyRegion.srcOffset = ringOffset;
+        copyRegion.dstOffset = dstOffset + done;
+        copyRegion.size = chunk;
+        vkCmdCopyBuffer(commandBuffer, m_ringBuffer, dstBuffer, 1, &copyRegion);
+
+        if (usesDedicatedQueue())
+        {
+            // Release half of the ownership transfer, recordAcquires() records the other half
+            VkBufferMemoryBarrier release{};
+            release.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            release.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            release.dstAccessMask = 0;
+            release.srcQueueFamilyIndex = m_transferFamily;
+            release.dstQueueFamilyIndex = m_graphicsFamily;
+            release.buffer = dstBuffer;
+            release.offset = dstOffset + done;
+            release.size = chunk;
+
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &release, 0, nullptr);
+        }
+
+        ticket = m_nextTicket++;
+
+        // The batch is submitted later, its value is the one after the last submitted
+        m_pendingAcquires.push_back({ dstBuffer, dstOffset + done, chunk, dstStage, dstAccess, m_submittedValue + 1, ticket, VK_NULL_HANDLE, 0 });
+
+        done += chunk;
+    }
+
+    return ticket;
+}
+
+UploadTicket StagingUploader::uploadImage(
+    VkImage                 dstImage,
+    uint32_t                mipLevel,
+    VkExtent2D              extent,
+    const void*             data,
+    VkDeviceSize            size,
+    VkPipelineStageFlags    dstStage,
+    VkAccessFlags           dstAccess)
+{
+    // Splitting a level into row ranges is possible, but nothing uploads levels that large
+    if (size > m_ringSize / 2)
+    {
+        throw std::runtime_error("Image level of " + std::to_string(size) + " bytes does not fit the staging ring");
+    }
+
+    VkDeviceSize ringOffset = allocateRange(size);
+    memcpy(static_cast<char*>(m_ringAllocation.mapped) + ringOffset, data, static_cast<size_t>(size));
+
+    VkCommandBuffer commandBuffer = recordingCommandBuffer();
+
+    VkImageMemoryBarrier toTransfer{};
+    toTransfer.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    toTransfer.srcAccessMask = 0;
+    toTransfer.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    toTransfer.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    toTransfer.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    toTransfer.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toTransfer.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toTransfer.image = dstImage;
+    toTransfer.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, mipLevel, 1, 0, 1 };
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &toTransfer);
+
+    VkBufferImageCopy copyRegion{};
+    copyRegion.bufferOffset = ringOffset;
+    copyRegion.bufferRowLength = 0;         // Tightly packed
+    copyRegion.bufferImageHeight = 0;
+    copyRegion.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mipLevel, 0, 1 };
+    copyRegion.imageOffset = { 0, 0, 0 };
+    copyRegion.imageExtent = { extent.width, extent.height, 1 };
+    vkCmdCopyBufferToImage(commandBuffer, m_ringBuffer, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
+
+    if (usesDedicatedQueue())
+    {
+        // Release half of the ownership transfer and layout change, recordAcquires() records the
+        // other half
+        VkImageMemoryBarrier release = toTransfer;
+        release.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        release.dstAccessMask = 0;
+        release.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        release.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        release.srcQueueFamilyIndex = m_transferFamily;
+        release.dstQueueFamilyIndex = m_graphicsFamily;
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &release);
+    }
+
+    UploadTicket ticket = m_nextTicket++;
+    m_pendingAcquires.push_back({ VK_NULL_HANDLE, 0, size, dstStage, dstAccess, m_submittedValue + 1, ticket, dstImage, mipLevel });
+
+    return ticket;
+}
+
+void StagingUploader::update()
+{
+    if (m_recording != VK_NULL_HANDLE) submitBatch();
+    reclaim(false);
+}
+
+void StagingUploader::recordAcquires(VkCommandBuffer commandBuffer, FrameScheduler& frameScheduler)
+{
+    if (m_pendingAcquires.empty()) return;
+
+    vkGetSemaphoreCounterValue(m_device, m_timeline, &m_completedValue);
+
+    m_barriers.clear();
+    m_imageBarriers.clear();
+    VkPipelineStageFlags dstStages = 0;
+    uint64_t waitValue = 0;
+    size_t acquired = 0;
+
+    // Only batches already complete are acquired, a frame never waits on an upload in progress
+    for (; acquired < m_pendingAcquires.size() && m_pendingAcquires[acquired].batchValue <= m_completedValue; acquired++)
+    {
+        const PendingAcquire& pending = m_pendingAcquires[acquired];
+
+        dstStages |= pending.dstStage;
+        waitValue = pending.batchValue;
+        m_readyTicket = pending.ticket;
+
+        if (pending.image != VK_NULL_HANDLE)
+        {
+            VkImageMemoryBarrier imageBarrier{};
+            imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            imageBarrier.dstAccessMask = pending.dstAccess;
+            imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            imageBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            imageBarrier.image = pending.image;
+            imageBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, pending.mipLevel, 1, 0, 1 };
+
+            if (usesDedicatedQueue())
+            {
+                imageBarrier.srcAccessMask = 0;
+                imageBarrier.srcQueueFamilyIndex = m_transferFamily;
+                imageBarrier.dstQueueFamilyIndex = m_graphicsFamily;
+            }
+            else
+            {
+                imageBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            }
+
+            m_imageBarriers.push_back(imageBarrier);
+            continue;
+        }
+
+        VkBufferMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.dstAccessMask = pending.dstAccess;
+        barrier.buffer = pending.buffer;
+        barrier.offset = pending.offset;
+        barrier.size = pending.size;
+
+        if (usesDedicatedQueue())
+        {
+            barrier.srcAccessMask = 0;              // Made available by the release
+            barrier.srcQueueFamilyIndex = m_transferFamily;
+            barrier.dstQueueFamilyIndex = m_graphicsFamily;
+        }
+        else
+        {
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        }
+
+        m_barriers.push_back(barrier);
+    }
+
+    if (acquired == 0) return;
+
+    VkPipelineStageFlags srcStage = usesDedicatedQueue() ? VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT : VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+    vkCmdPipelineBarrier(
+        commandBuffer, srcStage, dstStages, 0, 0, nullptr, 
+        static_cast<uint32_t>(m_barriers.size()), m_barriers.data(), 
+        static_cast<uint32_t>(m_imageBarriers.size()), m_imageBarriers.data()
+    );
+
+    // The release has to happen-before the acquire, which takes a semaphore between the queues.
+    // The batch is known to be complete, so the wait is free
+    frameScheduler.addWait(m_timeline, waitValue, dstStages);
+
+    m_pendingAcquires.erase(m_pendingAcquires.begin(), m_pendingAcquires.begin() + acquired);
+}
+
+bool StagingUploader::isReady(UploadTicket ticket) const
+{
+    return ticket <= m_readyTicket;
+}
+
+bool StagingUploader::hasPendingUploads() const
+{
+    return !m_pendingAcquires.empty();
+}
+
+void StagingUploader::waitIdle()
+{
+    if (m_recording != VK_NULL_HANDLE) submitBatch();
+
+    while (!m_inFlight.empty())
+    {
+        reclaim(true);
+    }
+}
+
+bool StagingUploader::usesDedicatedQueue() const
+{
+    return m_transferFamily != m_graphicsFamily;
+}
+
+VkDeviceSize StagingUploader::allocateRange(VkDeviceSize size)
+{
+    VkDeviceSize start = alignUp(m_ringHead, STAGING_ALIGNMENT);
+
+    // A range never wraps around the end of the ring, skip to the start instead
+    if (start % m_ringSize + size > m_ringSize)
+    {
+        start += m_ringSize - start % m_ringSize;
+    }
+
+    if (start + size - m_ringTail > m_ringSize)
+    {
+        FrameProfiler::Scope scope(*m_frameProfiler, m_waitChannel);
+
+        // Uploading faster than the transfer queue drains the ring. The space may well be held by
+        // the batch still being recorded, so that goes out first
+        if (m_recording != VK_NULL_HANDLE) submitBatch();
+
+        while (start + size - m_ringTail > m_ringSize)
+        {
+            if (m_inFlight.empty())
+            {
+                // Everything has been reclaimed, the ring is empty and can start over at offset 0
+                m_ringHead += (m_ringSize - m_ringHead % m_ringSize) % m_ringSize;
+                m_ringTail = m_ringHead;
+                start = m_ringHead;
+                break;
+            }
+
+            reclaim(true);
+        }
+    }
+
+    m_ringHead = start + size;
+    return start % m_ringSize;
+}
+
+VkCommandBuffer StagingUploader::recordingCommandBuffer()
+{
+    if (m_recording != VK_NULL_HANDLE) return m_recording;
+
+    if (m_freeCommandBuffers.empty())
+    {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = m_commandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer;
+        if (vkAllocateCommandBuffers(m_device, &allocInfo, &commandBuffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to allocate upload command buffer");
+        }
+
+        m_freeCommandBuffers.push_back(commandBuffer);
+    }
+
+    m_recording = m_freeCommandBuffers.back();
+    m_freeCommandBuffers.pop_back();
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if (vkBeginCommandBuffer(m_recording, &beginInfo) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to begin recording upload command buffer");
+    }
+
+    return m_recording;
+}
+
+void StagingUploader::submitBatch()
+{
+    if (vkEndCommandBuffer(m_recording) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to record upload command buffer");
+    }
+
+    uint64_t value = m_submittedValue + 1;
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &value;
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &m_recording;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &m_timeline;
+
+    if (vkQueueSubmit(m_transferQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to submit upload command buffer");
+    }
+
+    m_inFlight.push_back({ m_recording, value, m_ringHead });
+    m_submittedValue = value;
+    m_recording = VK_NULL_HANDLE;
+}
+
+void StagingUploader::reclaim(bool waitForOldest)
+{
+    if (m_inFlight.empty()) return;
+
+    if (waitForOldest && m_inFlight.front().value > m_completedValue)
+    {
+        uint64_t value = m_inFlight.front().value;
+
+        VkSemaphoreWaitInfo waitInfo{};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &m_timeline;
+        waitInfo.pValues = &value;
+
+        if (vkWaitSemaphores(m_device, &waitInfo, UINT64_MAX) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to wait on the upload timeline semaphore");
+        }
+    }
+
+    vkGetSemaphoreCounterValue(m_device, m_timeline, &m_completedValue);
+
+    while (!m_inFlight.empty() && m_inFlight.front().value <= m_completedValue)
+    {
+        m_ringTail = m_inFlight.front().ringEnd;
+
+        // Command buffers are reset implicitly when they are begun again
+        m_freeCommandBuffers.push_back(m_inFlight.front().commandBuffer);
+        m_inFlight.pop_front();
+    }
+}
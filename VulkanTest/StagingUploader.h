@@ -0,0 +1,141 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <deque>                            // Batches in flight, in submission order
+#include <vector>
+
+#include "DeviceAllocator.h"                // The staging ring's memory
+#include "FrameProfiler.h"                  // Time spent waiting for ring space
+#include "FrameScheduler.h"                 // Graphics submits wait on finished uploads
+
+// Identifies an upload. Later uploads have larger tickets, 0 is never handed out
+typedef uint64_t UploadTicket;
+
+// Moves data into device local buffers and images through a persistently mapped staging ring. Copies are
+// batched into command buffers on the transfer queue (a dedicated transfer family when the device
+// has one) and each batch signals a timeline semaphore, so uploads run alongside rendering rather
+// than in front of it.
+//
+// With a separate transfer family every uploaded range is released to the graphics family after
+// its copy. recordAcquires() then acquires the ranges whose batches have completed at the start of
+// a graphics command buffer, and makes that frame's submit wait on the batch, which by then costs
+// the GPU nothing. Until isReady() says so, an upload must not be used for drawing.
+//
+// Render thread only (or whichever single thread owns rendering at the time).
+class StagingUploader
+{
+public:
+    // CONSTRUCTOR
+    //------------------------------------------------------------------------//
+    StagingUploader();
+    //------------------------------------------------------------------------//
+
+    // PUBLIC FUNCTIONS
+    //------------------------------------------------------------------------//
+    void create(
+        VkDevice,
+        const VkAllocationCallbacks*,
+        DeviceAllocator&,
+        FrameProfiler&,
+        VkQueue transferQueue,
+        uint32_t transferFamily,
+        uint32_t graphicsFamily,
+        VkDeviceSize ringSize
+    );
+    void destruct();
+
+    // Copies size bytes of data into the ring and records their copy to dstBuffer. Uploads larger
+    // than the ring are split into chunks. dstStage/dstAccess are the graphics queue's first use
+    UploadTicket uploadBuffer(
+        VkBuffer dstBuffer,
+        VkDeviceSize dstOffset,
+        const void* data,
+        VkDeviceSize size,
+        VkPipelineStageFlags dstStage,
+        VkAccessFlags dstAccess
+    );
+
+    // Copies one mip level of a 2D image, which must fit in half the ring. The level goes from
+    // undefined to SHADER_READ_ONLY_OPTIMAL, its previous contents are discarded
+    UploadTicket uploadImage(
+        VkImage dstImage,
+        uint32_t mipLevel,
+        VkExtent2D extent,
+        const void* data,
+        VkDeviceSize size,
+        VkPipelineStageFlags dstStage,
+        VkAccessFlags dstAccess
+    );
+
+    // Once per frame: submits what was uploaded since the last call and reclaims the ring space
+    // of completed batches
+    void update();
+
+    // Outside a render pass, before anything uses the uploads
+    void recordAcquires(VkCommandBuffer, FrameScheduler&);
+
+    bool isReady(UploadTicket) const;
+    bool hasPendingUploads() const;
+    void waitIdle();
+    bool usesDedicatedQueue() const;
+    //------------------------------------------------------------------------//
+
+private:
+    struct Batch
+    {
+        VkCommandBuffer                     commandBuffer;
+        uint64_t                            value;                  // Timeline value signalled on completion
+        VkDeviceSize                        ringEnd;                // Ring position freed on completion
+    };
+
+    struct PendingAcquire
+    {
+        VkBuffer                            buffer;
+        VkDeviceSize                        offset;
+        VkDeviceSize                        size;
+        VkPipelineStageFlags                dstStage;
+        VkAccessFlags                       dstAccess;
+        uint64_t                            batchValue;
+        UploadTicket                        ticket;
+        VkImage                             image;                  // Image uploads instead of buffer/offset/size
+        uint32_t                            mipLevel;
+    };
+
+    // PRIVATE MEMBERS
+    //------------------------------------------------------------------------//
+    VkDevice                                m_device;
+    const VkAllocationCallbacks*            m_allocationCallbacks;
+    DeviceAllocator*                        m_allocator;
+    FrameProfiler*                          m_frameProfiler;
+    uint32_t                                m_waitChannel;
+    VkQueue                                 m_transferQueue;
+    uint32_t                                m_transferFamily;
+    uint32_t                                m_graphicsFamily;
+    VkCommandPool                           m_commandPool;
+    std::vector<VkCommandBuffer>            m_freeCommandBuffers;
+    VkCommandBuffer                         m_recording;            // Batch being recorded, or null
+    std::deque<Batch>                       m_inFlight;
+    VkSemaphore                             m_timeline;
+    uint64_t                                m_submittedValue;
+    uint64_t                                m_completedValue;
+    VkBuffer                                m_ringBuffer;
+    MemoryAllocation                        m_ringAllocation;
+    VkDeviceSize                            m_ringSize;
+    VkDeviceSize                            m_ringHead;             // Positions only ever grow, the
+    VkDeviceSize                            m_ringTail;             // ring offset is position % size
+    std::vector<PendingAcquire>             m_pendingAcquires;      // Batch order
+    std::vector<VkBufferMemoryBarrier>      m_barriers;             // Scratch for recordAcquires
+    std::vector<VkImageMemoryBarrier>       m_imageBarriers;        //
+    UploadTicket                            m_nextTicket;
+    UploadTicket                            m_readyTicket;          // Every ticket up to this one is ready
+    //------------------------------------------------------------------------//
+
+    // PRIVATE FUNCTIONS
+    //------------------------------------------------------------------------//
+    VkDeviceSize allocateRange(VkDeviceSize size);
+    VkCommandBuffer recordingCommandBuffer();
+    void submitBatch();
+    void reclaim(bool waitForOldest);
+    //------------------------------------------------------------------------//
+};
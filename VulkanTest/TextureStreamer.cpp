@@ -0,0 +1,497 @@
+#include "TextureStreamer.h"
+
+#include <algorithm>                        // std::max
+#include <stdexcept>                        // Error reporting
+
+#include "GlobalApplicationConstants.h"     // g_TEXTURE_* streaming limits
+
+TextureStreamer::TextureStreamer()
+{
+    m_device = VK_NULL_HANDLE;
+    m_physicalDevice = VK_NULL_HANDLE;
+    m_allocationCallbacks = nullptr;
+    m_allocator = nullptr;
+    m_uploader = nullptr;
+    m_bindlessTable = nullptr;
+    m_threadPool = nullptr;
+    m_deletionQueue = nullptr;
+    m_frameProfiler = nullptr;
+    m_mipGenerator = nullptr;
+    m_sampler = VK_NULL_HANDLE;
+    m_budget = 0;
+    m_streamedBytes = 0;
+    m_tailBytes = 0;
+    m_streamCount = 0;
+    m_evictions = 0;
+    m_frame = 0;
+    m_pendingReads = 0;
+    m_stopping = false;
+
+    for (uint32_t i = 0; i < GaugeCount; i++) m_gauges[i] = 0;
+}
+
+void TextureStreamer::create(
+    VkPhysicalDevice                physicalDevice,
+    VkDevice                        device,
+    const VkAllocationCallbacks*    allocationCallbacks,
+    DeviceAllocator&                allocator,
+    StagingUploader&                uploader,
+    BindlessTable&                  bindlessTable,
+    ThreadPool&                     threadPool,
+    DeletionQueue&                  deletionQueue,
+    FrameProfiler&                  frameProfiler,
+    MipGenerator&                   mipGenerator,
+    VkDeviceSize                    budget)
+{
+    m_physicalDevice = physicalDevice;
+    m_device = device;
+    m_allocationCallbacks = allocationCallbacks;
+    m_allocator = &allocator;
+    m_uploader = &uploader;
+    m_bindlessTable = &bindlessTable;
+    m_threadPool = &threadPool;
+    m_deletionQueue = &deletionQueue;
+    m_frameProfiler = &frameProfiler;
+    m_mipGenerator = &mipGenerator;
+    m_budget = budget;
+    m_stopping = false;
+
+    m_gauges[ResidentBytesGauge] = frameProfiler.registerGauge("textures.resident_bytes");
+    m_gauges[StreamingGauge] = frameProfiler.registerGauge("textures.streaming");
+    m_gauges[EvictionsGauge] = frameProfiler.registerGauge("textures.evictions");
+
+    // Full chains and tails are separate images sampled through separate views, so one sampler
+    // without an LOD clamp covers both
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.minLod = 0.0f;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+    if (vkCreateSampler(m_device, &samplerInfo, m_allocationCallbacks, &m_sampler) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create texture sampler");
+    }
+
+    const uint32_t white = 0xFFFFFFFF;
+
+    createImage(m_defaultTexture, VK_FORMAT_R8G8B8A8_UNORM, 1, 1, 1);
+    m_defaultTexture.lastTicket = m_uploader->uploadImage(
+        m_defaultTexture.image, 0, { 1, 1 }, &white, sizeof(white), VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT
+    );
+}
+
+void TextureStreamer::destruct()
+{
+    // Queued reads still run, but skip their copies
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_stopping = true;
+        m_readsFinished.wait(lock, [this]() { return m_pendingReads == 0; });
+        m_readLevels.clear();
+    }
+
+    for (std::unique_ptr<Texture>& texture : m_textures)
+    {
+        if (texture->mips.image != VK_NULL_HANDLE) m_mipGenerator->destroyChain(texture->mips);
+        destroyImage(texture->full);
+        destroyImage(texture->tail);
+    }
+
+    m_textures.clear();
+    destroyImage(m_defaultTexture);
+
+    if (m_sampler != VK_NULL_HANDLE) vkDestroySampler(m_device, m_sampler, m_allocationCallbacks);
+    m_sampler = VK_NULL_HANDLE;
+
+    m_streamedBytes = 0;
+    m_tailBytes = 0;
+    m_streamCount = 0;
+}
+
+TextureHandle TextureStreamer::load(const std::string& path)
+{
+    std::unique_ptr<Texture> texture = std::make_unique<Texture>();
+    texture->file.open(path);
+
+    try
+    {
+        texture->source = parseKtx2File(texture->file.data(), texture->file.size());
+    }
+    catch (const std::runtime_error& error)
+    {
+        throw std::runtime_error(path + ": " + error.what());
+    }
+
+    const Ktx2View& source = texture->source;
+
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(m_physicalDevice, source.format, &formatProperties);
+
+    const VkFormatFeatureFlags requiredFeatures = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT | VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
+
+    if ((formatProperties.optimalTilingFeatures & requiredFeatures) != requiredFeatures)
+    {
+        throw std::runtime_error(path + ": format " + std::to_string(source.format) + " cannot be sampled with linear filtering on this device");
+    }
+
+    for (uint32_t level = 0; level < source.levelCount; level++)
+    {
+        if (source.levelBytes[level] > g_STAGING_RING_SIZE / 2)
+        {
+            throw std::runtime_error(path + ": level " + std::to_string(level) + " is too large for the staging ring");
+        }
+    }
+
+    // Files that ask for it get their mips generated from level 0, where the format allows it.
+    // Otherwise level 0 is all there is
+    VkImageUsageFlags mipUsage = m_mipGenerator->imageUsage(source.format);
+    texture->generateMips = source.generateMips && std::max(source.width, source.height) > 1 && mipUsage != 0;
+    texture->mipsRecorded = false;
+
+    if (texture->generateMips)
+    {
+        texture->mipLevelCount = 1;
+        while ((std::max(source.width, source.height) >> texture->mipLevelCount) > 0) texture->mipLevelCount++;
+
+        texture->tailLevel = 0;
+        createImage(texture->tail, source.format, source.width, source.height, texture->mipLevelCount, mipUsage);
+        m_tailBytes += texture->tail.allocation.size;
+
+        // First used by the generation, on either path
+        texture->tail.lastTicket = m_uploader->uploadImage(
+            texture->tail.image,
+            0,
+            { source.width, source.height },
+            source.levels[0],
+            source.levelBytes[0],
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT
+        );
+    }
+    else
+    {
+        // The tail is every level up to the tail size, or at least the last one if the file stops short
+        texture->tailLevel = source.levelCount - 1;
+
+        while (texture->tailLevel > 0 && std::max(source.levelWidth(texture->tailLevel - 1), source.levelHeight(texture->tailLevel - 1)) <= g_TEXTURE_TAIL_SIZE)
+        {
+            texture->tailLevel--;
+        }
+
+        createImage(texture->tail, source.format, source.levelWidth(texture->tailLevel), source.levelHeight(texture->tailLevel), source.levelCount - texture->tailLevel);
+        m_tailBytes += texture->tail.allocation.size;
+
+        // A few kilobytes straight from the mapping, drawing can start with it a frame or two later
+        for (uint32_t level = texture->tailLevel; level < source.levelCount; level++)
+        {
+            texture->tail.lastTicket = m_uploader->uploadImage(
+                texture->tail.image,
+                level - texture->tailLevel,
+                { source.levelWidth(level), source.levelHeight(level) },
+                source.levels[level],
+                source.levelBytes[level],
+                VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                VK_ACCESS_SHADER_READ_BIT
+            );
+        }
+    }
+
+    texture->residency = Residency::Tail;
+    texture->uploadedLevels = 0;
+    texture->lastUsedFrame = 0;
+
+    m_textures.push_back(std::move(texture));
+
+    return static_cast<TextureHandle>(m_textures.size() - 1);
+}
+
+BindlessHandle TextureStreamer::use(TextureHandle handle)
+{
+    Texture& texture = *m_textures[handle];
+    texture.lastUsedFrame = m_frame;
+
+    if (texture.residency == Residency::Resident) return texture.full.slot;
+    if (texture.tail.slot != INVALID_BINDLESS_HANDLE) return texture.tail.slot;
+
+    return m_defaultTexture.slot;
+}
+
+void TextureStreamer::update(uint64_t retireValue)
+{
+    m_frame++;
+
+    if (m_defaultTexture.slot == INVALID_BINDLESS_HANDLE && m_uploader->isReady(m_defaultTexture.lastTicket))
+    {
+        m_defaultTexture.slot = m_bindlessTable->addTexture(m_defaultTexture.view, m_sampler);
+    }
+
+    // Images are only sampled once the frame that acquired their last level has been submitted,
+    // or generated the rest of them
+    for (std::unique_ptr<Texture>& texture : m_textures)
+    {
+        bool tailComplete = texture->generateMips ? texture->mipsRecorded : m_uploader->isReady(texture->tail.lastTicket);
+
+        if (texture->tail.slot == INVALID_BINDLESS_HANDLE && tailComplete)
+        {
+            texture->tail.slot = m_bindlessTable->addTexture(texture->tail.view, m_sampler);
+        }
+
+        if (texture->mipsRecorded && texture->mips.image != VK_NULL_HANDLE)
+        {
+            MipGenerator* mipGenerator = m_mipGenerator;
+            MipChain mips = texture->mips;
+
+            m_deletionQueue->push(retireValue, [mipGenerator, mips]() mutable {
+                mipGenerator->destroyChain(mips);
+            });
+
+            texture->mips = MipChain();
+        }
+
+        if (texture->residency == Residency::Streaming && texture->uploadedLevels == texture->source.levelCount && m_uploader->isReady(texture->full.lastTicket))
+        {
+            texture->full.slot = m_bindlessTable->addTexture(texture->full.view, m_sampler);
+            texture->residency = Residency::Resident;
+            m_streamCount--;
+        }
+    }
+
+    uploadReadLevels();
+
+    // Stream whatever was drawn last frame, as far as the budget goes
+    for (std::unique_ptr<Texture>& texture : m_textures)
+    {
+        if (m_streamCount == g_TEXTURE_MAX_STREAMS) break;
+
+        bool drawnLastFrame = texture->lastUsedFrame != 0 && texture->lastUsedFrame + 1 >= m_frame;
+
+        // With the tail starting at level 0 there is nothing more to stream
+        if (texture->residency != Residency::Tail || texture->tailLevel == 0 || texture->tail.slot == INVALID_BINDLESS_HANDLE || !drawnLastFrame) continue;
+
+        VkDeviceSize bytes = 0;
+        for (uint32_t level = 0; level < texture->source.levelCount; level++) bytes += texture->source.levelBytes[level];
+
+        if (!evictFor(bytes, retireValue)) continue;
+
+        startStreaming(*texture);
+    }
+
+    publishStatistics();
+}
+
+void TextureStreamer::recordMipGeneration(VkCommandBuffer commandBuffer)
+{
+    for (std::unique_ptr<Texture>& texture : m_textures)
+    {
+        if (!texture->generateMips || texture->mipsRecorded || !m_uploader->isReady(texture->tail.lastTicket)) continue;
+
+        const Ktx2View& source = texture->source;
+        texture->mips = m_mipGenerator->createChain(texture->tail.image, source.format, { source.width, source.height }, texture->mipLevelCount);
+
+        // Blitted until the compute pipeline has compiled
+        MipGenerationMethod method = m_mipGenerator->preferredMethod(texture->mips);
+        if (method == MipGenerationMethod::Compute && !m_mipGenerator->isReady()) method = MipGenerationMethod::Blit;
+
+        m_mipGenerator->record(
+            commandBuffer,
+            texture->mips,
+            method,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
+        );
+
+        texture->mipsRecorded = true;
+    }
+}
+
+bool TextureStreamer::isReady() const
+{
+    return m_defaultTexture.slot != INVALID_BINDLESS_HANDLE;
+}
+
+uint32_t TextureStreamer::textureCount() const
+{
+    return static_cast<uint32_t>(m_textures.size());
+}
+
+void TextureStreamer::createImage(Image& image, VkFormat format, uint32_t width, uint32_t height, uint32_t levelCount, VkImageUsageFlags extraUsage)
+{
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = format;
+    imageInfo.extent = { width, height, 1 };
+    imageInfo.mipLevels = levelCount;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | extraUsage;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    m_allocator->createImage(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image.image, image.allocation);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = image.image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = format;
+    viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, levelCount, 0, 1 };
+
+    if (vkCreateImageView(m_device, &viewInfo, m_allocationCallbacks, &image.view) != VK_SUCCESS)
+    {
+        m_allocator->destroyImage(image.image, image.allocation);
+        image.image = VK_NULL_HANDLE;
+
+        throw std::runtime_error("Failed to create texture image view");
+    }
+}
+
+void TextureStreamer::destroyImage(Image& image)
+{
+    m_bindlessTable->removeTexture(image.slot);
+    if (image.view != VK_NULL_HANDLE) vkDestroyImageView(m_device, image.view, m_allocationCallbacks);
+    if (image.image != VK_NULL_HANDLE) m_allocator->destroyImage(image.image, image.allocation);
+
+    image = Image();
+}
+
+void TextureStreamer::retireImage(Image& image, uint64_t retireValue)
+{
+    VkDevice device = m_device;
+    const VkAllocationCallbacks* allocationCallbacks = m_allocationCallbacks;
+    DeviceAllocator* allocator = m_allocator;
+    BindlessTable* bindlessTable = m_bindlessTable;
+    Image retired = image;
+
+    // Frames in flight may still sample it through its slot, which is only freed with the image
+    m_deletionQueue->push(retireValue, [device, allocationCallbacks, allocator, bindlessTable, retired]() mutable {
+        bindlessTable->removeTexture(retired.slot);
+        vkDestroyImageView(device, retired.view, allocationCallbacks);
+        allocator->destroyImage(retired.image, retired.allocation);
+    });
+
+    image = Image();
+}
+
+void TextureStreamer::startStreaming(Texture& texture)
+{
+    const Ktx2View& source = texture.source;
+
+    createImage(texture.full, source.format, source.width, source.height, source.levelCount);
+
+    texture.residency = Residency::Streaming;
+    texture.uploadedLevels = 0;
+    m_streamedBytes += texture.full.allocation.size;
+    m_streamCount++;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pendingReads++;
+    }
+
+    Texture* streamed = &texture;
+    m_threadPool->submit([this, streamed]() { readLevels(*streamed); });
+}
+
+void TextureStreamer::readLevels(Texture& texture)
+{
+    const Ktx2View& source = texture.source;
+
+    // Coarse to fine, the way they are uploaded. The copy is what pages the mapping in
+    for (uint32_t level = source.levelCount; level-- > 0;)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_stopping) break;
+        }
+
+        ReadLevel read;
+        read.texture = &texture;
+        read.level = level;
+        read.data.assign(source.levels[level], source.levels[level] + source.levelBytes[level]);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_readLevels.push_back(std::move(read));
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pendingReads--;
+    m_readsFinished.notify_all();
+}
+
+void TextureStreamer::uploadReadLevels()
+{
+    VkDeviceSize uploadedBytes = 0;
+
+    // At least one level per frame, however large, so a big level cannot stall its texture
+    while (uploadedBytes < g_TEXTURE_UPLOAD_BYTES_PER_FRAME)
+    {
+        ReadLevel read;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_readLevels.empty()) break;
+
+            read = std::move(m_readLevels.front());
+            m_readLevels.pop_front();
+        }
+
+        Texture& texture = *read.texture;
+
+        texture.full.lastTicket = m_uploader->uploadImage(
+            texture.full.image,
+            read.level,
+            { texture.source.levelWidth(read.level), texture.source.levelHeight(read.level) },
+            read.data.data(),
+            read.data.size(),
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            VK_ACCESS_SHADER_READ_BIT
+        );
+
+        texture.uploadedLevels++;
+        uploadedBytes += read.data.size();
+    }
+}
+
+bool TextureStreamer::evictFor(VkDeviceSize bytes, uint64_t retireValue)
+{
+    if (bytes > m_budget) return false;
+
+    while (m_streamedBytes + bytes > m_budget)
+    {
+        // Least recently used chain that was not drawn last frame. Streaming chains are never
+        // evicted, the budget they were started under stays theirs
+        Texture* victim = nullptr;
+
+        for (std::unique_ptr<Texture>& texture : m_textures)
+        {
+            if (texture->residency != Residency::Resident || texture->lastUsedFrame + 1 >= m_frame) continue;
+            if (victim == nullptr || texture->lastUsedFrame < victim->lastUsedFrame) victim = texture.get();
+        }
+
+        if (victim == nullptr) return false;
+
+        m_streamedBytes -= victim->full.allocation.size;
+        retireImage(victim->full, retireValue);
+        victim->residency = Residency::Tail;
+        m_evictions++;
+    }
+
+    return true;
+}
+
+void TextureStreamer::publishStatistics()
+{
+    m_frameProfiler->setGauge(m_gauges[ResidentBytesGauge], static_cast<double>(m_streamedBytes + m_tailBytes));
+    m_frameProfiler->setGauge(m_gauges[StreamingGauge], static_cast<double>(m_streamCount));
+    m_frameProfiler->setGauge(m_gauges[EvictionsGauge], static_cast<double>(m_evictions));
+}
@@ -0,0 +1,186 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <condition_variable>               // destruct() waits on outstanding reads
+#include <cstdint>
+#include <deque>                            // Levels read but not yet uploaded
+#include <memory>                           // Texture storage
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "BindlessTable.h"                  // Textures are sampled through their slot
+#include "DeletionQueue.h"                  // Evicted images retire with the frame timeline
+#include "DeviceAllocator.h"                // Image memory
+#include "FrameProfiler.h"                  // Residency gauges
+#include "Ktx2File.h"                       // Level layout of the source files
+#include "MappedFile.h"                     // Sources stay mapped while loaded
+#include "MipGenerator.h"                   // Mips of files that ask for them to be generated
+#include "StagingUploader.h"                // Level uploads
+#include "ThreadPool.h"                     // Reads happen off the render thread
+
+// Index of a texture in its TextureStreamer, stable for the streamer's lifetime
+typedef uint32_t TextureHandle;
+
+// Fragment stage push constants of textured draws, behind MeshConstants
+struct MaterialConstants
+{
+    BindlessHandle              albedo;
+};
+
+// Streams KTX2 textures in at two granularities. Loading a texture uploads its mip tail (the levels
+// no larger than g_TEXTURE_TAIL_SIZE) straight away, that stays resident and is what draws sample
+// until the full chain arrives. Textures drawn recently get their full chain streamed in: a worker
+// copies the levels out of the mapped file coarse to fine, faulting the pages in off the render
+// thread, and update() uploads at most g_TEXTURE_UPLOAD_BYTES_PER_FRAME of them per frame. Once
+// every level has been acquired the full image takes over.
+//
+// Files that ask for generated mips (a KTX2 level count of 0) have no tail to stream around. Their "tail" is the whole chain,
+// level 0 uploaded and the rest generated on the GPU by recordMipGeneration(), and it is sampled
+// once that has been submitted. Nothing more streams in for them, and like other tails they stay
+// resident outside the budget.
+//
+// Full chains count against a byte budget. When a stream does not fit, the least recently used
+// resident chains that were not drawn last frame are evicted back to their tails, retired through
+// the DeletionQueue so frames in flight can finish sampling them.
+//
+// Until isReady() a 1x1 white texture is being uploaded and nothing textured may be drawn.
+// Render thread only, apart from the reads it runs on the ThreadPool.
+class TextureStreamer
+{
+public:
+    // CONSTRUCTOR
+    //------------------------------------------------------------------------//
+    TextureStreamer();
+    //------------------------------------------------------------------------//
+
+    // PUBLIC FUNCTIONS
+    //------------------------------------------------------------------------//
+    void create(
+        VkPhysicalDevice,
+        VkDevice,
+        const VkAllocationCallbacks*,
+        DeviceAllocator&,
+        StagingUploader&,
+        BindlessTable&,
+        ThreadPool&,
+        DeletionQueue&,
+        FrameProfiler&,
+        MipGenerator&,
+        VkDeviceSize budget
+    );
+
+    // Waits for outstanding reads, the device must be idle
+    void destruct();
+
+    // Maps the file and uploads its mip tail. Throws std::runtime_error if the file cannot be read
+    // or its format cannot be sampled
+    TextureHandle load(const std::string& path);
+
+    // Slot to sample the texture through this frame: the full chain if resident, else the tail,
+    // else the default texture. Marks the texture as used
+    BindlessHandle use(TextureHandle);
+
+    // Once per frame, before StagingUploader::update() so this frame's uploads go out with it.
+    // retireValue is the timeline value of the last submitted frame
+    void update(uint64_t retireValue);
+
+    // Outside a render pass, after StagingUploader::recordAcquires(). Generates the mips of
+    // uploaded textures whose files ask for them
+    void recordMipGeneration(VkCommandBuffer);
+
+    bool isReady() const;
+    uint32_t textureCount() const;
+    //------------------------------------------------------------------------//
+
+private:
+    enum class Residency
+    {
+        Tail,                                                       // Only the mip tail
+        Streaming,                                                  // Full chain being read and uploaded
+        Resident                                                    // Full chain sampled
+    };
+
+    struct Image
+    {
+        VkImage                             image = VK_NULL_HANDLE;
+        VkImageView                         view = VK_NULL_HANDLE;
+        MemoryAllocation                    allocation;
+        BindlessHandle                      slot = INVALID_BINDLESS_HANDLE;
+        UploadTicket                        lastTicket = 0;         // Usable once this one is ready
+    };
+
+    struct Texture
+    {
+        MappedFile                          file;
+        Ktx2View                            source;
+        uint32_t                            tailLevel;              // First level of the mip tail
+        Image                               tail;
+        Image                               full;
+        bool                                generateMips;           // The file asks for mips, the tail gets them from MipGenerator
+        uint32_t                            mipLevelCount;          // Of the generated chain
+        MipChain                            mips;                   // While generating, retired once submitted
+        bool                                mipsRecorded;
+        Residency                           residency;
+        uint32_t                            uploadedLevels;         // Of the full chain while streaming
+        uint64_t                            lastUsedFrame;
+    };
+
+    // One level of a full chain, copied out of the mapping by a worker
+    struct ReadLevel
+    {
+        Texture*                            texture;
+        uint32_t                            level;
+        std::vector<unsigned char>          data;
+    };
+
+    enum GaugeIndex
+    {
+        ResidentBytesGauge,
+        StreamingGauge,
+        EvictionsGauge,
+        GaugeCount
+    };
+
+    // PRIVATE MEMBERS
+    //------------------------------------------------------------------------//
+    VkDevice                                m_device;
+    VkPhysicalDevice                        m_physicalDevice;
+    const VkAllocationCallbacks*            m_allocationCallbacks;
+    DeviceAllocator*                        m_allocator;
+    StagingUploader*                        m_uploader;
+    BindlessTable*                          m_bindlessTable;
+    ThreadPool*                             m_threadPool;
+    DeletionQueue*                          m_deletionQueue;
+    FrameProfiler*                          m_frameProfiler;
+    MipGenerator*                           m_mipGenerator;
+    uint32_t                                m_gauges[GaugeCount];
+    VkSampler                               m_sampler;
+    Image                                   m_defaultTexture;
+    std::vector<std::unique_ptr<Texture>>   m_textures;
+    VkDeviceSize                            m_budget;
+    VkDeviceSize                            m_streamedBytes;        // Full chains, streaming or resident
+    VkDeviceSize                            m_tailBytes;
+    uint32_t                                m_streamCount;
+    uint64_t                                m_evictions;
+    uint64_t                                m_frame;
+
+    std::mutex                              m_mutex;                // Guards what the workers touch
+    std::condition_variable                 m_readsFinished;
+    std::deque<ReadLevel>                   m_readLevels;
+    uint32_t                                m_pendingReads;         // Jobs submitted and not yet done
+    bool                                    m_stopping;
+    //------------------------------------------------------------------------//
+
+    // PRIVATE FUNCTIONS
+    //------------------------------------------------------------------------//
+    void createImage(Image&, VkFormat, uint32_t width, uint32_t height, uint32_t levelCount, VkImageUsageFlags extraUsage = 0);
+    void destroyImage(Image&);
+    void retireImage(Image&, uint64_t retireValue);
+    void startStreaming(Texture&);
+    void readLevels(Texture&);
+    void uploadReadLevels();
+    bool evictFor(VkDeviceSize bytes, uint64_t retireValue);
+    void publishStatistics();
+    //------------------------------------------------------------------------//
+};
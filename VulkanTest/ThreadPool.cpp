@@ -0,0 +1,107 @@
+#include "ThreadPool.h"
+
+#include <algorithm>                        // std::max
+#include <iostream>                         // Reporting failed jobs
+
+ThreadPool::ThreadPool()
+{
+    m_activeJobs = 0;
+    m_stopping = false;
+}
+
+ThreadPool::~ThreadPool()
+{
+    destruct();
+}
+
+void ThreadPool::create(uint32_t workerCount)
+{
+    if (workerCount == 0)
+    {
+        // hardware_concurrency() may report 0 when unknown
+        workerCount = std::max(1u, std::thread::hardware_concurrency()) - 1;
+        workerCount = std::max(1u, workerCount);
+    }
+
+    m_stopping = false;
+
+    for (uint32_t i = 0; i < workerCount; i++)
+    {
+        m_workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+void ThreadPool::destruct()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+
+    m_jobAvailable.notify_all();
+
+    // Workers drain whatever is still queued before they exit
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+
+    m_workers.clear();
+}
+
+void ThreadPool::submit(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back(std::move(job));
+    }
+
+    m_jobAvailable.notify_one();
+}
+
+void ThreadPool::waitIdle()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this]() { return m_jobs.empty() && m_activeJobs == 0; });
+}
+
+uint32_t ThreadPool::workerCount() const
+{
+    return static_cast<uint32_t>(m_workers.size());
+}
+
+void ThreadPool::workerLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true)
+    {
+        m_jobAvailable.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+
+        if (m_jobs.empty()) return;     // Stopping and nothing left to do
+
+        std::function<void()> job = std::move(m_jobs.front());
+        m_jobs.pop_front();
+        m_activeJobs++;
+
+        lock.unlock();
+
+        // A job has nowhere to report an exception to, so it must not take the worker down with it
+        try
+        {
+            job();
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Worker job failed: " << e.what() << std::endl;
+        }
+
+        lock.lock();
+        m_activeJobs--;
+
+        if (m_jobs.empty() && m_activeJobs == 0)
+        {
+            m_idle.notify_all();
+        }
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <condition_variable>               // Idle workers sleep on it
+#include <cstdint>
+#include <deque>                            // FIFO of pending jobs
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads running submitted jobs in FIFO order. Meant for work that must stay
+// off the render thread (pipeline compilation, file IO), not for per-frame fan out.
+class ThreadPool
+{
+public:
+    // CONSTRUCTOR/DESTRUCTOR
+    //------------------------------------------------------------------------//
+    ThreadPool();
+    ~ThreadPool();
+    //------------------------------------------------------------------------//
+
+    // PUBLIC FUNCTIONS
+    //------------------------------------------------------------------------//
+    // 0 picks one worker per hardware thread, minus one for the render thread
+    void create(uint32_t workerCount);
+    void destruct();
+    void submit(std::function<void()> job);
+    void waitIdle();
+    uint32_t workerCount() const;
+    //------------------------------------------------------------------------//
+
+private:
+    // PRIVATE MEMBERS
+    //------------------------------------------------------------------------//
+    std::vector<std::thread>                m_workers;
+    std::deque<std::function<void()>>       m_jobs;
+    std::mutex                              m_mutex;
+    std::condition_variable                 m_jobAvailable;
+    std::condition_variable                 m_idle;
+    uint32_t                                m_activeJobs;           // Jobs currently running
+    bool                                    m_stopping;
+    //------------------------------------------------------------------------//
+
+    // PRIVATE FUNCTIONS
+    //------------------------------------------------------------------------//
+    void workerLoop();
+    //------------------------------------------------------------------------//
+};
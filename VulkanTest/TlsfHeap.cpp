@@ -0,0 +1,297 @@
+#include "TlsfHeap.h"
+
+#include <stdexcept>                        // Error reporting
+
+namespace
+{
+    uint32_t highestBit(uint64_t value)
+    {
+        uint32_t bit = 0;
+        while (value >>= 1) bit++;
+        return bit;
+    }
+
+    uint32_t lowestBit(uint64_t value)
+    {
+        uint32_t bit = 0;
+        while ((value & 1) == 0) { value >>= 1; bit++; }
+        return bit;
+    }
+
+    uint64_t alignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+TlsfHeap::TlsfHeap()
+{
+    m_flBitmap = 0;
+    m_size = 0;
+    m_usedBytes = 0;
+    m_allocationCount = 0;
+
+    for (uint32_t fl = 0; fl < FL_COUNT; fl++)
+    {
+        m_slBitmaps[fl] = 0;
+        for (uint32_t sl = 0; sl < SL_COUNT; sl++) m_freeHeads[fl][sl] = INVALID_NODE;
+    }
+}
+
+void TlsfHeap::create(uint64_t size)
+{
+    if (size == 0)
+    {
+        throw std::runtime_error("TLSF heap size must be greater than zero");
+    }
+
+    m_size = size;
+
+    // The whole range starts out as one free node
+    uint32_t node = newNode();
+    m_nodes[node].offset = 0;
+    m_nodes[node].size = size;
+    insertFree(node);
+}
+
+uint32_t TlsfHeap::allocate(uint64_t size, uint64_t alignment, uint64_t& offset)
+{
+    if (size == 0) size = 1;
+    if (alignment == 0) alignment = 1;
+
+    // Any free node this large can hold the allocation whatever padding its alignment needs
+    uint32_t node = findFreeNode(size + alignment - 1);
+    if (node == INVALID_NODE) return INVALID_NODE;
+
+    removeFree(node);
+
+    uint64_t alignedOffset = alignUp(m_nodes[node].offset, alignment);
+    uint64_t padding = alignedOffset - m_nodes[node].offset;
+
+    // The node before is in use (free neighbours are always merged), so the padding becomes a
+    // free node of its own rather than being lost
+    if (padding > 0)
+    {
+        uint32_t front = newNode();
+        Node& split = m_nodes[front];
+        Node& current = m_nodes[node];
+
+        split.offset = current.offset;
+        split.size = padding;
+        split.prevPhysical = current.prevPhysical;
+        split.nextPhysical = node;
+        if (split.prevPhysical != INVALID_NODE) m_nodes[split.prevPhysical].nextPhysical = front;
+
+        current.prevPhysical = front;
+        current.offset = alignedOffset;
+        current.size -= padding;
+
+        insertFree(front);
+    }
+
+    if (m_nodes[node].size > size)
+    {
+        uint32_t back = newNode();
+        Node& split = m_nodes[back];
+        Node& current = m_nodes[node];
+
+        split.offset = current.offset + size;
+        split.size = current.size - size;
+        split.prevPhysical = node;
+        split.nextPhysical = current.nextPhysical;
+        if (split.nextPhysical != INVALID_NODE) m_nodes[split.nextPhysical].prevPhysical = back;
+
+        current.nextPhysical = back;
+        current.size = size;
+
+        insertFree(back);
+    }
+
+    m_nodes[node].free = false;
+    m_usedBytes += size;
+    m_allocationCount++;
+
+    offset = alignedOffset;
+    return node;
+}
+
+void TlsfHeap::free(uint32_t node)
+{
+    m_usedBytes -= m_nodes[node].size;
+    m_allocationCount--;
+
+    uint32_t prev = m_nodes[node].prevPhysical;
+    if (prev != INVALID_NODE && m_nodes[prev].free)
+    {
+        removeFree(prev);
+
+        m_nodes[node].offset = m_nodes[prev].offset;
+        m_nodes[node].size += m_nodes[prev].size;
+        m_nodes[node].prevPhysical = m_nodes[prev].prevPhysical;
+        if (m_nodes[node].prevPhysical != INVALID_NODE) m_nodes[m_nodes[node].prevPhysical].nextPhysical = node;
+
+        releaseNode(prev);
+    }
+
+    uint32_t next = m_nodes[node].nextPhysical;
+    if (next != INVALID_NODE && m_nodes[next].free)
+    {
+        removeFree(next);
+
+        m_nodes[node].size += m_nodes[next].size;
+        m_nodes[node].nextPhysical = m_nodes[next].nextPhysical;
+        if (m_nodes[node].nextPhysical != INVALID_NODE) m_nodes[m_nodes[node].nextPhysical].prevPhysical = node;
+
+        releaseNode(next);
+    }
+
+    insertFree(node);
+}
+
+uint64_t TlsfHeap::size() const
+{
+    return m_size;
+}
+
+uint64_t TlsfHeap::usedBytes() const
+{
+    return m_usedBytes;
+}
+
+uint32_t TlsfHeap::allocationCount() const
+{
+    return m_allocationCount;
+}
+
+uint64_t TlsfHeap::largestFreeRange() const
+{
+    if (m_flBitmap == 0) return 0;
+
+    // The largest range is somewhere in the highest non-empty bin
+    uint32_t fl = highestBit(m_flBitmap);
+    uint32_t sl = highestBit(m_slBitmaps[fl]);
+    uint64_t largest = 0;
+
+    for (uint32_t node = m_freeHeads[fl][sl]; node != INVALID_NODE; node = m_nodes[node].nextFree)
+    {
+        if (m_nodes[node].size > largest) largest = m_nodes[node].size;
+    }
+
+    return largest;
+}
+
+bool TlsfHeap::isEmpty() const
+{
+    return m_allocationCount == 0;
+}
+
+void TlsfHeap::mapping(uint64_t size, uint32_t& fl, uint32_t& sl)
+{
+    if (size < SMALL_SIZE)
+    {
+        fl = 0;
+        sl = static_cast<uint32_t>(size / (SMALL_SIZE / SL_COUNT));
+        return;
+    }
+
+    uint32_t msb = highestBit(size);
+    sl = static_cast<uint32_t>(size >> (msb - SL_LOG2)) ^ SL_COUNT;
+    fl = msb - FL_SHIFT + 1;
+}
+
+uint32_t TlsfHeap::findFreeNode(uint64_t size) const
+{
+    // Round up to the start of the next bin, so every node in the bin found is large enough
+    if (size < SMALL_SIZE)
+    {
+        size = alignUp(size, SMALL_SIZE / SL_COUNT);
+    }
+    else
+    {
+        size += (1ull << (highestBit(size) - SL_LOG2)) - 1;
+    }
+
+    uint32_t fl, sl;
+    mapping(size, fl, sl);
+
+    uint32_t slMap = sl < SL_COUNT ? m_slBitmaps[fl] & (~0u << sl) : 0;
+
+    if (slMap == 0)
+    {
+        // Nothing in this power of two, take the smallest bin of the next non-empty one
+        uint64_t flMap = fl + 1 < 64 ? m_flBitmap & (~0ull << (fl + 1)) : 0;
+        if (flMap == 0) return INVALID_NODE;
+
+        fl = lowestBit(flMap);
+        slMap = m_slBitmaps[fl];
+    }
+
+    return m_freeHeads[fl][lowestBit(slMap)];
+}
+
+uint32_t TlsfHeap::newNode()
+{
+    uint32_t node;
+
+    if (!m_unusedNodes.empty())
+    {
+        node = m_unusedNodes.back();
+        m_unusedNodes.pop_back();
+    }
+    else
+    {
+        node = static_cast<uint32_t>(m_nodes.size());
+        m_nodes.emplace_back();
+    }
+
+    m_nodes[node] = { 0, 0, INVALID_NODE, INVALID_NODE, INVALID_NODE, INVALID_NODE, false };
+    return node;
+}
+
+void TlsfHeap::releaseNode(uint32_t node)
+{
+    m_unusedNodes.push_back(node);
+}
+
+void TlsfHeap::insertFree(uint32_t node)
+{
+    uint32_t fl, sl;
+    mapping(m_nodes[node].size, fl, sl);
+
+    uint32_t head = m_freeHeads[fl][sl];
+
+    m_nodes[node].free = true;
+    m_nodes[node].prevFree = INVALID_NODE;
+    m_nodes[node].nextFree = head;
+    if (head != INVALID_NODE) m_nodes[head].prevFree = node;
+
+    m_freeHeads[fl][sl] = node;
+    m_slBitmaps[fl] |= 1u << sl;
+    m_flBitmap |= 1ull << fl;
+}
+
+void TlsfHeap::removeFree(uint32_t node)
+{
+    uint32_t fl, sl;
+    mapping(m_nodes[node].size, fl, sl);
+
+    Node& current = m_nodes[node];
+
+    if (current.prevFree != INVALID_NODE) m_nodes[current.prevFree].nextFree = current.nextFree;
+    if (current.nextFree != INVALID_NODE) m_nodes[current.nextFree].prevFree = current.prevFree;
+
+    if (m_freeHeads[fl][sl] == node)
+    {
+        m_freeHeads[fl][sl] = current.nextFree;
+
+        if (current.nextFree == INVALID_NODE)
+        {
+            m_slBitmaps[fl] &= ~(1u << sl);
+            if (m_slBitmaps[fl] == 0) m_flBitmap &= ~(1ull << fl);
+        }
+    }
+
+    current.free = false;
+    current.prevFree = INVALID_NODE;
+    current.nextFree = INVALID_NODE;
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Two-level segregated fit allocator over an abstract range [0, size). It never touches the memory
+// it manages, all bookkeeping lives in a node array on the side, so it works for device memory the
+// CPU cannot see. Allocation and free are O(1): free ranges are binned by size class (a power of
+// two, split into 32 linear steps), and two bitmaps find the first non-empty bin that is
+// guaranteed to fit. Neighbouring free ranges are merged on free.
+//
+// Not thread safe, the owner locks.
+class TlsfHeap
+{
+public:
+    static const uint32_t INVALID_NODE = UINT32_MAX;
+
+    // CONSTRUCTOR
+    //------------------------------------------------------------------------//
+    TlsfHeap();
+    //------------------------------------------------------------------------//
+
+    // PUBLIC FUNCTIONS
+    //------------------------------------------------------------------------//
+    void create(uint64_t size);
+
+    // Returns the node identifying the range, or INVALID_NODE when nothing large enough is free.
+    // alignment must be a power of two
+    uint32_t allocate(uint64_t size, uint64_t alignment, uint64_t& offset);
+    void free(uint32_t node);
+
+    uint64_t size() const;
+    uint64_t usedBytes() const;
+    uint32_t allocationCount() const;
+    uint64_t largestFreeRange() const;
+    bool isEmpty() const;
+    //------------------------------------------------------------------------//
+
+private:
+    static const uint32_t SL_LOG2 = 5;                          // 32 second level bins per power of two
+    static const uint32_t SL_COUNT = 1u << SL_LOG2;
+    static const uint32_t FL_SHIFT = SL_LOG2 + 3;               // Below 256 bytes bins are 8 bytes apart
+    static const uint64_t SMALL_SIZE = 1ull << FL_SHIFT;
+    static const uint32_t FL_COUNT = 64 - FL_SHIFT + 1;
+
+    struct Node
+    {
+        uint64_t    offset;
+        uint64_t    size;
+        uint32_t    prevPhysical;       // Neighbouring ranges by address
+        uint32_t    nextPhysical;
+        uint32_t    prevFree;           // Neighbours in the bin's free list, free nodes only
+        uint32_t    nextFree;
+        bool        free;
+    };
+
+    // PRIVATE MEMBERS
+    //------------------------------------------------------------------------//
+    std::vector<Node>                       m_nodes;
+    std::vector<uint32_t>                   m_unusedNodes;          // Recycled m_nodes entries
+    uint64_t                                m_flBitmap;             // Bit per first level with a non-empty bin
+    uint32_t                                m_slBitmaps[FL_COUNT];  // Bit per non-empty second level bin
+    uint32_t                                m_freeHeads[FL_COUNT][SL_COUNT];
+    uint64_t                                m_size;
+    uint64_t                                m_usedBytes;
+    uint32_t                                m_allocationCount;
+    //------------------------------------------------------------------------//
+
+    // PRIVATE FUNCTIONS
+    //------------------------------------------------------------------------//
+    static void mapping(uint64_t size, uint32_t& fl, uint32_t& sl);
+    uint32_t findFreeNode(uint64_t size) const;
+    uint32_t newNode();
+    void releaseNode(uint32_t);
+    void insertFree(uint32_t);
+    void removeFree(uint32_t);
+    //------------------------------------------------------------------------//
+};
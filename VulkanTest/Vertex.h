@@ -0,0 +1,152 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cstddef>                          // offsetof
+#include <cstdint>
+#include <vector>
+
+// Vertex layouts a pipeline can consume. None pipelines generate their positions in the shader
+enum class VertexFormat : uint32_t
+{
+    None,
+    PositionColor,              // Vertex below, one interleaved binding
+    PositionColorInstanced      // Vertex at binding 0, then one binding per InstanceStream
+};
+
+// How the mesh's own vertices at binding 0 are stored, whatever the format adds per instance
+enum class VertexEncoding : uint32_t
+{
+    Float,                      // Vertex, 20 bytes
+    Quantized                   // PackedVertex, 8 bytes
+};
+
+// Per-instance attributes of PositionColorInstanced. Each is a separate, tightly packed array
+// (structure of arrays) so the CPU can update them with SIMD, and each has a binding of its own
+enum InstanceStream : uint32_t
+{
+    InstancePositionX,          // float
+    InstancePositionY,          // float
+    InstanceRotation,           // float, radians
+    InstanceColor,              // RGBA8 unorm
+    InstanceStreamCount
+};
+
+struct Vertex
+{
+    // MEMBERS
+    float       position[2];
+    float       color[3];
+
+    // FUNCTIONS
+    static VkVertexInputBindingDescription bindingDescription()
+    {
+        VkVertexInputBindingDescription binding{};
+        binding.binding = 0;
+        binding.stride = sizeof(Vertex);
+        binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+        return binding;
+    }
+
+    static std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions()
+    {
+        std::array<VkVertexInputAttributeDescription, 2> attributes{};
+
+        attributes[0].binding = 0;
+        attributes[0].location = 0;
+        attributes[0].format = VK_FORMAT_R32G32_SFLOAT;
+        attributes[0].offset = offsetof(Vertex, position);
+
+        attributes[1].binding = 0;
+        attributes[1].location = 1;
+        attributes[1].format = VK_FORMAT_R32G32B32_SFLOAT;
+        attributes[1].offset = offsetof(Vertex, color);
+
+        return attributes;
+    }
+};
+
+// Vertex compressed for bandwidth. The position is snorm16 in [-1, 1], which the vertex shader
+// multiplies by the mesh's dequantization scale (MeshConstants::positionScale), and the colour is
+// unorm8. Both formats are mandatory for vertex buffers
+struct PackedVertex
+{
+    // MEMBERS
+    int16_t     position[2];
+    uint8_t     color[4];       // Alpha is unused and pads the vertex to 8 bytes
+
+    // FUNCTIONS
+    static VkVertexInputBindingDescription bindingDescription()
+    {
+        VkVertexInputBindingDescription binding{};
+        binding.binding = 0;
+        binding.stride = sizeof(PackedVertex);
+        binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+        return binding;
+    }
+
+    static std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions()
+    {
+        std::array<VkVertexInputAttributeDescription, 2> attributes{};
+
+        attributes[0].binding = 0;
+        attributes[0].location = 0;
+        attributes[0].format = VK_FORMAT_R16G16_SNORM;
+        attributes[0].offset = offsetof(PackedVertex, position);
+
+        // The shaders read a vec3, the extra component is dropped
+        attributes[1].binding = 0;
+        attributes[1].location = 1;
+        attributes[1].format = VK_FORMAT_R8G8B8A8_UNORM;
+        attributes[1].offset = offsetof(PackedVertex, color);
+
+        return attributes;
+    }
+};
+
+static_assert(sizeof(Vertex) == 20, "Vertex is stored in mesh files as is");
+static_assert(sizeof(PackedVertex) == 8, "PackedVertex is stored in mesh files as is");
+
+// Vertex input state for a pipeline of the given format, empty for None
+struct VertexInputDescription
+{
+    // MEMBERS
+    std::vector<VkVertexInputBindingDescription>    bindings;
+    std::vector<VkVertexInputAttributeDescription>  attributes;
+
+    // FUNCTIONS
+    static VertexInputDescription of(VertexFormat format, VertexEncoding encoding)
+    {
+        VertexInputDescription description;
+        if (format == VertexFormat::None) return description;
+
+        bool quantized = encoding == VertexEncoding::Quantized;
+        auto vertexAttributes = quantized ? PackedVertex::attributeDescriptions() : Vertex::attributeDescriptions();
+        description.bindings.push_back(quantized ? PackedVertex::bindingDescription() : Vertex::bindingDescription());
+        description.attributes.assign(vertexAttributes.begin(), vertexAttributes.end());
+
+        if (format == VertexFormat::PositionColorInstanced)
+        {
+            for (uint32_t stream = 0; stream < InstanceStreamCount; stream++)
+            {
+                VkVertexInputBindingDescription binding{};
+                binding.binding = 1 + stream;
+                binding.stride = 4;
+                binding.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+                VkVertexInputAttributeDescription attribute{};
+                attribute.binding = binding.binding;
+                attribute.location = static_cast<uint32_t>(vertexAttributes.size()) + stream;
+                attribute.format = stream == InstanceColor ? VK_FORMAT_R8G8B8A8_UNORM : VK_FORMAT_R32_SFLOAT;
+                attribute.offset = 0;
+
+                description.bindings.push_back(binding);
+                description.attributes.push_back(attribute);
+            }
+        }
+
+        return description;
+    }
+};
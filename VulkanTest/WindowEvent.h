@@ -0,0 +1,16 @@
+#pragma once
+#include <cstdint>
+
+// Messages from the event (GLFW) thread to the render thread
+enum class WindowEventType : uint32_t
+{
+    Resize,                     // Framebuffer size changed, width/height hold the new size in pixels
+    Quit                        // Window is closing, the render thread should finish its frames and stop
+};
+
+struct WindowEvent
+{
+    WindowEventType     type;
+    uint32_t            width;
+    uint32_t            height;
+};
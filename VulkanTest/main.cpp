@@ -11,13 +11,21 @@
 
 #include "HelloTriangleApplication.h"       // The Vulkan Application
 #include "GlobalApplicationConstants.h"     // const uint32_t WINDOW_HEIGHT etc
+#include "ApplicationSettings.h"            // Command line configuration
 
-int main() 
+int main(int argc, char** argv) 
 {
-    HelloTriangleApplication app;
-
     try 
     {
+        ApplicationSettings settings = ApplicationSettings::fromCommandLine(argc, argv);
+
+        if (settings.showHelp)
+        {
+            ApplicationSettings::printUsage();
+            return EXIT_SUCCESS;
+        }
+
+        HelloTriangleApplication app(settings);
         app.run();
     }
     catch (const std::exception& e) 
@@ -1,3 +1,13 @@
 C:\VulkanSDK\1.2.198.1\Bin\glslc.exe shader.vert -o vert.spv
 C:\VulkanSDK\1.2.198.1\Bin\glslc.exe shader.frag -o frag.spv
+C:\VulkanSDK\1.2.198.1\Bin\glslc.exe --target-env=vulkan1.2 draw_list.vert -o draw_list.spv
+C:\VulkanSDK\1.2.198.1\Bin\glslc.exe --target-env=vulkan1.2 mesh.vert -o mesh.spv
+C:\VulkanSDK\1.2.198.1\Bin\glslc.exe --target-env=vulkan1.2 instanced.vert -o instanced.spv
+C:\VulkanSDK\1.2.198.1\Bin\glslc.exe --target-env=vulkan1.2 gpu_driven.vert -o gpu_driven.spv
+C:\VulkanSDK\1.2.198.1\Bin\glslc.exe --target-env=vulkan1.2 cull.comp -o cull.spv
+C:\VulkanSDK\1.2.198.1\Bin\glslc.exe --target-env=vulkan1.2 textured.frag -o textured.spv
+C:\VulkanSDK\1.2.198.1\Bin\glslc.exe --target-env=vulkan1.2 mipgen.comp -o mipgen.spv
+C:\VulkanSDK\1.2.198.1\Bin\glslc.exe --target-env=vulkan1.2 simulate_particles.comp -o simulate_particles.spv
+C:\VulkanSDK\1.2.198.1\Bin\glslc.exe --target-env=vulkan1.2 particles.vert -o particles.spv
+C:\VulkanSDK\1.2.198.1\Bin\glslc.exe --target-env=vulkan1.2 overdraw.frag -o overdraw.spv
 pause
\ No newline at end of file
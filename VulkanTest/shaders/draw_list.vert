@@ -0,0 +1,42 @@
+#version 450
+
+// One small copy of the triangle per draw, placed by the draw's push constants
+layout(push_constant) uniform DrawConstants
+{
+    vec2 offset;
+    float scale;
+    float depth;
+} draw;
+
+// Per frame data from the frame allocator
+layout(set = 0, binding = 0) uniform FrameConstants
+{
+    vec2 viewOffset;
+    float viewScale;
+    float time;
+} frame;
+
+layout(location = 0) out vec3 fragColor;
+
+// Bit identical between the depth prepass and the colour pass, whose EQUAL test relies on it
+invariant gl_Position;
+
+vec2 positions[3] = vec2[](
+    vec2(0.0, -0.5),
+    vec2(0.5, 0.5),
+    vec2(-0.5, 0.5)
+);
+
+vec3 colors[3] = vec3[](
+    vec3(1.0, 0.0, 0.0),
+    vec3(0.0, 1.0, 0.0),
+    vec3(0.0, 0.0, 1.0)
+);
+
+void main() 
+{
+    vec2 position = positions[gl_VertexIndex] * draw.scale + draw.offset;
+
+    gl_Position = vec4(position * frame.viewScale + frame.viewOffset, draw.depth, 1.0);
+    fragColor = colors[gl_VertexIndex];
+}
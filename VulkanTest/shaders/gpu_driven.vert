@@ -0,0 +1,38 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+// Draws the objects that survived culling. Each indirect draw has one instance whose
+// firstInstance is the object's index, which selects its DrawCommand from the object buffer
+layout(push_constant) uniform DrawConstants
+{
+    uint objectBuffer;                      // Bindless handle of the DrawCommands
+    layout(offset = 16) float positionScale; // MeshConstants, dequantizes snorm16 positions
+} draw;
+
+// Per frame data from the frame allocator
+layout(set = 0, binding = 0) uniform FrameConstants
+{
+    vec2 viewOffset;
+    float viewScale;
+    float time;
+} frame;
+
+// The bindless table's storage buffers, seen as DrawCommands: xy offset, z scale, w depth
+layout(set = 1, binding = 1) readonly buffer ObjectBuffer
+{
+    vec4 objects[];
+} buffers[];
+
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec3 inColor;
+
+layout(location = 0) out vec3 fragColor;
+
+void main() 
+{
+    vec4 object = buffers[draw.objectBuffer].objects[gl_InstanceIndex];
+    vec2 position = inPosition * draw.positionScale * object.z + object.xy;
+
+    gl_Position = vec4(position * frame.viewScale + frame.viewOffset, object.w, 1.0);
+    fragColor = inColor;
+}
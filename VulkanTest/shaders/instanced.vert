@@ -0,0 +1,40 @@
+#version 450
+
+// The mesh drawn once per instance. Every instance attribute is a stream of its own (structure of
+// arrays) rewritten by the CPU each frame, the push constants only supply the size
+layout(push_constant) uniform DrawConstants
+{
+    vec2 offset;
+    float scale;
+    float depth;
+    float positionScale;                    // MeshConstants, dequantizes snorm16 positions
+} draw;
+
+// Per frame data from the frame allocator
+layout(set = 0, binding = 0) uniform FrameConstants
+{
+    vec2 viewOffset;
+    float viewScale;
+    float time;
+} frame;
+
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec3 inColor;
+layout(location = 2) in float instancePositionX;
+layout(location = 3) in float instancePositionY;
+layout(location = 4) in float instanceRotation;
+layout(location = 5) in vec4 instanceColor;
+
+layout(location = 0) out vec3 fragColor;
+
+void main() 
+{
+    float s = sin(instanceRotation);
+    float c = cos(instanceRotation);
+    vec2 rotated = mat2(c, s, -s, c) * (inPosition * draw.positionScale);
+
+    vec2 position = rotated * draw.scale + vec2(instancePositionX, instancePositionY) + draw.offset;
+
+    gl_Position = vec4(position * frame.viewScale + frame.viewOffset, draw.depth, 1.0);
+    fragColor = inColor * instanceColor.rgb;
+}
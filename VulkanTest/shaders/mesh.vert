@@ -0,0 +1,38 @@
+#version 450
+
+// Same placement as draw_list.vert, but the triangle comes from the vertex buffer
+layout(push_constant) uniform DrawConstants
+{
+    vec2 offset;
+    float scale;
+    float depth;
+    float positionScale;                    // MeshConstants, dequantizes snorm16 positions
+} draw;
+
+// Per frame data from the frame allocator
+layout(set = 0, binding = 0) uniform FrameConstants
+{
+    vec2 viewOffset;
+    float viewScale;
+    float time;
+} frame;
+
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec3 inColor;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragUv;                       // Read by textured.frag only
+
+// Bit identical between the depth prepass and the colour pass, whose EQUAL test relies on it
+invariant gl_Position;
+
+void main() 
+{
+    vec2 position = inPosition * draw.positionScale * draw.scale + draw.offset;
+
+    gl_Position = vec4(position * frame.viewScale + frame.viewOffset, draw.depth, 1.0);
+    fragColor = inColor;
+
+    // Planar mapping in mesh space, one repeat of the texture across [-1, 1]
+    fragUv = inPosition * draw.positionScale * 0.5 + 0.5;
+}
@@ -0,0 +1,34 @@
+#version 450
+
+// A deliberately expensive material for the overdraw benchmark. Every fragment that survives the
+// depth test pays for a few dozen rounds of hashing, so shading cost scales with overdraw
+layout(location = 0) in vec3 fragColor;
+
+layout(location = 0) out vec4 outColor;
+
+const uint ROUNDS = 32;
+
+uint hash(uint x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+void main()
+{
+    uvec2 pixel = uvec2(gl_FragCoord.xy);
+    uint state = pixel.x * 1973u + pixel.y * 9277u;
+    float noise = 0.0;
+
+    for (uint i = 0; i < ROUNDS; i++)
+    {
+        state = hash(state + i);
+        noise += float(state & 0xffffu) / 65535.0;
+    }
+
+    outColor = vec4(fragColor * (0.75 + 0.25 * noise / float(ROUNDS)), 1.0);
+}
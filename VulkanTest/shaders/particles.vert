@@ -0,0 +1,36 @@
+#version 450
+
+// Draws the particle simulation's latest state as points, one vertex per particle, pulled from the
+// particle buffer through its bindless handle rather than bound as a vertex buffer
+layout(push_constant) uniform DrawConstants
+{
+    uint particleBuffer;                    // Bindless handle of the particles
+} draw;
+
+// Per frame data from the frame allocator
+layout(set = 0, binding = 0) uniform FrameConstants
+{
+    vec2 viewOffset;
+    float viewScale;
+    float time;
+} frame;
+
+// The bindless table's storage buffers, seen as particles: xy position, zw velocity
+layout(set = 1, binding = 1) readonly buffer ParticleBuffer
+{
+    vec4 particles[];
+} buffers[];
+
+layout(location = 0) out vec3 fragColor;
+
+void main() 
+{
+    vec4 particle = buffers[draw.particleBuffer].particles[gl_VertexIndex];
+
+    gl_Position = vec4(particle.xy * frame.viewScale + frame.viewOffset, 0.0, 1.0);
+    gl_PointSize = 1.0;
+
+    // Slow particles blue, fast ones orange
+    float speed = clamp(length(particle.zw) * 2.0, 0.0, 1.0);
+    fragColor = mix(vec3(0.1, 0.3, 1.0), vec3(1.0, 0.6, 0.1), speed);
+}
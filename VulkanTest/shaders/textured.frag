@@ -0,0 +1,20 @@
+#version 450
+
+// Mesh draws with --texture: the vertex colour modulated by a bindless texture
+layout(push_constant) uniform MaterialConstants
+{
+    layout(offset = 20) uint albedo;        // Behind the vertex stage's DrawCommand and MeshConstants
+} material;
+
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragUv;
+
+layout(location = 0) out vec4 outColor;
+
+void main() 
+{
+    // Push constants are uniform across the draw, no nonuniformEXT needed
+    outColor = vec4(fragColor, 1.0) * texture(textures[material.albedo], fragUv);
+}